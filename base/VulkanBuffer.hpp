@@ -14,6 +14,7 @@
 
 #include "vulkan/vulkan.h"
 #include "VulkanTools.h"
+#include "VulkanMemoryAllocator.hpp"
 
 namespace vks
 {	
@@ -35,6 +36,10 @@ namespace vks
 		VkBufferUsageFlags usageFlags;
 		/** @brief Memory propertys flags to be filled by external source at buffer creation (to query at some later point) */
 		VkMemoryPropertyFlags memoryPropertyFlags;
+		/** @brief Allocator the buffer's memory has been sub-allocated from (null if memory is owned by the buffer) */
+		vks::MemoryAllocator *allocator = nullptr;
+		/** @brief Sub-allocated memory range, memory is shared with other resources if allocator is set */
+		vks::Allocation allocation;
 
 		/** 
 		* Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
@@ -46,6 +51,16 @@ namespace vks
 		*/
 		VkResult map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0)
 		{
+			if (allocator)
+			{
+				// Sub-allocated host visible memory is persistently mapped by the allocator
+				if (!allocation.mapped)
+				{
+					return VK_ERROR_MEMORY_MAP_FAILED;
+				}
+				mapped = static_cast<char*>(allocation.mapped) + offset;
+				return VK_SUCCESS;
+			}
 			return vkMapMemory(device, memory, offset, size, 0, &mapped);
 		}
 
@@ -58,7 +73,10 @@ namespace vks
 		{
 			if (mapped)
 			{
-				vkUnmapMemory(device, memory);
+				if (!allocator)
+				{
+					vkUnmapMemory(device, memory);
+				}
 				mapped = nullptr;
 			}
 		}
@@ -72,7 +90,7 @@ namespace vks
 		*/
 		VkResult bind(VkDeviceSize offset = 0)
 		{
-			return vkBindBufferMemory(device, buffer, memory, offset);
+			return vkBindBufferMemory(device, buffer, memory, allocation.offset + offset);
 		}
 
 		/**
@@ -117,8 +135,8 @@ namespace vks
 			VkMappedMemoryRange mappedRange = {};
 			mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
 			mappedRange.memory = memory;
-			mappedRange.offset = offset;
-			mappedRange.size = size;
+			mappedRange.offset = allocation.offset + offset;
+			mappedRange.size = ((size == VK_WHOLE_SIZE) && allocator) ? allocation.size - offset : size;
 			return vkFlushMappedMemoryRanges(device, 1, &mappedRange);
 		}
 
@@ -137,8 +155,8 @@ namespace vks
 			VkMappedMemoryRange mappedRange = {};
 			mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
 			mappedRange.memory = memory;
-			mappedRange.offset = offset;
-			mappedRange.size = size;
+			mappedRange.offset = allocation.offset + offset;
+			mappedRange.size = ((size == VK_WHOLE_SIZE) && allocator) ? allocation.size - offset : size;
 			return vkInvalidateMappedMemoryRanges(device, 1, &mappedRange);
 		}
 
@@ -151,10 +169,18 @@ namespace vks
 			{
 				vkDestroyBuffer(device, buffer, nullptr);
 			}
-			if (memory)
+			if (allocator)
+			{
+				allocator->free(allocation);
+				allocator = nullptr;
+			}
+			else if (memory)
 			{
 				vkFreeMemory(device, memory, nullptr);
 			}
+			buffer = VK_NULL_HANDLE;
+			memory = VK_NULL_HANDLE;
+			mapped = nullptr;
 		}
 
 	};
@@ -16,9 +16,12 @@
 #include "vulkan/vulkan.h"
 #include "VulkanTools.h"
 #include "VulkanBuffer.hpp"
+#include "VulkanMemoryAllocator.hpp"
 
 namespace vks
 {	
+	class UploadManager;
+
 	struct VulkanDevice
 	{
 		/** @brief Physical device representation */
@@ -41,6 +44,12 @@ namespace vks
 		/** @brief Default command pool for the graphics queue family index */
 		VkCommandPool commandPool = VK_NULL_HANDLE;
 
+		/** @brief Sub-allocator used for buffers and images created by the base classes (created along with the logical device) */
+		vks::MemoryAllocator *memoryAllocator = nullptr;
+
+		/** @brief Optional upload manager used by the asset loaders to batch staging copies (owned and set up by the application, see VulkanUploadManager.hpp) */
+		vks::UploadManager *uploadManager = nullptr;
+
 		/** @brief Set to true when the debug marker extension is detected */
 		bool enableDebugMarkers = false;
 
@@ -106,6 +115,10 @@ namespace vks
 			{
 				vkDestroyCommandPool(logicalDevice, commandPool, nullptr);
 			}
+			if (memoryAllocator)
+			{
+				delete memoryAllocator;
+			}
 			if (logicalDevice)
 			{
 				vkDestroyDevice(logicalDevice, nullptr);
@@ -213,7 +226,7 @@ namespace vks
 		*
 		* @return VkResult of the device creation call
 		*/
-		VkResult createLogicalDevice(VkPhysicalDeviceFeatures enabledFeatures, std::vector<const char*> enabledExtensions, bool useSwapChain = true, VkQueueFlags requestedQueueTypes = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)
+		VkResult createLogicalDevice(VkPhysicalDeviceFeatures enabledFeatures, std::vector<const char*> enabledExtensions, bool useSwapChain = true, VkQueueFlags requestedQueueTypes = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT)
 		{			
 			// Desired queues need to be requested upon logical device creation
 			// Due to differing queue family configurations of Vulkan implementations this can be a bit tricky, especially if the application
@@ -269,7 +282,7 @@ namespace vks
 				queueFamilyIndices.transfer = getQueueFamilyIndex(VK_QUEUE_TRANSFER_BIT);
 				if ((queueFamilyIndices.transfer != queueFamilyIndices.graphics) && (queueFamilyIndices.transfer != queueFamilyIndices.compute))
 				{
-					// If compute family index differs, we need an additional queue create info for the compute queue
+					// If transfer family index differs, we need an additional queue create info for the transfer queue
 					VkDeviceQueueCreateInfo queueInfo{};
 					queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 					queueInfo.queueFamilyIndex = queueFamilyIndices.transfer;
@@ -317,6 +330,7 @@ namespace vks
 			{
 				// Create a default command pool for graphics command buffers
 				commandPool = createCommandPool(queueFamilyIndices.graphics);
+				memoryAllocator = new vks::MemoryAllocator(physicalDevice, logicalDevice);
 			}
 
 			this->enabledFeatures = enabledFeatures;
@@ -335,6 +349,8 @@ namespace vks
 		* @param data Pointer to the data that should be copied to the buffer after creation (optional, if not set, no data is copied over)
 		*
 		* @return VK_SUCCESS if buffer handle and memory have been created and (optionally passed) data has been copied
+		*
+		* @note Uses a dedicated memory allocation that is owned (and freed) by the caller
 		*/
 		VkResult createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize size, VkBuffer *buffer, VkDeviceMemory *memory, void *data = nullptr)
 		{
@@ -384,10 +400,13 @@ namespace vks
 		* @param buffer Pointer to a vk::Vulkan buffer object
 		* @param size Size of the buffer in byes
 		* @param data Pointer to the data that should be copied to the buffer after creation (optional, if not set, no data is copied over)
+		* @param strategy (Optional) Allocation strategy, use ALLOCATION_STRATEGY_LINEAR for short lived buffers like staging buffers (defaults to ALLOCATION_STRATEGY_FREE_LIST)
 		*
 		* @return VK_SUCCESS if buffer handle and memory have been created and (optionally passed) data has been copied
+		*
+		* @note The buffer's memory is sub-allocated from the device's memory allocator and may be shared with other resources, use the buffer's functions for mapping and flushing
 		*/
-		VkResult createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, vks::Buffer *buffer, VkDeviceSize size, void *data = nullptr)
+		VkResult createBuffer(VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, vks::Buffer *buffer, VkDeviceSize size, void *data = nullptr, vks::AllocationStrategy strategy = vks::ALLOCATION_STRATEGY_FREE_LIST)
 		{
 			buffer->device = logicalDevice;
 
@@ -395,17 +414,17 @@ namespace vks
 			VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo(usageFlags, size);
 			VK_CHECK_RESULT(vkCreateBuffer(logicalDevice, &bufferCreateInfo, nullptr, &buffer->buffer));
 
-			// Create the memory backing up the buffer handle
+			// Sub-allocate the memory backing up the buffer handle
 			VkMemoryRequirements memReqs;
-			VkMemoryAllocateInfo memAlloc = vks::initializers::memoryAllocateInfo();
 			vkGetBufferMemoryRequirements(logicalDevice, buffer->buffer, &memReqs);
-			memAlloc.allocationSize = memReqs.size;
 			// Find a memory type index that fits the properties of the buffer
-			memAlloc.memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags);
-			VK_CHECK_RESULT(vkAllocateMemory(logicalDevice, &memAlloc, nullptr, &buffer->memory));
+			uint32_t memoryTypeIndex = getMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags);
+			VK_CHECK_RESULT(memoryAllocator->allocate(memReqs, memoryTypeIndex, vks::ALLOCATION_RESOURCE_LINEAR, &buffer->allocation, strategy));
+			buffer->allocator = memoryAllocator;
+			buffer->memory = buffer->allocation.memory;
 
 			buffer->alignment = memReqs.alignment;
-			buffer->size = memAlloc.allocationSize;
+			buffer->size = memReqs.size;
 			buffer->usageFlags = usageFlags;
 			buffer->memoryPropertyFlags = memoryPropertyFlags;
 
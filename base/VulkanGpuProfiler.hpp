@@ -0,0 +1,307 @@
+/*
+* Vulkan GPU profiler
+*
+* Measures the GPU time of named scopes inside of command buffers using timestamp queries
+* Each command buffer slot (e.g. one per swap chain image) has its own query pool, results are read back
+* without waiting as soon as the device has made all of a slot's queries available and accumulated per scope name
+*
+* Copyright (C) 2016-2017 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cstdint>
+#include <assert.h>
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+#include "VulkanDevice.hpp"
+#include "VulkanDebug.h"
+
+namespace vks
+{
+	class GpuProfiler
+	{
+	public:
+		/** @brief Accumulated GPU times of a named scope (in ms) */
+		struct ScopeTiming
+		{
+			std::string name;
+			/** @brief Nesting depth of the scope at the time it was recorded */
+			uint32_t depth = 0;
+			double last = 0.0;
+			double min = 0.0;
+			double max = 0.0;
+			double total = 0.0;
+			uint32_t samples = 0;
+			double average() const { return (samples > 0) ? total / samples : 0.0; }
+		};
+
+		/**
+		* Writes timestamps at construction and destruction, usable inside of any command buffer recording
+		* @note Also adds a debug marker region if debug markers are active
+		*/
+		class Scope
+		{
+		private:
+			GpuProfiler &profiler;
+			VkCommandBuffer commandBuffer;
+		public:
+			Scope(GpuProfiler &profiler, VkCommandBuffer commandBuffer, const std::string &name) : profiler(profiler), commandBuffer(commandBuffer)
+			{
+				profiler.beginScope(commandBuffer, name);
+			}
+			~Scope()
+			{
+				profiler.endScope(commandBuffer);
+			}
+		};
+
+	private:
+		/** @brief Scope recorded into a slot's command buffer */
+		struct RecordedScope
+		{
+			size_t timing;
+			uint32_t query;
+		};
+
+		/** @brief Query pool and scope layout of one command buffer slot */
+		struct Slot
+		{
+			VkQueryPool queryPool = VK_NULL_HANDLE;
+			std::vector<RecordedScope> scopes;
+			uint32_t queryCount = 0;
+			/** @brief True if the slot has been submitted since its results were last read back */
+			bool pending = false;
+		};
+
+		vks::VulkanDevice *device = nullptr;
+		std::vector<Slot> slots;
+		std::vector<ScopeTiming> timings;
+		std::map<std::string, size_t> timingIndices;
+		std::vector<uint64_t> queryResults;
+		uint32_t maxScopes = 0;
+		uint64_t timestampMask = 0;
+		float timestampPeriod = 1.0f;
+
+		// Slot that is currently being recorded and stack of its open scopes
+		Slot *recordingSlot = nullptr;
+		std::vector<size_t> openScopes;
+
+		size_t getTimingIndex(const std::string &name, uint32_t depth)
+		{
+			auto it = timingIndices.find(name);
+			if (it != timingIndices.end()) {
+				return it->second;
+			}
+			ScopeTiming timing;
+			timing.name = name;
+			timing.depth = depth;
+			timings.push_back(timing);
+			timingIndices[name] = timings.size() - 1;
+			return timings.size() - 1;
+		}
+
+		// Reads back the timestamps of a slot, returns false if the results are not yet available
+		// The availability of each query is checked instead of waiting on a fence, so this also works for pre-recorded command buffers that
+		// are resubmitted every frame (their queries are reset at the start of each submission and become available again once it has finished)
+		bool readSlot(Slot &slot)
+		{
+			if (slot.queryCount == 0) {
+				return true;
+			}
+			// Each query returns the timestamp followed by its availability
+			queryResults.resize(slot.queryCount * 2);
+			VkResult result = vkGetQueryPoolResults(device->logicalDevice, slot.queryPool, 0, slot.queryCount, queryResults.size() * sizeof(uint64_t), queryResults.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+			if (result == VK_NOT_READY) {
+				return false;
+			}
+			VK_CHECK_RESULT(result);
+			for (auto& scope : slot.scopes) {
+				const uint64_t *begin = &queryResults[scope.query * 2];
+				const uint64_t *end = &queryResults[(scope.query + 1) * 2];
+				if ((begin[1] == 0) || (end[1] == 0)) {
+					return false;
+				}
+			}
+			for (auto& scope : slot.scopes) {
+				const uint64_t begin = queryResults[scope.query * 2] & timestampMask;
+				const uint64_t end = queryResults[(scope.query + 1) * 2] & timestampMask;
+				// Timestamps may wrap around if the device supports less than 64 valid bits
+				const uint64_t ticks = (end - begin) & timestampMask;
+				const double time = (double)ticks * timestampPeriod / 1000000.0;
+				ScopeTiming &timing = timings[scope.timing];
+				timing.min = (timing.samples > 0) ? std::min(timing.min, time) : time;
+				timing.max = (timing.samples > 0) ? std::max(timing.max, time) : time;
+				timing.last = time;
+				timing.total += time;
+				timing.samples++;
+			}
+			return true;
+		}
+
+	public:
+		~GpuProfiler()
+		{
+			destroy();
+		}
+
+		/**
+		* Create the query pools
+		*
+		* @param device Vulkan device to create the query pools on
+		* @param queueFamilyIndex Queue family the profiled command buffers are submitted to
+		* @param slotCount Number of command buffers that may be recorded at the same time (e.g. number of swap chain images)
+		* @param (Optional) maxScopes Maximum number of scopes per command buffer (Defaults to 32)
+		*
+		* @note If the queue family does not support timestamps, all profiler calls are no-ops
+		*/
+		void prepare(vks::VulkanDevice *device, uint32_t queueFamilyIndex, uint32_t slotCount, uint32_t maxScopes = 32)
+		{
+			destroy();
+			this->device = device;
+			this->maxScopes = maxScopes;
+			const uint32_t validBits = device->queueFamilyProperties[queueFamilyIndex].timestampValidBits;
+			if (validBits == 0) {
+				return;
+			}
+			timestampMask = (validBits >= 64) ? ~0ULL : ((1ULL << validBits) - 1);
+			timestampPeriod = device->properties.limits.timestampPeriod;
+			slots.resize(slotCount);
+			for (auto& slot : slots) {
+				VkQueryPoolCreateInfo queryPoolInfo = {};
+				queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+				queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+				queryPoolInfo.queryCount = maxScopes * 2;
+				VK_CHECK_RESULT(vkCreateQueryPool(device->logicalDevice, &queryPoolInfo, nullptr, &slot.queryPool));
+			}
+		}
+
+		/** @brief Destroy the query pools, the queries must no longer be in use by the device */
+		void destroy()
+		{
+			for (auto& slot : slots) {
+				vkDestroyQueryPool(device->logicalDevice, slot.queryPool, nullptr);
+			}
+			slots.clear();
+			recordingSlot = nullptr;
+			openScopes.clear();
+		}
+
+		/** @brief True if timestamps are supported and the query pools have been created */
+		bool supported()
+		{
+			return !slots.empty();
+		}
+
+		/**
+		* Start recording scopes for a command buffer slot, resets the slot's queries
+		* Scopes started outside of beginCommandBuffer and endCommandBuffer are not measured
+		*
+		* @param commandBuffer Command buffer to record the query reset to, must be called outside of a render pass
+		* @param slot Index of the slot, submissions have to be reported with the same index (see frameSubmitted)
+		*/
+		void beginCommandBuffer(VkCommandBuffer commandBuffer, uint32_t slot)
+		{
+			if (!supported()) {
+				return;
+			}
+			assert(slot < slots.size());
+			recordingSlot = &slots[slot];
+			recordingSlot->scopes.clear();
+			recordingSlot->queryCount = 0;
+			recordingSlot->pending = false;
+			openScopes.clear();
+			vkCmdResetQueryPool(commandBuffer, recordingSlot->queryPool, 0, maxScopes * 2);
+		}
+
+		/** @brief Stop recording scopes for the current slot, all scopes must have been ended */
+		void endCommandBuffer()
+		{
+			assert(openScopes.empty());
+			recordingSlot = nullptr;
+		}
+
+		/** @brief Start a named scope in the command buffer passed to beginCommandBuffer, prefer the RAII Scope class */
+		void beginScope(VkCommandBuffer commandBuffer, const std::string &name)
+		{
+			if (vks::debugmarker::active) {
+				vks::debugmarker::beginRegion(commandBuffer, name.c_str(), glm::vec4(1.0f));
+			}
+			if (!recordingSlot) {
+				return;
+			}
+			if (recordingSlot->queryCount + 2 > maxScopes * 2) {
+				// Out of queries, the scope is not measured
+				openScopes.push_back(SIZE_MAX);
+				return;
+			}
+			RecordedScope scope;
+			scope.timing = getTimingIndex(name, static_cast<uint32_t>(openScopes.size()));
+			scope.query = recordingSlot->queryCount;
+			recordingSlot->queryCount += 2;
+			openScopes.push_back(recordingSlot->scopes.size());
+			recordingSlot->scopes.push_back(scope);
+			vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, recordingSlot->queryPool, scope.query);
+		}
+
+		/** @brief End the last scope started with beginScope */
+		void endScope(VkCommandBuffer commandBuffer)
+		{
+			if (vks::debugmarker::active) {
+				vks::debugmarker::endRegion(commandBuffer);
+			}
+			if (!recordingSlot) {
+				return;
+			}
+			assert(!openScopes.empty());
+			const size_t index = openScopes.back();
+			openScopes.pop_back();
+			if (index != SIZE_MAX) {
+				vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, recordingSlot->queryPool, recordingSlot->scopes[index].query + 1);
+			}
+		}
+
+		/** @brief Notify the profiler that the command buffer recorded for the given slot has been submitted */
+		void frameSubmitted(uint32_t slot)
+		{
+			if (!supported() || (slot >= slots.size())) {
+				return;
+			}
+			if (!slots[slot].scopes.empty()) {
+				slots[slot].pending = true;
+			}
+		}
+
+		/** @brief Read back all results that have become available since the last call, never waits on the device */
+		void update()
+		{
+			for (auto& slot : slots) {
+				if (slot.pending && readSlot(slot)) {
+					slot.pending = false;
+				}
+			}
+		}
+
+		/** @brief Accumulated timings of all scopes, in order of their first use */
+		const std::vector<ScopeTiming>& getTimings()
+		{
+			return timings;
+		}
+
+		/** @brief Clear all accumulated timings (e.g. after a warmup phase) */
+		void resetTimings()
+		{
+			for (auto& timing : timings) {
+				timing.last = timing.min = timing.max = timing.total = 0.0;
+				timing.samples = 0;
+			}
+		}
+	};
+}
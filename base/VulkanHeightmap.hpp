@@ -13,6 +13,7 @@
 #include "vulkan/vulkan.h"
 #include "VulkanDevice.hpp"
 #include "VulkanBuffer.hpp"
+#include "VulkanUploadManager.hpp"
 
 namespace vks 
 {
@@ -192,6 +193,27 @@ namespace vks
 
 			// Generate Vulkan buffers
 
+			// Device local (target) buffer
+			device->createBuffer(
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				&vertexBuffer,
+				vertexBufferSize);
+
+			device->createBuffer(
+				VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				&indexBuffer,
+				indexBufferSize);
+
+			if (device->uploadManager)
+			{
+				// Copies are batched by the upload manager, the data is staged in its ring buffer
+				device->uploadManager->uploadBuffer(vertexBuffer.buffer, vertices, vertexBufferSize, 0, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+				device->uploadManager->complete(device->uploadManager->uploadBuffer(indexBuffer.buffer, indices, indexBufferSize, 0, VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT));
+				return;
+			}
+
 			vks::Buffer vertexStaging, indexStaging;
 
 			// Create staging buffers
@@ -200,27 +222,16 @@ namespace vks
 				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 				&vertexStaging,
 				vertexBufferSize,
-				vertices);
+				vertices,
+				vks::ALLOCATION_STRATEGY_LINEAR);
 
 			device->createBuffer(
 				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 				&indexStaging,
 				indexBufferSize,
-				indices);
-
-			// Device local (target) buffer
-			device->createBuffer(
-				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-				&vertexBuffer,
-				vertexBufferSize);
-
-			device->createBuffer(
-				VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-				&indexBuffer,
-				indexBufferSize);
+				indices,
+				vks::ALLOCATION_STRATEGY_LINEAR);
 
 			// Copy from staging buffers
 			VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
@@ -245,10 +256,8 @@ namespace vks
 
 			device->flushCommandBuffer(copyCmd, copyQueue, true);
 
-			vkDestroyBuffer(device->logicalDevice, vertexStaging.buffer, nullptr);
-			vkFreeMemory(device->logicalDevice, vertexStaging.memory, nullptr);
-			vkDestroyBuffer(device->logicalDevice, indexStaging.buffer, nullptr);
-			vkFreeMemory(device->logicalDevice, indexStaging.memory, nullptr);
+			vertexStaging.destroy();
+			indexStaging.destroy();
 		}
 	};
 }
@@ -0,0 +1,482 @@
+/*
+* Vulkan device memory allocator
+*
+* Sub-allocates buffers and images from larger device memory blocks (per memory type)
+* to keep the number of vkAllocateMemory calls low
+*
+* Copyright (C) 2016-2017 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <list>
+#include <mutex>
+#include <ostream>
+#include <iomanip>
+#include <algorithm>
+#include <assert.h>
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+
+namespace vks
+{
+	/** @brief Strategy used to place allocations inside of a memory block */
+	enum AllocationStrategy {
+		/** @brief Best fit search in a list of free ranges, freed ranges are merged with their neighbours and can be reused */
+		ALLOCATION_STRATEGY_FREE_LIST = 0,
+		/** @brief Allocations are placed one after another, memory is only reclaimed once all allocations of a block have been freed (e.g. for staging) */
+		ALLOCATION_STRATEGY_LINEAR = 1
+	};
+
+	/** @brief Kind of resource bound to an allocation, required to respect the bufferImageGranularity limit */
+	enum AllocationResourceType {
+		/** @brief Buffers and images with linear tiling */
+		ALLOCATION_RESOURCE_LINEAR = 0,
+		/** @brief Images with optimal tiling */
+		ALLOCATION_RESOURCE_OPTIMAL = 1
+	};
+
+	struct MemoryBlock;
+
+	/** @brief A range of device memory handed out by the allocator */
+	struct Allocation
+	{
+		/** @brief Device memory object the allocation is part of (shared with other allocations) */
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		/** @brief Offset of the allocation inside of the memory object (to be used for binding) */
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		uint32_t memoryTypeIndex = 0;
+		/** @brief Host pointer to the start of the allocation if the memory is host visible (memory blocks are persistently mapped) */
+		void* mapped = nullptr;
+		/** @brief Block the allocation has been taken from (internal) */
+		MemoryBlock* block = nullptr;
+	};
+
+	/** @brief Device memory object that allocations are sub-allocated from (internal) */
+	struct MemoryBlock
+	{
+		struct Range {
+			VkDeviceSize offset;
+			VkDeviceSize size;
+			bool free;
+			AllocationResourceType resourceType;
+		};
+
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		uint32_t memoryTypeIndex = 0;
+		AllocationStrategy strategy = ALLOCATION_STRATEGY_FREE_LIST;
+		/** @brief Dedicated blocks hold a single (large) allocation and are released along with it */
+		bool dedicated = false;
+		void* mapped = nullptr;
+		uint32_t allocationCount = 0;
+		VkDeviceSize usedBytes = 0;
+
+		/** @brief Ranges ordered by offset, only used by the free list strategy */
+		std::list<Range> ranges;
+		/** @brief Next free offset and type of the last allocation, only used by the linear strategy */
+		VkDeviceSize linearOffset = 0;
+		AllocationResourceType linearLastType = ALLOCATION_RESOURCE_LINEAR;
+
+		static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (alignment > 1) ? ((value + alignment - 1) / alignment) * alignment : value;
+		}
+
+		/** @brief Returns true if the last byte of resource A and the first byte of resource B share the same "page" of size granularity */
+		static bool onSamePage(VkDeviceSize offsetA, VkDeviceSize sizeA, VkDeviceSize offsetB, VkDeviceSize granularity)
+		{
+			VkDeviceSize endA = offsetA + sizeA - 1;
+			return (endA & ~(granularity - 1)) == (offsetB & ~(granularity - 1));
+		}
+
+		/** @brief Try to place an allocation inside of this block, returns false if it doesn't fit */
+		bool allocate(VkDeviceSize allocSize, VkDeviceSize alignment, AllocationResourceType resourceType, VkDeviceSize granularity, VkDeviceSize *offset)
+		{
+			if (strategy == ALLOCATION_STRATEGY_LINEAR) {
+				VkDeviceSize candidate = alignUp(linearOffset, alignment);
+				if ((allocationCount > 0) && (linearLastType != resourceType) && onSamePage(0, linearOffset, candidate, granularity)) {
+					candidate = alignUp(candidate, granularity);
+				}
+				if (candidate + allocSize > size) {
+					return false;
+				}
+				*offset = candidate;
+				linearOffset = candidate + allocSize;
+				linearLastType = resourceType;
+				allocationCount++;
+				usedBytes += allocSize;
+				return true;
+			}
+
+			// Best fit search over all free ranges
+			auto best = ranges.end();
+			VkDeviceSize bestOffset = 0;
+			for (auto it = ranges.begin(); it != ranges.end(); it++) {
+				if (!it->free || it->size < allocSize) {
+					continue;
+				}
+				VkDeviceSize candidate = alignUp(it->offset, alignment);
+				// Previous range is in use by a resource of a different kind, so keep them on separate pages
+				if (it != ranges.begin()) {
+					auto prev = std::prev(it);
+					if ((prev->resourceType != resourceType) && onSamePage(prev->offset, prev->size, candidate, granularity)) {
+						candidate = alignUp(candidate, granularity);
+					}
+				}
+				if (candidate + allocSize > it->offset + it->size) {
+					continue;
+				}
+				// Same for the next range in use
+				auto next = std::next(it);
+				if ((next != ranges.end()) && (next->resourceType != resourceType) && onSamePage(candidate, allocSize, next->offset, granularity)) {
+					continue;
+				}
+				if ((best == ranges.end()) || (it->size < best->size)) {
+					best = it;
+					bestOffset = candidate;
+				}
+			}
+
+			if (best == ranges.end()) {
+				return false;
+			}
+
+			// Split the free range into (optional) padding, the allocation and the (optional) remainder
+			Range remainder = { bestOffset + allocSize, (best->offset + best->size) - (bestOffset + allocSize), true, ALLOCATION_RESOURCE_LINEAR };
+			if (bestOffset > best->offset) {
+				ranges.insert(best, { best->offset, bestOffset - best->offset, true, ALLOCATION_RESOURCE_LINEAR });
+			}
+			best->offset = bestOffset;
+			best->size = allocSize;
+			best->free = false;
+			best->resourceType = resourceType;
+			if (remainder.size > 0) {
+				ranges.insert(std::next(best), remainder);
+			}
+
+			*offset = bestOffset;
+			allocationCount++;
+			usedBytes += allocSize;
+			return true;
+		}
+
+		/** @brief Release the allocation starting at the given offset */
+		void free(VkDeviceSize offset, VkDeviceSize allocSize)
+		{
+			assert(allocationCount > 0);
+			allocationCount--;
+			usedBytes -= allocSize;
+
+			if (strategy == ALLOCATION_STRATEGY_LINEAR) {
+				// Linear blocks are reset once the last allocation has been freed
+				if (allocationCount == 0) {
+					linearOffset = 0;
+				}
+				return;
+			}
+
+			auto it = std::find_if(ranges.begin(), ranges.end(), [offset](const Range &range) { return range.offset == offset; });
+			assert(it != ranges.end() && !it->free);
+			it->free = true;
+			it->resourceType = ALLOCATION_RESOURCE_LINEAR;
+			// Merge with free neighbours
+			auto next = std::next(it);
+			if ((next != ranges.end()) && next->free) {
+				it->size += next->size;
+				ranges.erase(next);
+			}
+			if (it != ranges.begin()) {
+				auto prev = std::prev(it);
+				if (prev->free) {
+					prev->size += it->size;
+					ranges.erase(it);
+				}
+			}
+		}
+
+		/** @brief Size of the largest range that could be used for a new allocation */
+		VkDeviceSize largestFreeRange() const
+		{
+			if (strategy == ALLOCATION_STRATEGY_LINEAR) {
+				return size - linearOffset;
+			}
+			VkDeviceSize largest = 0;
+			for (auto& range : ranges) {
+				if (range.free) {
+					largest = std::max(largest, range.size);
+				}
+			}
+			return largest;
+		}
+	};
+
+	/**
+	* @brief Block based device memory sub-allocator
+	*
+	* Keeps a list of memory blocks for each memory type and allocation strategy, large allocations get a dedicated block
+	* Host visible blocks are persistently mapped
+	*/
+	class MemoryAllocator
+	{
+	public:
+		/** @brief Statistics for a single memory heap */
+		struct HeapStats {
+			/** @brief Number of device memory objects allocated from this heap */
+			uint32_t blockCount = 0;
+			uint32_t allocationCount = 0;
+			/** @brief Size of all device memory objects allocated from this heap */
+			VkDeviceSize blockBytes = 0;
+			/** @brief Bytes actually used by allocations (including alignment) */
+			VkDeviceSize usedBytes = 0;
+			/** @brief Largest free range in any of the heap's blocks */
+			VkDeviceSize largestFreeRange = 0;
+			/** @brief 0.0 if all free memory is available as one range, approaching 1.0 the more it's split up */
+			float fragmentation = 0.0f;
+		};
+
+		/** @brief Default size for new memory blocks (smaller heaps use an eighth of their size) */
+		VkDeviceSize preferredBlockSize = 64 * 1024 * 1024;
+
+	private:
+		VkDevice device;
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		VkDeviceSize bufferImageGranularity;
+		VkDeviceSize nonCoherentAtomSize;
+		// Blocks per memory type and allocation strategy
+		std::vector<std::vector<MemoryBlock*>> blocks[2];
+		std::mutex mutex;
+
+		VkDeviceSize getBlockSize(uint32_t memoryTypeIndex)
+		{
+			VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+			return (heapSize <= 1024ull * 1024 * 1024) ? std::min(preferredBlockSize, heapSize / 8) : preferredBlockSize;
+		}
+
+		VkResult createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, AllocationStrategy strategy, bool dedicated, MemoryBlock **block)
+		{
+			VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
+			memAllocInfo.allocationSize = size;
+			memAllocInfo.memoryTypeIndex = memoryTypeIndex;
+			VkDeviceMemory memory;
+			VkResult result = vkAllocateMemory(device, &memAllocInfo, nullptr, &memory);
+			if (result != VK_SUCCESS) {
+				return result;
+			}
+			MemoryBlock *newBlock = new MemoryBlock();
+			newBlock->memory = memory;
+			newBlock->size = size;
+			newBlock->memoryTypeIndex = memoryTypeIndex;
+			newBlock->strategy = strategy;
+			newBlock->dedicated = dedicated;
+			newBlock->ranges.push_back({ 0, size, true, ALLOCATION_RESOURCE_LINEAR });
+			// Keep host visible memory mapped for the lifetime of the block, as a memory object can only be mapped once
+			if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+				result = vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &newBlock->mapped);
+				if (result != VK_SUCCESS) {
+					vkFreeMemory(device, memory, nullptr);
+					delete newBlock;
+					return result;
+				}
+			}
+			*block = newBlock;
+			return VK_SUCCESS;
+		}
+
+		void destroyBlock(MemoryBlock *block)
+		{
+			if (block->mapped) {
+				vkUnmapMemory(device, block->memory);
+			}
+			vkFreeMemory(device, block->memory, nullptr);
+			delete block;
+		}
+
+	public:
+		/**
+		* Create an allocator for the given logical device
+		*
+		* @param physicalDevice Physical device used to get memory properties and limits
+		* @param device Logical device to allocate memory from
+		*/
+		MemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice device)
+		{
+			this->device = device;
+			vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+			bufferImageGranularity = std::max(properties.limits.bufferImageGranularity, (VkDeviceSize)1);
+			nonCoherentAtomSize = std::max(properties.limits.nonCoherentAtomSize, (VkDeviceSize)1);
+			for (auto& strategyBlocks : blocks) {
+				strategyBlocks.resize(memoryProperties.memoryTypeCount);
+			}
+		}
+
+		/**
+		* Destructor, frees all device memory blocks
+		*
+		* @note All resources bound to memory from this allocator must have been destroyed before
+		*/
+		~MemoryAllocator()
+		{
+			for (auto& strategyBlocks : blocks) {
+				for (auto& typeBlocks : strategyBlocks) {
+					for (auto& block : typeBlocks) {
+						destroyBlock(block);
+					}
+					typeBlocks.clear();
+				}
+			}
+		}
+
+		/**
+		* Allocate memory for a resource
+		*
+		* @param memReqs Memory requirements of the resource (from vkGet*MemoryRequirements)
+		* @param memoryTypeIndex Index of the memory type to allocate from
+		* @param resourceType Linear (buffers, linear images) or optimal tiling images, used to respect bufferImageGranularity
+		* @param allocation Pointer to the allocation that is filled by this function
+		* @param strategy (Optional) Strategy used for placing the allocation (defaults to the free list)
+		*
+		* @return VkResult of the device memory allocation (VK_SUCCESS if the allocation could be placed in an existing block)
+		*/
+		VkResult allocate(const VkMemoryRequirements &memReqs, uint32_t memoryTypeIndex, AllocationResourceType resourceType, Allocation *allocation, AllocationStrategy strategy = ALLOCATION_STRATEGY_FREE_LIST)
+		{
+			assert(memoryTypeIndex < memoryProperties.memoryTypeCount);
+			std::lock_guard<std::mutex> lock(mutex);
+
+			VkDeviceSize alignment = std::max(memReqs.alignment, (VkDeviceSize)1);
+			VkDeviceSize size = memReqs.size;
+			const VkMemoryPropertyFlags propertyFlags = memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+			// Flushing and invalidating ranges of non-coherent memory requires nonCoherentAtomSize alignment
+			if ((propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+				alignment = std::max(alignment, nonCoherentAtomSize);
+				size = MemoryBlock::alignUp(size, nonCoherentAtomSize);
+			}
+
+			MemoryBlock *block = nullptr;
+			VkDeviceSize offset = 0;
+			VkDeviceSize blockSize = getBlockSize(memoryTypeIndex);
+			auto& typeBlocks = blocks[strategy][memoryTypeIndex];
+
+			if (size > blockSize / 2) {
+				// Large resources get their own memory object
+				VkResult result = createBlock(memoryTypeIndex, size, strategy, true, &block);
+				if (result != VK_SUCCESS) {
+					return result;
+				}
+				block->allocate(size, alignment, resourceType, bufferImageGranularity, &offset);
+				typeBlocks.push_back(block);
+			}
+			else {
+				for (auto& existingBlock : typeBlocks) {
+					if (!existingBlock->dedicated && existingBlock->allocate(size, alignment, resourceType, bufferImageGranularity, &offset)) {
+						block = existingBlock;
+						break;
+					}
+				}
+				if (!block) {
+					VkResult result = createBlock(memoryTypeIndex, blockSize, strategy, false, &block);
+					if (result != VK_SUCCESS) {
+						return result;
+					}
+					typeBlocks.push_back(block);
+					if (!block->allocate(size, alignment, resourceType, bufferImageGranularity, &offset)) {
+						return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+					}
+				}
+			}
+
+			allocation->memory = block->memory;
+			allocation->offset = offset;
+			allocation->size = size;
+			allocation->memoryTypeIndex = memoryTypeIndex;
+			allocation->mapped = block->mapped ? static_cast<char*>(block->mapped) + offset : nullptr;
+			allocation->block = block;
+			return VK_SUCCESS;
+		}
+
+		/**
+		* Return an allocation to the allocator
+		*
+		* @note Empty blocks are freed, except for the last non-dedicated block of a memory type (to avoid reallocations)
+		*/
+		void free(Allocation &allocation)
+		{
+			if (!allocation.block) {
+				return;
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+
+			MemoryBlock *block = allocation.block;
+			block->free(allocation.offset, allocation.size);
+			if (block->allocationCount == 0) {
+				auto& typeBlocks = blocks[block->strategy][block->memoryTypeIndex];
+				size_t sharedBlocks = std::count_if(typeBlocks.begin(), typeBlocks.end(), [](MemoryBlock *b) { return !b->dedicated; });
+				if (block->dedicated || (sharedBlocks > 1)) {
+					typeBlocks.erase(std::find(typeBlocks.begin(), typeBlocks.end(), block));
+					destroyBlock(block);
+				}
+			}
+			allocation = Allocation();
+		}
+
+		/**
+		* Get memory statistics for all memory heaps
+		*
+		* @return Vector with one entry per memory heap of the physical device
+		*/
+		std::vector<HeapStats> getStats()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			std::vector<HeapStats> stats(memoryProperties.memoryHeapCount);
+			std::vector<VkDeviceSize> freeBytes(memoryProperties.memoryHeapCount, 0);
+			for (auto& strategyBlocks : blocks) {
+				for (auto& typeBlocks : strategyBlocks) {
+					for (auto& block : typeBlocks) {
+						const uint32_t heapIndex = memoryProperties.memoryTypes[block->memoryTypeIndex].heapIndex;
+						HeapStats &heapStats = stats[heapIndex];
+						heapStats.blockCount++;
+						heapStats.allocationCount += block->allocationCount;
+						heapStats.blockBytes += block->size;
+						heapStats.usedBytes += block->usedBytes;
+						if (!block->dedicated) {
+							heapStats.largestFreeRange = std::max(heapStats.largestFreeRange, block->largestFreeRange());
+							freeBytes[heapIndex] += block->size - block->usedBytes;
+						}
+					}
+				}
+			}
+			for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+				if (freeBytes[i] > 0) {
+					stats[i].fragmentation = 1.0f - (float)stats[i].largestFreeRange / (float)freeBytes[i];
+				}
+			}
+			return stats;
+		}
+
+		/** @brief Write the statistics of all heaps that have memory allocated to the given stream */
+		void printStats(std::ostream &os)
+		{
+			std::vector<HeapStats> stats = getStats();
+			os << "Device memory allocations:" << std::endl;
+			for (uint32_t i = 0; i < stats.size(); i++) {
+				if (stats[i].blockCount == 0) {
+					continue;
+				}
+				const bool deviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+				os << "heap " << i << (deviceLocal ? " (device local)" : "") << ": "
+					<< stats[i].blockCount << " blocks, "
+					<< stats[i].allocationCount << " allocations, "
+					<< std::fixed << std::setprecision(2)
+					<< (stats[i].usedBytes / (1024.0 * 1024.0)) << " / " << (stats[i].blockBytes / (1024.0 * 1024.0)) << " MB used, "
+					<< "fragmentation " << (stats[i].fragmentation * 100.0f) << "%" << std::endl;
+			}
+		}
+	};
+}
@@ -12,6 +12,9 @@
 #include <string>
 #include <fstream>
 #include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <sys/stat.h>
 
 #include "vulkan/vulkan.h"
 
@@ -23,9 +26,13 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include "VulkanDevice.hpp"
 #include "VulkanBuffer.hpp"
+#include "VulkanUploadManager.hpp"
+#include "mappedfile.hpp"
+#include "meshoptimizer.hpp"
 
 #if defined(__ANDROID__)
 #include <android/asset_manager.h>
@@ -42,9 +49,183 @@ namespace vks
 		VERTEX_COMPONENT_TANGENT = 0x4,
 		VERTEX_COMPONENT_BITANGENT = 0x5,
 		VERTEX_COMPONENT_DUMMY_FLOAT = 0x6,
-		VERTEX_COMPONENT_DUMMY_VEC4 = 0x7
+		VERTEX_COMPONENT_DUMMY_VEC4 = 0x7,
+		// Quantized components, decoded by the vertex input stage so shaders can keep using float inputs
+		// Half float position, padded to four components (w = 1.0)
+		VERTEX_COMPONENT_POSITION_HALF = 0x8,
+		// Half float texture coordinates
+		VERTEX_COMPONENT_UV_HALF = 0x9,
+		// Signed normalized 10:10:10:2 normal, tangent and bitangent
+		VERTEX_COMPONENT_NORMAL_PACKED = 0xA,
+		VERTEX_COMPONENT_TANGENT_PACKED = 0xB,
+		VERTEX_COMPONENT_BITANGENT_PACKED = 0xC,
+		// 8 bit unsigned normalized color, padded to four components (a = 1.0)
+		VERTEX_COMPONENT_COLOR_UNORM8 = 0xD
 	} Component;
 
+	/**
+	* Source data of the vertices of a single mesh, as passed to the vertex writers
+	* Attributes missing in the mesh point to a single zero vector that is read with a stride of 0
+	*/
+	struct VertexSource {
+		const aiVector3D *positions;
+		const aiVector3D *normals;
+		const aiVector3D *texCoords;
+		const aiVector3D *tangents;
+		const aiVector3D *bitangents;
+		uint32_t texCoordStride;
+		uint32_t tangentStride;
+		aiColor3D color;
+		glm::vec3 scale;
+		glm::vec3 center;
+		glm::vec2 uvscale;
+	};
+
+	/** @brief Compile time size, format and writer of a vertex component (see StaticVertexLayout) */
+	template<Component C> struct ComponentWriter;
+
+	template<> struct ComponentWriter<VERTEX_COMPONENT_POSITION> {
+		static const uint32_t size = 3 * sizeof(float);
+		static const VkFormat format = VK_FORMAT_R32G32B32_SFLOAT;
+		static void write(unsigned char *dst, const VertexSource &src, uint32_t i)
+		{
+			const float value[3] = { src.positions[i].x * src.scale.x + src.center.x, -src.positions[i].y * src.scale.y + src.center.y, src.positions[i].z * src.scale.z + src.center.z };
+			memcpy(dst, value, size);
+		}
+	};
+
+	template<> struct ComponentWriter<VERTEX_COMPONENT_NORMAL> {
+		static const uint32_t size = 3 * sizeof(float);
+		static const VkFormat format = VK_FORMAT_R32G32B32_SFLOAT;
+		static void write(unsigned char *dst, const VertexSource &src, uint32_t i)
+		{
+			const float value[3] = { src.normals[i].x, -src.normals[i].y, src.normals[i].z };
+			memcpy(dst, value, size);
+		}
+	};
+
+	template<> struct ComponentWriter<VERTEX_COMPONENT_UV> {
+		static const uint32_t size = 2 * sizeof(float);
+		static const VkFormat format = VK_FORMAT_R32G32_SFLOAT;
+		static void write(unsigned char *dst, const VertexSource &src, uint32_t i)
+		{
+			const aiVector3D &texCoord = src.texCoords[i * src.texCoordStride];
+			const float value[2] = { texCoord.x * src.uvscale.s, texCoord.y * src.uvscale.t };
+			memcpy(dst, value, size);
+		}
+	};
+
+	template<> struct ComponentWriter<VERTEX_COMPONENT_COLOR> {
+		static const uint32_t size = 3 * sizeof(float);
+		static const VkFormat format = VK_FORMAT_R32G32B32_SFLOAT;
+		static void write(unsigned char *dst, const VertexSource &src, uint32_t)
+		{
+			const float value[3] = { src.color.r, src.color.g, src.color.b };
+			memcpy(dst, value, size);
+		}
+	};
+
+	template<> struct ComponentWriter<VERTEX_COMPONENT_TANGENT> {
+		static const uint32_t size = 3 * sizeof(float);
+		static const VkFormat format = VK_FORMAT_R32G32B32_SFLOAT;
+		static void write(unsigned char *dst, const VertexSource &src, uint32_t i)
+		{
+			memcpy(dst, &src.tangents[i * src.tangentStride], size);
+		}
+	};
+
+	template<> struct ComponentWriter<VERTEX_COMPONENT_BITANGENT> {
+		static const uint32_t size = 3 * sizeof(float);
+		static const VkFormat format = VK_FORMAT_R32G32B32_SFLOAT;
+		static void write(unsigned char *dst, const VertexSource &src, uint32_t i)
+		{
+			memcpy(dst, &src.bitangents[i * src.tangentStride], size);
+		}
+	};
+
+	// Dummy components for padding
+	template<> struct ComponentWriter<VERTEX_COMPONENT_DUMMY_FLOAT> {
+		static const uint32_t size = sizeof(float);
+		static const VkFormat format = VK_FORMAT_R32_SFLOAT;
+		static void write(unsigned char *dst, const VertexSource &, uint32_t)
+		{
+			memset(dst, 0, size);
+		}
+	};
+
+	template<> struct ComponentWriter<VERTEX_COMPONENT_DUMMY_VEC4> {
+		static const uint32_t size = 4 * sizeof(float);
+		static const VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		static void write(unsigned char *dst, const VertexSource &, uint32_t)
+		{
+			memset(dst, 0, size);
+		}
+	};
+
+	// Quantized components
+	template<> struct ComponentWriter<VERTEX_COMPONENT_POSITION_HALF> {
+		static const uint32_t size = 4 * sizeof(uint16_t);
+		static const VkFormat format = VK_FORMAT_R16G16B16A16_SFLOAT;
+		static void write(unsigned char *dst, const VertexSource &src, uint32_t i)
+		{
+			const uint64_t value = glm::packHalf4x16(glm::vec4(src.positions[i].x * src.scale.x + src.center.x, -src.positions[i].y * src.scale.y + src.center.y, src.positions[i].z * src.scale.z + src.center.z, 1.0f));
+			memcpy(dst, &value, size);
+		}
+	};
+
+	template<> struct ComponentWriter<VERTEX_COMPONENT_UV_HALF> {
+		static const uint32_t size = 2 * sizeof(uint16_t);
+		static const VkFormat format = VK_FORMAT_R16G16_SFLOAT;
+		static void write(unsigned char *dst, const VertexSource &src, uint32_t i)
+		{
+			const aiVector3D &texCoord = src.texCoords[i * src.texCoordStride];
+			const uint32_t value = glm::packHalf2x16(glm::vec2(texCoord.x * src.uvscale.s, texCoord.y * src.uvscale.t));
+			memcpy(dst, &value, size);
+		}
+	};
+
+	template<> struct ComponentWriter<VERTEX_COMPONENT_NORMAL_PACKED> {
+		static const uint32_t size = sizeof(uint32_t);
+		static const VkFormat format = VK_FORMAT_A2B10G10R10_SNORM_PACK32;
+		static void write(unsigned char *dst, const VertexSource &src, uint32_t i)
+		{
+			const uint32_t value = glm::packSnorm3x10_1x2(glm::vec4(src.normals[i].x, -src.normals[i].y, src.normals[i].z, 0.0f));
+			memcpy(dst, &value, size);
+		}
+	};
+
+	template<> struct ComponentWriter<VERTEX_COMPONENT_TANGENT_PACKED> {
+		static const uint32_t size = sizeof(uint32_t);
+		static const VkFormat format = VK_FORMAT_A2B10G10R10_SNORM_PACK32;
+		static void write(unsigned char *dst, const VertexSource &src, uint32_t i)
+		{
+			const aiVector3D &tangent = src.tangents[i * src.tangentStride];
+			const uint32_t value = glm::packSnorm3x10_1x2(glm::vec4(tangent.x, tangent.y, tangent.z, 0.0f));
+			memcpy(dst, &value, size);
+		}
+	};
+
+	template<> struct ComponentWriter<VERTEX_COMPONENT_BITANGENT_PACKED> {
+		static const uint32_t size = sizeof(uint32_t);
+		static const VkFormat format = VK_FORMAT_A2B10G10R10_SNORM_PACK32;
+		static void write(unsigned char *dst, const VertexSource &src, uint32_t i)
+		{
+			const aiVector3D &bitangent = src.bitangents[i * src.tangentStride];
+			const uint32_t value = glm::packSnorm3x10_1x2(glm::vec4(bitangent.x, bitangent.y, bitangent.z, 0.0f));
+			memcpy(dst, &value, size);
+		}
+	};
+
+	template<> struct ComponentWriter<VERTEX_COMPONENT_COLOR_UNORM8> {
+		static const uint32_t size = sizeof(uint32_t);
+		static const VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+		static void write(unsigned char *dst, const VertexSource &src, uint32_t)
+		{
+			const uint32_t value = glm::packUnorm4x8(glm::vec4(src.color.r, src.color.g, src.color.b, 1.0f));
+			memcpy(dst, &value, size);
+		}
+	};
+
 	/** @brief Stores vertex layout components for model loading and Vulkan vertex input and atribute bindings  */
 	struct VertexLayout {
 	public:
@@ -56,28 +237,228 @@ namespace vks
 			this->components = std::move(components);
 		}
 
+		/** @brief Size of a single component in bytes */
+		static uint32_t componentSize(Component component)
+		{
+			switch (component)
+			{
+			case VERTEX_COMPONENT_POSITION:
+				return ComponentWriter<VERTEX_COMPONENT_POSITION>::size;
+			case VERTEX_COMPONENT_NORMAL:
+				return ComponentWriter<VERTEX_COMPONENT_NORMAL>::size;
+			case VERTEX_COMPONENT_COLOR:
+				return ComponentWriter<VERTEX_COMPONENT_COLOR>::size;
+			case VERTEX_COMPONENT_UV:
+				return ComponentWriter<VERTEX_COMPONENT_UV>::size;
+			case VERTEX_COMPONENT_TANGENT:
+				return ComponentWriter<VERTEX_COMPONENT_TANGENT>::size;
+			case VERTEX_COMPONENT_BITANGENT:
+				return ComponentWriter<VERTEX_COMPONENT_BITANGENT>::size;
+			case VERTEX_COMPONENT_DUMMY_FLOAT:
+				return ComponentWriter<VERTEX_COMPONENT_DUMMY_FLOAT>::size;
+			case VERTEX_COMPONENT_DUMMY_VEC4:
+				return ComponentWriter<VERTEX_COMPONENT_DUMMY_VEC4>::size;
+			case VERTEX_COMPONENT_POSITION_HALF:
+				return ComponentWriter<VERTEX_COMPONENT_POSITION_HALF>::size;
+			case VERTEX_COMPONENT_UV_HALF:
+				return ComponentWriter<VERTEX_COMPONENT_UV_HALF>::size;
+			case VERTEX_COMPONENT_NORMAL_PACKED:
+				return ComponentWriter<VERTEX_COMPONENT_NORMAL_PACKED>::size;
+			case VERTEX_COMPONENT_TANGENT_PACKED:
+				return ComponentWriter<VERTEX_COMPONENT_TANGENT_PACKED>::size;
+			case VERTEX_COMPONENT_BITANGENT_PACKED:
+				return ComponentWriter<VERTEX_COMPONENT_BITANGENT_PACKED>::size;
+			case VERTEX_COMPONENT_COLOR_UNORM8:
+				return ComponentWriter<VERTEX_COMPONENT_COLOR_UNORM8>::size;
+			}
+			return 0;
+		}
+
+		/** @brief Vulkan format of a component as read by the vertex input stage */
+		static VkFormat componentFormat(Component component)
+		{
+			switch (component)
+			{
+			case VERTEX_COMPONENT_POSITION:
+				return ComponentWriter<VERTEX_COMPONENT_POSITION>::format;
+			case VERTEX_COMPONENT_NORMAL:
+				return ComponentWriter<VERTEX_COMPONENT_NORMAL>::format;
+			case VERTEX_COMPONENT_COLOR:
+				return ComponentWriter<VERTEX_COMPONENT_COLOR>::format;
+			case VERTEX_COMPONENT_UV:
+				return ComponentWriter<VERTEX_COMPONENT_UV>::format;
+			case VERTEX_COMPONENT_TANGENT:
+				return ComponentWriter<VERTEX_COMPONENT_TANGENT>::format;
+			case VERTEX_COMPONENT_BITANGENT:
+				return ComponentWriter<VERTEX_COMPONENT_BITANGENT>::format;
+			case VERTEX_COMPONENT_DUMMY_FLOAT:
+				return ComponentWriter<VERTEX_COMPONENT_DUMMY_FLOAT>::format;
+			case VERTEX_COMPONENT_DUMMY_VEC4:
+				return ComponentWriter<VERTEX_COMPONENT_DUMMY_VEC4>::format;
+			case VERTEX_COMPONENT_POSITION_HALF:
+				return ComponentWriter<VERTEX_COMPONENT_POSITION_HALF>::format;
+			case VERTEX_COMPONENT_UV_HALF:
+				return ComponentWriter<VERTEX_COMPONENT_UV_HALF>::format;
+			case VERTEX_COMPONENT_NORMAL_PACKED:
+				return ComponentWriter<VERTEX_COMPONENT_NORMAL_PACKED>::format;
+			case VERTEX_COMPONENT_TANGENT_PACKED:
+				return ComponentWriter<VERTEX_COMPONENT_TANGENT_PACKED>::format;
+			case VERTEX_COMPONENT_BITANGENT_PACKED:
+				return ComponentWriter<VERTEX_COMPONENT_BITANGENT_PACKED>::format;
+			case VERTEX_COMPONENT_COLOR_UNORM8:
+				return ComponentWriter<VERTEX_COMPONENT_COLOR_UNORM8>::format;
+			}
+			return VK_FORMAT_UNDEFINED;
+		}
+
 		uint32_t stride()
 		{
 			uint32_t res = 0;
 			for (auto& component : components)
 			{
-				switch (component)
+				res += componentSize(component);
+			}
+			return res;
+		}
+
+		/** @brief Offset of the first occurrence of a component inside of a vertex in bytes, -1 if the layout does not contain the component */
+		int32_t offsetOf(Component component)
+		{
+			uint32_t offset = 0;
+			for (auto& layoutComponent : components)
+			{
+				if (layoutComponent == component)
 				{
-				case VERTEX_COMPONENT_UV:
-					res += 2 * sizeof(float);
-					break;
-				case VERTEX_COMPONENT_DUMMY_FLOAT:
-					res += sizeof(float);
-					break;
-				case VERTEX_COMPONENT_DUMMY_VEC4:
-					res += 4 * sizeof(float);
-					break;
-				default:
-					// All components except the ones listed above are made up of 3 floats
-					res += 3 * sizeof(float);
+					return static_cast<int32_t>(offset);
 				}
+				offset += componentSize(layoutComponent);
 			}
-			return res;
+			return -1;
+		}
+
+		/**
+		* Get the vertex input attribute descriptions for this layout, one per component except for the dummy (padding) components
+		*
+		* @param binding Vertex input binding the model's vertex buffer is bound to
+		* @param (Optional) firstLocation Shader input location of the first component, following components use consecutive locations (Defaults to 0)
+		*/
+		std::vector<VkVertexInputAttributeDescription> inputAttributeDescriptions(uint32_t binding, uint32_t firstLocation = 0)
+		{
+			std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+			uint32_t offset = 0;
+			uint32_t location = firstLocation;
+			for (auto& component : components)
+			{
+				if ((component != VERTEX_COMPONENT_DUMMY_FLOAT) && (component != VERTEX_COMPONENT_DUMMY_VEC4))
+				{
+					VkVertexInputAttributeDescription attributeDescription{};
+					attributeDescription.location = location++;
+					attributeDescription.binding = binding;
+					attributeDescription.format = componentFormat(component);
+					attributeDescription.offset = offset;
+					attributeDescriptions.push_back(attributeDescription);
+				}
+				offset += componentSize(component);
+			}
+			return attributeDescriptions;
+		}
+
+		/**
+		* Check if the physical device can read all components of this layout from a vertex buffer
+		* @note The 10:10:10:2 format of the packed normals is not a required vertex buffer format
+		*/
+		bool supported(VkPhysicalDevice physicalDevice)
+		{
+			for (auto& component : components)
+			{
+				VkFormatProperties formatProperties;
+				vkGetPhysicalDeviceFormatProperties(physicalDevice, componentFormat(component), &formatProperties);
+				if (!(formatProperties.bufferFeatures & VK_FORMAT_FEATURE_VERTEX_BUFFER_BIT))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+	};
+
+	/**
+	* Vertex layout defined at compile time
+	* Stride and offsets are compile time constants and loading a model with a static layout uses a vertex writer
+	* specialized for the layout, without a per component switch
+	*
+	* Usage:
+	*	typedef vks::StaticVertexLayout<vks::VERTEX_COMPONENT_POSITION, vks::VERTEX_COMPONENT_NORMAL, vks::VERTEX_COMPONENT_UV> Layout;
+	*	model.loadFromFile(filename, Layout(), scale, vulkanDevice, queue);
+	*	vks::initializers::vertexInputBindingDescription(0, Layout::stride(), VK_VERTEX_INPUT_RATE_VERTEX);
+	*/
+	template<Component... Components> struct StaticVertexLayout;
+
+	template<> struct StaticVertexLayout<> {
+		static constexpr uint32_t stride() { return 0; }
+		static constexpr uint32_t offset(uint32_t) { return 0; }
+		static void write(unsigned char *, const VertexSource &, uint32_t) {}
+		static void addAttributeDescriptions(std::vector<VkVertexInputAttributeDescription> &, uint32_t, uint32_t, uint32_t) {}
+	};
+
+	template<Component First, Component... Rest> struct StaticVertexLayout<First, Rest...> {
+		typedef StaticVertexLayout<Rest...> Tail;
+		static const uint32_t componentCount = 1 + sizeof...(Rest);
+
+		/** @brief Size of a vertex in bytes */
+		static constexpr uint32_t stride()
+		{
+			return ComponentWriter<First>::size + Tail::stride();
+		}
+
+		/** @brief Offset of the component at the given index inside of a vertex in bytes */
+		static constexpr uint32_t offset(uint32_t index)
+		{
+			return (index == 0) ? 0 : ComponentWriter<First>::size + Tail::offset(index - 1);
+		}
+
+		/** @brief Write all components of a single vertex, unrolled at compile time */
+		static void write(unsigned char *dst, const VertexSource &src, uint32_t i)
+		{
+			ComponentWriter<First>::write(dst, src, i);
+			Tail::write(dst + ComponentWriter<First>::size, src, i);
+		}
+
+		/** @brief Write the vertices of a mesh (see Model::loadFromFile) */
+		static void writeVertices(const VertexLayout &, unsigned char *dst, const VertexSource &src, uint32_t vertexCount)
+		{
+			for (uint32_t i = 0; i < vertexCount; i++) {
+				write(dst + (size_t)i * stride(), src, i);
+			}
+		}
+
+		static void addAttributeDescriptions(std::vector<VkVertexInputAttributeDescription> &attributeDescriptions, uint32_t binding, uint32_t location, uint32_t offset)
+		{
+			const bool dummy = (First == VERTEX_COMPONENT_DUMMY_FLOAT) || (First == VERTEX_COMPONENT_DUMMY_VEC4);
+			if (!dummy) {
+				VkVertexInputAttributeDescription attributeDescription{};
+				attributeDescription.location = location;
+				attributeDescription.binding = binding;
+				attributeDescription.format = ComponentWriter<First>::format;
+				attributeDescription.offset = offset;
+				attributeDescriptions.push_back(attributeDescription);
+			}
+			Tail::addAttributeDescriptions(attributeDescriptions, binding, dummy ? location : location + 1, offset + ComponentWriter<First>::size);
+		}
+
+		/** @brief Vertex input attribute descriptions, same rules as VertexLayout::inputAttributeDescriptions */
+		static std::vector<VkVertexInputAttributeDescription> inputAttributeDescriptions(uint32_t binding, uint32_t firstLocation = 0)
+		{
+			std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+			attributeDescriptions.reserve(componentCount);
+			addAttributeDescriptions(attributeDescriptions, binding, firstLocation, 0);
+			return attributeDescriptions;
+		}
+
+		/** @brief Runtime description of the layout */
+		static VertexLayout layout()
+		{
+			return VertexLayout({ First, Rest... });
 		}
 	};
 
@@ -86,6 +467,12 @@ namespace vks
 		glm::vec3 center;
 		glm::vec3 scale;
 		glm::vec2 uvscale;
+		/** @brief Post load geometry optimizations (see vks::meshopt::OptimizeFlagBits), none by default */
+		uint32_t optimizeFlags = 0;
+		/** @brief Components of an additional vertex stream for depth only passes (see Model::depthStream), must be part of the vertex layout, none by default */
+		std::vector<Component> depthStreamComponents;
+		/** @brief Split the model parts into meshlets for cluster culling (see Model::meshlets), requires a position component, disabled by default */
+		bool buildMeshlets = false;
 
 		ModelCreateInfo() {};
 
@@ -111,6 +498,8 @@ namespace vks
 		vks::Buffer indices;
 		uint32_t indexCount = 0;
 		uint32_t vertexCount = 0;
+		/** @brief Type of the indices, only differs from 32 bit if 16 bit indices have been requested via the create info's optimize flags */
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
 
 		/** @brief Stores vertex and index base and counts for each part of a model */
 		struct ModelPart {
@@ -118,9 +507,39 @@ namespace vks
 			uint32_t vertexCount;
 			uint32_t indexBase;
 			uint32_t indexCount;
+			// Range of the part's meshlets, only set if the model has been loaded with meshlets
+			uint32_t meshletBase;
+			uint32_t meshletCount;
 		};
 		std::vector<ModelPart> parts;
 
+		/**
+		* Meshlets (clusters of up to 124 triangles and 64 vertices) with model space bounding spheres and normal cones
+		* Each meshlet is a contiguous range of the index buffer, so visible meshlets can be drawn with indexed indirect draws
+		*/
+		std::vector<vks::meshopt::Meshlet> meshlets;
+
+		/**
+		* Optional vertex stream for depth only passes (e.g. shadow maps) that only contains a subset of the vertex components (e.g. positions)
+		* Vertices that only differed in the other components are merged, so the stream has its own index buffer
+		* Index count, index type and the index ranges of the model parts are the same as for the full vertex layout
+		*/
+		struct DepthStream {
+			vks::Buffer vertices;
+			vks::Buffer indices;
+			uint32_t vertexCount = 0;
+			uint32_t stride = 0;
+			/** @brief Estimated vertex data fetched for drawing all parts of the model with the full vertex layout and with the depth stream (vertex cache misses * stride, in bytes) */
+			uint64_t fullFetchSize = 0;
+			uint64_t fetchSize = 0;
+		} depthStream;
+
+		/** @brief True if the model has been loaded with depth stream components */
+		bool hasDepthStream()
+		{
+			return depthStream.vertices.buffer != VK_NULL_HANDLE;
+		}
+
 		static const int defaultFlags = aiProcess_FlipWindingOrder | aiProcess_Triangulate | aiProcess_PreTransformVertices | aiProcess_CalcTangentSpace | aiProcess_GenSmoothNormals;
 
 		struct Dimension
@@ -130,33 +549,572 @@ namespace vks
 			glm::vec3 size;
 		} dim;
 
+		/**
+		* Processed meshes are stored in a binary cache file after the first import, later loads map the cache file
+		* and upload its vertex and index data directly without running ASSIMP
+		* The cache is keyed by the source file (path, modification time and size), the vertex layout, the create info and the ASSIMP flags
+		* Disabled by default, as the cache files are never cleaned up (enabled with the "-meshcache" command line argument)
+		*/
+		static bool& useCache()
+		{
+			return vks::tools::meshCacheEnabled;
+		}
+
+		/** @brief Directory to store mesh cache files in (defaults to the system's temporary directory) */
+		static std::string& cacheDirectory()
+		{
+			static std::string directory;
+			return directory;
+		}
+
+	private:
+		/** @brief Header of a mesh cache file, followed by the model parts, the meshlets, the vertex data, the index data and the (optional) depth stream's vertex and index data */
+		struct CacheHeader {
+			uint32_t magic;
+			uint32_t version;
+			uint64_t key;
+			uint32_t vertexCount;
+			uint32_t indexCount;
+			uint32_t partCount;
+			uint32_t vertexBufferSize;
+			uint32_t indexBufferSize;
+			uint32_t indexType;
+			float dimMin[3];
+			float dimMax[3];
+			uint32_t depthVertexCount;
+			uint32_t depthStride;
+			uint32_t depthVertexBufferSize;
+			uint32_t depthIndexBufferSize;
+			uint64_t fullFetchSize;
+			uint64_t depthFetchSize;
+			uint32_t meshletCount;
+			uint32_t _pad0;
+		};
+		static const uint32_t cacheMagic = 0x434d4b56; // "VKMC"
+		static const uint32_t cacheVersion = 5;
+
+		// FNV-1a
+		static void hashBytes(uint64_t &hash, const void *data, size_t size)
+		{
+			const unsigned char *bytes = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < size; i++) {
+				hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+			}
+		}
+
+		/** @brief Get the cache key and file name for a model load, returns false if the source file does not exist */
+		static bool getCacheKey(const std::string &filename, vks::VertexLayout &layout, const glm::vec3 &scale, const glm::vec2 &uvscale, const glm::vec3 &center, uint32_t optimizeFlags, const std::vector<Component> &depthStreamComponents, bool buildMeshlets, int flags, uint64_t &key, std::string &cacheFilename)
+		{
+			struct stat fileStat;
+			if (stat(filename.c_str(), &fileStat) != 0) {
+				return false;
+			}
+			key = 0xcbf29ce484222325ULL;
+			const int64_t modified = static_cast<int64_t>(fileStat.st_mtime);
+			const int64_t size = static_cast<int64_t>(fileStat.st_size);
+			hashBytes(key, &cacheVersion, sizeof(cacheVersion));
+			hashBytes(key, filename.data(), filename.size());
+			hashBytes(key, &modified, sizeof(modified));
+			hashBytes(key, &size, sizeof(size));
+			for (auto& component : layout.components) {
+				const uint32_t value = static_cast<uint32_t>(component);
+				hashBytes(key, &value, sizeof(value));
+			}
+			const float createValues[8] = { scale.x, scale.y, scale.z, uvscale.s, uvscale.t, center.x, center.y, center.z };
+			hashBytes(key, createValues, sizeof(createValues));
+			hashBytes(key, &optimizeFlags, sizeof(optimizeFlags));
+			for (auto& component : depthStreamComponents) {
+				const uint32_t value = static_cast<uint32_t>(component) | 0x80000000;
+				hashBytes(key, &value, sizeof(value));
+			}
+			const uint32_t meshletLimits[2] = { buildMeshlets ? meshopt::defaultMeshletMaxVertices : 0, buildMeshlets ? meshopt::defaultMeshletMaxTriangles : 0 };
+			hashBytes(key, meshletLimits, sizeof(meshletLimits));
+			hashBytes(key, &flags, sizeof(flags));
+
+			std::string directory = cacheDirectory();
+			if (directory.empty()) {
+#if defined(_WIN32)
+				char tempPath[MAX_PATH];
+				directory = (GetTempPathA(MAX_PATH, tempPath) > 0) ? std::string(tempPath) : ".";
+#else
+				const char *tempPath = getenv("TMPDIR");
+				directory = tempPath ? tempPath : "/tmp";
+#endif
+			}
+			if (directory.back() != '/' && directory.back() != '\\') {
+				directory += "/";
+			}
+			const size_t separator = filename.find_last_of("/\\");
+			const std::string name = (separator != std::string::npos) ? filename.substr(separator + 1) : filename;
+			char keyString[17];
+			snprintf(keyString, sizeof(keyString), "%016llx", static_cast<unsigned long long>(key));
+			cacheFilename = directory + name + "." + keyString + ".meshcache";
+			return true;
+		}
+
+		/** @brief Write the processed geometry to a cache file, failures only mean that the next load imports the model again */
+		void writeCache(const std::string &cacheFilename, uint64_t key, const std::vector<float> &vertexBuffer, const void *indexData, uint32_t indexBufferSize, const std::vector<unsigned char> &depthVertexBuffer, const void *depthIndexData, uint32_t depthIndexBufferSize, const Dimension &fileDim)
+		{
+			CacheHeader header = {};
+			header.magic = cacheMagic;
+			header.version = cacheVersion;
+			header.key = key;
+			header.vertexCount = vertexCount;
+			header.indexCount = indexCount;
+			header.partCount = static_cast<uint32_t>(parts.size());
+			header.vertexBufferSize = static_cast<uint32_t>(vertexBuffer.size() * sizeof(float));
+			header.indexBufferSize = indexBufferSize;
+			header.indexType = static_cast<uint32_t>(indexType);
+			memcpy(header.dimMin, &fileDim.min, sizeof(header.dimMin));
+			memcpy(header.dimMax, &fileDim.max, sizeof(header.dimMax));
+			header.depthVertexCount = depthStream.vertexCount;
+			header.depthStride = depthStream.stride;
+			header.depthVertexBufferSize = static_cast<uint32_t>(depthVertexBuffer.size());
+			header.depthIndexBufferSize = depthIndexBufferSize;
+			header.fullFetchSize = depthStream.fullFetchSize;
+			header.depthFetchSize = depthStream.fetchSize;
+			header.meshletCount = static_cast<uint32_t>(meshlets.size());
+			// Write to a temporary file first, so other instances never map a partially written cache
+			const std::string tempFilename = getUniqueTempFilename(cacheFilename);
+			{
+				std::ofstream file(tempFilename, std::ios::binary | std::ios::trunc);
+				if (!file.is_open()) {
+					return;
+				}
+				file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+				file.write(reinterpret_cast<const char*>(parts.data()), parts.size() * sizeof(ModelPart));
+				file.write(reinterpret_cast<const char*>(meshlets.data()), meshlets.size() * sizeof(meshopt::Meshlet));
+				file.write(reinterpret_cast<const char*>(vertexBuffer.data()), header.vertexBufferSize);
+				file.write(reinterpret_cast<const char*>(indexData), header.indexBufferSize);
+				file.write(reinterpret_cast<const char*>(depthVertexBuffer.data()), header.depthVertexBufferSize);
+				file.write(reinterpret_cast<const char*>(depthIndexData), header.depthIndexBufferSize);
+				if (!file.good()) {
+					file.close();
+					std::remove(tempFilename.c_str());
+					return;
+				}
+			}
+			std::remove(cacheFilename.c_str());
+			std::rename(tempFilename.c_str(), cacheFilename.c_str());
+		}
+
+		/** @brief Create device local vertex and index buffers and upload the geometry (used for the model's buffers and the depth stream) */
+		void createBuffers(vks::VulkanDevice *device, VkQueue copyQueue, vks::Buffer &vertexTarget, const void *vertexData, uint32_t vBufferSize, vks::Buffer &indexTarget, const void *indexData, uint32_t iBufferSize)
+		{
+			// Create device local target buffers
+			// Vertex buffer
+			VK_CHECK_RESULT(device->createBuffer(
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				&vertexTarget,
+				vBufferSize));
+
+			// Index buffer
+			VK_CHECK_RESULT(device->createBuffer(
+				VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				&indexTarget,
+				iBufferSize));
+
+			if (device->uploadManager)
+			{
+				// Copies are batched by the upload manager, the data is staged in its ring buffer
+				device->uploadManager->uploadBuffer(vertexTarget.buffer, vertexData, vBufferSize, 0, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+				device->uploadManager->complete(device->uploadManager->uploadBuffer(indexTarget.buffer, indexData, iBufferSize, 0, VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT));
+				return;
+			}
+
+			// Use staging buffer to move vertex and index buffer to device local memory
+			// Create staging buffers
+			vks::Buffer vertexStaging, indexStaging;
+
+			// Vertex buffer
+			VK_CHECK_RESULT(device->createBuffer(
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&vertexStaging,
+				vBufferSize,
+				const_cast<void*>(vertexData),
+				vks::ALLOCATION_STRATEGY_LINEAR));
+
+			// Index buffer
+			VK_CHECK_RESULT(device->createBuffer(
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&indexStaging,
+				iBufferSize,
+				const_cast<void*>(indexData),
+				vks::ALLOCATION_STRATEGY_LINEAR));
+
+			// Copy from staging buffers
+			VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+
+			VkBufferCopy copyRegion{};
+
+			copyRegion.size = vertexTarget.size;
+			vkCmdCopyBuffer(copyCmd, vertexStaging.buffer, vertexTarget.buffer, 1, &copyRegion);
+
+			copyRegion.size = indexTarget.size;
+			vkCmdCopyBuffer(copyCmd, indexStaging.buffer, indexTarget.buffer, 1, &copyRegion);
+
+			device->flushCommandBuffer(copyCmd, copyQueue);
+
+			// Destroy staging resources
+			vertexStaging.destroy();
+			indexStaging.destroy();
+		}
+
+		/**
+		* Run the requested optimizations on the imported geometry, the vertex cache statistics before and after are printed if verbose output is enabled
+		* Triangles are only reordered inside of their part, so the parts' index ranges stay valid
+		*/
+		void optimize(const std::string &filename, vks::VertexLayout &layout, uint32_t optimizeFlags, std::vector<float> &vertexBuffer, std::vector<uint32_t> &indexBuffer)
+		{
+			const uint32_t stride = layout.stride();
+			const uint32_t vertexCountBefore = vertexCount;
+			// The statistics are only needed for the report
+			meshopt::VertexCacheStatistics statsBefore;
+			if (vks::tools::verboseOutput)
+			{
+				statsBefore = meshopt::analyzeVertexCache(indexBuffer.data(), indexBuffer.size(), vertexCount);
+			}
+
+			if (optimizeFlags & meshopt::OPTIMIZE_WELD)
+			{
+				vertexCount = meshopt::weldVertices(vertexBuffer.data(), vertexCount, stride, indexBuffer.data(), indexBuffer.size());
+			}
+
+			const int32_t positionOffset = layout.offsetOf(VERTEX_COMPONENT_POSITION);
+			for (auto& part : parts)
+			{
+				if (part.indexCount == 0)
+				{
+					continue;
+				}
+				// Work on the range of vertices referenced by the part, keeps the optimizer's per vertex data small
+				uint32_t *partIndices = &indexBuffer[part.indexBase];
+				const auto range = std::minmax_element(partIndices, partIndices + part.indexCount);
+				const uint32_t firstVertex = *range.first;
+				const uint32_t rangeCount = *range.second - firstVertex + 1;
+				for (uint32_t i = 0; i < part.indexCount; i++)
+				{
+					partIndices[i] -= firstVertex;
+				}
+				if (optimizeFlags & meshopt::OPTIMIZE_VERTEX_CACHE)
+				{
+					meshopt::optimizeVertexCache(partIndices, part.indexCount, rangeCount);
+				}
+				if ((optimizeFlags & meshopt::OPTIMIZE_OVERDRAW) && (positionOffset >= 0))
+				{
+					const unsigned char *positions = reinterpret_cast<const unsigned char*>(vertexBuffer.data()) + (size_t)firstVertex * stride + positionOffset;
+					meshopt::optimizeOverdraw(partIndices, part.indexCount, positions, stride, rangeCount);
+				}
+				for (uint32_t i = 0; i < part.indexCount; i++)
+				{
+					partIndices[i] += firstVertex;
+				}
+			}
+
+			if (optimizeFlags & meshopt::OPTIMIZE_VERTEX_FETCH)
+			{
+				vertexCount = meshopt::optimizeVertexFetch(vertexBuffer.data(), vertexCount, stride, indexBuffer.data(), indexBuffer.size());
+			}
+			vertexBuffer.resize((size_t)vertexCount * stride / sizeof(float));
+
+			// Welding and reordering move the vertices of a part
+			for (auto& part : parts)
+			{
+				if (part.indexCount == 0)
+				{
+					part.vertexBase = part.vertexCount = 0;
+					continue;
+				}
+				const auto range = std::minmax_element(indexBuffer.begin() + part.indexBase, indexBuffer.begin() + part.indexBase + part.indexCount);
+				part.vertexBase = *range.first;
+				part.vertexCount = *range.second - *range.first + 1;
+			}
+
+			if ((optimizeFlags & meshopt::OPTIMIZE_INDEX_16BIT) && (vertexCount <= 65536))
+			{
+				indexType = VK_INDEX_TYPE_UINT16;
+			}
+
+			if (!vks::tools::verboseOutput)
+			{
+				return;
+			}
+			const meshopt::VertexCacheStatistics statsAfter = meshopt::analyzeVertexCache(indexBuffer.data(), indexBuffer.size(), vertexCount);
+			printf("Optimized '%s': %u -> %u vertices, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %s bit indices\n", filename.c_str(), vertexCountBefore, vertexCount, statsBefore.acmr, statsAfter.acmr, statsBefore.atvr, statsAfter.atvr, (indexType == VK_INDEX_TYPE_UINT16) ? "16" : "32");
+		}
+
+		/**
+		* Split the index range of each model part into meshlets
+		* Triangles are reordered within the parts, so this has to run before anything that depends on the final triangle order (e.g. the depth stream)
+		*/
+		void buildMeshlets(const std::string &filename, vks::VertexLayout &layout, bool clockwise, const std::vector<float> &vertexBuffer, std::vector<uint32_t> &indexBuffer)
+		{
+			const int32_t positionOffset = layout.offsetOf(VERTEX_COMPONENT_POSITION);
+			if (positionOffset < 0)
+			{
+				printf("Meshlets of '%s' require a position component in the vertex layout\n", filename.c_str());
+				return;
+			}
+			const unsigned char *positions = reinterpret_cast<const unsigned char*>(vertexBuffer.data()) + positionOffset;
+			meshlets.clear();
+			for (auto& part : parts)
+			{
+				part.meshletBase = static_cast<uint32_t>(meshlets.size());
+				part.meshletCount = meshopt::buildMeshlets(&indexBuffer[part.indexBase], part.indexCount, part.indexBase, positions, layout.stride(), clockwise, meshlets);
+			}
+			uint32_t coneCount = 0;
+			for (auto& meshlet : meshlets)
+			{
+				coneCount += (meshlet.coneCutoff < 1.0f) ? 1 : 0;
+			}
+			// Sanity check of the cone orientation against the model's normals: A camera in front of a meshlet's surface must never cull it
+			const int32_t normalOffset = layout.offsetOf(VERTEX_COMPONENT_NORMAL);
+			if (normalOffset >= 0)
+			{
+				const unsigned char *normals = reinterpret_cast<const unsigned char*>(vertexBuffer.data()) + normalOffset;
+				uint32_t culledFacing = 0;
+				for (auto& meshlet : meshlets)
+				{
+					if (meshlet.coneCutoff >= 1.0f)
+					{
+						continue;
+					}
+					glm::vec3 facing(0.0f);
+					for (uint32_t i = 0; i < meshlet.indexCount; i++)
+					{
+						glm::vec3 normal;
+						memcpy(&normal, normals + (size_t)indexBuffer[meshlet.firstIndex + i] * layout.stride(), sizeof(normal));
+						facing += normal;
+					}
+					if (glm::length(facing) == 0.0f)
+					{
+						continue;
+					}
+					const glm::vec3 cameraPos = glm::make_vec3(meshlet.center) + glm::normalize(facing) * (meshlet.radius * 4.0f + 1.0f);
+					culledFacing += meshopt::coneVisible(meshlet, glm::value_ptr(cameraPos)) ? 0 : 1;
+				}
+				if (culledFacing > 0)
+				{
+					printf("Meshlets of '%s': %u meshlets are culled by a camera facing them, the normal cones do not match the triangle winding\n", filename.c_str(), culledFacing);
+				}
+			}
+			if (vks::tools::verboseOutput)
+			{
+				printf("Meshlets of '%s': %u meshlets, %.1f triangles per meshlet, %u with normal cones\n", filename.c_str(), static_cast<uint32_t>(meshlets.size()), meshlets.empty() ? 0.0f : (indexCount / 3.0f) / meshlets.size(), coneCount);
+			}
+		}
+
+		/**
+		* Extract the depth stream components from the vertices and merge vertices that are identical in these components
+		* Triangle order is kept, so the index ranges of the model parts are also valid for the depth stream's indices
+		*
+		* @return False if one of the components is not part of the vertex layout
+		*/
+		bool createDepthStream(const std::string &filename, vks::VertexLayout &layout, const std::vector<Component> &components, const std::vector<float> &vertexBuffer, const std::vector<uint32_t> &indexBuffer, std::vector<unsigned char> &depthVertexBuffer, std::vector<uint32_t> &depthIndexBuffer)
+		{
+			std::vector<uint32_t> offsets(components.size());
+			uint32_t stride = 0;
+			for (size_t i = 0; i < components.size(); i++)
+			{
+				const int32_t offset = layout.offsetOf(components[i]);
+				if (offset < 0)
+				{
+					printf("Depth stream component %d of '%s' is not part of the vertex layout, no depth stream created\n", static_cast<int>(components[i]), filename.c_str());
+					return false;
+				}
+				offsets[i] = static_cast<uint32_t>(offset);
+				stride += VertexLayout::componentSize(components[i]);
+			}
+
+			const uint32_t layoutStride = layout.stride();
+			const unsigned char *src = reinterpret_cast<const unsigned char*>(vertexBuffer.data());
+			depthVertexBuffer.resize((size_t)vertexCount * stride);
+			unsigned char *dst = depthVertexBuffer.data();
+			for (uint32_t v = 0; v < vertexCount; v++)
+			{
+				for (size_t i = 0; i < components.size(); i++)
+				{
+					const uint32_t size = VertexLayout::componentSize(components[i]);
+					memcpy(dst, src + (size_t)v * layoutStride + offsets[i], size);
+					dst += size;
+				}
+			}
+
+			depthIndexBuffer = indexBuffer;
+			uint32_t depthVertexCount = meshopt::weldVertices(depthVertexBuffer.data(), vertexCount, stride, depthIndexBuffer.data(), depthIndexBuffer.size());
+			depthVertexCount = meshopt::optimizeVertexFetch(depthVertexBuffer.data(), depthVertexCount, stride, depthIndexBuffer.data(), depthIndexBuffer.size());
+			depthVertexBuffer.resize((size_t)depthVertexCount * stride);
+
+			depthStream.vertexCount = depthVertexCount;
+			depthStream.stride = stride;
+			// Every post transform cache miss fetches a vertex
+			const double triangleCount = static_cast<double>(indexBuffer.size() / 3);
+			const meshopt::VertexCacheStatistics fullStats = meshopt::analyzeVertexCache(indexBuffer.data(), indexBuffer.size(), vertexCount);
+			const meshopt::VertexCacheStatistics depthStats = meshopt::analyzeVertexCache(depthIndexBuffer.data(), depthIndexBuffer.size(), depthVertexCount);
+			depthStream.fullFetchSize = static_cast<uint64_t>(fullStats.acmr * triangleCount + 0.5) * layoutStride;
+			depthStream.fetchSize = static_cast<uint64_t>(depthStats.acmr * triangleCount + 0.5) * stride;
+			if (vks::tools::verboseOutput)
+			{
+				printf("Depth stream of '%s': %u -> %u vertices, %u -> %u bytes per vertex, estimated vertex fetch per draw %.1f -> %.1f KB\n", filename.c_str(), vertexCount, depthVertexCount, layoutStride, stride, depthStream.fullFetchSize / 1024.0, depthStream.fetchSize / 1024.0);
+			}
+			return true;
+		}
+
+		/** @brief Load the model from a mesh cache file, returns false if there is no valid cache file for the key */
+		bool loadFromCache(const std::string &cacheFilename, uint64_t key, vks::VulkanDevice *device, VkQueue copyQueue)
+		{
+			vks::MappedFile file(cacheFilename);
+			if (!file.isOpen() || file.size() < sizeof(CacheHeader)) {
+				return false;
+			}
+			CacheHeader header;
+			memcpy(&header, file.data(), sizeof(header));
+			const size_t expectedSize = sizeof(CacheHeader) + header.partCount * sizeof(ModelPart) + header.meshletCount * sizeof(meshopt::Meshlet) + header.vertexBufferSize + header.indexBufferSize + header.depthVertexBufferSize + header.depthIndexBufferSize;
+			if ((header.magic != cacheMagic) || (header.version != cacheVersion) || (header.key != key) || (file.size() != expectedSize) || (header.vertexBufferSize == 0)) {
+				return false;
+			}
+			const unsigned char *data = file.data() + sizeof(CacheHeader);
+			parts.resize(header.partCount);
+			memcpy(parts.data(), data, header.partCount * sizeof(ModelPart));
+			data += header.partCount * sizeof(ModelPart);
+			meshlets.resize(header.meshletCount);
+			memcpy(meshlets.data(), data, header.meshletCount * sizeof(meshopt::Meshlet));
+			data += header.meshletCount * sizeof(meshopt::Meshlet);
+			vertexCount = header.vertexCount;
+			indexCount = header.indexCount;
+			indexType = static_cast<VkIndexType>(header.indexType);
+			dim.min = glm::min(dim.min, glm::vec3(header.dimMin[0], header.dimMin[1], header.dimMin[2]));
+			dim.max = glm::max(dim.max, glm::vec3(header.dimMax[0], header.dimMax[1], header.dimMax[2]));
+			dim.size = dim.max - dim.min;
+			// The geometry is uploaded straight from the mapped file
+			createBuffers(device, copyQueue, vertices, data, header.vertexBufferSize, indices, data + header.vertexBufferSize, header.indexBufferSize);
+			data += header.vertexBufferSize + header.indexBufferSize;
+			if (header.depthVertexBufferSize > 0)
+			{
+				depthStream.vertexCount = header.depthVertexCount;
+				depthStream.stride = header.depthStride;
+				depthStream.fullFetchSize = header.fullFetchSize;
+				depthStream.fetchSize = header.depthFetchSize;
+				createBuffers(device, copyQueue, depthStream.vertices, data, header.depthVertexBufferSize, depthStream.indices, data + header.depthVertexBufferSize, header.depthIndexBufferSize);
+			}
+			return true;
+		}
+
+	public:
 		/** @brief Release all Vulkan resources of this model */
 		void destroy()
 		{		
 			assert(device);
-			vkDestroyBuffer(device, vertices.buffer, nullptr);
-			vkFreeMemory(device, vertices.memory, nullptr);
+			// Some examples fill the model buffers through the raw createBuffer overload, which does not set the buffer's device
+			vertices.device = device;
+			vertices.destroy();
 			if (indices.buffer != VK_NULL_HANDLE)
 			{
-				vkDestroyBuffer(device, indices.buffer, nullptr);
-				vkFreeMemory(device, indices.memory, nullptr);
+				indices.device = device;
+				indices.destroy();
+			}
+			if (hasDepthStream())
+			{
+				depthStream.vertices.destroy();
+				depthStream.indices.destroy();
 			}
 		}
 
-		/**
-		* Loads a 3D model from a file into Vulkan buffers
-		*
-		* @param device Pointer to the Vulkan device used to generated the vertex and index buffers on
-		* @param filename File to load (must be a model format supported by ASSIMP)
-		* @param layout Vertex layout components (position, normals, tangents, etc.)
-		* @param createInfo MeshCreateInfo structure for load time settings like scale, center, etc.
-		* @param copyQueue Queue used for the memory staging copy commands (must support transfer)
-		* @param (Optional) flags ASSIMP model loading flags
-		*/
-		bool loadFromFile(const std::string& filename, vks::VertexLayout layout, vks::ModelCreateInfo *createInfo, vks::VulkanDevice *device, VkQueue copyQueue, const int flags = defaultFlags)
+	private:
+		/** @brief Writes the vertices of a mesh into the model's vertex data, either for a runtime or a static layout */
+		typedef void(*VertexWriter)(const VertexLayout &layout, unsigned char *dst, const VertexSource &src, uint32_t vertexCount);
+
+		/** @brief Vertex writer for runtime layouts, selects the writer of each component per vertex */
+		static void writeLayoutVertices(const VertexLayout &layout, unsigned char *dst, const VertexSource &src, uint32_t vertexCount)
+		{
+			for (uint32_t i = 0; i < vertexCount; i++)
+			{
+				for (auto& component : layout.components)
+				{
+					switch (component) {
+					case VERTEX_COMPONENT_POSITION:
+						ComponentWriter<VERTEX_COMPONENT_POSITION>::write(dst, src, i);
+						break;
+					case VERTEX_COMPONENT_NORMAL:
+						ComponentWriter<VERTEX_COMPONENT_NORMAL>::write(dst, src, i);
+						break;
+					case VERTEX_COMPONENT_COLOR:
+						ComponentWriter<VERTEX_COMPONENT_COLOR>::write(dst, src, i);
+						break;
+					case VERTEX_COMPONENT_UV:
+						ComponentWriter<VERTEX_COMPONENT_UV>::write(dst, src, i);
+						break;
+					case VERTEX_COMPONENT_TANGENT:
+						ComponentWriter<VERTEX_COMPONENT_TANGENT>::write(dst, src, i);
+						break;
+					case VERTEX_COMPONENT_BITANGENT:
+						ComponentWriter<VERTEX_COMPONENT_BITANGENT>::write(dst, src, i);
+						break;
+					case VERTEX_COMPONENT_DUMMY_FLOAT:
+						ComponentWriter<VERTEX_COMPONENT_DUMMY_FLOAT>::write(dst, src, i);
+						break;
+					case VERTEX_COMPONENT_DUMMY_VEC4:
+						ComponentWriter<VERTEX_COMPONENT_DUMMY_VEC4>::write(dst, src, i);
+						break;
+					case VERTEX_COMPONENT_POSITION_HALF:
+						ComponentWriter<VERTEX_COMPONENT_POSITION_HALF>::write(dst, src, i);
+						break;
+					case VERTEX_COMPONENT_UV_HALF:
+						ComponentWriter<VERTEX_COMPONENT_UV_HALF>::write(dst, src, i);
+						break;
+					case VERTEX_COMPONENT_NORMAL_PACKED:
+						ComponentWriter<VERTEX_COMPONENT_NORMAL_PACKED>::write(dst, src, i);
+						break;
+					case VERTEX_COMPONENT_TANGENT_PACKED:
+						ComponentWriter<VERTEX_COMPONENT_TANGENT_PACKED>::write(dst, src, i);
+						break;
+					case VERTEX_COMPONENT_BITANGENT_PACKED:
+						ComponentWriter<VERTEX_COMPONENT_BITANGENT_PACKED>::write(dst, src, i);
+						break;
+					case VERTEX_COMPONENT_COLOR_UNORM8:
+						ComponentWriter<VERTEX_COMPONENT_COLOR_UNORM8>::write(dst, src, i);
+						break;
+					};
+					dst += VertexLayout::componentSize(component);
+				}
+			}
+		}
+
+		bool load(const std::string& filename, vks::VertexLayout &layout, vks::ModelCreateInfo *createInfo, vks::VulkanDevice *device, VkQueue copyQueue, const int flags, VertexWriter writeVertices)
 		{
 			this->device = device->logicalDevice;
 
+			glm::vec3 scale(1.0f);
+			glm::vec2 uvscale(1.0f);
+			glm::vec3 center(0.0f);
+			uint32_t optimizeFlags = 0;
+			std::vector<Component> depthStreamComponents;
+			bool meshletsRequested = false;
+			if (createInfo)
+			{
+				scale = createInfo->scale;
+				uvscale = createInfo->uvscale;
+				center = createInfo->center;
+				optimizeFlags = createInfo->optimizeFlags;
+				depthStreamComponents = createInfo->depthStreamComponents;
+				meshletsRequested = createInfo->buildMeshlets;
+			}
+			indexType = VK_INDEX_TYPE_UINT32;
+
+			// Meshes can't be cached on Android as they are stored inside the apk
+#if !defined(__ANDROID__)
+			uint64_t cacheKey = 0;
+			std::string cacheFilename;
+			const bool cacheable = useCache() && getCacheKey(filename, layout, scale, uvscale, center, optimizeFlags, depthStreamComponents, meshletsRequested, flags, cacheKey, cacheFilename);
+			if (cacheable && loadFromCache(cacheFilename, cacheKey, device, copyQueue)) {
+				return true;
+			}
+#endif
+
 			Assimp::Importer Importer;
 			const aiScene* pScene;
 
@@ -195,18 +1153,24 @@ namespace vks
 				parts.clear();
 				parts.resize(pScene->mNumMeshes);
 
-				glm::vec3 scale(1.0f);
-				glm::vec2 uvscale(1.0f);
-				glm::vec3 center(0.0f);
-				if (createInfo)
+				std::vector<float> vertexBuffer;
+				std::vector<uint32_t> indexBuffer;
+
+				// Allocate the final buffer sizes to avoid reallocations while repacking the vertices
+				size_t totalVertices = 0;
+				size_t totalIndices = 0;
+				for (unsigned int i = 0; i < pScene->mNumMeshes; i++)
 				{
-					scale = createInfo->scale;
-					uvscale = createInfo->uvscale;
-					center = createInfo->center;
+					totalVertices += pScene->mMeshes[i]->mNumVertices;
+					totalIndices += pScene->mMeshes[i]->mNumFaces * 3;
 				}
+				// Vertices are written in place by the vertex writer
+				const uint32_t stride = layout.stride();
+				vertexBuffer.resize(totalVertices * stride / sizeof(float));
+				indexBuffer.reserve(totalIndices);
 
-				std::vector<float> vertexBuffer;
-				std::vector<uint32_t> indexBuffer;
+				// Dimensions of this file only, stored in the mesh cache
+				Dimension fileDim;
 
 				vertexCount = 0;
 				indexCount = 0;
@@ -227,73 +1191,42 @@ namespace vks
 
 					const aiVector3D Zero3D(0.0f, 0.0f, 0.0f);
 
+					VertexSource source;
+					source.positions = paiMesh->mVertices;
+					source.normals = paiMesh->mNormals;
+					source.texCoords = paiMesh->HasTextureCoords(0) ? paiMesh->mTextureCoords[0] : &Zero3D;
+					source.texCoordStride = paiMesh->HasTextureCoords(0) ? 1 : 0;
+					source.tangents = paiMesh->HasTangentsAndBitangents() ? paiMesh->mTangents : &Zero3D;
+					source.bitangents = paiMesh->HasTangentsAndBitangents() ? paiMesh->mBitangents : &Zero3D;
+					source.tangentStride = paiMesh->HasTangentsAndBitangents() ? 1 : 0;
+					source.color = pColor;
+					source.scale = scale;
+					source.center = center;
+					source.uvscale = uvscale;
+
+					writeVertices(layout, reinterpret_cast<unsigned char*>(vertexBuffer.data()) + (size_t)parts[i].vertexBase * stride, source, paiMesh->mNumVertices);
+
 					for (unsigned int j = 0; j < paiMesh->mNumVertices; j++)
 					{
 						const aiVector3D* pPos = &(paiMesh->mVertices[j]);
-						const aiVector3D* pNormal = &(paiMesh->mNormals[j]);
-						const aiVector3D* pTexCoord = (paiMesh->HasTextureCoords(0)) ? &(paiMesh->mTextureCoords[0][j]) : &Zero3D;
-						const aiVector3D* pTangent = (paiMesh->HasTangentsAndBitangents()) ? &(paiMesh->mTangents[j]) : &Zero3D;
-						const aiVector3D* pBiTangent = (paiMesh->HasTangentsAndBitangents()) ? &(paiMesh->mBitangents[j]) : &Zero3D;
-
-						for (auto& component : layout.components)
-						{
-							switch (component) {
-							case VERTEX_COMPONENT_POSITION:
-								vertexBuffer.push_back(pPos->x * scale.x + center.x);
-								vertexBuffer.push_back(-pPos->y * scale.y + center.y);
-								vertexBuffer.push_back(pPos->z * scale.z + center.z);
-								break;
-							case VERTEX_COMPONENT_NORMAL:
-								vertexBuffer.push_back(pNormal->x);
-								vertexBuffer.push_back(-pNormal->y);
-								vertexBuffer.push_back(pNormal->z);
-								break;
-							case VERTEX_COMPONENT_UV:
-								vertexBuffer.push_back(pTexCoord->x * uvscale.s);
-								vertexBuffer.push_back(pTexCoord->y * uvscale.t);
-								break;
-							case VERTEX_COMPONENT_COLOR:
-								vertexBuffer.push_back(pColor.r);
-								vertexBuffer.push_back(pColor.g);
-								vertexBuffer.push_back(pColor.b);
-								break;
-							case VERTEX_COMPONENT_TANGENT:
-								vertexBuffer.push_back(pTangent->x);
-								vertexBuffer.push_back(pTangent->y);
-								vertexBuffer.push_back(pTangent->z);
-								break;
-							case VERTEX_COMPONENT_BITANGENT:
-								vertexBuffer.push_back(pBiTangent->x);
-								vertexBuffer.push_back(pBiTangent->y);
-								vertexBuffer.push_back(pBiTangent->z);
-								break;
-							// Dummy components for padding
-							case VERTEX_COMPONENT_DUMMY_FLOAT:
-								vertexBuffer.push_back(0.0f);
-								break;
-							case VERTEX_COMPONENT_DUMMY_VEC4:
-								vertexBuffer.push_back(0.0f);
-								vertexBuffer.push_back(0.0f);
-								vertexBuffer.push_back(0.0f);
-								vertexBuffer.push_back(0.0f);
-								break;
-							};
-						}
-
-						dim.max.x = fmax(pPos->x, dim.max.x);
-						dim.max.y = fmax(pPos->y, dim.max.y);
-						dim.max.z = fmax(pPos->z, dim.max.z);
-
-						dim.min.x = fmin(pPos->x, dim.min.x);
-						dim.min.y = fmin(pPos->y, dim.min.y);
-						dim.min.z = fmin(pPos->z, dim.min.z);
+
+						fileDim.max.x = fmax(pPos->x, fileDim.max.x);
+						fileDim.max.y = fmax(pPos->y, fileDim.max.y);
+						fileDim.max.z = fmax(pPos->z, fileDim.max.z);
+
+						fileDim.min.x = fmin(pPos->x, fileDim.min.x);
+						fileDim.min.y = fmin(pPos->y, fileDim.min.y);
+						fileDim.min.z = fmin(pPos->z, fileDim.min.z);
 					}
 
+					dim.min = glm::min(dim.min, fileDim.min);
+					dim.max = glm::max(dim.max, fileDim.max);
+
 					dim.size = dim.max - dim.min;
 
 					parts[i].vertexCount = paiMesh->mNumVertices;
 
-					uint32_t indexBase = static_cast<uint32_t>(indexBuffer.size());
+					uint32_t indexBase = parts[i].vertexBase;
 					for (unsigned int j = 0; j < paiMesh->mNumFaces; j++)
 					{
 						const aiFace& Face = paiMesh->mFaces[j];
@@ -308,62 +1241,56 @@ namespace vks
 				}
 
 
+				if (optimizeFlags != 0)
+				{
+					optimize(filename, layout, optimizeFlags, vertexBuffer, indexBuffer);
+				}
+
+				if (meshletsRequested)
+				{
+					// Assimp's faces are counter clockwise, flipping their order and mirroring the positions on y (see ComponentWriter) both reverse the winding
+					// So the stored triangles are only clockwise (seen from the outside) if the winding has not been flipped
+					buildMeshlets(filename, layout, (flags & aiProcess_FlipWindingOrder) == 0, vertexBuffer, indexBuffer);
+				}
+
 				uint32_t vBufferSize = static_cast<uint32_t>(vertexBuffer.size()) * sizeof(float);
 				uint32_t iBufferSize = static_cast<uint32_t>(indexBuffer.size()) * sizeof(uint32_t);
+				const void *indexData = indexBuffer.data();
 
-				// Use staging buffer to move vertex and index buffer to device local memory
-				// Create staging buffers
-				vks::Buffer vertexStaging, indexStaging;
-
-				// Vertex buffer
-				VK_CHECK_RESULT(device->createBuffer(
-					VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-					&vertexStaging,
-					vBufferSize,
-					vertexBuffer.data()));
-
-				// Index buffer
-				VK_CHECK_RESULT(device->createBuffer(
-					VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-					&indexStaging,
-					iBufferSize,
-					indexBuffer.data()));
-
-				// Create device local target buffers
-				// Vertex buffer
-				VK_CHECK_RESULT(device->createBuffer(
-					VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-					&vertices,
-					vBufferSize));
-
-				// Index buffer
-				VK_CHECK_RESULT(device->createBuffer(
-					VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-					VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-					&indices,
-					iBufferSize));
-
-				// Copy from staging buffers
-				VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-				VkBufferCopy copyRegion{};
-
-				copyRegion.size = vertices.size;
-				vkCmdCopyBuffer(copyCmd, vertexStaging.buffer, vertices.buffer, 1, &copyRegion);
-
-				copyRegion.size = indices.size;
-				vkCmdCopyBuffer(copyCmd, indexStaging.buffer, indices.buffer, 1, &copyRegion);
-
-				device->flushCommandBuffer(copyCmd, copyQueue);
-
-				// Destroy staging resources
-				vkDestroyBuffer(device->logicalDevice, vertexStaging.buffer, nullptr);
-				vkFreeMemory(device->logicalDevice, vertexStaging.memory, nullptr);
-				vkDestroyBuffer(device->logicalDevice, indexStaging.buffer, nullptr);
-				vkFreeMemory(device->logicalDevice, indexStaging.memory, nullptr);
+				std::vector<uint16_t> indexBuffer16;
+				if (indexType == VK_INDEX_TYPE_UINT16)
+				{
+					indexBuffer16.assign(indexBuffer.begin(), indexBuffer.end());
+					iBufferSize = static_cast<uint32_t>(indexBuffer16.size()) * sizeof(uint16_t);
+					indexData = indexBuffer16.data();
+				}
+
+				createBuffers(device, copyQueue, vertices, vertexBuffer.data(), vBufferSize, indices, indexData, iBufferSize);
+
+				std::vector<unsigned char> depthVertexBuffer;
+				std::vector<uint32_t> depthIndexBuffer;
+				std::vector<uint16_t> depthIndexBuffer16;
+				const void *depthIndexData = nullptr;
+				uint32_t depthIndexBufferSize = 0;
+				if (!depthStreamComponents.empty() && createDepthStream(filename, layout, depthStreamComponents, vertexBuffer, indexBuffer, depthVertexBuffer, depthIndexBuffer))
+				{
+					// The depth stream has at most as many vertices as the model, so it can always use the model's index type
+					depthIndexData = depthIndexBuffer.data();
+					depthIndexBufferSize = static_cast<uint32_t>(depthIndexBuffer.size()) * sizeof(uint32_t);
+					if (indexType == VK_INDEX_TYPE_UINT16)
+					{
+						depthIndexBuffer16.assign(depthIndexBuffer.begin(), depthIndexBuffer.end());
+						depthIndexData = depthIndexBuffer16.data();
+						depthIndexBufferSize = static_cast<uint32_t>(depthIndexBuffer16.size()) * sizeof(uint16_t);
+					}
+					createBuffers(device, copyQueue, depthStream.vertices, depthVertexBuffer.data(), static_cast<uint32_t>(depthVertexBuffer.size()), depthStream.indices, depthIndexData, depthIndexBufferSize);
+				}
+
+#if !defined(__ANDROID__)
+				if (cacheable) {
+					writeCache(cacheFilename, cacheKey, vertexBuffer, indexData, iBufferSize, depthVertexBuffer, depthIndexData, depthIndexBufferSize, fileDim);
+				}
+#endif
 
 				return true;
 			}
@@ -377,6 +1304,57 @@ namespace vks
 			}
 		};
 
+	public:
+		/**
+		* Loads a 3D model from a file into Vulkan buffers
+		*
+		* @param device Pointer to the Vulkan device used to generated the vertex and index buffers on
+		* @param filename File to load (must be a model format supported by ASSIMP)
+		* @param layout Vertex layout components (position, normals, tangents, etc.)
+		* @param createInfo MeshCreateInfo structure for load time settings like scale, center, etc.
+		* @param copyQueue Queue used for the memory staging copy commands (must support transfer)
+		* @param (Optional) flags ASSIMP model loading flags
+		*/
+		bool loadFromFile(const std::string& filename, vks::VertexLayout layout, vks::ModelCreateInfo *createInfo, vks::VulkanDevice *device, VkQueue copyQueue, const int flags = defaultFlags)
+		{
+			return load(filename, layout, createInfo, device, copyQueue, flags, writeLayoutVertices);
+		}
+
+		/**
+		* Loads a 3D model from a file into Vulkan buffers using a compile time vertex layout
+		*
+		* @param device Pointer to the Vulkan device used to generated the vertex and index buffers on
+		* @param filename File to load (must be a model format supported by ASSIMP)
+		* @param layout Static vertex layout, vertices are written by a writer specialized for the layout
+		* @param createInfo MeshCreateInfo structure for load time settings like scale, center, etc.
+		* @param copyQueue Queue used for the memory staging copy commands (must support transfer)
+		* @param (Optional) flags ASSIMP model loading flags
+		*/
+		template<Component... Components>
+		bool loadFromFile(const std::string& filename, StaticVertexLayout<Components...> layout, vks::ModelCreateInfo *createInfo, vks::VulkanDevice *device, VkQueue copyQueue, const int flags = defaultFlags)
+		{
+			static_assert(StaticVertexLayout<Components...>::stride() % sizeof(float) == 0, "Vertex stride must be a multiple of four bytes");
+			vks::VertexLayout runtimeLayout = StaticVertexLayout<Components...>::layout();
+			return load(filename, runtimeLayout, createInfo, device, copyQueue, flags, &StaticVertexLayout<Components...>::writeVertices);
+		}
+
+		/**
+		* Loads a 3D model from a file into Vulkan buffers using a compile time vertex layout
+		*
+		* @param device Pointer to the Vulkan device used to generated the vertex and index buffers on
+		* @param filename File to load (must be a model format supported by ASSIMP)
+		* @param layout Static vertex layout, vertices are written by a writer specialized for the layout
+		* @param scale Load time scene scale
+		* @param copyQueue Queue used for the memory staging copy commands (must support transfer)
+		* @param (Optional) flags ASSIMP model loading flags
+		*/
+		template<Component... Components>
+		bool loadFromFile(const std::string& filename, StaticVertexLayout<Components...> layout, float scale, vks::VulkanDevice *device, VkQueue copyQueue, const int flags = defaultFlags)
+		{
+			vks::ModelCreateInfo modelCreateInfo(scale, 1.0f, 0.0f);
+			return loadFromFile(filename, layout, &modelCreateInfo, device, copyQueue, flags);
+		}
+
 		/**
 		* Loads a 3D model from a file into Vulkan buffers
 		*
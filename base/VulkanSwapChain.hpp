@@ -2,6 +2,7 @@
 * Class wrapping access to the swap chain
 * 
 * A swap chain is a collection of framebuffers used for rendering and presentation to the windowing system
+* In headless mode the swap chain is backed by a ring of offscreen images instead, so no window system is required
 *
 * Copyright (C) 2016-2017 by Sascha Willems - www.saschawillems.de
 *
@@ -54,7 +55,12 @@ private:
 	VkInstance instance;
 	VkDevice device;
 	VkPhysicalDevice physicalDevice;
-	VkSurfaceKHR surface;
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
+	// Headless mode
+	static const uint32_t headlessImageCount = 3;
+	std::vector<VkDeviceMemory> headlessMemory;
+	uint32_t headlessImageIndex = 0;
+	VkQueue headlessQueue = VK_NULL_HANDLE;
 	// Function pointers
 	PFN_vkGetPhysicalDeviceSurfaceSupportKHR fpGetPhysicalDeviceSurfaceSupportKHR;
 	PFN_vkGetPhysicalDeviceSurfaceCapabilitiesKHR fpGetPhysicalDeviceSurfaceCapabilitiesKHR; 
@@ -75,6 +81,8 @@ public:
 	std::vector<SwapChainBuffer> buffers;
 	/** @brief Queue family index of the detected graphics and presenting device queue */
 	uint32_t queueNodeIndex = UINT32_MAX;
+	/** @brief Render to offscreen images instead of a surface, must be set before calling connect */
+	bool headless = false;
 
 	/** @brief Creates the platform specific surface abstraction of the native platform window used for presentation */	
 #if defined(VK_USE_PLATFORM_WIN32_KHR)
@@ -247,6 +255,44 @@ public:
 
 	}
 
+	/**
+	* Select the queue family and color format for headless mode, replaces initSurface
+	*/
+	void initHeadless()
+	{
+		assert(headless);
+
+		uint32_t queueCount;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueCount, NULL);
+		assert(queueCount >= 1);
+		std::vector<VkQueueFamilyProperties> queueProps(queueCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueCount, queueProps.data());
+
+		// There is no surface to present to, so any graphics queue will do
+		for (uint32_t i = 0; i < queueCount; i++)
+		{
+			if ((queueProps[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0)
+			{
+				queueNodeIndex = i;
+				break;
+			}
+		}
+		if (queueNodeIndex == UINT32_MAX)
+		{
+			vks::tools::exitFatal("Could not find a graphics queue!", -1);
+		}
+
+		// Use the same format a surface would usually offer, with a fallback for implementations that can't render to it
+		colorFormat = VK_FORMAT_B8G8R8A8_UNORM;
+		colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+		VkFormatProperties formatProps;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, colorFormat, &formatProps);
+		if (!(formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT))
+		{
+			colorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+		}
+	}
+
 	/**
 	* Set instance, physical and logical device to use for the swapchain and get all required function pointers
 	* 
@@ -260,6 +306,11 @@ public:
 		this->instance = instance;
 		this->physicalDevice = physicalDevice;
 		this->device = device;
+		if (headless)
+		{
+			// Surface and swapchain extensions may not be enabled in headless mode
+			return;
+		}
 		GET_INSTANCE_PROC_ADDR(instance, GetPhysicalDeviceSurfaceSupportKHR);
 		GET_INSTANCE_PROC_ADDR(instance, GetPhysicalDeviceSurfaceCapabilitiesKHR);
 		GET_INSTANCE_PROC_ADDR(instance, GetPhysicalDeviceSurfaceFormatsKHR);
@@ -280,6 +331,12 @@ public:
 	*/
 	void create(uint32_t *width, uint32_t *height, bool vsync = false)
 	{
+		if (headless)
+		{
+			createHeadless(*width, *height);
+			return;
+		}
+
 		VkSwapchainKHR oldSwapchain = swapChain;
 
 		// Get physical device surface properties and formats
@@ -461,6 +518,22 @@ public:
 	*/
 	VkResult acquireNextImage(VkSemaphore presentCompleteSemaphore, uint32_t *imageIndex)
 	{
+		if (headless)
+		{
+			// Images are used in order, the caller's frame synchronization guarantees that the image is no longer in use
+			*imageIndex = headlessImageIndex;
+			headlessImageIndex = (headlessImageIndex + 1) % imageCount;
+			if (presentCompleteSemaphore == VK_NULL_HANDLE)
+			{
+				return VK_SUCCESS;
+			}
+			// The frame's submission waits on the semaphore, so it still needs to be signaled
+			VkSubmitInfo submitInfo = {};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.pSignalSemaphores = &presentCompleteSemaphore;
+			return vkQueueSubmit(headlessQueue, 1, &submitInfo, VK_NULL_HANDLE);
+		}
 		// By setting timeout to UINT64_MAX we will always wait until the next image has been acquired or an actual error is thrown
 		// With that we don't have to handle VK_NOT_READY
 		return fpAcquireNextImageKHR(device, swapChain, UINT64_MAX, presentCompleteSemaphore, (VkFence)nullptr, imageIndex);
@@ -477,6 +550,21 @@ public:
 	*/
 	VkResult queuePresent(VkQueue queue, uint32_t imageIndex, VkSemaphore waitSemaphore = VK_NULL_HANDLE)
 	{
+		if (headless)
+		{
+			// Nothing is presented, but the semaphore has to be waited on (unsignaled) before it can be signaled again
+			if (waitSemaphore == VK_NULL_HANDLE)
+			{
+				return VK_SUCCESS;
+			}
+			VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+			VkSubmitInfo submitInfo = {};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.waitSemaphoreCount = 1;
+			submitInfo.pWaitSemaphores = &waitSemaphore;
+			submitInfo.pWaitDstStageMask = &waitStageMask;
+			return vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+		}
 		VkPresentInfoKHR presentInfo = {};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 		presentInfo.pNext = NULL;
@@ -498,6 +586,11 @@ public:
 	*/
 	void cleanup()
 	{
+		if (headless)
+		{
+			destroyHeadlessImages();
+			return;
+		}
 		if (swapChain != VK_NULL_HANDLE)
 		{
 			for (uint32_t i = 0; i < imageCount; i++)
@@ -514,6 +607,101 @@ public:
 		swapChain = VK_NULL_HANDLE;
 	}
 
+private:
+	void destroyHeadlessImages()
+	{
+		for (uint32_t i = 0; i < buffers.size(); i++)
+		{
+			vkDestroyImageView(device, buffers[i].view, nullptr);
+			vkDestroyImage(device, buffers[i].image, nullptr);
+			vkFreeMemory(device, headlessMemory[i], nullptr);
+		}
+		buffers.clear();
+		images.clear();
+		headlessMemory.clear();
+	}
+
+	/**
+	* Create the offscreen images used in place of the swap chain images in headless mode
+	* The images use the same usage flags as swap chain images so examples (e.g. screenshots) work unchanged
+	*/
+	void createHeadless(uint32_t width, uint32_t height)
+	{
+		destroyHeadlessImages();
+
+		vkGetDeviceQueue(device, queueNodeIndex, 0, &headlessQueue);
+
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+		imageCount = headlessImageCount;
+		headlessImageIndex = 0;
+		images.resize(imageCount);
+		buffers.resize(imageCount);
+		headlessMemory.resize(imageCount);
+		for (uint32_t i = 0; i < imageCount; i++)
+		{
+			VkImageCreateInfo imageCI = {};
+			imageCI.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageCI.imageType = VK_IMAGE_TYPE_2D;
+			imageCI.format = colorFormat;
+			imageCI.extent = { width, height, 1 };
+			imageCI.mipLevels = 1;
+			imageCI.arrayLayers = 1;
+			imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageCI.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+			imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VK_CHECK_RESULT(vkCreateImage(device, &imageCI, nullptr, &images[i]));
+
+			VkMemoryRequirements memReqs;
+			vkGetImageMemoryRequirements(device, images[i], &memReqs);
+			// Prefer device local memory, fall back to any compatible memory type
+			uint32_t memoryTypeIndex = UINT32_MAX;
+			for (uint32_t j = 0; j < memoryProperties.memoryTypeCount; j++)
+			{
+				if ((memReqs.memoryTypeBits & (1 << j)) == 0)
+				{
+					continue;
+				}
+				if (memoryProperties.memoryTypes[j].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+				{
+					memoryTypeIndex = j;
+					break;
+				}
+				if (memoryTypeIndex == UINT32_MAX)
+				{
+					memoryTypeIndex = j;
+				}
+			}
+			assert(memoryTypeIndex != UINT32_MAX);
+			VkMemoryAllocateInfo memAllocInfo = {};
+			memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			memAllocInfo.allocationSize = memReqs.size;
+			memAllocInfo.memoryTypeIndex = memoryTypeIndex;
+			VK_CHECK_RESULT(vkAllocateMemory(device, &memAllocInfo, nullptr, &headlessMemory[i]));
+			VK_CHECK_RESULT(vkBindImageMemory(device, images[i], headlessMemory[i], 0));
+
+			VkImageViewCreateInfo colorAttachmentView = {};
+			colorAttachmentView.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			colorAttachmentView.format = colorFormat;
+			colorAttachmentView.components = {
+				VK_COMPONENT_SWIZZLE_R,
+				VK_COMPONENT_SWIZZLE_G,
+				VK_COMPONENT_SWIZZLE_B,
+				VK_COMPONENT_SWIZZLE_A
+			};
+			colorAttachmentView.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			colorAttachmentView.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			colorAttachmentView.image = images[i];
+
+			buffers[i].image = images[i];
+			VK_CHECK_RESULT(vkCreateImageView(device, &colorAttachmentView, nullptr, &buffers[i].view));
+		}
+	}
+
+public:
 #if defined(_DIRECT2DISPLAY)
 	/**
 	* Create direct to display surface
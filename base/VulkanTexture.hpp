@@ -12,6 +12,11 @@
 #include <string>
 #include <fstream>
 #include <vector>
+#include <chrono>
+#include <functional>
+#include <atomic>
+#include <iomanip>
+#include <sstream>
 
 #include "vulkan/vulkan.h"
 
@@ -20,6 +25,10 @@
 #include "VulkanTools.h"
 #include "VulkanDevice.hpp"
 #include "VulkanBuffer.hpp"
+#include "VulkanUploadManager.hpp"
+#include "ktxfile.hpp"
+#include "ktx2file.hpp"
+#include "jobsystem.hpp"
 
 #if defined(__ANDROID__)
 #include <android/asset_manager.h>
@@ -27,6 +36,16 @@
 
 namespace vks
 {
+	/** @brief Image data of a single mip level of an array layer (or cube face), points into the loaded file */
+	struct TextureSubresource {
+		uint32_t mipLevel;
+		uint32_t arrayLayer;
+		uint32_t width;
+		uint32_t height;
+		const void *data;
+		VkDeviceSize size;
+	};
+
 	/** @brief Vulkan texture base class */
 	class Texture {
 	public:
@@ -34,6 +53,8 @@ namespace vks
 		VkImage image;
 		VkImageLayout imageLayout;
 		VkDeviceMemory deviceMemory;
+		/** @brief Memory range sub-allocated for the image if the texture has been created by one of the loaders */
+		vks::Allocation allocation;
 		VkImageView view;
 		uint32_t width, height;
 		uint32_t mipLevels;
@@ -43,6 +64,20 @@ namespace vks
 		/** @brief Optional sampler to use with this texture */
 		VkSampler sampler;
 
+		/** @brief Statistics of the last loadFromFile call */
+		struct LoadStats {
+			/** @brief Time from opening the file until the upload has finished (or has been queued if an upload batch is open) in ms */
+			double loadTime = 0.0;
+			/** @brief Size of the image data of all subresources */
+			VkDeviceSize dataSize = 0;
+			/** @brief Size of the file, only known for memory mapped files (smaller than the image data for supercompressed KTX2 files) */
+			VkDeviceSize fileSize = 0;
+			/** @brief Peak resident memory of the process after loading the texture */
+			size_t peakResidentMemory = 0;
+			/** @brief True if the file has been memory mapped and copied (or decoded) straight to staging memory (KTX and KTX2), false if it has been loaded via gli */
+			bool memoryMapped = false;
+		} loadStats;
+
 		/** @brief Update image descriptor from current sampler, view and image layout */
 		void updateDescriptor()
 		{
@@ -60,7 +95,326 @@ namespace vks
 			{
 				vkDestroySampler(device->logicalDevice, sampler, nullptr);
 			}
-			vkFreeMemory(device->logicalDevice, deviceMemory, nullptr);
+			if (allocation.block)
+			{
+				device->memoryAllocator->free(allocation);
+			}
+			else
+			{
+				vkFreeMemory(device->logicalDevice, deviceMemory, nullptr);
+			}
+		}
+
+	protected:
+		/**
+		* Sub-allocate memory for an image from the device's memory allocator and bind it
+		*
+		* @param image Image to allocate memory for
+		* @param memoryPropertyFlags Memory properties for the image's memory
+		* @param resourceType Optimal or linear tiling of the image (required for bufferImageGranularity)
+		*/
+		void allocateImageMemory(VkImage image, VkMemoryPropertyFlags memoryPropertyFlags, vks::AllocationResourceType resourceType)
+		{
+			VkMemoryRequirements memReqs;
+			vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
+			uint32_t memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, memoryPropertyFlags);
+			VK_CHECK_RESULT(device->memoryAllocator->allocate(memReqs, memoryTypeIndex, resourceType, &allocation));
+			deviceMemory = allocation.memory;
+			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, allocation.memory, allocation.offset));
+		}
+
+		/**
+		* Upload image data to the (optimal tiled) texture image and transition it to the final layout
+		* Uses the device's upload manager if present, otherwise the data is copied with a temporary staging buffer on the copy queue
+		*
+		* @param size Size of the staging data in bytes
+		* @param write Called once with a pointer to the staging memory, must write size bytes laid out as described by the regions
+		* @param regions Copy regions with buffer offsets relative to the start of the staging data
+		* @param subresourceRange Subresources of the image covered by the copy regions
+		* @param targetLayout Layout the image is transitioned to after the copy
+		* @param copyQueue Queue used for the staging copy commands if no upload manager is present
+		*/
+		void uploadImageData(VkDeviceSize size, const std::function<void(void *dst)> &write, const std::vector<VkBufferImageCopy> &regions, VkImageSubresourceRange subresourceRange, VkImageLayout targetLayout, VkQueue copyQueue)
+		{
+			this->imageLayout = targetLayout;
+
+			if (device->uploadManager)
+			{
+				device->uploadManager->complete(device->uploadManager->uploadImage(image, subresourceRange, size, write, regions, targetLayout));
+				return;
+			}
+
+			// Create a host-visible staging buffer that receives the raw image data
+			// Staging memory is only used for the upload, so it's taken from a linear block
+			vks::Buffer stagingBuffer;
+			VK_CHECK_RESULT(device->createBuffer(
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&stagingBuffer,
+				size,
+				nullptr,
+				vks::ALLOCATION_STRATEGY_LINEAR));
+			VK_CHECK_RESULT(stagingBuffer.map());
+			write(stagingBuffer.mapped);
+			stagingBuffer.unmap();
+
+			// Use a separate command buffer for texture loading
+			VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+
+			// Image barrier for optimal image (target)
+			// Optimal image will be used as destination for the copy
+			vks::tools::setImageLayout(
+				copyCmd,
+				image,
+				VK_IMAGE_LAYOUT_UNDEFINED,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				subresourceRange);
+
+			// Copy all layers and mip levels from the staging buffer
+			vkCmdCopyBufferToImage(
+				copyCmd,
+				stagingBuffer.buffer,
+				image,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				static_cast<uint32_t>(regions.size()),
+				regions.data());
+
+			// Change texture image layout to the target layout after all layers and mip levels have been copied
+			vks::tools::setImageLayout(
+				copyCmd,
+				image,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				targetLayout,
+				subresourceRange);
+
+			device->flushCommandBuffer(copyCmd, copyQueue);
+
+			// Clean up staging resources
+			stagingBuffer.destroy();
+		}
+
+		/** @brief Upload image data stored in a single contiguous block, see above */
+		void uploadImageData(const void *data, VkDeviceSize size, const std::vector<VkBufferImageCopy> &regions, VkImageSubresourceRange subresourceRange, VkImageLayout targetLayout, VkQueue copyQueue)
+		{
+			uploadImageData(size, [data, size](void *dst) { memcpy(dst, data, size); }, regions, subresourceRange, targetLayout, copyQueue);
+		}
+
+		/** @brief Buffer offsets of copies to an image of the given format need to be a multiple of its texel block size and of 4 */
+		static VkDeviceSize alignCopyOffset(VkDeviceSize offset, VkFormat format)
+		{
+			VkDeviceSize alignment = vks::tools::getFormatBlockSize(format);
+			// Least common multiple of the texel block size and 4
+			while (alignment % 4 != 0) {
+				alignment += vks::tools::getFormatBlockSize(format);
+			}
+			return (offset + alignment - 1) / alignment * alignment;
+		}
+
+		/**
+		* Upload subresources that may be scattered in memory (e.g. inside of a memory mapped file)
+		* Each subresource is copied once, straight from its source into the staging memory
+		*/
+		void uploadSubresources(const std::vector<TextureSubresource> &subresources, VkFormat format, VkImageSubresourceRange subresourceRange, VkImageLayout targetLayout, VkQueue copyQueue)
+		{
+			std::vector<VkBufferImageCopy> bufferCopyRegions;
+			VkDeviceSize offset = 0;
+			for (auto &subresource : subresources)
+			{
+				offset = alignCopyOffset(offset, format);
+
+				VkBufferImageCopy bufferCopyRegion = {};
+				bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				bufferCopyRegion.imageSubresource.mipLevel = subresource.mipLevel;
+				bufferCopyRegion.imageSubresource.baseArrayLayer = subresource.arrayLayer;
+				bufferCopyRegion.imageSubresource.layerCount = 1;
+				bufferCopyRegion.imageExtent.width = subresource.width;
+				bufferCopyRegion.imageExtent.height = subresource.height;
+				bufferCopyRegion.imageExtent.depth = 1;
+				bufferCopyRegion.bufferOffset = offset;
+				bufferCopyRegions.push_back(bufferCopyRegion);
+
+				offset += subresource.size;
+			}
+
+			uploadImageData(offset, [&subresources, &bufferCopyRegions](void *dst) {
+				for (size_t i = 0; i < subresources.size(); i++)
+				{
+					memcpy(static_cast<char*>(dst) + bufferCopyRegions[i].bufferOffset, subresources[i].data, subresources[i].size);
+				}
+			}, bufferCopyRegions, subresourceRange, targetLayout, copyQueue);
+		}
+
+		/** @brief All mip levels, array layers and cube faces of a KTX file, cube faces are stored as array layers */
+		static std::vector<TextureSubresource> getSubresources(const vks::KtxFile &ktxFile)
+		{
+			std::vector<TextureSubresource> subresources;
+			for (uint32_t level = 0; level < ktxFile.levelCount(); level++)
+			{
+				for (uint32_t layer = 0; layer < ktxFile.layerCount(); layer++)
+				{
+					for (uint32_t face = 0; face < ktxFile.faceCount(); face++)
+					{
+						TextureSubresource subresource;
+						size_t size;
+						subresource.mipLevel = level;
+						subresource.arrayLayer = layer * ktxFile.faceCount() + face;
+						subresource.width = ktxFile.width(level);
+						subresource.height = ktxFile.height(level);
+						subresource.data = ktxFile.imageData(level, layer, face, &size);
+						subresource.size = size;
+						subresources.push_back(subresource);
+					}
+				}
+			}
+			return subresources;
+		}
+
+		/** @brief Load a texture file with gli, used for files that can't be memory mapped and parsed by vks::KtxFile (e.g. DDS) */
+		template<typename T>
+		static T loadGliTexture(const std::string &filename)
+		{
+#if defined(__ANDROID__)
+			// Textures are stored inside the apk on Android (compressed)
+			// So they need to be loaded via the asset manager
+			AAsset* asset = AAssetManager_open(androidApp->activity->assetManager, filename.c_str(), AASSET_MODE_STREAMING);
+			if (!asset) {
+				vks::tools::exitFatal("Could not load texture from " + filename + "\n\nThe file may be part of the additional asset pack.\n\nRun \"download_assets.py\" in the repository root to download the latest version.", -1);
+			}
+			size_t size = AAsset_getLength(asset);
+			assert(size > 0);
+
+			void *textureData = malloc(size);
+			AAsset_read(asset, textureData, size);
+			AAsset_close(asset);
+
+			T texture(gli::load((const char*)textureData, size));
+
+			free(textureData);
+#else
+			if (!vks::tools::fileExists(filename)) {
+				vks::tools::exitFatal("Could not load texture from " + filename + "\n\nThe file may be part of the additional asset pack.\n\nRun \"download_assets.py\" in the repository root to download the latest version.", -1);
+			}
+			T texture(gli::load(filename.c_str()));
+#endif
+			assert(!texture.empty());
+			return texture;
+		}
+
+		/** @brief Job system shared by the texture loaders (e.g. for decoding supercompressed levels in parallel), created on first use by the loading thread */
+		static vks::JobSystem& getJobSystem()
+		{
+			static vks::JobSystem jobSystem;
+			return jobSystem;
+		}
+
+		/**
+		* Open a .ktx2 file, returns false for all other file types
+		* Exits if a .ktx2 file can't be loaded or if its format doesn't match the requested format (KTX2 files store their Vulkan format, no conversion is done)
+		*/
+		static bool openKtx2(const std::string &filename, VkFormat format, vks::Ktx2File &ktx2File)
+		{
+			if (!vks::Ktx2File::isKtx2(filename)) {
+				return false;
+			}
+			if (!ktx2File.open(filename)) {
+				vks::tools::exitFatal("Could not load texture from " + filename + "\n\n" + ktx2File.getError(), -1);
+				return false;
+			}
+			if (ktx2File.getFormat() != format) {
+				vks::tools::exitFatal("Could not load texture from " + filename + "\n\nThe file's format (" + std::to_string(ktx2File.getFormat()) + ") does not match the requested format (" + std::to_string(format) + ")", -1);
+				ktx2File.close();
+				return false;
+			}
+			return true;
+		}
+
+		/**
+		* Upload all levels, layers and faces of a KTX2 file
+		* The levels are decoded in parallel straight into the staging memory (supercompressed files) or copied from the mapped file
+		*/
+		void uploadKtx2(const std::string &filename, const vks::Ktx2File &ktx2File, VkImageSubresourceRange subresourceRange, VkImageLayout targetLayout, VkQueue copyQueue)
+		{
+			std::vector<VkBufferImageCopy> bufferCopyRegions;
+			std::vector<VkDeviceSize> levelOffsets;
+			VkDeviceSize offset = 0;
+			for (uint32_t level = 0; level < ktx2File.levelCount(); level++)
+			{
+				offset = alignCopyOffset(offset, ktx2File.getFormat());
+				levelOffsets.push_back(offset);
+				// Layers and faces of a level are stored back to back (tightly packed), so they are copied with a single region
+				// Only the level offset needs to be aligned, faces of formats with 3, 6 or 12 byte texels may not start at a multiple of 4
+				VkBufferImageCopy bufferCopyRegion = {};
+				bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				bufferCopyRegion.imageSubresource.mipLevel = level;
+				bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
+				bufferCopyRegion.imageSubresource.layerCount = ktx2File.layerCount() * ktx2File.faceCount();
+				bufferCopyRegion.imageExtent.width = ktx2File.width(level);
+				bufferCopyRegion.imageExtent.height = ktx2File.height(level);
+				bufferCopyRegion.imageExtent.depth = 1;
+				bufferCopyRegion.bufferOffset = offset;
+				bufferCopyRegions.push_back(bufferCopyRegion);
+				offset += ktx2File.levelSize(level);
+			}
+
+			std::atomic<bool> failed(false);
+			uploadImageData(offset, [&](void *dst) {
+				getJobSystem().parallelFor(ktx2File.levelCount(), [&](uint32_t begin, uint32_t end) {
+					for (uint32_t level = begin; level < end; level++)
+					{
+						if (!ktx2File.decodeLevel(level, static_cast<char*>(dst) + levelOffsets[level]))
+						{
+							failed = true;
+						}
+					}
+				});
+			}, bufferCopyRegions, subresourceRange, targetLayout, copyQueue);
+
+			if (failed)
+			{
+				vks::tools::exitFatal("Could not decode texture " + filename + ", the file is corrupt", -1);
+			}
+		}
+
+		/** @brief Store the load statistics, they are also printed if verbose output is enabled */
+		void updateLoadStats(const std::string &filename, std::chrono::high_resolution_clock::time_point tStart, const vks::Ktx2File &ktx2File, const vks::KtxFile &ktxFile, const std::vector<TextureSubresource> &subresources)
+		{
+			loadStats.loadTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+			loadStats.dataSize = 0;
+			loadStats.fileSize = 0;
+			std::string source = "gli";
+			if (ktx2File.isOpen())
+			{
+				loadStats.dataSize = ktx2File.dataSize();
+				loadStats.fileSize = ktx2File.getFileSize();
+				source = ktx2File.isSupercompressed() ? "ktx2, zstd" : "ktx2";
+			}
+			else
+			{
+				for (auto &subresource : subresources)
+				{
+					loadStats.dataSize += subresource.size;
+				}
+				if (ktxFile.isOpen())
+				{
+					loadStats.fileSize = ktxFile.getFileSize();
+					source = "ktx";
+				}
+			}
+			loadStats.peakResidentMemory = vks::tools::getPeakResidentMemory();
+			loadStats.memoryMapped = ktx2File.isOpen() || ktxFile.isOpen();
+			if (vks::tools::verboseOutput)
+			{
+				std::stringstream stats;
+				stats << std::fixed << std::setprecision(2);
+				stats << "Loaded texture " << filename << " (" << source << (loadStats.memoryMapped ? ", mapped" : "") << ") in " << loadStats.loadTime << " ms, ";
+				stats << (loadStats.dataSize / (1024.0 * 1024.0)) << " MB image data";
+				if (loadStats.fileSize > 0)
+				{
+					stats << " (" << (loadStats.fileSize / (1024.0 * 1024.0)) << " MB file)";
+				}
+				stats << ", peak resident memory " << (loadStats.peakResidentMemory / (1024.0 * 1024.0)) << " MB";
+				std::cout << stats.str() << std::endl;
+			}
 		}
 	};
 
@@ -88,35 +442,42 @@ namespace vks
 			VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 
 			bool forceLinear = false)
 		{
-#if defined(__ANDROID__)
-			// Textures are stored inside the apk on Android (compressed)
-			// So they need to be loaded via the asset manager
-			AAsset* asset = AAssetManager_open(androidApp->activity->assetManager, filename.c_str(), AASSET_MODE_STREAMING);
-			if (!asset) {
-				vks::tools::exitFatal("Could not load texture from " + filename + "\n\nThe file may be part of the additional asset pack.\n\nRun \"download_assets.py\" in the repository root to download the latest version.", -1);
+			const auto tStart = std::chrono::high_resolution_clock::now();
+
+			// KTX and KTX2 files are memory mapped and the image data is copied (or decoded) straight from the mapping to the staging memory
+			// Other formats (and KTX files that can't be parsed in place) are loaded via gli
+			vks::Ktx2File ktx2File;
+			vks::KtxFile ktxFile;
+			gli::texture2d tex2D;
+			std::vector<TextureSubresource> subresources;
+			if (openKtx2(filename, format, ktx2File))
+			{
+				assert((ktx2File.faceCount() == 1) && (ktx2File.layerCount() == 1));
+				width = ktx2File.width();
+				height = ktx2File.height();
+				mipLevels = ktx2File.levelCount();
 			}
-			size_t size = AAsset_getLength(asset);
-			assert(size > 0);
-
-			void *textureData = malloc(size);
-			AAsset_read(asset, textureData, size);
-			AAsset_close(asset);
-
-			gli::texture2d tex2D(gli::load((const char*)textureData, size));
-
-			free(textureData);
-#else
-			if (!vks::tools::fileExists(filename)) {
-				vks::tools::exitFatal("Could not load texture from " + filename + "\n\nThe file may be part of the additional asset pack.\n\nRun \"download_assets.py\" in the repository root to download the latest version.", -1);
+			else if (ktxFile.open(filename))
+			{
+				assert(ktxFile.faceCount() == 1);
+				subresources = getSubresources(ktxFile);
+				width = ktxFile.width();
+				height = ktxFile.height();
+				mipLevels = ktxFile.levelCount();
+			}
+			else
+			{
+				tex2D = loadGliTexture<gli::texture2d>(filename);
+				for (uint32_t level = 0; level < static_cast<uint32_t>(tex2D.levels()); level++)
+				{
+					subresources.push_back({ level, 0, static_cast<uint32_t>(tex2D[level].extent().x), static_cast<uint32_t>(tex2D[level].extent().y), tex2D[level].data(), tex2D[level].size() });
+				}
+				width = static_cast<uint32_t>(tex2D[0].extent().x);
+				height = static_cast<uint32_t>(tex2D[0].extent().y);
+				mipLevels = static_cast<uint32_t>(tex2D.levels());
 			}
-			gli::texture2d tex2D(gli::load(filename.c_str()));
-#endif		
-			assert(!tex2D.empty());
 
 			this->device = device;
-			width = static_cast<uint32_t>(tex2D[0].extent().x);
-			height = static_cast<uint32_t>(tex2D[0].extent().y);
-			mipLevels = static_cast<uint32_t>(tex2D.levels());
 
 			// Get device properites for the requested texture format
 			VkFormatProperties formatProperties;
@@ -129,63 +490,8 @@ namespace vks
 			// limited amount of formats and features (mip maps, cubemaps, arrays, etc.)
 			VkBool32 useStaging = !forceLinear;
 
-			VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
-			VkMemoryRequirements memReqs;
-
-			// Use a separate command buffer for texture loading
-			VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
 			if (useStaging)
 			{
-				// Create a host-visible staging buffer that contains the raw image data
-				VkBuffer stagingBuffer;
-				VkDeviceMemory stagingMemory;
-
-				VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-				bufferCreateInfo.size = tex2D.size();
-				// This buffer is used as a transfer source for the buffer copy
-				bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-				bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-				VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-				// Get memory requirements for the staging buffer (alignment, memory type bits)
-				vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-
-				memAllocInfo.allocationSize = memReqs.size;
-				// Get memory type index for a host visible buffer
-				memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-				VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-				VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-				// Copy texture data into staging buffer
-				uint8_t *data;
-				VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-				memcpy(data, tex2D.data(), tex2D.size());
-				vkUnmapMemory(device->logicalDevice, stagingMemory);
-
-				// Setup buffer copy regions for each mip level
-				std::vector<VkBufferImageCopy> bufferCopyRegions;
-				uint32_t offset = 0;
-
-				for (uint32_t i = 0; i < mipLevels; i++)
-				{
-					VkBufferImageCopy bufferCopyRegion = {};
-					bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-					bufferCopyRegion.imageSubresource.mipLevel = i;
-					bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
-					bufferCopyRegion.imageSubresource.layerCount = 1;
-					bufferCopyRegion.imageExtent.width = static_cast<uint32_t>(tex2D[i].extent().x);
-					bufferCopyRegion.imageExtent.height = static_cast<uint32_t>(tex2D[i].extent().y);
-					bufferCopyRegion.imageExtent.depth = 1;
-					bufferCopyRegion.bufferOffset = offset;
-
-					bufferCopyRegions.push_back(bufferCopyRegion);
-
-					offset += static_cast<uint32_t>(tex2D[i].size());
-				}
-
 				// Create optimal tiled target image
 				VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
 				imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -205,13 +511,7 @@ namespace vks
 				}
 				VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
 
-				vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-
-				memAllocInfo.allocationSize = memReqs.size;
-
-				memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-				VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-				VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+				allocateImageMemory(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vks::ALLOCATION_RESOURCE_OPTIMAL);
 
 				VkImageSubresourceRange subresourceRange = {};
 				subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -219,39 +519,15 @@ namespace vks
 				subresourceRange.levelCount = mipLevels;
 				subresourceRange.layerCount = 1;
 
-				// Image barrier for optimal image (target)
-				// Optimal image will be used as destination for the copy
-				vks::tools::setImageLayout(
-					copyCmd,
-					image,
-					VK_IMAGE_LAYOUT_UNDEFINED,
-					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-					subresourceRange);
-
-				// Copy mip levels from staging buffer
-				vkCmdCopyBufferToImage(
-					copyCmd,
-					stagingBuffer,
-					image,
-					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-					static_cast<uint32_t>(bufferCopyRegions.size()),
-					bufferCopyRegions.data()
-				);
-
-				// Change texture image layout to shader read after all mip levels have been copied
-				this->imageLayout = imageLayout;
-				vks::tools::setImageLayout(
-					copyCmd,
-					image,
-					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-					imageLayout,
-					subresourceRange);
-
-				device->flushCommandBuffer(copyCmd, copyQueue);
-
-				// Clean up staging resources
-				vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-				vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
+				// Copy all mip levels and change the texture image layout to shader read afterwards
+				if (ktx2File.isOpen())
+				{
+					uploadKtx2(filename, ktx2File, subresourceRange, imageLayout, copyQueue);
+				}
+				else
+				{
+					uploadSubresources(subresources, format, subresourceRange, imageLayout, copyQueue);
+				}
 			}
 			else
 			{
@@ -263,7 +539,6 @@ namespace vks
 				assert(formatProperties.linearTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
 
 				VkImage mappableImage;
-				VkDeviceMemory mappableMemory;
 
 				VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
 				imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -280,20 +555,9 @@ namespace vks
 				// Load mip map level 0 to linear tiling image
 				VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &mappableImage));
 
-				// Get memory requirements for this image 
-				// like size and alignment
-				vkGetImageMemoryRequirements(device->logicalDevice, mappableImage, &memReqs);
-				// Set memory allocation size to required memory size
-				memAllocInfo.allocationSize = memReqs.size;
-
-				// Get memory type that can be mapped to host memory
-				memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-				// Allocate host memory
-				VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &mappableMemory));
-
-				// Bind allocated image for use
-				VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, mappableImage, mappableMemory, 0));
+				// Allocate and bind memory that can be mapped to host memory
+				// Host visible memory is persistently mapped by the allocator
+				allocateImageMemory(mappableImage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, vks::ALLOCATION_RESOURCE_LINEAR);
 
 				// Get sub resource layout
 				// Mip map count, array layer, etc.
@@ -302,32 +566,35 @@ namespace vks
 				subRes.mipLevel = 0;
 
 				VkSubresourceLayout subResLayout;
-				void *data;
 
 				// Get sub resources layout 
 				// Includes row pitch, size offsets, etc.
 				vkGetImageSubresourceLayout(device->logicalDevice, mappableImage, &subRes, &subResLayout);
 
-				// Map image memory
-				VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, mappableMemory, 0, memReqs.size, 0, &data));
-
 				// Copy image data into memory
-				memcpy(data, tex2D[subRes.mipLevel].data(), tex2D[subRes.mipLevel].size());
-
-				vkUnmapMemory(device->logicalDevice, mappableMemory);
+				if (ktx2File.isOpen())
+				{
+					ktx2File.decodeLevel(subRes.mipLevel, allocation.mapped);
+				}
+				else
+				{
+					memcpy(allocation.mapped, subresources[subRes.mipLevel].data, subresources[subRes.mipLevel].size);
+				}
 
 				// Linear tiled images don't need to be staged
 				// and can be directly used as textures
 				image = mappableImage;
-				deviceMemory = mappableMemory;
 				this->imageLayout = imageLayout;
 
 				// Setup image memory barrier
+				VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
 				vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, imageLayout);
 
 				device->flushCommandBuffer(copyCmd, copyQueue);
 			}
 
+			updateLoadStats(filename, tStart, ktx2File, ktxFile, subresources);
+
 			// Create a defaultsampler
 			VkSamplerCreateInfo samplerCreateInfo = {};
 			samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -401,40 +668,6 @@ namespace vks
 			height = texHeight;
 			mipLevels = 1;
 
-			VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
-			VkMemoryRequirements memReqs;
-
-			// Use a separate command buffer for texture loading
-			VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-			// Create a host-visible staging buffer that contains the raw image data
-			VkBuffer stagingBuffer;
-			VkDeviceMemory stagingMemory;
-
-			VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-			bufferCreateInfo.size = bufferSize;
-			// This buffer is used as a transfer source for the buffer copy
-			bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-			bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-			VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-			// Get memory requirements for the staging buffer (alignment, memory type bits)
-			vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-
-			memAllocInfo.allocationSize = memReqs.size;
-			// Get memory type index for a host visible buffer
-			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-			VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-			// Copy texture data into staging buffer
-			uint8_t *data;
-			VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-			memcpy(data, buffer, bufferSize);
-			vkUnmapMemory(device->logicalDevice, stagingMemory);
-
 			VkBufferImageCopy bufferCopyRegion = {};
 			bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			bufferCopyRegion.imageSubresource.mipLevel = 0;
@@ -464,13 +697,7 @@ namespace vks
 			}
 			VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
 
-			vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-
-			memAllocInfo.allocationSize = memReqs.size;
-
-			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+			allocateImageMemory(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vks::ALLOCATION_RESOURCE_OPTIMAL);
 
 			VkImageSubresourceRange subresourceRange = {};
 			subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -478,39 +705,8 @@ namespace vks
 			subresourceRange.levelCount = mipLevels;
 			subresourceRange.layerCount = 1;
 
-			// Image barrier for optimal image (target)
-			// Optimal image will be used as destination for the copy
-			vks::tools::setImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_UNDEFINED,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				subresourceRange);
-
-			// Copy mip levels from staging buffer
-			vkCmdCopyBufferToImage(
-				copyCmd,
-				stagingBuffer,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				1,
-				&bufferCopyRegion
-			);
-
-			// Change texture image layout to shader read after all mip levels have been copied
-			this->imageLayout = imageLayout;
-			vks::tools::setImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				imageLayout,
-				subresourceRange);
-
-			device->flushCommandBuffer(copyCmd, copyQueue);
-
-			// Clean up staging resources
-			vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-			vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
+			// Copy the buffer data and change the texture image layout to shader read afterwards
+			uploadImageData(buffer, bufferSize, { bufferCopyRegion }, subresourceRange, imageLayout, copyQueue);
 
 			// Create sampler
 			VkSamplerCreateInfo samplerCreateInfo = {};
@@ -568,93 +764,48 @@ namespace vks
 			VkImageUsageFlags imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT,
 			VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
 		{
-#if defined(__ANDROID__)
-			// Textures are stored inside the apk on Android (compressed)
-			// So they need to be loaded via the asset manager
-			AAsset* asset = AAssetManager_open(androidApp->activity->assetManager, filename.c_str(), AASSET_MODE_STREAMING);
-			if (!asset) {
-				vks::tools::exitFatal("Could not load texture from " + filename + "\n\nThe file may be part of the additional asset pack.\n\nRun \"download_assets.py\" in the repository root to download the latest version.", -1);
+			const auto tStart = std::chrono::high_resolution_clock::now();
+
+			// KTX and KTX2 files are memory mapped and the image data is copied (or decoded) straight from the mapping to the staging memory
+			vks::Ktx2File ktx2File;
+			vks::KtxFile ktxFile;
+			gli::texture2d_array tex2DArray;
+			std::vector<TextureSubresource> subresources;
+			if (openKtx2(filename, format, ktx2File))
+			{
+				assert(ktx2File.faceCount() == 1);
+				width = ktx2File.width();
+				height = ktx2File.height();
+				layerCount = ktx2File.layerCount();
+				mipLevels = ktx2File.levelCount();
 			}
-			size_t size = AAsset_getLength(asset);
-			assert(size > 0);
-
-			void *textureData = malloc(size);
-			AAsset_read(asset, textureData, size);
-			AAsset_close(asset);
-
-			gli::texture2d_array tex2DArray(gli::load((const char*)textureData, size));
-
-			free(textureData);
-#else
-			if (!vks::tools::fileExists(filename)) {
-				vks::tools::exitFatal("Could not load texture from " + filename + "\n\nThe file may be part of the additional asset pack.\n\nRun \"download_assets.py\" in the repository root to download the latest version.", -1);
+			else if (ktxFile.open(filename))
+			{
+				assert(ktxFile.faceCount() == 1);
+				subresources = getSubresources(ktxFile);
+				width = ktxFile.width();
+				height = ktxFile.height();
+				layerCount = ktxFile.layerCount();
+				mipLevels = ktxFile.levelCount();
 			}
-			gli::texture2d_array tex2DArray(gli::load(filename));
-#endif	
-			assert(!tex2DArray.empty());
-
-			this->device = device;
-			width = static_cast<uint32_t>(tex2DArray.extent().x);
-			height = static_cast<uint32_t>(tex2DArray.extent().y);
-			layerCount = static_cast<uint32_t>(tex2DArray.layers());
-			mipLevels = static_cast<uint32_t>(tex2DArray.levels());
-
-			VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
-			VkMemoryRequirements memReqs;
-
-			// Create a host-visible staging buffer that contains the raw image data
-			VkBuffer stagingBuffer;
-			VkDeviceMemory stagingMemory;
-
-			VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-			bufferCreateInfo.size = tex2DArray.size();
-			// This buffer is used as a transfer source for the buffer copy
-			bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-			bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-			VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-			// Get memory requirements for the staging buffer (alignment, memory type bits)
-			vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-
-			memAllocInfo.allocationSize = memReqs.size;
-			// Get memory type index for a host visible buffer
-			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-			VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-			// Copy texture data into staging buffer
-			uint8_t *data;
-			VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-			memcpy(data, tex2DArray.data(), static_cast<size_t>(tex2DArray.size()));
-			vkUnmapMemory(device->logicalDevice, stagingMemory);
-
-			// Setup buffer copy regions for each layer including all of it's miplevels
-			std::vector<VkBufferImageCopy> bufferCopyRegions;
-			size_t offset = 0;
-
-			for (uint32_t layer = 0; layer < layerCount; layer++)
+			else
 			{
-				for (uint32_t level = 0; level < mipLevels; level++)
+				tex2DArray = loadGliTexture<gli::texture2d_array>(filename);
+				width = static_cast<uint32_t>(tex2DArray.extent().x);
+				height = static_cast<uint32_t>(tex2DArray.extent().y);
+				layerCount = static_cast<uint32_t>(tex2DArray.layers());
+				mipLevels = static_cast<uint32_t>(tex2DArray.levels());
+				for (uint32_t layer = 0; layer < layerCount; layer++)
 				{
-					VkBufferImageCopy bufferCopyRegion = {};
-					bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-					bufferCopyRegion.imageSubresource.mipLevel = level;
-					bufferCopyRegion.imageSubresource.baseArrayLayer = layer;
-					bufferCopyRegion.imageSubresource.layerCount = 1;
-					bufferCopyRegion.imageExtent.width = static_cast<uint32_t>(tex2DArray[layer][level].extent().x);
-					bufferCopyRegion.imageExtent.height = static_cast<uint32_t>(tex2DArray[layer][level].extent().y);
-					bufferCopyRegion.imageExtent.depth = 1;
-					bufferCopyRegion.bufferOffset = offset;
-
-					bufferCopyRegions.push_back(bufferCopyRegion);
-
-					// Increase offset into staging buffer for next level / face
-					offset += tex2DArray[layer][level].size();
+					for (uint32_t level = 0; level < mipLevels; level++)
+					{
+						subresources.push_back({ level, layer, static_cast<uint32_t>(tex2DArray[layer][level].extent().x), static_cast<uint32_t>(tex2DArray[layer][level].extent().y), tex2DArray[layer][level].data(), tex2DArray[layer][level].size() });
+					}
 				}
 			}
 
+			this->device = device;
+
 			// Create optimal tiled target image
 			VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
 			imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -675,51 +826,26 @@ namespace vks
 
 			VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
 
-			vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-
-			memAllocInfo.allocationSize = memReqs.size;
-			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			allocateImageMemory(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vks::ALLOCATION_RESOURCE_OPTIMAL);
 
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
-
-			// Use a separate command buffer for texture loading
-			VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-			// Image barrier for optimal image (target)
-			// Set initial layout for all array layers (faces) of the optimal (target) tiled texture
+			// Subresource range covering all array layers of the optimal (target) tiled texture
 			VkImageSubresourceRange subresourceRange = {};
 			subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			subresourceRange.baseMipLevel = 0;
 			subresourceRange.levelCount = mipLevels;
 			subresourceRange.layerCount = layerCount;
 
-			vks::tools::setImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_UNDEFINED,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				subresourceRange);
-
-			// Copy the layers and mip levels from the staging buffer to the optimal tiled image
-			vkCmdCopyBufferToImage(
-				copyCmd,
-				stagingBuffer,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				static_cast<uint32_t>(bufferCopyRegions.size()),
-				bufferCopyRegions.data());
-
-			// Change texture image layout to shader read after all faces have been copied
-			this->imageLayout = imageLayout;
-			vks::tools::setImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				imageLayout,
-				subresourceRange);
+			// Copy the layers and mip levels to the optimal tiled image and change the texture image layout to shader read afterwards
+			if (ktx2File.isOpen())
+			{
+				uploadKtx2(filename, ktx2File, subresourceRange, imageLayout, copyQueue);
+			}
+			else
+			{
+				uploadSubresources(subresources, format, subresourceRange, imageLayout, copyQueue);
+			}
 
-			device->flushCommandBuffer(copyCmd, copyQueue);
+			updateLoadStats(filename, tStart, ktx2File, ktxFile, subresources);
 
 			// Create sampler
 			VkSamplerCreateInfo samplerCreateInfo = vks::initializers::samplerCreateInfo();
@@ -749,10 +875,6 @@ namespace vks
 			viewCreateInfo.image = image;
 			VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &view));
 
-			// Clean up staging resources
-			vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-			vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-
 			// Update descriptor image info member that can be used for setting up descriptor sets
 			updateDescriptor();
 		}
@@ -780,92 +902,47 @@ namespace vks
 			VkImageUsageFlags imageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT,
 			VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
 		{
-#if defined(__ANDROID__)
-			// Textures are stored inside the apk on Android (compressed)
-			// So they need to be loaded via the asset manager
-			AAsset* asset = AAssetManager_open(androidApp->activity->assetManager, filename.c_str(), AASSET_MODE_STREAMING);
-			if (!asset) {
-				vks::tools::exitFatal("Could not load texture from " + filename + "\n\nThe file may be part of the additional asset pack.\n\nRun \"download_assets.py\" in the repository root to download the latest version.", -1);
+			const auto tStart = std::chrono::high_resolution_clock::now();
+
+			// KTX and KTX2 files are memory mapped and the image data is copied (or decoded) straight from the mapping to the staging memory
+			vks::Ktx2File ktx2File;
+			vks::KtxFile ktxFile;
+			gli::texture_cube texCube;
+			std::vector<TextureSubresource> subresources;
+			if (openKtx2(filename, format, ktx2File))
+			{
+				// Cube faces are stored as array layers (layer * 6 + face)
+				assert((ktx2File.faceCount() == 6) && (ktx2File.layerCount() == 1));
+				width = ktx2File.width();
+				height = ktx2File.height();
+				mipLevels = ktx2File.levelCount();
 			}
-			size_t size = AAsset_getLength(asset);
-			assert(size > 0);
-
-			void *textureData = malloc(size);
-			AAsset_read(asset, textureData, size);
-			AAsset_close(asset);
-
-			gli::texture_cube texCube(gli::load((const char*)textureData, size));
-
-			free(textureData);
-#else
-			if (!vks::tools::fileExists(filename)) {
-				vks::tools::exitFatal("Could not load texture from " + filename + "\n\nThe file may be part of the additional asset pack.\n\nRun \"download_assets.py\" in the repository root to download the latest version.", -1);
+			else if (ktxFile.open(filename))
+			{
+				// Cube faces are stored as array layers (layer * 6 + face)
+				assert((ktxFile.faceCount() == 6) && (ktxFile.layerCount() == 1));
+				subresources = getSubresources(ktxFile);
+				width = ktxFile.width();
+				height = ktxFile.height();
+				mipLevels = ktxFile.levelCount();
 			}
-			gli::texture_cube texCube(gli::load(filename));
-#endif	
-			assert(!texCube.empty());
-
-			this->device = device;
-			width = static_cast<uint32_t>(texCube.extent().x);
-			height = static_cast<uint32_t>(texCube.extent().y);
-			mipLevels = static_cast<uint32_t>(texCube.levels());
-
-			VkMemoryAllocateInfo memAllocInfo = vks::initializers::memoryAllocateInfo();
-			VkMemoryRequirements memReqs;
-
-			// Create a host-visible staging buffer that contains the raw image data
-			VkBuffer stagingBuffer;
-			VkDeviceMemory stagingMemory;
-
-			VkBufferCreateInfo bufferCreateInfo = vks::initializers::bufferCreateInfo();
-			bufferCreateInfo.size = texCube.size();
-			// This buffer is used as a transfer source for the buffer copy
-			bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-			bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-			VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-
-			// Get memory requirements for the staging buffer (alignment, memory type bits)
-			vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-
-			memAllocInfo.allocationSize = memReqs.size;
-			// Get memory type index for a host visible buffer
-			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-			VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-			// Copy texture data into staging buffer
-			uint8_t *data;
-			VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-			memcpy(data, texCube.data(), texCube.size());
-			vkUnmapMemory(device->logicalDevice, stagingMemory);
-
-			// Setup buffer copy regions for each face including all of it's miplevels
-			std::vector<VkBufferImageCopy> bufferCopyRegions;
-			size_t offset = 0;
-
-			for (uint32_t face = 0; face < 6; face++)
+			else
 			{
-				for (uint32_t level = 0; level < mipLevels; level++)
+				texCube = loadGliTexture<gli::texture_cube>(filename);
+				width = static_cast<uint32_t>(texCube.extent().x);
+				height = static_cast<uint32_t>(texCube.extent().y);
+				mipLevels = static_cast<uint32_t>(texCube.levels());
+				for (uint32_t face = 0; face < 6; face++)
 				{
-					VkBufferImageCopy bufferCopyRegion = {};
-					bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-					bufferCopyRegion.imageSubresource.mipLevel = level;
-					bufferCopyRegion.imageSubresource.baseArrayLayer = face;
-					bufferCopyRegion.imageSubresource.layerCount = 1;
-					bufferCopyRegion.imageExtent.width = static_cast<uint32_t>(texCube[face][level].extent().x);
-					bufferCopyRegion.imageExtent.height = static_cast<uint32_t>(texCube[face][level].extent().y);
-					bufferCopyRegion.imageExtent.depth = 1;
-					bufferCopyRegion.bufferOffset = offset;
-
-					bufferCopyRegions.push_back(bufferCopyRegion);
-
-					// Increase offset into staging buffer for next level / face
-					offset += texCube[face][level].size();
+					for (uint32_t level = 0; level < mipLevels; level++)
+					{
+						subresources.push_back({ level, face, static_cast<uint32_t>(texCube[face][level].extent().x), static_cast<uint32_t>(texCube[face][level].extent().y), texCube[face][level].data(), texCube[face][level].size() });
+					}
 				}
 			}
 
+			this->device = device;
+
 			// Create optimal tiled target image
 			VkImageCreateInfo imageCreateInfo = vks::initializers::imageCreateInfo();
 			imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -890,51 +967,26 @@ namespace vks
 
 			VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
 
-			vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-
-			memAllocInfo.allocationSize = memReqs.size;
-			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+			allocateImageMemory(image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vks::ALLOCATION_RESOURCE_OPTIMAL);
 
-			// Use a separate command buffer for texture loading
-			VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-			// Image barrier for optimal image (target)
-			// Set initial layout for all array layers (faces) of the optimal (target) tiled texture
+			// Subresource range covering all array layers (faces) of the optimal (target) tiled texture
 			VkImageSubresourceRange subresourceRange = {};
 			subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 			subresourceRange.baseMipLevel = 0;
 			subresourceRange.levelCount = mipLevels;
 			subresourceRange.layerCount = 6;
 
-			vks::tools::setImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_UNDEFINED,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				subresourceRange);
-
-			// Copy the cube map faces from the staging buffer to the optimal tiled image
-			vkCmdCopyBufferToImage(
-				copyCmd,
-				stagingBuffer,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				static_cast<uint32_t>(bufferCopyRegions.size()),
-				bufferCopyRegions.data());
-
-			// Change texture image layout to shader read after all faces have been copied
-			this->imageLayout = imageLayout;
-			vks::tools::setImageLayout(
-				copyCmd,
-				image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				imageLayout,
-				subresourceRange);
+			// Copy the cube map faces to the optimal tiled image and change the texture image layout to shader read afterwards
+			if (ktx2File.isOpen())
+			{
+				uploadKtx2(filename, ktx2File, subresourceRange, imageLayout, copyQueue);
+			}
+			else
+			{
+				uploadSubresources(subresources, format, subresourceRange, imageLayout, copyQueue);
+			}
 
-			device->flushCommandBuffer(copyCmd, copyQueue);
+			updateLoadStats(filename, tStart, ktx2File, ktxFile, subresources);
 
 			// Create sampler
 			VkSamplerCreateInfo samplerCreateInfo = vks::initializers::samplerCreateInfo();
@@ -964,10 +1016,6 @@ namespace vks
 			viewCreateInfo.image = image;
 			VK_CHECK_RESULT(vkCreateImageView(device->logicalDevice, &viewCreateInfo, nullptr, &view));
 
-			// Clean up staging resources
-			vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-			vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
-
 			// Update descriptor image info member that can be used for setting up descriptor sets
 			updateDescriptor();
 		}
@@ -8,11 +8,20 @@
 
 #include "VulkanTools.h"
 
+#if defined(_WIN32)
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
 namespace vks
 {
 	namespace tools
 	{
 		bool errorModeSilent = false;
+		bool meshCacheEnabled = false;
+		bool verboseOutput = false;
 
 		std::string errorString(VkResult errorCode)
 		{
@@ -89,6 +98,58 @@ namespace vks
 			return false;
 		}
 
+		uint32_t getFormatBlockSize(VkFormat format)
+		{
+			if (format == VK_FORMAT_R4G4_UNORM_PACK8 || (format >= VK_FORMAT_R8_UNORM && format <= VK_FORMAT_R8_SRGB)) {
+				return 1;
+			}
+			if ((format >= VK_FORMAT_R4G4B4A4_UNORM_PACK16 && format <= VK_FORMAT_A1R5G5B5_UNORM_PACK16) ||
+				(format >= VK_FORMAT_R8G8_UNORM && format <= VK_FORMAT_R8G8_SRGB) ||
+				(format >= VK_FORMAT_R16_UNORM && format <= VK_FORMAT_R16_SFLOAT) ||
+				format == VK_FORMAT_D16_UNORM) {
+				return 2;
+			}
+			if (format >= VK_FORMAT_R8G8B8_UNORM && format <= VK_FORMAT_B8G8R8_SRGB) {
+				return 3;
+			}
+			if ((format >= VK_FORMAT_R8G8B8A8_UNORM && format <= VK_FORMAT_A2B10G10R10_SINT_PACK32) ||
+				(format >= VK_FORMAT_R16G16_UNORM && format <= VK_FORMAT_R16G16_SFLOAT) ||
+				(format >= VK_FORMAT_R32_UINT && format <= VK_FORMAT_R32_SFLOAT) ||
+				(format >= VK_FORMAT_B10G11R11_UFLOAT_PACK32 && format <= VK_FORMAT_D32_SFLOAT)) {
+				return 4;
+			}
+			if (format >= VK_FORMAT_R16G16B16_UNORM && format <= VK_FORMAT_R16G16B16_SFLOAT) {
+				return 6;
+			}
+			if ((format >= VK_FORMAT_R16G16B16A16_UNORM && format <= VK_FORMAT_R16G16B16A16_SFLOAT) ||
+				(format >= VK_FORMAT_R32G32_UINT && format <= VK_FORMAT_R32G32_SFLOAT) ||
+				(format >= VK_FORMAT_R64_UINT && format <= VK_FORMAT_R64_SFLOAT)) {
+				return 8;
+			}
+			if (format >= VK_FORMAT_R32G32B32_UINT && format <= VK_FORMAT_R32G32B32_SFLOAT) {
+				return 12;
+			}
+			if ((format >= VK_FORMAT_R32G32B32A32_UINT && format <= VK_FORMAT_R32G32B32A32_SFLOAT) ||
+				(format >= VK_FORMAT_R64G64_UINT && format <= VK_FORMAT_R64G64_SFLOAT)) {
+				return 16;
+			}
+			if (format >= VK_FORMAT_R64G64B64_UINT && format <= VK_FORMAT_R64G64B64_SFLOAT) {
+				return 24;
+			}
+			if (format >= VK_FORMAT_R64G64B64A64_UINT && format <= VK_FORMAT_R64G64B64A64_SFLOAT) {
+				return 32;
+			}
+			// 64 bit blocks: BC1, BC4, ETC2 RGB(A1) and EAC R11
+			if ((format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC1_RGBA_SRGB_BLOCK) ||
+				(format >= VK_FORMAT_BC4_UNORM_BLOCK && format <= VK_FORMAT_BC4_SNORM_BLOCK) ||
+				(format >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && format <= VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK) ||
+				(format >= VK_FORMAT_EAC_R11_UNORM_BLOCK && format <= VK_FORMAT_EAC_R11_SNORM_BLOCK)) {
+				return 8;
+			}
+			// All other block compressed formats (BC2, BC3, BC5-BC7, ETC2 RGBA, EAC RG11 and ASTC) use 128 bit blocks
+			return 16;
+		}
+
 		// Create an image memory barrier for changing the layout of
 		// an image and put it into an active command buffer
 		// See chapter 11.4 "Image Layout" for details
@@ -395,5 +456,28 @@ namespace vks
 			std::ifstream f(filename.c_str());
 			return !f.fail();
 		}
+
+		size_t getPeakResidentMemory()
+		{
+#if defined(_WIN32)
+			PROCESS_MEMORY_COUNTERS counters;
+			if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+				return static_cast<size_t>(counters.PeakWorkingSetSize);
+			}
+			return 0;
+#else
+			struct rusage usage;
+			if (getrusage(RUSAGE_SELF, &usage) != 0) {
+				return 0;
+			}
+#if defined(__APPLE__)
+			// Reported in bytes on macOS
+			return static_cast<size_t>(usage.ru_maxrss);
+#else
+			// Reported in kilobytes on Linux and Android
+			return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+		}
 	}
 }
\ No newline at end of file
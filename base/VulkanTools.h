@@ -72,6 +72,11 @@ namespace vks
 		/** @brief Disable message boxes on fatal errors */
 		extern bool errorModeSilent;
 
+		/** @brief Store processed meshes in a disk cache (see vks::Model::useCache), opt-in via the "-meshcache" command line argument */
+		extern bool meshCacheEnabled;
+		/** @brief Print loader diagnostics (e.g. load timings) to stdout, enabled via the "-verbose" command line argument */
+		extern bool verboseOutput;
+
 		/** @brief Returns an error code as a string */
 		std::string errorString(VkResult errorCode);
 
@@ -82,6 +87,10 @@ namespace vks
 		// Returns false if none of the depth formats in the list is supported by the device
 		VkBool32 getSupportedDepthFormat(VkPhysicalDevice physicalDevice, VkFormat *depthFormat);
 
+		// Returns the size in bytes of a texel (uncompressed formats) or of a block (compressed formats) of the given color format
+		// Buffer offsets of buffer to image copies need to be a multiple of this size
+		uint32_t getFormatBlockSize(VkFormat format);
+
 		// Put an image memory barrier for setting an image layout on the sub resource into the given command buffer
 		void setImageLayout(
 			VkCommandBuffer cmdbuffer,
@@ -130,5 +139,8 @@ namespace vks
 
 		/** @brief Checks if a file exists */
 		bool fileExists(const std::string &filename);
+
+		/** @brief Peak resident set size (working set on Windows) of the process in bytes, 0 if not available */
+		size_t getPeakResidentMemory();
 	}
 }
@@ -0,0 +1,634 @@
+/*
+* Vulkan upload manager
+*
+* Batches buffer and image uploads from host memory into few queue submissions
+* Staging data is placed in a persistently mapped ring buffer and copies are done on a dedicated
+* transfer queue (if the device offers one) with queue family ownership transfers to the graphics queue
+*
+* Copyright (C) 2016-2017 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <functional>
+#include <algorithm>
+#include <string.h>
+#include <assert.h>
+
+#include "vulkan/vulkan.h"
+#include "VulkanTools.h"
+#include "VulkanDevice.hpp"
+#include "VulkanBuffer.hpp"
+
+namespace vks
+{
+	/** @brief Identifies a batch of uploads that can be waited on, tokens increase in submission order */
+	typedef uint64_t UploadToken;
+
+	class UploadManager
+	{
+	private:
+		/** @brief Uploads recorded into a single submission */
+		struct Batch
+		{
+			UploadToken token = 0;
+			/** @brief Copy commands, submitted to the transfer queue */
+			VkCommandBuffer copyCmd = VK_NULL_HANDLE;
+			/** @brief Ownership acquire barriers, submitted to the graphics queue (only used with a dedicated transfer queue) */
+			VkCommandBuffer acquireCmd = VK_NULL_HANDLE;
+			VkSemaphore semaphore = VK_NULL_HANDLE;
+			VkFence fence = VK_NULL_HANDLE;
+			/** @brief Ring buffer position after the last staging range of this batch, the ring tail moves here once the batch has completed */
+			VkDeviceSize ringEnd = 0;
+			uint32_t uploadCount = 0;
+			VkPipelineStageFlags dstStageMask = 0;
+			/** @brief Barriers making the uploaded data visible to the graphics queue (recorded at submission time) */
+			std::vector<VkBufferMemoryBarrier> bufferBarriers;
+			std::vector<VkImageMemoryBarrier> imageBarriers;
+			/** @brief Staging buffers for uploads that don't fit into the ring buffer */
+			std::vector<vks::Buffer> oversizedStaging;
+		};
+
+		vks::VulkanDevice *device;
+		VkQueue graphicsQueue;
+		VkQueue transferQueue;
+		uint32_t graphicsQueueFamily;
+		uint32_t transferQueueFamily;
+		bool dedicatedTransferQueue;
+		VkCommandPool copyCmdPool = VK_NULL_HANDLE;
+		VkCommandPool acquireCmdPool = VK_NULL_HANDLE;
+
+		vks::Buffer ring;
+		VkDeviceSize ringHead = 0;
+		VkDeviceSize ringTail = 0;
+		VkDeviceSize ringAlignment;
+
+		Batch *currentBatch = nullptr;
+		std::deque<Batch*> pendingBatches;
+		std::vector<Batch*> freeBatches;
+		std::vector<Batch*> batches;
+		UploadToken nextToken = 1;
+		UploadToken lastSubmittedToken = 0;
+		UploadToken lastCompletedToken = 0;
+		uint32_t batchDepth = 0;
+		std::mutex mutex;
+
+		VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (value + alignment - 1) & ~(alignment - 1);
+		}
+
+		Batch* createBatch()
+		{
+			Batch *batch = new Batch();
+			VkCommandBufferAllocateInfo cmdBufAllocateInfo = vks::initializers::commandBufferAllocateInfo(copyCmdPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, 1);
+			VK_CHECK_RESULT(vkAllocateCommandBuffers(device->logicalDevice, &cmdBufAllocateInfo, &batch->copyCmd));
+			if (dedicatedTransferQueue)
+			{
+				cmdBufAllocateInfo.commandPool = acquireCmdPool;
+				VK_CHECK_RESULT(vkAllocateCommandBuffers(device->logicalDevice, &cmdBufAllocateInfo, &batch->acquireCmd));
+				VkSemaphoreCreateInfo semaphoreCreateInfo = vks::initializers::semaphoreCreateInfo();
+				VK_CHECK_RESULT(vkCreateSemaphore(device->logicalDevice, &semaphoreCreateInfo, nullptr, &batch->semaphore));
+			}
+			VkFenceCreateInfo fenceCreateInfo = vks::initializers::fenceCreateInfo(VK_FLAGS_NONE);
+			VK_CHECK_RESULT(vkCreateFence(device->logicalDevice, &fenceCreateInfo, nullptr, &batch->fence));
+			batches.push_back(batch);
+			return batch;
+		}
+
+		/** @brief Returns the batch new uploads are recorded into, starts a new one if required */
+		Batch* getCurrentBatch()
+		{
+			if (!currentBatch)
+			{
+				if (freeBatches.empty())
+				{
+					currentBatch = createBatch();
+				}
+				else
+				{
+					currentBatch = freeBatches.back();
+					freeBatches.pop_back();
+				}
+				currentBatch->token = nextToken++;
+				VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
+				cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+				VK_CHECK_RESULT(vkBeginCommandBuffer(currentBatch->copyCmd, &cmdBufInfo));
+			}
+			return currentBatch;
+		}
+
+		/** @brief Records the ownership transfer / layout barriers and submits the current batch */
+		void submitCurrentBatch()
+		{
+			Batch *batch = currentBatch;
+			if (!batch)
+			{
+				return;
+			}
+			currentBatch = nullptr;
+
+			const uint32_t bufferBarrierCount = static_cast<uint32_t>(batch->bufferBarriers.size());
+			const uint32_t imageBarrierCount = static_cast<uint32_t>(batch->imageBarriers.size());
+			const bool hasBarriers = (bufferBarrierCount + imageBarrierCount) > 0;
+
+			if (dedicatedTransferQueue)
+			{
+				// Release barriers on the transfer queue, the access masks are ignored for the release half of an ownership transfer
+				std::vector<VkBufferMemoryBarrier> bufferReleaseBarriers(batch->bufferBarriers);
+				std::vector<VkImageMemoryBarrier> imageReleaseBarriers(batch->imageBarriers);
+				for (auto& barrier : bufferReleaseBarriers) {
+					barrier.dstAccessMask = 0;
+				}
+				for (auto& barrier : imageReleaseBarriers) {
+					barrier.dstAccessMask = 0;
+				}
+				if (hasBarriers)
+				{
+					vkCmdPipelineBarrier(batch->copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, bufferBarrierCount, bufferReleaseBarriers.data(), imageBarrierCount, imageReleaseBarriers.data());
+				}
+				VK_CHECK_RESULT(vkEndCommandBuffer(batch->copyCmd));
+
+				VkSubmitInfo submitInfo = vks::initializers::submitInfo();
+				submitInfo.commandBufferCount = 1;
+				submitInfo.pCommandBuffers = &batch->copyCmd;
+				submitInfo.signalSemaphoreCount = 1;
+				submitInfo.pSignalSemaphores = &batch->semaphore;
+				VK_CHECK_RESULT(vkQueueSubmit(transferQueue, 1, &submitInfo, VK_NULL_HANDLE));
+
+				// Matching acquire barriers on the graphics queue
+				std::vector<VkBufferMemoryBarrier> bufferAcquireBarriers(batch->bufferBarriers);
+				std::vector<VkImageMemoryBarrier> imageAcquireBarriers(batch->imageBarriers);
+				for (auto& barrier : bufferAcquireBarriers) {
+					barrier.srcAccessMask = 0;
+				}
+				for (auto& barrier : imageAcquireBarriers) {
+					barrier.srcAccessMask = 0;
+				}
+				VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
+				cmdBufInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+				VK_CHECK_RESULT(vkBeginCommandBuffer(batch->acquireCmd, &cmdBufInfo));
+				if (hasBarriers)
+				{
+					vkCmdPipelineBarrier(batch->acquireCmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, batch->dstStageMask, 0, 0, nullptr, bufferBarrierCount, bufferAcquireBarriers.data(), imageBarrierCount, imageAcquireBarriers.data());
+				}
+				VK_CHECK_RESULT(vkEndCommandBuffer(batch->acquireCmd));
+
+				VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+				submitInfo = vks::initializers::submitInfo();
+				submitInfo.waitSemaphoreCount = 1;
+				submitInfo.pWaitSemaphores = &batch->semaphore;
+				submitInfo.pWaitDstStageMask = &waitStageMask;
+				submitInfo.commandBufferCount = 1;
+				submitInfo.pCommandBuffers = &batch->acquireCmd;
+				VK_CHECK_RESULT(vkQueueSubmit(graphicsQueue, 1, &submitInfo, batch->fence));
+			}
+			else
+			{
+				if (hasBarriers)
+				{
+					vkCmdPipelineBarrier(batch->copyCmd, VK_PIPELINE_STAGE_TRANSFER_BIT, batch->dstStageMask, 0, 0, nullptr, bufferBarrierCount, batch->bufferBarriers.data(), imageBarrierCount, batch->imageBarriers.data());
+				}
+				VK_CHECK_RESULT(vkEndCommandBuffer(batch->copyCmd));
+
+				VkSubmitInfo submitInfo = vks::initializers::submitInfo();
+				submitInfo.commandBufferCount = 1;
+				submitInfo.pCommandBuffers = &batch->copyCmd;
+				VK_CHECK_RESULT(vkQueueSubmit(graphicsQueue, 1, &submitInfo, batch->fence));
+			}
+
+			batch->ringEnd = ringHead;
+			lastSubmittedToken = batch->token;
+			pendingBatches.push_back(batch);
+		}
+
+		/** @brief Waits for the oldest submitted batch and releases its staging memory */
+		void retireOldestBatch(bool wait)
+		{
+			Batch *batch = pendingBatches.front();
+			if (wait)
+			{
+				VK_CHECK_RESULT(vkWaitForFences(device->logicalDevice, 1, &batch->fence, VK_TRUE, DEFAULT_FENCE_TIMEOUT));
+			}
+			pendingBatches.pop_front();
+
+			ringTail = batch->ringEnd;
+			if (pendingBatches.empty() && (ringHead == ringTail))
+			{
+				// Ring is empty, start over at the beginning to avoid unnecessary wrapping
+				ringHead = ringTail = 0;
+			}
+
+			for (auto& stagingBuffer : batch->oversizedStaging)
+			{
+				stagingBuffer.destroy();
+			}
+			batch->oversizedStaging.clear();
+			batch->bufferBarriers.clear();
+			batch->imageBarriers.clear();
+			batch->uploadCount = 0;
+			batch->dstStageMask = 0;
+			VK_CHECK_RESULT(vkResetFences(device->logicalDevice, 1, &batch->fence));
+			VK_CHECK_RESULT(vkResetCommandBuffer(batch->copyCmd, 0));
+			if (batch->acquireCmd)
+			{
+				VK_CHECK_RESULT(vkResetCommandBuffer(batch->acquireCmd, 0));
+			}
+
+			lastCompletedToken = batch->token;
+			freeBatches.push_back(batch);
+		}
+
+		/** @brief Retires all submitted batches that have already completed on the device */
+		void pollPendingBatches()
+		{
+			while (!pendingBatches.empty() && (vkGetFenceStatus(device->logicalDevice, pendingBatches.front()->fence) == VK_SUCCESS))
+			{
+				retireOldestBatch(false);
+			}
+		}
+
+		/**
+		* Try to reserve a range in the staging ring buffer
+		*
+		* @note Staging ranges are freed in the order they have been handed out, strict comparisons keep head and tail from meeting on a full ring
+		*/
+		bool tryAllocateFromRing(VkDeviceSize size, VkDeviceSize *offset)
+		{
+			if (ringHead >= ringTail)
+			{
+				// Free space at the end and at the start of the ring
+				if (ringHead + size <= ring.size)
+				{
+					*offset = ringHead;
+					ringHead += size;
+					return true;
+				}
+				if (size < ringTail)
+				{
+					*offset = 0;
+					ringHead = size;
+					return true;
+				}
+			}
+			else
+			{
+				// Ring has wrapped, free space is between head and tail
+				if (ringHead + size < ringTail)
+				{
+					*offset = ringHead;
+					ringHead += size;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/**
+		* Reserve staging memory for the current batch and let the caller write the data to it
+		*
+		* @return Buffer and offset to use as the source of the copy commands
+		*/
+		void stage(VkDeviceSize size, const std::function<void(void *dst)> &write, VkBuffer *srcBuffer, VkDeviceSize *srcOffset)
+		{
+			const VkDeviceSize alignedSize = alignUp(size, ringAlignment);
+			if (alignedSize < ring.size)
+			{
+				pollPendingBatches();
+				while (!tryAllocateFromRing(alignedSize, srcOffset))
+				{
+					// Ring is full, submit what has been recorded so far and wait for the oldest uploads to free up their staging memory
+					if (currentBatch && (currentBatch->uploadCount > 0))
+					{
+						submitCurrentBatch();
+					}
+					assert(!pendingBatches.empty());
+					retireOldestBatch(true);
+				}
+				write((char*)ring.mapped + *srcOffset);
+				*srcBuffer = ring.buffer;
+				return;
+			}
+
+			// Data doesn't fit into the ring buffer, use a separate staging buffer that is released along with the batch
+			vks::Buffer stagingBuffer;
+			VK_CHECK_RESULT(device->createBuffer(
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&stagingBuffer,
+				size,
+				nullptr,
+				vks::ALLOCATION_STRATEGY_LINEAR));
+			VK_CHECK_RESULT(stagingBuffer.map());
+			write(stagingBuffer.mapped);
+			stagingBuffer.unmap();
+			getCurrentBatch()->oversizedStaging.push_back(stagingBuffer);
+			*srcBuffer = stagingBuffer.buffer;
+			*srcOffset = 0;
+		}
+
+		/** @brief Copy data into staging memory for the current batch */
+		void stage(const void *data, VkDeviceSize size, VkBuffer *srcBuffer, VkDeviceSize *srcOffset)
+		{
+			stage(size, [data, size](void *dst) { memcpy(dst, data, size); }, srcBuffer, srcOffset);
+		}
+
+	public:
+		/**
+		* Create the upload manager
+		*
+		* @param device Vulkan device to upload to, the transfer queue is only used if it has been requested at logical device creation
+		* @param graphicsQueue Queue the uploaded resources will be used on, ownership of the resources is transferred to this queue's family
+		* @param (Optional) ringSize Size of the persistently mapped staging ring buffer (Defaults to 32 MB)
+		*/
+		UploadManager(vks::VulkanDevice *device, VkQueue graphicsQueue, VkDeviceSize ringSize = 32 * 1024 * 1024)
+		{
+			this->device = device;
+			this->graphicsQueue = graphicsQueue;
+			graphicsQueueFamily = device->queueFamilyIndices.graphics;
+			transferQueueFamily = device->queueFamilyIndices.transfer;
+			dedicatedTransferQueue = (transferQueueFamily != graphicsQueueFamily);
+			if (dedicatedTransferQueue)
+			{
+				vkGetDeviceQueue(device->logicalDevice, transferQueueFamily, 0, &transferQueue);
+				acquireCmdPool = device->createCommandPool(graphicsQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+			}
+			else
+			{
+				transferQueue = graphicsQueue;
+			}
+			copyCmdPool = device->createCommandPool(transferQueueFamily, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+
+			// Staging offsets need to be aligned to the largest texel block size (16 bytes for BC formats) and to the optimal copy offset
+			ringAlignment = std::max((VkDeviceSize)16, device->properties.limits.optimalBufferCopyOffsetAlignment);
+
+			VK_CHECK_RESULT(device->createBuffer(
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&ring,
+				ringSize));
+			VK_CHECK_RESULT(ring.map());
+		}
+
+		/** @brief Waits for all outstanding uploads and releases all resources */
+		~UploadManager()
+		{
+			waitIdle();
+			for (auto batch : batches)
+			{
+				vkDestroyFence(device->logicalDevice, batch->fence, nullptr);
+				if (batch->semaphore)
+				{
+					vkDestroySemaphore(device->logicalDevice, batch->semaphore, nullptr);
+				}
+				delete batch;
+			}
+			ring.destroy();
+			vkDestroyCommandPool(device->logicalDevice, copyCmdPool, nullptr);
+			if (acquireCmdPool)
+			{
+				vkDestroyCommandPool(device->logicalDevice, acquireCmdPool, nullptr);
+			}
+		}
+
+		/** @brief True if copies are done on a dedicated transfer queue family */
+		bool usesDedicatedTransferQueue()
+		{
+			return dedicatedTransferQueue;
+		}
+
+		/**
+		* Queue an upload of host data into a buffer
+		*
+		* @param dstBuffer Buffer to upload to (must have been created with the TRANSFER_DST usage flag)
+		* @param data Pointer to the data to upload
+		* @param size Size of the data in bytes
+		* @param (Optional) dstOffset Offset into the destination buffer
+		* @param (Optional) dstAccessMask Access types the buffer will be used with after the upload (Defaults to VK_ACCESS_MEMORY_READ_BIT)
+		* @param (Optional) dstStageMask Pipeline stages the buffer will be used in after the upload (Defaults to VK_PIPELINE_STAGE_ALL_COMMANDS_BIT)
+		*
+		* @return Token that can be used to wait for the upload, the data has been copied into staging memory when the function returns
+		*/
+		UploadToken uploadBuffer(
+			VkBuffer dstBuffer,
+			const void *data,
+			VkDeviceSize size,
+			VkDeviceSize dstOffset = 0,
+			VkAccessFlags dstAccessMask = VK_ACCESS_MEMORY_READ_BIT,
+			VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			VkBuffer srcBuffer;
+			VkDeviceSize srcOffset;
+			stage(data, size, &srcBuffer, &srcOffset);
+
+			Batch *batch = getCurrentBatch();
+			VkBufferCopy copyRegion = {};
+			copyRegion.srcOffset = srcOffset;
+			copyRegion.dstOffset = dstOffset;
+			copyRegion.size = size;
+			vkCmdCopyBuffer(batch->copyCmd, srcBuffer, dstBuffer, 1, &copyRegion);
+
+			VkBufferMemoryBarrier bufferBarrier = vks::initializers::bufferMemoryBarrier();
+			bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			bufferBarrier.dstAccessMask = dstAccessMask;
+			bufferBarrier.srcQueueFamilyIndex = dedicatedTransferQueue ? transferQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.dstQueueFamilyIndex = dedicatedTransferQueue ? graphicsQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+			bufferBarrier.buffer = dstBuffer;
+			bufferBarrier.offset = dstOffset;
+			bufferBarrier.size = size;
+			batch->bufferBarriers.push_back(bufferBarrier);
+			batch->dstStageMask |= dstStageMask;
+			batch->uploadCount++;
+
+			return batch->token;
+		}
+
+		/**
+		* Queue an upload of host data into an optimal tiled image
+		*
+		* @param image Image to upload to (must have been created with the TRANSFER_DST usage flag), the previous contents are discarded
+		* @param subresourceRange Subresources of the image that are written by the copy regions
+		* @param data Pointer to the data to upload
+		* @param size Size of the data in bytes
+		* @param regions Copy regions, buffer offsets are relative to the start of data
+		* @param finalLayout Layout the image is transitioned to after the upload
+		* @param (Optional) dstAccessMask Access types the image will be used with after the upload (Defaults to all memory reads and writes, as e.g. storage images may also be written)
+		* @param (Optional) dstStageMask Pipeline stages the image will be used in after the upload (Defaults to VK_PIPELINE_STAGE_ALL_COMMANDS_BIT)
+		*
+		* @return Token that can be used to wait for the upload, the data has been copied into staging memory when the function returns
+		*/
+		UploadToken uploadImage(
+			VkImage image,
+			VkImageSubresourceRange subresourceRange,
+			const void *data,
+			VkDeviceSize size,
+			const std::vector<VkBufferImageCopy> &regions,
+			VkImageLayout finalLayout,
+			VkAccessFlags dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+			VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT)
+		{
+			return uploadImage(image, subresourceRange, size, [data, size](void *dst) { memcpy(dst, data, size); }, regions, finalLayout, dstAccessMask, dstStageMask);
+		}
+
+		/**
+		* Queue an upload into an optimal tiled image, with the image data written directly into staging memory by the caller
+		* Avoids an intermediate copy if the data is scattered (e.g. mip levels inside of a memory mapped file)
+		*
+		* @param image Image to upload to (must have been created with the TRANSFER_DST usage flag), the previous contents are discarded
+		* @param subresourceRange Subresources of the image that are written by the copy regions
+		* @param size Size of the staging data in bytes
+		* @param write Called once with a pointer to the staging memory, must write size bytes laid out as described by the regions
+		* @param regions Copy regions, buffer offsets are relative to the start of the staging data
+		* @param finalLayout Layout the image is transitioned to after the upload
+		* @param (Optional) dstAccessMask Access types the image will be used with after the upload (Defaults to all memory reads and writes, as e.g. storage images may also be written)
+		* @param (Optional) dstStageMask Pipeline stages the image will be used in after the upload (Defaults to VK_PIPELINE_STAGE_ALL_COMMANDS_BIT)
+		*
+		* @return Token that can be used to wait for the upload, the data has been written to staging memory when the function returns
+		*/
+		UploadToken uploadImage(
+			VkImage image,
+			VkImageSubresourceRange subresourceRange,
+			VkDeviceSize size,
+			const std::function<void(void *dst)> &write,
+			const std::vector<VkBufferImageCopy> &regions,
+			VkImageLayout finalLayout,
+			VkAccessFlags dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+			VkPipelineStageFlags dstStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			VkBuffer srcBuffer;
+			VkDeviceSize srcOffset;
+			stage(size, write, &srcBuffer, &srcOffset);
+
+			Batch *batch = getCurrentBatch();
+
+			VkImageMemoryBarrier imageBarrier = vks::initializers::imageMemoryBarrier();
+			imageBarrier.srcAccessMask = 0;
+			imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			imageBarrier.image = image;
+			imageBarrier.subresourceRange = subresourceRange;
+			vkCmdPipelineBarrier(batch->copyCmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+			std::vector<VkBufferImageCopy> stagingRegions(regions);
+			for (auto& region : stagingRegions)
+			{
+				region.bufferOffset += srcOffset;
+			}
+			vkCmdCopyBufferToImage(batch->copyCmd, srcBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(stagingRegions.size()), stagingRegions.data());
+
+			imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			imageBarrier.dstAccessMask = dstAccessMask;
+			imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+			imageBarrier.newLayout = finalLayout;
+			imageBarrier.srcQueueFamilyIndex = dedicatedTransferQueue ? transferQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+			imageBarrier.dstQueueFamilyIndex = dedicatedTransferQueue ? graphicsQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+			batch->imageBarriers.push_back(imageBarrier);
+			batch->dstStageMask |= dstStageMask;
+			batch->uploadCount++;
+
+			return batch->token;
+		}
+
+		/**
+		* Submit all uploads that have been queued so far
+		*
+		* @return Token of the last submitted batch
+		*/
+		UploadToken flush()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			submitCurrentBatch();
+			return lastSubmittedToken;
+		}
+
+		/** @brief Returns true if the uploads identified by the token have finished on the device (does not block) */
+		bool isComplete(UploadToken token)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pollPendingBatches();
+			return lastCompletedToken >= token;
+		}
+
+		/** @brief Block until the uploads identified by the token have finished, submits the uploads if they're still being recorded */
+		void wait(UploadToken token)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (currentBatch && (token >= currentBatch->token))
+			{
+				submitCurrentBatch();
+			}
+			while (lastCompletedToken < token)
+			{
+				assert(!pendingBatches.empty());
+				retireOldestBatch(true);
+			}
+		}
+
+		/** @brief Submit and wait for all queued uploads */
+		void waitIdle()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			submitCurrentBatch();
+			while (!pendingBatches.empty())
+			{
+				retireOldestBatch(true);
+			}
+		}
+
+		/**
+		* Start collecting uploads into a batch
+		* Loaders return without waiting for their uploads while a batch is open (see complete)
+		*
+		* @note Batches can be nested, uploads are only submitted once the outermost batch ends
+		*/
+		void beginBatch()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			batchDepth++;
+		}
+
+		/**
+		* End a batch started with beginBatch and submit the collected uploads
+		*
+		* @return Token for all uploads queued while the batch was open
+		*/
+		UploadToken endBatch()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			assert(batchDepth > 0);
+			batchDepth--;
+			if (batchDepth == 0)
+			{
+				submitCurrentBatch();
+			}
+			return currentBatch ? currentBatch->token : lastSubmittedToken;
+		}
+
+		/**
+		* Called by the loaders after queueing their uploads
+		* Waits for the uploads unless a batch is open, in which case the caller of endBatch is responsible for waiting
+		*/
+		void complete(UploadToken token)
+		{
+			bool deferred;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				deferred = (batchDepth > 0);
+			}
+			if (!deferred)
+			{
+				wait(token);
+			}
+		}
+	};
+}
@@ -12,9 +12,21 @@
 #include <string>
 #include <fstream>
 #include <vector>
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
+#include <functional>
+#include <memory>
 
 #include "vulkan/vulkan.h"
 #include "VulkanDevice.hpp"
+#include "VulkanUploadManager.hpp"
+#include "mappedfile.hpp"
+#include "meshoptimizer.hpp"
+#include "texturecompression.hpp"
+#include "imageprocessing.hpp"
+#include "ktxfile.hpp"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -44,6 +56,7 @@ namespace vkglTF
 		VkImage image;
 		VkImageLayout imageLayout;
 		VkDeviceMemory deviceMemory;
+		vks::Allocation allocation;
 		VkImageView view;
 		uint32_t width, height;
 		uint32_t mipLevels;
@@ -62,36 +75,29 @@ namespace vkglTF
 		{
 			vkDestroyImageView(device->logicalDevice, view, nullptr);
 			vkDestroyImage(device->logicalDevice, image, nullptr);
-			vkFreeMemory(device->logicalDevice, deviceMemory, nullptr);
+			device->memoryAllocator->free(allocation);
 			vkDestroySampler(device->logicalDevice, sampler, nullptr);
 		}
 
 		/*
 			Load a texture from a glTF image (stored as vector of chars loaded via stb_image)
 			Also generates the mip chain as glTF images are stored as jpg or png without any mips
+			The mip chain is blitted on the GPU if the format supports it, otherwise (or if cpuMips is set) it's generated on the CPU with the given options
 		*/
-		void fromglTfImage(tinygltf::Image &gltfimage, vks::VulkanDevice *device, VkQueue copyQueue)
+		void fromglTfImage(tinygltf::Image &gltfimage, vks::VulkanDevice *device, VkQueue copyQueue, const vks::imageproc::MipOptions &mipOptions = vks::imageproc::MipOptions(), bool cpuMips = false, vks::JobSystem *jobSystem = nullptr)
 		{
 			this->device = device;
 
 			unsigned char* buffer = nullptr;
 			VkDeviceSize bufferSize = 0;
-			bool deleteBuffer = false;
-			if (gltfimage.component == 3) {
+			std::vector<unsigned char> expanded;
+			if (gltfimage.component != 4) {
 				// Most devices don't support RGB only on Vulkan so convert if necessary
-				// TODO: Check actual format support and transform only if required
-				bufferSize = gltfimage.width * gltfimage.height * 4;
-				buffer = new unsigned char[bufferSize];
-				unsigned char* rgba = buffer;
-				unsigned char* rgb = &gltfimage.image[0];
-				for (size_t i = 0; i< gltfimage.width * gltfimage.height; ++i) {
-					for (int32_t j = 0; j < 3; ++j) {
-						rgba[j] = rgb[j];
-					}
-					rgba += 4;
-					rgb += 3;
-				}
-				deleteBuffer = true;
+				const size_t texelCount = static_cast<size_t>(gltfimage.width) * gltfimage.height;
+				expanded.resize(texelCount * 4);
+				vks::imageproc::expandToRgba(gltfimage.image.data(), gltfimage.component, texelCount, expanded.data(), jobSystem);
+				buffer = expanded.data();
+				bufferSize = expanded.size();
 			}
 			else {
 				buffer = &gltfimage.image[0];
@@ -104,35 +110,32 @@ namespace vkglTF
 
 			width = gltfimage.width;
 			height = gltfimage.height;
-			mipLevels = static_cast<uint32_t>(floor(log2(std::max(width, height))) + 1.0);
+			mipLevels = vks::imageproc::getMipLevelCount(width, height);
 
 			vkGetPhysicalDeviceFormatProperties(device->physicalDevice, format, &formatProperties);
-			assert(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT);
-			assert(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT);
-
-			VkMemoryAllocateInfo memAllocInfo{};
-			memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-			VkMemoryRequirements memReqs{};
-
-			VkBuffer stagingBuffer;
-			VkDeviceMemory stagingMemory;
-
-			VkBufferCreateInfo bufferCreateInfo{};
-			bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-			bufferCreateInfo.size = bufferSize;
-			bufferCreateInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-			bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-			VK_CHECK_RESULT(vkCreateBuffer(device->logicalDevice, &bufferCreateInfo, nullptr, &stagingBuffer));
-			vkGetBufferMemoryRequirements(device->logicalDevice, stagingBuffer, &memReqs);
-			memAllocInfo.allocationSize = memReqs.size;
-			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &stagingMemory));
-			VK_CHECK_RESULT(vkBindBufferMemory(device->logicalDevice, stagingBuffer, stagingMemory, 0));
-
-			uint8_t *data;
-			VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, stagingMemory, 0, memReqs.size, 0, (void **)&data));
-			memcpy(data, buffer, bufferSize);
-			vkUnmapMemory(device->logicalDevice, stagingMemory);
+			const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+			if (cpuMips || ((formatProperties.optimalTilingFeatures & blitFeatures) != blitFeatures)) {
+				// The mip chain is generated straight into the staging memory
+				const std::vector<vks::imageproc::MipLevel> levels = vks::imageproc::getMipLevels(width, height);
+				std::vector<VkDeviceSize> levelOffsets;
+				for (auto &level : levels) {
+					levelOffsets.push_back(level.offset);
+				}
+				uploadLevels(format, levelOffsets, vks::imageproc::getMipChainSize(levels), [&](void *dst) {
+					vks::imageproc::generateMipChain(buffer, levels, static_cast<uint8_t*>(dst), mipOptions, jobSystem);
+				}, copyQueue);
+				createSamplerAndView(format);
+				return;
+			}
+
+			vks::Buffer stagingBuffer;
+			VK_CHECK_RESULT(device->createBuffer(
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&stagingBuffer,
+				bufferSize,
+				buffer,
+				vks::ALLOCATION_STRATEGY_LINEAR));
 
 			VkImageCreateInfo imageCreateInfo{};
 			imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -148,11 +151,12 @@ namespace vkglTF
 			imageCreateInfo.extent = { width, height, 1 };
 			imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
 			VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
+			VkMemoryRequirements memReqs;
 			vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
-			memAllocInfo.allocationSize = memReqs.size;
-			memAllocInfo.memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-			VK_CHECK_RESULT(vkAllocateMemory(device->logicalDevice, &memAllocInfo, nullptr, &deviceMemory));
-			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, deviceMemory, 0));
+			uint32_t memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			VK_CHECK_RESULT(device->memoryAllocator->allocate(memReqs, memoryTypeIndex, vks::ALLOCATION_RESOURCE_OPTIMAL, &allocation));
+			deviceMemory = allocation.memory;
+			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, allocation.memory, allocation.offset));
 
 			VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
 
@@ -182,7 +186,7 @@ namespace vkglTF
 			bufferCopyRegion.imageExtent.height = height;
 			bufferCopyRegion.imageExtent.depth = 1;
 
-			vkCmdCopyBufferToImage(copyCmd, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
+			vkCmdCopyBufferToImage(copyCmd, stagingBuffer.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &bufferCopyRegion);
 
 			{
 				VkImageMemoryBarrier imageMemoryBarrier{};
@@ -198,8 +202,7 @@ namespace vkglTF
 
 			device->flushCommandBuffer(copyCmd, copyQueue, true);
 
-			vkFreeMemory(device->logicalDevice, stagingMemory, nullptr);
-			vkDestroyBuffer(device->logicalDevice, stagingBuffer, nullptr);
+			stagingBuffer.destroy();
 
 			// Generate the mip chain (glTF uses jpg and png, so we need to create this manually)
 			VkCommandBuffer blitCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
@@ -270,6 +273,113 @@ namespace vkglTF
 
 			device->flushCommandBuffer(blitCmd, copyQueue, true);
 
+			createSamplerAndView(format);
+		}
+
+		/*
+			Create the texture from a block compressed mip chain (see Model::TextureCompression)
+			The levels are written straight from their source (e.g. a memory mapped cache file) into the staging memory
+		*/
+		void fromCompressedLevels(VkFormat format, uint32_t width, uint32_t height, const std::vector<const void*> &levelData, const std::vector<size_t> &levelSizes, vks::VulkanDevice *device, VkQueue copyQueue)
+		{
+			this->device = device;
+			this->width = width;
+			this->height = height;
+			mipLevels = static_cast<uint32_t>(levelData.size());
+
+			std::vector<VkDeviceSize> levelOffsets;
+			VkDeviceSize offset = 0;
+			for (uint32_t i = 0; i < mipLevels; i++) {
+				// Buffer offsets need to be a multiple of the block size
+				offset = (offset + 15) & ~static_cast<VkDeviceSize>(15);
+				levelOffsets.push_back(offset);
+				offset += levelSizes[i];
+			}
+			uploadLevels(format, levelOffsets, offset, [&](void *dst) {
+				for (uint32_t i = 0; i < mipLevels; i++) {
+					memcpy(static_cast<char*>(dst) + levelOffsets[i], levelData[i], levelSizes[i]);
+				}
+			}, copyQueue);
+
+			createSamplerAndView(format);
+		}
+
+		/*
+			Create the image for all mip levels (width, height and mipLevels must be set) and upload them
+			The write function fills the staging memory, level i starts at levelOffsets[i]
+		*/
+		void uploadLevels(VkFormat format, const std::vector<VkDeviceSize> &levelOffsets, VkDeviceSize bufferSize, const std::function<void(void *dst)> &writeLevels, VkQueue copyQueue)
+		{
+			std::vector<VkBufferImageCopy> bufferCopyRegions;
+			for (uint32_t i = 0; i < mipLevels; i++) {
+				VkBufferImageCopy bufferCopyRegion = {};
+				bufferCopyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				bufferCopyRegion.imageSubresource.mipLevel = i;
+				bufferCopyRegion.imageSubresource.baseArrayLayer = 0;
+				bufferCopyRegion.imageSubresource.layerCount = 1;
+				bufferCopyRegion.imageExtent.width = std::max(width >> i, 1u);
+				bufferCopyRegion.imageExtent.height = std::max(height >> i, 1u);
+				bufferCopyRegion.imageExtent.depth = 1;
+				bufferCopyRegion.bufferOffset = levelOffsets[i];
+				bufferCopyRegions.push_back(bufferCopyRegion);
+			}
+
+			VkImageCreateInfo imageCreateInfo{};
+			imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageCreateInfo.format = format;
+			imageCreateInfo.mipLevels = mipLevels;
+			imageCreateInfo.arrayLayers = 1;
+			imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			imageCreateInfo.extent = { width, height, 1 };
+			imageCreateInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+			VK_CHECK_RESULT(vkCreateImage(device->logicalDevice, &imageCreateInfo, nullptr, &image));
+			VkMemoryRequirements memReqs;
+			vkGetImageMemoryRequirements(device->logicalDevice, image, &memReqs);
+			uint32_t memoryTypeIndex = device->getMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+			VK_CHECK_RESULT(device->memoryAllocator->allocate(memReqs, memoryTypeIndex, vks::ALLOCATION_RESOURCE_OPTIMAL, &allocation));
+			deviceMemory = allocation.memory;
+			VK_CHECK_RESULT(vkBindImageMemory(device->logicalDevice, image, allocation.memory, allocation.offset));
+
+			VkImageSubresourceRange subresourceRange = {};
+			subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			subresourceRange.levelCount = mipLevels;
+			subresourceRange.layerCount = 1;
+			imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+			if (device->uploadManager) {
+				device->uploadManager->complete(device->uploadManager->uploadImage(image, subresourceRange, bufferSize, writeLevels, bufferCopyRegions, imageLayout));
+			} else {
+				vks::Buffer stagingBuffer;
+				VK_CHECK_RESULT(device->createBuffer(
+					VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+					&stagingBuffer,
+					bufferSize,
+					nullptr,
+					vks::ALLOCATION_STRATEGY_LINEAR));
+				VK_CHECK_RESULT(stagingBuffer.map());
+				writeLevels(stagingBuffer.mapped);
+				stagingBuffer.unmap();
+
+				VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+				vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, subresourceRange);
+				vkCmdCopyBufferToImage(copyCmd, stagingBuffer.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(bufferCopyRegions.size()), bufferCopyRegions.data());
+				vks::tools::setImageLayout(copyCmd, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, imageLayout, subresourceRange);
+				device->flushCommandBuffer(copyCmd, copyQueue, true);
+
+				stagingBuffer.destroy();
+			}
+		}
+
+		/*
+			Create the sampler and the image view for all mip levels, the image must have been uploaded
+		*/
+		void createSamplerAndView(VkFormat format)
+		{
 			VkSamplerCreateInfo samplerInfo{};
 			samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
 			samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -363,12 +473,16 @@ namespace vkglTF
 		std::vector<Primitive*> primitives;
 		std::string name;
 
+		/*
+			The uniform blocks of all meshes are packed into a single buffer owned by the model (see Model::MeshUniforms)
+		*/
 		struct UniformBuffer {
-			VkBuffer buffer;
-			VkDeviceMemory memory;
-			VkDescriptorBufferInfo descriptor;
+			// Offset of the mesh's uniform block, passed as the dynamic offset when binding the descriptor set
+			uint32_t dynamicOffset = 0;
+			// Dynamic uniform buffer descriptor set shared by all meshes of the model
 			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
-			void *mapped;
+			// Points into the model's host copy of the buffer, which is written to the device in one go by Model::updateNodes
+			void *mapped = nullptr;
 		} uniformBuffer;
 
 		struct UniformBlock {
@@ -380,22 +494,8 @@ namespace vkglTF
 		Mesh(vks::VulkanDevice *device, glm::mat4 matrix) {
 			this->device = device;
 			this->uniformBlock.matrix = matrix;
-			VK_CHECK_RESULT(device->createBuffer(
-				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-				sizeof(uniformBlock),
-				&uniformBuffer.buffer,
-				&uniformBuffer.memory,
-				&uniformBlock));
-			VK_CHECK_RESULT(vkMapMemory(device->logicalDevice, uniformBuffer.memory, 0, sizeof(uniformBlock), 0, &uniformBuffer.mapped));
-			uniformBuffer.descriptor = { uniformBuffer.buffer, 0, sizeof(uniformBlock) };
 		};
 
-		~Mesh() {
-			vkDestroyBuffer(device->logicalDevice, uniformBuffer.buffer, nullptr);
-			vkFreeMemory(device->logicalDevice, uniformBuffer.memory, nullptr);
-		}
-
 	};
 
 	/*
@@ -408,6 +508,93 @@ namespace vkglTF
 		std::vector<Node*> joints;
 	};
 
+	/*
+		Flattened transform hierarchy of all nodes of a model
+		Transforms are stored in topological order (parents before their children) in contiguous arrays,
+		so world matrices of changed subtrees can be updated in a single linear pass without walking parent chains
+	*/
+	struct NodeTransforms {
+		// Index of the parent transform, -1 for root nodes
+		std::vector<int32_t> parents;
+		std::vector<glm::vec3> translations;
+		std::vector<glm::quat> rotations;
+		std::vector<glm::vec3> scales;
+		// Static node matrix from the glTF file, applied after TRS
+		std::vector<glm::mat4> matrices;
+		std::vector<glm::mat4> worldMatrices;
+		// Set if the local transform has changed (or, after update, if the world matrix has changed)
+		std::vector<uint8_t> dirty;
+
+		/** @brief Add a transform, the parent must have been added before (returns the index of the new transform) */
+		uint32_t add(int32_t parent)
+		{
+			assert(parent < static_cast<int32_t>(parents.size()));
+			parents.push_back(parent);
+			translations.push_back(glm::vec3(0.0f));
+			rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+			scales.push_back(glm::vec3(1.0f));
+			matrices.push_back(glm::mat4(1.0f));
+			worldMatrices.push_back(glm::mat4(1.0f));
+			dirty.push_back(1);
+			return static_cast<uint32_t>(parents.size() - 1);
+		}
+
+		size_t size() const
+		{
+			return parents.size();
+		}
+
+		void setTranslation(uint32_t index, const glm::vec3 &translation)
+		{
+			translations[index] = translation;
+			dirty[index] = 1;
+		}
+
+		void setRotation(uint32_t index, const glm::quat &rotation)
+		{
+			rotations[index] = rotation;
+			dirty[index] = 1;
+		}
+
+		void setScale(uint32_t index, const glm::vec3 &scale)
+		{
+			scales[index] = scale;
+			dirty[index] = 1;
+		}
+
+		glm::mat4 localMatrix(uint32_t index) const
+		{
+			return glm::translate(glm::mat4(1.0f), translations[index]) * glm::mat4(rotations[index]) * glm::scale(glm::mat4(1.0f), scales[index]) * matrices[index];
+		}
+
+		/**
+		* Recalculate the world matrices of all dirty transforms and their descendants
+		* Dirty flags are propagated to the children, so they can be used to find the changed world matrices until clearDirty is called
+		*
+		* @return True if any world matrix has changed
+		*/
+		bool update()
+		{
+			bool changed = false;
+			for (size_t i = 0; i < parents.size(); i++) {
+				const int32_t parent = parents[i];
+				if (parent > -1) {
+					dirty[i] |= dirty[parent];
+				}
+				if (dirty[i]) {
+					worldMatrices[i] = (parent > -1) ? worldMatrices[parent] * localMatrix(static_cast<uint32_t>(i)) : localMatrix(static_cast<uint32_t>(i));
+					changed = true;
+				}
+			}
+			return changed;
+		}
+
+		void clearDirty()
+		{
+			std::fill(dirty.begin(), dirty.end(), 0);
+		}
+	};
+
 	/*
 		glTF node
 	*/
@@ -415,51 +602,40 @@ namespace vkglTF
 		Node *parent;
 		uint32_t index;
 		std::vector<Node*> children;
-		glm::mat4 matrix;
 		std::string name;
 		Mesh *mesh;
 		Skin *skin;
 		int32_t skinIndex = -1;
-		glm::vec3 translation{};
-		glm::vec3 scale{ 1.0f };
-		glm::quat rotation{};
+		// Transform of this node inside of the model's flattened hierarchy
+		NodeTransforms *transforms = nullptr;
+		uint32_t transformIndex = 0;
 
 		glm::mat4 localMatrix() {
-			return glm::translate(glm::mat4(1.0f), translation) * glm::mat4(rotation) * glm::scale(glm::mat4(1.0f), scale) * matrix;
+			return transforms->localMatrix(transformIndex);
 		}
 
-		glm::mat4 getMatrix() {
-			glm::mat4 m = localMatrix();
-			vkglTF::Node *p = parent;
-			while (p) {
-				m = p->localMatrix() * m;
-				p = p->parent;
-			}
-			return m;
+		/** @brief Cached world matrix, valid after the model's node transforms have been updated */
+		const glm::mat4& getMatrix() {
+			return transforms->worldMatrices[transformIndex];
 		}
 
-		void update() {
-			if (mesh) {
-				glm::mat4 m = getMatrix();
-				if (skin) {
-					mesh->uniformBlock.matrix = m;
-					// Update join matrices
-					glm::mat4 inverseTransform = glm::inverse(m);
-					for (size_t i = 0; i < skin->joints.size(); i++) {
-						vkglTF::Node *jointNode = skin->joints[i];
-						glm::mat4 jointMat = jointNode->getMatrix() * skin->inverseBindMatrices[i];
-						jointMat = inverseTransform * jointMat;
-						mesh->uniformBlock.jointMatrix[i] = jointMat;
-					}
-					mesh->uniformBlock.jointcount = (float)skin->joints.size();
-					memcpy(mesh->uniformBuffer.mapped, &mesh->uniformBlock, sizeof(mesh->uniformBlock));
-				} else {
-					memcpy(mesh->uniformBuffer.mapped, &m, sizeof(glm::mat4));
+		/** @brief Write the node's matrix (and joint matrices for skinned meshes) from the cached world matrices to the mesh's uniform block */
+		void updateMesh() {
+			const glm::mat4 &m = getMatrix();
+			if (skin) {
+				mesh->uniformBlock.matrix = m;
+				// Update join matrices
+				glm::mat4 inverseTransform = glm::inverse(m);
+				for (size_t i = 0; i < skin->joints.size(); i++) {
+					vkglTF::Node *jointNode = skin->joints[i];
+					glm::mat4 jointMat = jointNode->getMatrix() * skin->inverseBindMatrices[i];
+					jointMat = inverseTransform * jointMat;
+					mesh->uniformBlock.jointMatrix[i] = jointMat;
 				}
-			}
-
-			for (auto& child : children) {
-				child->update();
+				mesh->uniformBlock.jointcount = (float)skin->joints.size();
+				memcpy(mesh->uniformBuffer.mapped, &mesh->uniformBlock, sizeof(mesh->uniformBlock));
+			} else {
+				memcpy(mesh->uniformBuffer.mapped, &m, sizeof(glm::mat4));
 			}
 		}
 
@@ -490,7 +666,91 @@ namespace vkglTF
 		enum InterpolationType { LINEAR, STEP, CUBICSPLINE };
 		InterpolationType interpolation;
 		std::vector<float> inputs;
+		// Cubic spline samplers store an in-tangent, the value and an out-tangent per key
 		std::vector<glm::vec4> outputsVec4;
+		// Key interval of the last sample, playback usually stays in the same or moves on to the next interval
+		// Used if the caller doesn't keep its own cursor (see AnimationLayer::cursors)
+		uint32_t cursor = 0;
+
+		static glm::quat toQuat(const glm::vec4 &v)
+		{
+			return glm::quat(v.w, v.x, v.y, v.z);
+		}
+
+		bool valid() const
+		{
+			const size_t stride = (interpolation == CUBICSPLINE) ? 3 : 1;
+			return !inputs.empty() && (outputsVec4.size() >= inputs.size() * stride);
+		}
+
+		/** @brief Find the key interval [i, i + 1] containing time, checks the cursor (and the following interval) before doing a binary search and updates it */
+		uint32_t findKey(float time, uint32_t &cursor) const
+		{
+			const uint32_t intervals = static_cast<uint32_t>(inputs.size()) - 1;
+			if (cursor < intervals && time >= inputs[cursor]) {
+				if (time <= inputs[cursor + 1]) {
+					return cursor;
+				}
+				if (cursor + 1 < intervals && time <= inputs[cursor + 2]) {
+					return ++cursor;
+				}
+			}
+			// Seek (or loop back to the start)
+			const uint32_t upper = static_cast<uint32_t>(std::upper_bound(inputs.begin(), inputs.end(), time) - inputs.begin());
+			cursor = std::min(std::max(upper, 1u) - 1, intervals - 1);
+			return cursor;
+		}
+
+		/**
+		* Sample the output at the given time, times outside of the key range are clamped to the first or last key
+		*
+		* @param time Time to sample at
+		* @param rotation Outputs are quaternions (x, y, z, w) and are interpolated spherically and normalized
+		* @param cursor Key cursor of the caller, evaluations at unrelated times (e.g. different characters) should use separate cursors
+		*/
+		glm::vec4 sample(float time, bool rotation, uint32_t &cursor) const
+		{
+			const uint32_t stride = (interpolation == CUBICSPLINE) ? 3 : 1;
+			const uint32_t valueOffset = (interpolation == CUBICSPLINE) ? 1 : 0;
+			const uint32_t lastKey = static_cast<uint32_t>(inputs.size()) - 1;
+			if (lastKey == 0 || time <= inputs[0]) {
+				return outputsVec4[valueOffset];
+			}
+			if (time >= inputs[lastKey]) {
+				return outputsVec4[lastKey * stride + valueOffset];
+			}
+			const uint32_t i = findKey(time, cursor);
+			const float delta = inputs[i + 1] - inputs[i];
+			const float u = (delta > 0.0f) ? (time - inputs[i]) / delta : 0.0f;
+			switch (interpolation) {
+			case STEP:
+				return outputsVec4[i];
+			case CUBICSPLINE: {
+				// Hermite spline, tangents are scaled by the interval length (see glTF 2.0 specification, Appendix C)
+				const glm::vec4 &p0 = outputsVec4[i * 3 + 1];
+				const glm::vec4 m0 = delta * outputsVec4[i * 3 + 2];
+				const glm::vec4 &p1 = outputsVec4[(i + 1) * 3 + 1];
+				const glm::vec4 m1 = delta * outputsVec4[(i + 1) * 3];
+				const float u2 = u * u;
+				const float u3 = u2 * u;
+				const glm::vec4 value = (2.0f * u3 - 3.0f * u2 + 1.0f) * p0 + (u3 - 2.0f * u2 + u) * m0 + (-2.0f * u3 + 3.0f * u2) * p1 + (u3 - u2) * m1;
+				return rotation ? glm::normalize(value) : value;
+			}
+			default: {
+				if (rotation) {
+					const glm::quat q = glm::normalize(glm::slerp(toQuat(outputsVec4[i]), toQuat(outputsVec4[i + 1]), u));
+					return glm::vec4(q.x, q.y, q.z, q.w);
+				}
+				return glm::mix(outputsVec4[i], outputsVec4[i + 1], u);
+			}
+			}
+		}
+
+		/** @brief Sample the output using the sampler's own key cursor */
+		glm::vec4 sample(float time, bool rotation)
+		{
+			return sample(time, rotation, cursor);
+		}
 	};
 
 	/*
@@ -504,6 +764,47 @@ namespace vkglTF
 		float end = std::numeric_limits<float>::min();
 	};
 
+	/*
+		Local transforms of all nodes of a model in contiguous arrays, indexed by the nodes' transform indices
+	*/
+	struct AnimationPose {
+		std::vector<glm::vec3> translations;
+		std::vector<glm::quat> rotations;
+		std::vector<glm::vec3> scales;
+
+		void resize(size_t count)
+		{
+			translations.resize(count, glm::vec3(0.0f));
+			rotations.resize(count, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+			scales.resize(count, glm::vec3(1.0f));
+		}
+
+		size_t size() const
+		{
+			return translations.size();
+		}
+	};
+
+	/*
+		Animation layer blended into a pose (see Model::blendAnimations)
+	*/
+	struct AnimationLayer {
+		enum BlendMode {
+			// Blend from the pose of the previous layers towards the layer's pose by weight (e.g. cross-fades)
+			BLEND_OVERRIDE,
+			// Add the layer's difference to the rest pose on top of the previous layers, scaled by weight
+			BLEND_ADDITIVE
+		};
+		uint32_t animation = 0;
+		float time = 0.0f;
+		float weight = 1.0f;
+		BlendMode blendMode = BLEND_OVERRIDE;
+		// Optional weights per transform index multiplied with the layer weight (see Model::getNodeMask), empty = all nodes
+		std::vector<float> mask;
+		// Key cursors of the animation's samplers for this layer, keep a layer per character so each one samples in coherent time order
+		std::vector<uint32_t> cursors;
+	};
+
 	/*
 		glTF model loading and rendering class
 	*/
@@ -511,8 +812,22 @@ namespace vkglTF
 
 		vks::VulkanDevice *device;
 		VkDescriptorPool descriptorPool;
+		// Single dynamic uniform buffer binding for the mesh uniform blocks (see MeshUniforms)
 		VkDescriptorSetLayout descriptorSetLayout;
 
+		/*
+			Uniform blocks (node matrix and joint palette) of all meshes, packed at aligned offsets into one host visible buffer
+			Bound as a dynamic uniform buffer, so a model only needs one buffer, one allocation and one descriptor set for its meshes
+		*/
+		struct MeshUniforms {
+			vks::Buffer buffer;
+			// Size of one mesh uniform block rounded up to minUniformBufferOffsetAlignment
+			VkDeviceSize alignedSize = 0;
+			// Host copy of the buffer, the changed range is written to the device with a single memcpy
+			std::vector<uint8_t> data;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		} meshUniforms;
+
 		struct Vertex {
 			glm::vec3 pos;
 			glm::vec3 normal;
@@ -529,10 +844,17 @@ namespace vkglTF
 			int count;
 			VkBuffer buffer;
 			VkDeviceMemory memory;
+			// Only differs from 32 bit if 16 bit indices have been requested via the optimize flags
+			VkIndexType type = VK_INDEX_TYPE_UINT32;
 		} indices;
 
 		std::vector<Node*> nodes;
 		std::vector<Node*> linearNodes;
+		NodeTransforms transforms;
+		// Local transforms of all nodes as loaded from the file, reference for additive animation layers
+		AnimationPose restPose;
+		// Scratch pose for sampling animation layers
+		AnimationPose layerPose;
 
 		std::vector<Skin*> skins;
 
@@ -550,6 +872,64 @@ namespace vkglTF
 
 		bool metallicRoughnessWorkflow = true;
 
+		// Post load geometry optimizations (see vks::meshopt::OptimizeFlagBits), must be set before calling loadFromFile
+		uint32_t optimizeFlags = 0;
+
+		/*
+			Primitive table entry for GPU driven rendering (std430, same layout as in the culling and vertex shaders)
+		*/
+		struct IndirectPrimitive {
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			uint32_t materialIndex;
+			// Index into the node matrix buffer
+			uint32_t matrixIndex;
+			// Bounding sphere in the node's local space (xyz = center, w = radius)
+			glm::vec4 boundingSphere;
+		};
+
+		/*
+			Resources for culling the model's primitives in a compute shader and drawing them with indirect draw commands (see prepareIndirect)
+		*/
+		struct IndirectDraw {
+			bool prepared = false;
+			// Primitive table, sorted by material so all draws of a material are consecutive
+			std::vector<IndirectPrimitive> primitives;
+			// Consecutive draws using the same material
+			struct Batch {
+				uint32_t materialIndex;
+				uint32_t firstDraw;
+				uint32_t drawCount;
+			};
+			std::vector<Batch> batches;
+			// Mesh nodes in the order of the node matrix buffer
+			std::vector<Node*> matrixNodes;
+			struct CullUniforms {
+				glm::mat4 model;
+				glm::vec4 frustumPlanes[6];
+				uint32_t primitiveCount;
+				uint32_t frustumCulling;
+			} cullUniforms;
+			// Written by the culling shader
+			struct Stats {
+				uint32_t visiblePrimitives;
+				uint32_t visibleTriangles;
+			} stats;
+			vks::Buffer primitiveBuffer;
+			vks::Buffer matrixBuffer;
+			vks::Buffer commandBuffer;
+			vks::Buffer uniformBuffer;
+			vks::Buffer statsBuffer;
+			VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+			// Vertex shader bindings: 0 = primitive table, 1 = node matrices
+			VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+			VkDescriptorSetLayout cullDescriptorSetLayout = VK_NULL_HANDLE;
+			VkDescriptorSet cullDescriptorSet = VK_NULL_HANDLE;
+			VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+			VkPipeline cullPipeline = VK_NULL_HANDLE;
+		} indirect;
+
 		Model() {};
 
 		~Model() 
@@ -564,158 +944,273 @@ namespace vkglTF
 			for (auto node : nodes) {
 				delete node;
 			}
+			meshUniforms.buffer.destroy();
 			vkDestroyDescriptorSetLayout(device->logicalDevice, descriptorSetLayout, nullptr);
 			vkDestroyDescriptorPool(device->logicalDevice, descriptorPool, nullptr);
+			if (indirect.prepared) {
+				indirect.primitiveBuffer.destroy();
+				indirect.matrixBuffer.destroy();
+				indirect.commandBuffer.destroy();
+				indirect.uniformBuffer.destroy();
+				indirect.statsBuffer.destroy();
+				vkDestroyPipeline(device->logicalDevice, indirect.cullPipeline, nullptr);
+				vkDestroyPipelineLayout(device->logicalDevice, indirect.cullPipelineLayout, nullptr);
+				vkDestroyDescriptorSetLayout(device->logicalDevice, indirect.cullDescriptorSetLayout, nullptr);
+				vkDestroyDescriptorSetLayout(device->logicalDevice, indirect.descriptorSetLayout, nullptr);
+				vkDestroyDescriptorPool(device->logicalDevice, indirect.descriptorPool, nullptr);
+			}
+		}
+
+		/*
+			Destination of the geometry of all nodes, the buffers are sized up front from the accessor counts (see getNodeProps)
+		*/
+		struct LoaderInfo {
+			uint32_t *indexBuffer;
+			Vertex *vertexBuffer;
+			size_t indexPos = 0;
+			size_t vertexPos = 0;
+		};
+
+		/*
+			Optional runtime block compression of the glTF images (see texturecompression.hpp), requires the textureCompressionBC feature to be enabled
+			The format is chosen by the material slots an image is used in, the compressed mip chains are cached as KTX files
+			keyed by a hash of the decoded image, so only the first load of an image pays for the encoding
+		*/
+		struct TextureCompression {
+			/** @brief Must be set before calling loadFromFile, the glTF examples set it from the "-texturecompression" command line argument */
+			bool enabled = false;
+			/** @brief Use BC1 and BC3 instead of BC7 for color and packed material textures (much faster to encode, lower quality) */
+			bool fast = false;
+			bool cache = true;
+			/** @brief Directory for the cache files (defaults to the system's temporary directory, the app's internal data path on Android) */
+			std::string cacheDirectory;
+		} textureCompression;
+
+		/*
+			Mip chain generation for the glTF images (see imageprocessing.hpp)
+			Uncompressed images are blitted on the GPU by default, the CPU is used if the format doesn't support blitting
+			Mip chains generated on the CPU filter color images in linear space and keep the alpha test coverage of alpha masked materials
+		*/
+		struct MipGeneration {
+			/** @brief Always generate the mip chains of uncompressed images on the CPU (higher quality than linear blits) */
+			bool cpu = false;
+			vks::imageproc::MipFilter filter = vks::imageproc::MIP_FILTER_KAISER;
+		} mipGeneration;
+
+		/*
+			CPU time spent in the different stages of the last loadFromFile call (in ms)
+			Only printed if verbose output is enabled (see vks::tools::verboseOutput)
+		*/
+		struct LoadTimings {
+			double parse = 0.0;
+			double images = 0.0;
+			double materials = 0.0;
+			double geometry = 0.0;
+			double animations = 0.0;
+			double upload = 0.0;
+			double descriptors = 0.0;
+			double total = 0.0;
+		} loadTimings;
+
+		/** @brief Start of an accessor's data and the distance between two of its elements in bytes (honours the buffer view's byteStride) */
+		static const unsigned char* getAccessorData(const tinygltf::Model &model, const tinygltf::Accessor &accessor, size_t &stride)
+		{
+			const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
+			const int byteStride = accessor.ByteStride(bufferView);
+			assert(byteStride > 0);
+			stride = static_cast<size_t>(byteStride);
+			return &model.buffers[bufferView.buffer].data[accessor.byteOffset + bufferView.byteOffset];
+		}
+
+		static const tinygltf::Accessor* findAttribute(const tinygltf::Model &model, const tinygltf::Primitive &primitive, const char *name)
+		{
+			auto it = primitive.attributes.find(name);
+			return (it != primitive.attributes.end()) ? &model.accessors[it->second] : nullptr;
+		}
+
+		/** @brief Read four integer or normalized integer components (e.g. joint indices or weights) as floats */
+		static glm::vec4 readVec4(const unsigned char *data, int componentType, bool normalize)
+		{
+			switch (componentType) {
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+				const glm::vec4 v(data[0], data[1], data[2], data[3]);
+				return normalize ? v / 255.0f : v;
+			}
+			case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+				uint16_t values[4];
+				memcpy(values, data, sizeof(values));
+				const glm::vec4 v(values[0], values[1], values[2], values[3]);
+				return normalize ? v / 65535.0f : v;
+			}
+			default: {
+				glm::vec4 v;
+				memcpy(&v, data, sizeof(glm::vec4));
+				return v;
+			}
+			}
+		}
+
+		/** @brief Count the vertices and indices of a node and its children, used to allocate the geometry buffers once */
+		void getNodeProps(const tinygltf::Node &node, const tinygltf::Model &model, size_t &vertexCount, size_t &indexCount)
+		{
+			for (auto child : node.children) {
+				getNodeProps(model.nodes[child], model, vertexCount, indexCount);
+			}
+			if (node.mesh > -1) {
+				const tinygltf::Mesh &mesh = model.meshes[node.mesh];
+				for (auto &primitive : mesh.primitives) {
+					if (primitive.indices < 0) {
+						continue;
+					}
+					vertexCount += model.accessors[primitive.attributes.find("POSITION")->second].count;
+					indexCount += model.accessors[primitive.indices].count;
+				}
+			}
 		}
 
-		void loadNode(vkglTF::Node *parent, const tinygltf::Node &node, uint32_t nodeIndex, const tinygltf::Model &model, std::vector<uint32_t>& indexBuffer, std::vector<Vertex>& vertexBuffer, float globalscale)
+		void loadNode(vkglTF::Node *parent, const tinygltf::Node &node, uint32_t nodeIndex, const tinygltf::Model &model, LoaderInfo &loaderInfo, float globalscale)
 		{
 			vkglTF::Node *newNode = new Node{};
 			newNode->index = nodeIndex;
 			newNode->parent = parent;
 			newNode->name = node.name;
 			newNode->skinIndex = node.skin;
-			newNode->matrix = glm::mat4(1.0f);
+
+			// Nodes are added to the flattened hierarchy before their children, keeping it topologically sorted
+			newNode->transforms = &transforms;
+			newNode->transformIndex = transforms.add(parent ? static_cast<int32_t>(parent->transformIndex) : -1);
 
 			// Generate local node matrix
-			glm::vec3 translation = glm::vec3(0.0f);
 			if (node.translation.size() == 3) {
-				translation = glm::make_vec3(node.translation.data());
-				newNode->translation = translation;
+				transforms.translations[newNode->transformIndex] = glm::make_vec3(node.translation.data());
 			}
-			glm::mat4 rotation = glm::mat4(1.0f);
 			if (node.rotation.size() == 4) {
-				glm::quat q = glm::make_quat(node.rotation.data());
-				newNode->rotation = glm::mat4(q);
+				transforms.rotations[newNode->transformIndex] = glm::make_quat(node.rotation.data());
 			}
-			glm::vec3 scale = glm::vec3(1.0f);
 			if (node.scale.size() == 3) {
-				scale = glm::make_vec3(node.scale.data());
-				newNode->scale = scale;
+				transforms.scales[newNode->transformIndex] = glm::make_vec3(node.scale.data());
 			}
 			if (node.matrix.size() == 16) {
-				newNode->matrix = glm::make_mat4x4(node.matrix.data());
+				transforms.matrices[newNode->transformIndex] = glm::make_mat4x4(node.matrix.data());
 				if (globalscale != 1.0f) {
-					//newNode->matrix = glm::scale(newNode->matrix, glm::vec3(globalscale));
+					//transforms.matrices[newNode->transformIndex] = glm::scale(transforms.matrices[newNode->transformIndex], glm::vec3(globalscale));
 				}
 			};
 
 			// Node with children
 			if (node.children.size() > 0) {
 				for (auto i = 0; i < node.children.size(); i++) {
-					loadNode(newNode, model.nodes[node.children[i]], node.children[i], model, indexBuffer, vertexBuffer, globalscale);
+					loadNode(newNode, model.nodes[node.children[i]], node.children[i], model, loaderInfo, globalscale);
 				}
 			}
 
 			// Node contains mesh data
 			if (node.mesh > -1) {
-				const tinygltf::Mesh mesh = model.meshes[node.mesh];
-				Mesh *newMesh = new Mesh(device, newNode->matrix);
+				const tinygltf::Mesh &mesh = model.meshes[node.mesh];
+				Mesh *newMesh = new Mesh(device, transforms.matrices[newNode->transformIndex]);
 				newMesh->name = mesh.name;
 				for (size_t j = 0; j < mesh.primitives.size(); j++) {
 					const tinygltf::Primitive &primitive = mesh.primitives[j];
 					if (primitive.indices < 0) {
 						continue;
 					}
-					uint32_t indexStart = static_cast<uint32_t>(indexBuffer.size());
-					uint32_t vertexStart = static_cast<uint32_t>(vertexBuffer.size());
+					uint32_t indexStart = static_cast<uint32_t>(loaderInfo.indexPos);
+					uint32_t vertexStart = static_cast<uint32_t>(loaderInfo.vertexPos);
 					uint32_t indexCount = 0;
 					glm::vec3 posMin{};
 					glm::vec3 posMax{};
 					bool hasSkin = false;
 					// Vertices
+					// Attributes are decoded one after another straight into the (zero initialized) vertex buffer, each source accessor is read sequentially
 					{
-						const float *bufferPos = nullptr;
-						const float *bufferNormals = nullptr;
-						const float *bufferTexCoords = nullptr;
-						const uint16_t *bufferJoints = nullptr;
-						const float *bufferWeights = nullptr;
-
 						// Position attribute is required
-						assert(primitive.attributes.find("POSITION") != primitive.attributes.end());
-
-						const tinygltf::Accessor &posAccessor = model.accessors[primitive.attributes.find("POSITION")->second];
-						const tinygltf::BufferView &posView = model.bufferViews[posAccessor.bufferView];
-						bufferPos = reinterpret_cast<const float *>(&(model.buffers[posView.buffer].data[posAccessor.byteOffset + posView.byteOffset]));
-						posMin = glm::vec3(posAccessor.minValues[0], posAccessor.minValues[1], posAccessor.minValues[2]);
-						posMax = glm::vec3(posAccessor.maxValues[0], posAccessor.maxValues[1], posAccessor.maxValues[2]);
-
-						if (primitive.attributes.find("NORMAL") != primitive.attributes.end()) {
-							const tinygltf::Accessor &normAccessor = model.accessors[primitive.attributes.find("NORMAL")->second];
-							const tinygltf::BufferView &normView = model.bufferViews[normAccessor.bufferView];
-							bufferNormals = reinterpret_cast<const float *>(&(model.buffers[normView.buffer].data[normAccessor.byteOffset + normView.byteOffset]));
+						const tinygltf::Accessor *posAccessor = findAttribute(model, primitive, "POSITION");
+						assert(posAccessor);
+						const tinygltf::Accessor *normAccessor = findAttribute(model, primitive, "NORMAL");
+						const tinygltf::Accessor *uvAccessor = findAttribute(model, primitive, "TEXCOORD_0");
+						const tinygltf::Accessor *jointAccessor = findAttribute(model, primitive, "JOINTS_0");
+						const tinygltf::Accessor *weightAccessor = findAttribute(model, primitive, "WEIGHTS_0");
+
+						const size_t vertexCount = posAccessor->count;
+						Vertex *vertices = &loaderInfo.vertexBuffer[loaderInfo.vertexPos];
+						size_t stride;
+
+						const unsigned char *bufferPos = getAccessorData(model, *posAccessor, stride);
+						posMin = glm::vec3(posAccessor->minValues[0], posAccessor->minValues[1], posAccessor->minValues[2]);
+						posMax = glm::vec3(posAccessor->maxValues[0], posAccessor->maxValues[1], posAccessor->maxValues[2]);
+						for (size_t v = 0; v < vertexCount; v++) {
+							memcpy(&vertices[v].pos, bufferPos + v * stride, sizeof(glm::vec3));
 						}
 
-						if (primitive.attributes.find("TEXCOORD_0") != primitive.attributes.end()) {
-							const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("TEXCOORD_0")->second];
-							const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
-							bufferTexCoords = reinterpret_cast<const float *>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
+						if (normAccessor) {
+							const unsigned char *bufferNormals = getAccessorData(model, *normAccessor, stride);
+							for (size_t v = 0; v < vertexCount; v++) {
+								glm::vec3 normal;
+								memcpy(&normal, bufferNormals + v * stride, sizeof(glm::vec3));
+								vertices[v].normal = glm::normalize(normal);
+							}
 						}
 
-						// Skinning
-						// Joints
-						if (primitive.attributes.find("JOINTS_0") != primitive.attributes.end()) {
-							const tinygltf::Accessor &jointAccessor = model.accessors[primitive.attributes.find("JOINTS_0")->second];
-							const tinygltf::BufferView &jointView = model.bufferViews[jointAccessor.bufferView];
-							bufferJoints = reinterpret_cast<const uint16_t *>(&(model.buffers[jointView.buffer].data[jointAccessor.byteOffset + jointView.byteOffset]));
+						if (uvAccessor) {
+							const unsigned char *bufferTexCoords = getAccessorData(model, *uvAccessor, stride);
+							for (size_t v = 0; v < vertexCount; v++) {
+								memcpy(&vertices[v].uv, bufferTexCoords + v * stride, sizeof(glm::vec2));
+							}
 						}
 
-						if (primitive.attributes.find("WEIGHTS_0") != primitive.attributes.end()) {
-							const tinygltf::Accessor &uvAccessor = model.accessors[primitive.attributes.find("WEIGHTS_0")->second];
-							const tinygltf::BufferView &uvView = model.bufferViews[uvAccessor.bufferView];
-							bufferWeights = reinterpret_cast<const float *>(&(model.buffers[uvView.buffer].data[uvAccessor.byteOffset + uvView.byteOffset]));
+						// Skinning
+						hasSkin = (jointAccessor && weightAccessor);
+						if (hasSkin) {
+							const unsigned char *bufferJoints = getAccessorData(model, *jointAccessor, stride);
+							for (size_t v = 0; v < vertexCount; v++) {
+								vertices[v].joint0 = readVec4(bufferJoints + v * stride, jointAccessor->componentType, false);
+							}
+							const unsigned char *bufferWeights = getAccessorData(model, *weightAccessor, stride);
+							for (size_t v = 0; v < vertexCount; v++) {
+								vertices[v].weight0 = readVec4(bufferWeights + v * stride, weightAccessor->componentType, true);
+							}
 						}
 
-						hasSkin = (bufferJoints && bufferWeights);
-
-						for (size_t v = 0; v < posAccessor.count; v++) {
-							Vertex vert{};
-							vert.pos = glm::vec4(glm::make_vec3(&bufferPos[v * 3]), 1.0f);
-							vert.normal = glm::normalize(glm::vec3(bufferNormals ? glm::make_vec3(&bufferNormals[v * 3]) : glm::vec3(0.0f)));
-							vert.uv = bufferTexCoords ? glm::make_vec2(&bufferTexCoords[v * 2]) : glm::vec3(0.0f);
-							
-							vert.joint0 = hasSkin ? glm::vec4(glm::make_vec4(&bufferJoints[v * 4])) : glm::vec4(0.0f);
-							vert.weight0 = hasSkin ? glm::make_vec4(&bufferWeights[v * 4]) : glm::vec4(0.0f);
-							vertexBuffer.push_back(vert);
-						}
+						loaderInfo.vertexPos += vertexCount;
 					}
 					// Indices
+					// Index buffer views are always tightly packed, the loops only widen and offset the indices and can be vectorized by the compiler
 					{
 						const tinygltf::Accessor &accessor = model.accessors[primitive.indices];
-						const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
-						const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+						size_t stride;
+						const unsigned char *data = getAccessorData(model, accessor, stride);
+						uint32_t *indices = &loaderInfo.indexBuffer[loaderInfo.indexPos];
 
 						indexCount = static_cast<uint32_t>(accessor.count);
 
 						switch (accessor.componentType) {
 						case TINYGLTF_PARAMETER_TYPE_UNSIGNED_INT: {
-							uint32_t *buf = new uint32_t[accessor.count];
-							memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint32_t));
+							const uint32_t *buf = reinterpret_cast<const uint32_t*>(data);
 							for (size_t index = 0; index < accessor.count; index++) {
-								indexBuffer.push_back(buf[index] + vertexStart);
+								indices[index] = buf[index] + vertexStart;
 							}
 							break;
 						}
 						case TINYGLTF_PARAMETER_TYPE_UNSIGNED_SHORT: {
-							uint16_t *buf = new uint16_t[accessor.count];
-							memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint16_t));
+							const uint16_t *buf = reinterpret_cast<const uint16_t*>(data);
 							for (size_t index = 0; index < accessor.count; index++) {
-								indexBuffer.push_back(buf[index] + vertexStart);
+								indices[index] = buf[index] + vertexStart;
 							}
 							break;
 						}
 						case TINYGLTF_PARAMETER_TYPE_UNSIGNED_BYTE: {
-							uint8_t *buf = new uint8_t[accessor.count];
-							memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(uint8_t));
+							const uint8_t *buf = data;
 							for (size_t index = 0; index < accessor.count; index++) {
-								indexBuffer.push_back(buf[index] + vertexStart);
+								indices[index] = buf[index] + vertexStart;
 							}
 							break;
 						}
 						default:
 							std::cerr << "Index component type " << accessor.componentType << " not supported!" << std::endl;
-							return;
+							loaderInfo.indexPos += indexCount;
+							continue;
 						}
+						loaderInfo.indexPos += indexCount;
 					}
 					Primitive *newPrimitive = new Primitive(indexStart, indexCount, materials[primitive.material]);
 					newPrimitive->setDimensions(posMin, posMax);
@@ -753,23 +1248,243 @@ namespace vkglTF
 				// Get inverse bind matrices from buffer
 				if (source.inverseBindMatrices > -1) {
 					const tinygltf::Accessor &accessor = gltfModel.accessors[source.inverseBindMatrices];
-					const tinygltf::BufferView &bufferView = gltfModel.bufferViews[accessor.bufferView];
-					const tinygltf::Buffer &buffer = gltfModel.buffers[bufferView.buffer];
+					size_t stride;
+					const unsigned char *data = getAccessorData(gltfModel, accessor, stride);
 					newSkin->inverseBindMatrices.resize(accessor.count);
-					memcpy(newSkin->inverseBindMatrices.data(), &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(glm::mat4));
+					for (size_t i = 0; i < accessor.count; i++) {
+						memcpy(&newSkin->inverseBindMatrices[i], data + i * stride, sizeof(glm::mat4));
+					}
 				}
 
 				skins.push_back(newSkin);
 			}
 		}
 
+		/** @brief Material slots an image is used in, selects the block format for texture compression */
+		enum TextureSlotBits {
+			TEXTURE_SLOT_BASE_COLOR = 0x1,
+			TEXTURE_SLOT_METALLIC_ROUGHNESS = 0x2,
+			TEXTURE_SLOT_NORMAL = 0x4,
+			TEXTURE_SLOT_OCCLUSION = 0x8,
+			TEXTURE_SLOT_EMISSIVE = 0x10
+		};
+
+		/** @brief Combined slot bits of all materials referencing each image */
+		static std::vector<uint32_t> getImageSlots(const tinygltf::Model &gltfModel)
+		{
+			std::vector<uint32_t> slots(gltfModel.images.size(), 0);
+			auto addSlot = [&](const tinygltf::ParameterMap &values, const char *name, uint32_t slot) {
+				auto it = values.find(name);
+				if (it != values.end()) {
+					const int source = gltfModel.textures[it->second.TextureIndex()].source;
+					if ((source >= 0) && (source < static_cast<int>(slots.size()))) {
+						slots[source] |= slot;
+					}
+				}
+			};
+			for (auto &mat : gltfModel.materials) {
+				addSlot(mat.values, "baseColorTexture", TEXTURE_SLOT_BASE_COLOR);
+				addSlot(mat.values, "metallicRoughnessTexture", TEXTURE_SLOT_METALLIC_ROUGHNESS);
+				addSlot(mat.additionalValues, "normalTexture", TEXTURE_SLOT_NORMAL);
+				addSlot(mat.additionalValues, "occlusionTexture", TEXTURE_SLOT_OCCLUSION);
+				addSlot(mat.additionalValues, "emissiveTexture", TEXTURE_SLOT_EMISSIVE);
+			}
+			return slots;
+		}
+
+		/** @brief Mip chain options for the images by the material slots they are used in */
+		std::vector<vks::imageproc::MipOptions> getImageMipOptions(const tinygltf::Model &gltfModel, const std::vector<uint32_t> &slots)
+		{
+			std::vector<vks::imageproc::MipOptions> options(gltfModel.images.size());
+			for (size_t i = 0; i < options.size(); i++) {
+				options[i].filter = mipGeneration.filter;
+				if (slots[i] & (TEXTURE_SLOT_BASE_COLOR | TEXTURE_SLOT_EMISSIVE)) {
+					options[i].colorSpace = vks::imageproc::COLOR_SPACE_SRGB;
+				}
+				// Alpha is only known to be opacity for base color images
+				options[i].alphaWeighted = (slots[i] & TEXTURE_SLOT_BASE_COLOR) != 0;
+				options[i].normalMap = (slots[i] == TEXTURE_SLOT_NORMAL);
+			}
+			// Base color images of alpha masked materials keep their alpha test coverage
+			for (auto &mat : gltfModel.materials) {
+				auto alphaMode = mat.additionalValues.find("alphaMode");
+				auto baseColor = mat.values.find("baseColorTexture");
+				if ((alphaMode == mat.additionalValues.end()) || (alphaMode->second.string_value != "MASK") || (baseColor == mat.values.end())) {
+					continue;
+				}
+				const int source = gltfModel.textures[baseColor->second.TextureIndex()].source;
+				if ((source >= 0) && (source < static_cast<int>(options.size()))) {
+					auto alphaCutoff = mat.additionalValues.find("alphaCutoff");
+					options[source].alphaCutoff = (alphaCutoff != mat.additionalValues.end()) ? static_cast<float>(alphaCutoff->second.Factor()) : 0.5f;
+				}
+			}
+			return options;
+		}
+
+		vks::texcompress::BlockFormat selectBlockFormat(uint32_t slots, bool alpha)
+		{
+			// Normal maps keep all three channels, BC5 would only store x and y and none of the shaders reconstruct z
+			if (slots == TEXTURE_SLOT_NORMAL) {
+				return textureCompression.fast ? vks::texcompress::BLOCK_FORMAT_BC1 : vks::texcompress::BLOCK_FORMAT_BC7;
+			}
+			if (slots & TEXTURE_SLOT_BASE_COLOR) {
+				return textureCompression.fast ? (alpha ? vks::texcompress::BLOCK_FORMAT_BC3 : vks::texcompress::BLOCK_FORMAT_BC1) : vks::texcompress::BLOCK_FORMAT_BC7;
+			}
+			// Metallic, roughness and occlusion are often packed into independent channels of one image, which BC1 can't represent well
+			if (slots & (TEXTURE_SLOT_METALLIC_ROUGHNESS | TEXTURE_SLOT_OCCLUSION)) {
+				return textureCompression.fast ? vks::texcompress::BLOCK_FORMAT_BC1 : vks::texcompress::BLOCK_FORMAT_BC7;
+			}
+			// Emissive and unreferenced images
+			return alpha ? vks::texcompress::BLOCK_FORMAT_BC3 : vks::texcompress::BLOCK_FORMAT_BC1;
+		}
+
+		std::string getTextureCacheFilename(uint64_t key)
+		{
+			std::string directory = textureCompression.cacheDirectory;
+			if (directory.empty()) {
+#if defined(__ANDROID__)
+				directory = androidApp->activity->internalDataPath;
+#elif defined(_WIN32)
+				char tempPath[MAX_PATH];
+				directory = (GetTempPathA(MAX_PATH, tempPath) > 0) ? std::string(tempPath) : ".";
+#else
+				const char *tempPath = getenv("TMPDIR");
+				directory = tempPath ? tempPath : "/tmp";
+#endif
+			}
+			if (directory.back() != '/' && directory.back() != '\\') {
+				directory += "/";
+			}
+			char keyString[17];
+			snprintf(keyString, sizeof(keyString), "%016llx", static_cast<unsigned long long>(key));
+			return directory + "gltf_" + keyString + ".ktx";
+		}
+
+		struct TextureCompressionStats {
+			uint32_t encoded = 0;
+			uint32_t cached = 0;
+			double encodeTime = 0.0;
+			size_t uncompressedSize = 0;
+			size_t compressedSize = 0;
+		};
+
+		/*
+			Load a glTF image as a block compressed texture, either from the cache or by compressing it on the CPU
+			The job system for the encoders is only created once the first image has to be encoded
+		*/
+		void loadCompressedImage(const tinygltf::Image &gltfimage, uint32_t slots, const vks::imageproc::MipOptions &mipOptions, vks::VulkanDevice *device, VkQueue transferQueue, std::unique_ptr<vks::JobSystem> &jobSystem, vkglTF::Texture &texture, TextureCompressionStats &stats)
+		{
+			const uint32_t width = static_cast<uint32_t>(gltfimage.width);
+			const uint32_t height = static_cast<uint32_t>(gltfimage.height);
+			const size_t texelCount = static_cast<size_t>(width) * height;
+
+			// The encoders work on RGBA, images with fewer components are expanded (grey, grey + alpha, RGB)
+			const unsigned char *rgba = gltfimage.image.data();
+			std::vector<unsigned char> expanded;
+			if (gltfimage.component != 4) {
+				expanded.resize(texelCount * 4);
+				vks::imageproc::expandToRgba(gltfimage.image.data(), gltfimage.component, texelCount, expanded.data(), jobSystem.get());
+				rgba = expanded.data();
+			}
+
+			const vks::texcompress::BlockFormat format = selectBlockFormat(slots, vks::texcompress::hasAlpha(rgba, texelCount));
+			const uint32_t levelCount = vks::texcompress::getMipLevelCount(width, height);
+			stats.uncompressedSize += texelCount * 4 * 4 / 3;
+
+			uint64_t key = 0xcbf29ce484222325ULL;
+			// The mip chain options change the contents of the levels, so they're part of the key
+			const uint32_t keyValues[8] = {
+				vks::texcompress::encoderVersion, width, height, static_cast<uint32_t>(format),
+				static_cast<uint32_t>(mipOptions.filter), static_cast<uint32_t>(mipOptions.colorSpace),
+				(mipOptions.alphaWeighted ? 1u : 0u) | (mipOptions.normalMap ? 2u : 0u), static_cast<uint32_t>(mipOptions.alphaCutoff * 255.0f)
+			};
+			vks::texcompress::hashBytes(key, keyValues, sizeof(keyValues));
+			vks::texcompress::hashBytes(key, rgba, texelCount * 4);
+			const std::string cacheFilename = getTextureCacheFilename(key);
+
+			std::vector<const void*> levelData;
+			std::vector<size_t> levelSizes;
+
+			// Cached images are uploaded straight from the mapped cache file
+			vks::KtxFile cacheFile;
+			if (textureCompression.cache && cacheFile.open(cacheFilename, false)) {
+				const vks::KtxFile::Header &header = cacheFile.getHeader();
+				if ((header.glInternalFormat == vks::texcompress::getGlInternalFormat(format)) && (cacheFile.width() == width) && (cacheFile.height() == height) && (cacheFile.levelCount() == levelCount)) {
+					for (uint32_t i = 0; i < levelCount; i++) {
+						size_t size;
+						levelData.push_back(cacheFile.imageData(i, 0, 0, &size));
+						levelSizes.push_back(size);
+						stats.compressedSize += size;
+					}
+					texture.fromCompressedLevels(vks::texcompress::getVkFormat(format), width, height, levelData, levelSizes, device, transferQueue);
+					stats.cached++;
+					return;
+				}
+				cacheFile.close();
+			}
+
+			if (!jobSystem) {
+				jobSystem.reset(new vks::JobSystem());
+			}
+			const auto tStart = std::chrono::high_resolution_clock::now();
+			const vks::texcompress::CompressedImage compressed = vks::texcompress::compressImage(rgba, width, height, format, mipOptions, jobSystem.get());
+			stats.encodeTime += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+			stats.encoded++;
+			for (auto &level : compressed.levels) {
+				levelData.push_back(compressed.data.data() + level.offset);
+				levelSizes.push_back(level.size);
+				stats.compressedSize += level.size;
+			}
+
+			if (textureCompression.cache) {
+				// Write to a temporary file first, so other instances never map a partially written cache file
+				const std::string tempFilename = vks::getUniqueTempFilename(cacheFilename);
+				if (vks::KtxFile::write(tempFilename, vks::texcompress::getGlInternalFormat(format), vks::texcompress::getGlBaseInternalFormat(format), width, height, levelData, levelSizes)) {
+					std::remove(cacheFilename.c_str());
+					std::rename(tempFilename.c_str(), cacheFilename.c_str());
+				} else {
+					std::remove(tempFilename.c_str());
+				}
+			}
+
+			texture.fromCompressedLevels(vks::texcompress::getVkFormat(format), width, height, levelData, levelSizes, device, transferQueue);
+		}
+
 		void loadImages(tinygltf::Model &gltfModel, vks::VulkanDevice *device, VkQueue transferQueue)
 		{
-			for (tinygltf::Image &image : gltfModel.images) {
+			const bool compress = textureCompression.enabled && device->enabledFeatures.textureCompressionBC;
+			if (textureCompression.enabled && !compress) {
+				std::cerr << "Texture compression requires the textureCompressionBC feature to be enabled, images are uploaded uncompressed" << std::endl;
+			}
+			const std::vector<uint32_t> slots = getImageSlots(gltfModel);
+			const std::vector<vks::imageproc::MipOptions> mipOptions = getImageMipOptions(gltfModel, slots);
+			std::unique_ptr<vks::JobSystem> jobSystem;
+			if (!compress && !gltfModel.images.empty()) {
+				// Uncompressed images fall back to CPU mip generation if the format can't be blitted (see fromglTfImage)
+				VkFormatProperties formatProperties;
+				vkGetPhysicalDeviceFormatProperties(device->physicalDevice, VK_FORMAT_R8G8B8A8_UNORM, &formatProperties);
+				const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+				if (mipGeneration.cpu || ((formatProperties.optimalTilingFeatures & blitFeatures) != blitFeatures)) {
+					jobSystem.reset(new vks::JobSystem());
+				}
+			}
+			TextureCompressionStats stats;
+			for (size_t i = 0; i < gltfModel.images.size(); i++) {
 				vkglTF::Texture texture;
-				texture.fromglTfImage(image, device, transferQueue);
+				if (compress) {
+					loadCompressedImage(gltfModel.images[i], slots[i], mipOptions[i], device, transferQueue, jobSystem, texture, stats);
+				} else {
+					texture.fromglTfImage(gltfModel.images[i], device, transferQueue, mipOptions[i], mipGeneration.cpu, jobSystem.get());
+				}
 				textures.push_back(texture);
 			}
+			if (compress && !gltfModel.images.empty() && vks::tools::verboseOutput) {
+				std::stringstream report;
+				report << std::fixed << std::setprecision(2);
+				report << "Compressed " << gltfModel.images.size() << " images (" << stats.cached << " from cache, " << stats.encoded << " encoded in " << stats.encodeTime << " ms): ";
+				report << (stats.uncompressedSize / (1024.0 * 1024.0)) << " MB -> " << (stats.compressedSize / (1024.0 * 1024.0)) << " MB";
+				std::cout << report.str() << std::endl;
+			}
 		}
 
 		void loadMaterials(tinygltf::Model &gltfModel)
@@ -844,15 +1559,14 @@ namespace vkglTF
 					// Read sampler input time values
 					{
 						const tinygltf::Accessor &accessor = gltfModel.accessors[samp.input];
-						const tinygltf::BufferView &bufferView = gltfModel.bufferViews[accessor.bufferView];
-						const tinygltf::Buffer &buffer = gltfModel.buffers[bufferView.buffer];
+						size_t stride;
+						const unsigned char *data = getAccessorData(gltfModel, accessor, stride);
 
 						assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
 
-						float *buf = new float[accessor.count];
-						memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(float));
+						sampler.inputs.resize(accessor.count);
 						for (size_t index = 0; index < accessor.count; index++) {
-							sampler.inputs.push_back(buf[index]);
+							memcpy(&sampler.inputs[index], data + index * stride, sizeof(float));
 						}
 
 						for (auto input : sampler.inputs) {
@@ -868,25 +1582,23 @@ namespace vkglTF
 					// Read sampler output T/R/S values 
 					{
 						const tinygltf::Accessor &accessor = gltfModel.accessors[samp.output];
-						const tinygltf::BufferView &bufferView = gltfModel.bufferViews[accessor.bufferView];
-						const tinygltf::Buffer &buffer = gltfModel.buffers[bufferView.buffer];
+						size_t stride;
+						const unsigned char *data = getAccessorData(gltfModel, accessor, stride);
 
 						assert(accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT);
 
 						switch (accessor.type) {
 						case TINYGLTF_TYPE_VEC3: {
-							glm::vec3 *buf = new glm::vec3[accessor.count];
-							memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(glm::vec3));
+							sampler.outputsVec4.resize(accessor.count, glm::vec4(0.0f));
 							for (size_t index = 0; index < accessor.count; index++) {
-								sampler.outputsVec4.push_back(glm::vec4(buf[index], 0.0f));
+								memcpy(&sampler.outputsVec4[index], data + index * stride, sizeof(glm::vec3));
 							}
 							break;
 						}
 						case TINYGLTF_TYPE_VEC4: {
-							glm::vec4 *buf = new glm::vec4[accessor.count];
-							memcpy(buf, &buffer.data[accessor.byteOffset + bufferView.byteOffset], accessor.count * sizeof(glm::vec4));
+							sampler.outputsVec4.resize(accessor.count);
 							for (size_t index = 0; index < accessor.count; index++) {
-								sampler.outputsVec4.push_back(buf[index]);
+								memcpy(&sampler.outputsVec4[index], data + index * stride, sizeof(glm::vec4));
 							}
 							break;
 						}
@@ -930,6 +1642,72 @@ namespace vkglTF
 			}
 		}
 
+		/*
+			Run the optimizations selected by optimizeFlags on the decoded geometry, the vertex cache statistics before and after are printed if verbose output is enabled
+			Triangles are only reordered inside of their primitive, so the primitives' index ranges stay valid
+		*/
+		void optimizeGeometry(const std::string &filename, std::vector<Vertex> &vertexBuffer, std::vector<uint32_t> &indexBuffer)
+		{
+			uint32_t vertexCount = static_cast<uint32_t>(vertexBuffer.size());
+			const uint32_t vertexCountBefore = vertexCount;
+			// The statistics are only needed for the report
+			vks::meshopt::VertexCacheStatistics statsBefore;
+			if (vks::tools::verboseOutput) {
+				statsBefore = vks::meshopt::analyzeVertexCache(indexBuffer.data(), indexBuffer.size(), vertexCount);
+			}
+
+			if (optimizeFlags & vks::meshopt::OPTIMIZE_WELD) {
+				vertexCount = vks::meshopt::weldVertices(vertexBuffer.data(), vertexCount, sizeof(Vertex), indexBuffer.data(), indexBuffer.size());
+			}
+
+			for (auto node : linearNodes) {
+				if (!node->mesh) {
+					continue;
+				}
+				for (Primitive *primitive : node->mesh->primitives) {
+					if (primitive->indexCount == 0) {
+						continue;
+					}
+					// Work on the range of vertices referenced by the primitive, keeps the optimizer's per vertex data small
+					uint32_t *primitiveIndices = &indexBuffer[primitive->firstIndex];
+					const auto range = std::minmax_element(primitiveIndices, primitiveIndices + primitive->indexCount);
+					const uint32_t firstVertex = *range.first;
+					const uint32_t rangeCount = *range.second - firstVertex + 1;
+					for (uint32_t i = 0; i < primitive->indexCount; i++) {
+						primitiveIndices[i] -= firstVertex;
+					}
+					if (optimizeFlags & vks::meshopt::OPTIMIZE_VERTEX_CACHE) {
+						vks::meshopt::optimizeVertexCache(primitiveIndices, primitive->indexCount, rangeCount);
+					}
+					if (optimizeFlags & vks::meshopt::OPTIMIZE_OVERDRAW) {
+						vks::meshopt::optimizeOverdraw(primitiveIndices, primitive->indexCount, &vertexBuffer[firstVertex].pos, sizeof(Vertex), rangeCount);
+					}
+					for (uint32_t i = 0; i < primitive->indexCount; i++) {
+						primitiveIndices[i] += firstVertex;
+					}
+				}
+			}
+
+			if (optimizeFlags & vks::meshopt::OPTIMIZE_VERTEX_FETCH) {
+				vertexCount = vks::meshopt::optimizeVertexFetch(vertexBuffer.data(), vertexCount, sizeof(Vertex), indexBuffer.data(), indexBuffer.size());
+			}
+			vertexBuffer.resize(vertexCount);
+
+			if ((optimizeFlags & vks::meshopt::OPTIMIZE_INDEX_16BIT) && (vertexCount <= 65536)) {
+				indices.type = VK_INDEX_TYPE_UINT16;
+			}
+
+			if (!vks::tools::verboseOutput) {
+				return;
+			}
+			const vks::meshopt::VertexCacheStatistics statsAfter = vks::meshopt::analyzeVertexCache(indexBuffer.data(), indexBuffer.size(), vertexCount);
+			std::stringstream report;
+			report << std::fixed << std::setprecision(3);
+			report << "Optimized " << filename << ": " << vertexCountBefore << " -> " << vertexCount << " vertices, ACMR " << statsBefore.acmr << " -> " << statsAfter.acmr;
+			report << ", ATVR " << statsBefore.atvr << " -> " << statsAfter.atvr << ", " << ((indices.type == VK_INDEX_TYPE_UINT16) ? 16 : 32) << " bit indices";
+			std::cout << report.str() << std::endl;
+		}
+
 		void loadFromFile(std::string filename, vks::VulkanDevice *device, VkQueue transferQueue, float scale = 1.0f)
 		{
 			tinygltf::Model gltfModel;
@@ -938,46 +1716,94 @@ namespace vkglTF
 
 			this->device = device;
 
+			loadTimings = LoadTimings();
+			const auto tStart = std::chrono::high_resolution_clock::now();
+			auto tStage = tStart;
+			// Returns the time since the last call (or the start of loading) in ms
+			auto stageTime = [&tStage]() {
+				const auto tNow = std::chrono::high_resolution_clock::now();
+				const double time = std::chrono::duration<double, std::milli>(tNow - tStage).count();
+				tStage = tNow;
+				return time;
+			};
+
+			// Binary glTF files (.glb) contain the json and the buffers in one file
+			const bool binary = (filename.size() > 4) && (filename.compare(filename.size() - 4, 4, ".glb") == 0);
+
 #if defined(__ANDROID__)
 			AAsset* asset = AAssetManager_open(androidApp->activity->assetManager, filename.c_str(), AASSET_MODE_STREAMING);
 			assert(asset);
 			size_t size = AAsset_getLength(asset);
 			assert(size > 0);
-			char* fileData = new char[size];
-			AAsset_read(asset, fileData, size);
+			std::vector<unsigned char> fileData(size);
+			AAsset_read(asset, fileData.data(), size);
 			AAsset_close(asset);
 			std::string baseDir;
-			bool fileLoaded = gltfContext.LoadASCIIFromString(&gltfModel, &error, &warning, fileData, size, baseDir);
-			free(fileData);
+			bool fileLoaded = binary ?
+				gltfContext.LoadBinaryFromMemory(&gltfModel, &error, &warning, fileData.data(), static_cast<unsigned int>(size), baseDir) :
+				gltfContext.LoadASCIIFromString(&gltfModel, &error, &warning, reinterpret_cast<const char*>(fileData.data()), static_cast<unsigned int>(size), baseDir);
 #else
-			bool fileLoaded = gltfContext.LoadASCIIFromFile(&gltfModel, &error, &warning, filename);
+			// The file is parsed straight from a memory mapping instead of being read into a temporary copy first
+			const size_t separator = filename.find_last_of("/\\");
+			const std::string baseDir = (separator != std::string::npos) ? filename.substr(0, separator) : "";
+			bool fileLoaded = false;
+			vks::MappedFile file(filename);
+			if (file.isOpen()) {
+				fileLoaded = binary ?
+					gltfContext.LoadBinaryFromMemory(&gltfModel, &error, &warning, file.data(), static_cast<unsigned int>(file.size()), baseDir) :
+					gltfContext.LoadASCIIFromString(&gltfModel, &error, &warning, reinterpret_cast<const char*>(file.data()), static_cast<unsigned int>(file.size()), baseDir);
+				file.close();
+			} else {
+				error = "could not open " + filename;
+			}
 #endif
+			loadTimings.parse = stageTime();
+
 			std::vector<uint32_t> indexBuffer;
 			std::vector<Vertex> vertexBuffer;
 
 			if (fileLoaded) {
 				loadImages(gltfModel, device, transferQueue);
+				loadTimings.images = stageTime();
 				loadMaterials(gltfModel);
+				loadTimings.materials = stageTime();
 				const tinygltf::Scene &scene = gltfModel.scenes[gltfModel.defaultScene > -1 ? gltfModel.defaultScene : 0];
+				// Allocate the final geometry buffers once and let the nodes decode their accessors directly into them
+				size_t vertexCount = 0;
+				size_t indexCount = 0;
 				for (size_t i = 0; i < scene.nodes.size(); i++) {
-					const tinygltf::Node node = gltfModel.nodes[scene.nodes[i]];
-					loadNode(nullptr, node, scene.nodes[i], gltfModel, indexBuffer, vertexBuffer, scale);
+					getNodeProps(gltfModel.nodes[scene.nodes[i]], gltfModel, vertexCount, indexCount);
 				}
+				vertexBuffer.resize(vertexCount);
+				indexBuffer.resize(indexCount);
+				LoaderInfo loaderInfo;
+				loaderInfo.vertexBuffer = vertexBuffer.data();
+				loaderInfo.indexBuffer = indexBuffer.data();
+				for (size_t i = 0; i < scene.nodes.size(); i++) {
+					const tinygltf::Node &node = gltfModel.nodes[scene.nodes[i]];
+					loadNode(nullptr, node, scene.nodes[i], gltfModel, loaderInfo, scale);
+				}
+				assert((loaderInfo.vertexPos == vertexCount) && (loaderInfo.indexPos == indexCount));
+				if (optimizeFlags != 0) {
+					optimizeGeometry(filename, vertexBuffer, indexBuffer);
+				}
+				loadTimings.geometry = stageTime();
 				if (gltfModel.animations.size() > 0) {
 					loadAnimations(gltfModel);
 				}
 				loadSkins(gltfModel);
 
+				// Assign skins
 				for (auto node : linearNodes) {
-					// Assign skins
 					if (node->skinIndex > -1) {
 						node->skin = skins[node->skinIndex];
 					}
-					// Initial pose
-					if (node->mesh) {
-						node->update();
-					}
 				}
+				prepareMeshUniforms();
+				// Initial pose
+				updateNodes();
+				getPose(restPose);
+				loadTimings.animations = stageTime();
 			}
 			else {
 				// TODO: throw
@@ -995,31 +1821,16 @@ namespace vkglTF
 			size_t vertexBufferSize = vertexBuffer.size() * sizeof(Vertex);
 			size_t indexBufferSize = indexBuffer.size() * sizeof(uint32_t);
 			indices.count = static_cast<uint32_t>(indexBuffer.size());
+			const void *indexData = indexBuffer.data();
 
-			assert((vertexBufferSize > 0) && (indexBufferSize > 0));
-
-			struct StagingBuffer {
-				VkBuffer buffer;
-				VkDeviceMemory memory;
-			} vertexStaging, indexStaging;
+			std::vector<uint16_t> indexBuffer16;
+			if (indices.type == VK_INDEX_TYPE_UINT16) {
+				indexBuffer16.assign(indexBuffer.begin(), indexBuffer.end());
+				indexBufferSize = indexBuffer16.size() * sizeof(uint16_t);
+				indexData = indexBuffer16.data();
+			}
 
-			// Create staging buffers
-			// Vertex data
-			VK_CHECK_RESULT(device->createBuffer(
-				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-				vertexBufferSize,
-				&vertexStaging.buffer,
-				&vertexStaging.memory,
-				vertexBuffer.data()));
-			// Index data
-			VK_CHECK_RESULT(device->createBuffer(
-				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-				indexBufferSize,
-				&indexStaging.buffer,
-				&indexStaging.memory,
-				indexBuffer.data()));
+			assert((vertexBufferSize > 0) && (indexBufferSize > 0));
 
 			// Create device local buffers
 			// Vertex buffer
@@ -1037,50 +1848,94 @@ namespace vkglTF
 				&indices.buffer,
 				&indices.memory));
 
-			// Copy from staging buffers
-			VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
-
-			VkBufferCopy copyRegion = {};
-
-			copyRegion.size = vertexBufferSize;
-			vkCmdCopyBuffer(copyCmd, vertexStaging.buffer, vertices.buffer, 1, &copyRegion);
-
-			copyRegion.size = indexBufferSize;
-			vkCmdCopyBuffer(copyCmd, indexStaging.buffer, indices.buffer, 1, &copyRegion);
-
-			device->flushCommandBuffer(copyCmd, transferQueue, true);
+			if (device->uploadManager)
+			{
+				// Copies are batched by the upload manager, the data is staged in its ring buffer
+				device->uploadManager->uploadBuffer(vertices.buffer, vertexBuffer.data(), vertexBufferSize, 0, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
+				device->uploadManager->complete(device->uploadManager->uploadBuffer(indices.buffer, indexData, indexBufferSize, 0, VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT));
+			}
+			else
+			{
+				// Create staging buffers
+				vks::Buffer vertexStaging, indexStaging;
+				// Vertex data
+				VK_CHECK_RESULT(device->createBuffer(
+					VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+					&vertexStaging,
+					vertexBufferSize,
+					vertexBuffer.data(),
+					vks::ALLOCATION_STRATEGY_LINEAR));
+				// Index data
+				VK_CHECK_RESULT(device->createBuffer(
+					VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+					VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+					&indexStaging,
+					indexBufferSize,
+					const_cast<void*>(indexData),
+					vks::ALLOCATION_STRATEGY_LINEAR));
+
+				// Copy from staging buffers
+				VkCommandBuffer copyCmd = device->createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, true);
+
+				VkBufferCopy copyRegion = {};
+
+				copyRegion.size = vertexBufferSize;
+				vkCmdCopyBuffer(copyCmd, vertexStaging.buffer, vertices.buffer, 1, &copyRegion);
+
+				copyRegion.size = indexBufferSize;
+				vkCmdCopyBuffer(copyCmd, indexStaging.buffer, indices.buffer, 1, &copyRegion);
+
+				device->flushCommandBuffer(copyCmd, transferQueue, true);
+
+				vertexStaging.destroy();
+				indexStaging.destroy();
+			}
 
-			vkDestroyBuffer(device->logicalDevice, vertexStaging.buffer, nullptr);
-			vkFreeMemory(device->logicalDevice, vertexStaging.memory, nullptr);
-			vkDestroyBuffer(device->logicalDevice, indexStaging.buffer, nullptr);
-			vkFreeMemory(device->logicalDevice, indexStaging.memory, nullptr);
+			loadTimings.upload = stageTime();
 
 			getSceneDimensions();
 
 			// Setup descriptors
-			uint32_t uboCount{ 0 };
-			for (auto node : linearNodes) {
-				if (node->mesh) {
-					uboCount++;
-				}
-			}
+			// All meshes share a single descriptor set, they only differ in the dynamic offset
 			std::vector<VkDescriptorPoolSize> poolSizes = {
-				vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uboCount),
+				vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1),
 			};
-			VkDescriptorPoolCreateInfo descriptorPoolCI = vks::initializers::descriptorPoolCreateInfo(static_cast<uint32_t>(poolSizes.size()), poolSizes.data(), uboCount);
+			VkDescriptorPoolCreateInfo descriptorPoolCI = vks::initializers::descriptorPoolCreateInfo(static_cast<uint32_t>(poolSizes.size()), poolSizes.data(), 1);
 			VK_CHECK_RESULT(vkCreateDescriptorPool(device->logicalDevice, &descriptorPoolCI, nullptr, &descriptorPool));
 
 			std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
-				vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0),
+				vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_VERTEX_BIT, 0),
 			};
 			VkDescriptorSetLayoutCreateInfo descriptorLayoutCI{};
 			descriptorLayoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 			descriptorLayoutCI.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
 			descriptorLayoutCI.pBindings = setLayoutBindings.data();
 			VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorLayoutCI, nullptr, &descriptorSetLayout));
-			for (auto node : nodes) {
-				prepareNodeDescriptor(node, descriptorSetLayout);
+			if (meshUniforms.buffer.buffer != VK_NULL_HANDLE) {
+				VkDescriptorSetAllocateInfo descriptorSetAllocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
+				VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &descriptorSetAllocInfo, &meshUniforms.descriptorSet));
+				// The range covers a single mesh uniform block, the dynamic offset selects the mesh
+				VkDescriptorBufferInfo bufferInfo = { meshUniforms.buffer.buffer, 0, sizeof(Mesh::UniformBlock) };
+				VkWriteDescriptorSet writeDescriptorSet = vks::initializers::writeDescriptorSet(meshUniforms.descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 0, &bufferInfo);
+				vkUpdateDescriptorSets(device->logicalDevice, 1, &writeDescriptorSet, 0, nullptr);
+				for (auto node : linearNodes) {
+					if (node->mesh) {
+						node->mesh->uniformBuffer.descriptorSet = meshUniforms.descriptorSet;
+					}
+				}
+			}
+			loadTimings.descriptors = stageTime();
+
+			loadTimings.total = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+			if (!vks::tools::verboseOutput) {
+				return;
 			}
+			std::stringstream timings;
+			timings << std::fixed << std::setprecision(2);
+			timings << "Loaded " << filename << " in " << loadTimings.total << " ms (parse " << loadTimings.parse << ", images " << loadTimings.images << ", materials " << loadTimings.materials;
+			timings << ", geometry " << loadTimings.geometry << ", animations " << loadTimings.animations << ", upload " << loadTimings.upload << ", descriptors " << loadTimings.descriptors << ")";
+			std::cout << timings.str() << std::endl;
 		}
 
 		void drawNode(Node *node, VkCommandBuffer commandBuffer)
@@ -1099,18 +1954,263 @@ namespace vkglTF
 		{
 			const VkDeviceSize offsets[1] = { 0 };
 			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
-			vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, indices.type);
 			for (auto& node : nodes) {
 				drawNode(node, commandBuffer);
 			}
 		}
 
+		/**
+		* Prepare GPU driven rendering of the model
+		* Builds the primitive table and the node matrix buffer, and a compute pipeline that culls the primitives against the view frustum
+		* and writes one indexed indirect draw command per primitive
+		* The draws select their primitive table entry via firstInstance, so the drawIndirectFirstInstance feature must be enabled
+		* Only the node matrix is applied in this path, joint matrices of skinned meshes are ignored
+		*
+		* @param cullShaderFile SPIR-V file of the culling compute shader (shaders/base/gltfcull.comp.spv)
+		*/
+		void prepareIndirect(const std::string &cullShaderFile)
+		{
+			assert(device->enabledFeatures.drawIndirectFirstInstance);
+
+			for (auto node : linearNodes) {
+				if (!node->mesh) {
+					continue;
+				}
+				const uint32_t matrixIndex = static_cast<uint32_t>(indirect.matrixNodes.size());
+				indirect.matrixNodes.push_back(node);
+				for (Primitive *primitive : node->mesh->primitives) {
+					IndirectPrimitive indirectPrimitive{};
+					indirectPrimitive.firstIndex = primitive->firstIndex;
+					indirectPrimitive.indexCount = primitive->indexCount;
+					indirectPrimitive.materialIndex = static_cast<uint32_t>(&primitive->material - materials.data());
+					indirectPrimitive.matrixIndex = matrixIndex;
+					indirectPrimitive.boundingSphere = glm::vec4(primitive->dimensions.center, primitive->dimensions.radius);
+					indirect.primitives.push_back(indirectPrimitive);
+				}
+			}
+			assert(!indirect.primitives.empty());
+
+			// Sort by material, so draws sharing a material can be issued with a single indirect draw
+			std::stable_sort(indirect.primitives.begin(), indirect.primitives.end(), [](const IndirectPrimitive &a, const IndirectPrimitive &b) { return a.materialIndex < b.materialIndex; });
+			for (uint32_t i = 0; i < static_cast<uint32_t>(indirect.primitives.size()); i++) {
+				if (indirect.batches.empty() || (indirect.batches.back().materialIndex != indirect.primitives[i].materialIndex)) {
+					indirect.batches.push_back({ indirect.primitives[i].materialIndex, i, 0 });
+				}
+				indirect.batches.back().drawCount++;
+			}
+
+			const uint32_t primitiveCount = static_cast<uint32_t>(indirect.primitives.size());
+
+			// Primitive table and node matrices are written by the host and read by the culling and vertex shaders
+			VK_CHECK_RESULT(device->createBuffer(
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&indirect.primitiveBuffer,
+				primitiveCount * sizeof(IndirectPrimitive),
+				indirect.primitives.data()));
+			VK_CHECK_RESULT(device->createBuffer(
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&indirect.matrixBuffer,
+				indirect.matrixNodes.size() * sizeof(glm::mat4)));
+			VK_CHECK_RESULT(indirect.matrixBuffer.map());
+			// Draw commands are only written by the culling shader
+			VK_CHECK_RESULT(device->createBuffer(
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+				&indirect.commandBuffer,
+				primitiveCount * sizeof(VkDrawIndexedIndirectCommand)));
+			VK_CHECK_RESULT(device->createBuffer(
+				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&indirect.uniformBuffer,
+				sizeof(IndirectDraw::CullUniforms)));
+			VK_CHECK_RESULT(indirect.uniformBuffer.map());
+			VK_CHECK_RESULT(device->createBuffer(
+				VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&indirect.statsBuffer,
+				sizeof(IndirectDraw::Stats)));
+			VK_CHECK_RESULT(indirect.statsBuffer.map());
+			memset(&indirect.stats, 0, sizeof(IndirectDraw::Stats));
+
+			for (size_t i = 0; i < indirect.matrixNodes.size(); i++) {
+				memcpy(static_cast<glm::mat4*>(indirect.matrixBuffer.mapped) + i, &indirect.matrixNodes[i]->getMatrix(), sizeof(glm::mat4));
+			}
+			// Culling is disabled until updateIndirectCulling is called
+			indirect.cullUniforms.model = glm::mat4(1.0f);
+			indirect.cullUniforms.primitiveCount = primitiveCount;
+			indirect.cullUniforms.frustumCulling = 0;
+			memcpy(indirect.uniformBuffer.mapped, &indirect.cullUniforms, sizeof(IndirectDraw::CullUniforms));
+
+			// Descriptors
+			std::vector<VkDescriptorPoolSize> poolSizes = {
+				vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 6),
+				vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
+			};
+			VkDescriptorPoolCreateInfo descriptorPoolCI = vks::initializers::descriptorPoolCreateInfo(static_cast<uint32_t>(poolSizes.size()), poolSizes.data(), 2);
+			VK_CHECK_RESULT(vkCreateDescriptorPool(device->logicalDevice, &descriptorPoolCI, nullptr, &indirect.descriptorPool));
+
+			std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+				vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0),
+				vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 1),
+			};
+			VkDescriptorSetLayoutCreateInfo descriptorLayoutCI = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+			VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorLayoutCI, nullptr, &indirect.descriptorSetLayout));
+
+			setLayoutBindings = {
+				vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 0),
+				vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 1),
+				vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 2),
+				vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 3),
+				vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT, 4),
+			};
+			descriptorLayoutCI = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+			VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device->logicalDevice, &descriptorLayoutCI, nullptr, &indirect.cullDescriptorSetLayout));
+
+			VkDescriptorSetAllocateInfo descriptorSetAllocInfo = vks::initializers::descriptorSetAllocateInfo(indirect.descriptorPool, &indirect.descriptorSetLayout, 1);
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &descriptorSetAllocInfo, &indirect.descriptorSet));
+			descriptorSetAllocInfo = vks::initializers::descriptorSetAllocateInfo(indirect.descriptorPool, &indirect.cullDescriptorSetLayout, 1);
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &descriptorSetAllocInfo, &indirect.cullDescriptorSet));
+
+			std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+				vks::initializers::writeDescriptorSet(indirect.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &indirect.primitiveBuffer.descriptor),
+				vks::initializers::writeDescriptorSet(indirect.descriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &indirect.matrixBuffer.descriptor),
+				vks::initializers::writeDescriptorSet(indirect.cullDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, &indirect.primitiveBuffer.descriptor),
+				vks::initializers::writeDescriptorSet(indirect.cullDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &indirect.matrixBuffer.descriptor),
+				vks::initializers::writeDescriptorSet(indirect.cullDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2, &indirect.commandBuffer.descriptor),
+				vks::initializers::writeDescriptorSet(indirect.cullDescriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 3, &indirect.uniformBuffer.descriptor),
+				vks::initializers::writeDescriptorSet(indirect.cullDescriptorSet, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4, &indirect.statsBuffer.descriptor),
+			};
+			vkUpdateDescriptorSets(device->logicalDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0, nullptr);
+
+			// Culling pipeline
+			VkPipelineLayoutCreateInfo pipelineLayoutCI = vks::initializers::pipelineLayoutCreateInfo(&indirect.cullDescriptorSetLayout, 1);
+			VK_CHECK_RESULT(vkCreatePipelineLayout(device->logicalDevice, &pipelineLayoutCI, nullptr, &indirect.cullPipelineLayout));
+
+			VkPipelineShaderStageCreateInfo shaderStage{};
+			shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+#if defined(__ANDROID__)
+			shaderStage.module = vks::tools::loadShader(androidApp->activity->assetManager, cullShaderFile.c_str(), device->logicalDevice);
+#else
+			shaderStage.module = vks::tools::loadShader(cullShaderFile.c_str(), device->logicalDevice);
+#endif
+			shaderStage.pName = "main";
+			assert(shaderStage.module != VK_NULL_HANDLE);
+			VkComputePipelineCreateInfo computePipelineCI = vks::initializers::computePipelineCreateInfo(indirect.cullPipelineLayout, 0);
+			computePipelineCI.stage = shaderStage;
+			VK_CHECK_RESULT(vkCreateComputePipelines(device->logicalDevice, VK_NULL_HANDLE, 1, &computePipelineCI, nullptr, &indirect.cullPipeline));
+			vkDestroyShaderModule(device->logicalDevice, shaderStage.module, nullptr);
+
+			indirect.prepared = true;
+		}
+
+		/**
+		* Update the culling parameters of the indirect path
+		*
+		* @param model Matrix applied on top of the node matrices (must match the one used in the vertex shader)
+		* @param frustumPlanes Six normalized world space frustum planes (see vks::Frustum)
+		* @param frustumCulling If false, all primitives are drawn
+		*/
+		void updateIndirectCulling(const glm::mat4 &model, const glm::vec4 *frustumPlanes, bool frustumCulling)
+		{
+			assert(indirect.prepared);
+			indirect.cullUniforms.model = model;
+			memcpy(indirect.cullUniforms.frustumPlanes, frustumPlanes, sizeof(glm::vec4) * 6);
+			indirect.cullUniforms.frustumCulling = frustumCulling ? 1 : 0;
+			memcpy(indirect.uniformBuffer.mapped, &indirect.cullUniforms, sizeof(IndirectDraw::CullUniforms));
+		}
+
+		/** @brief Record the culling dispatch that writes the indirect draw commands, must be recorded outside of a render pass before drawIndirect */
+		void cullIndirect(VkCommandBuffer commandBuffer)
+		{
+			assert(indirect.prepared);
+
+			// The draw commands of the previous frame must have been consumed before they're overwritten
+			VkBufferMemoryBarrier commandBarrier = vks::initializers::bufferMemoryBarrier();
+			commandBarrier.buffer = indirect.commandBuffer.buffer;
+			commandBarrier.size = VK_WHOLE_SIZE;
+			commandBarrier.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+			commandBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			commandBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			commandBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &commandBarrier, 0, nullptr);
+
+			// Reset the statistics before the shader accumulates them
+			vkCmdFillBuffer(commandBuffer, indirect.statsBuffer.buffer, 0, sizeof(IndirectDraw::Stats), 0);
+			VkBufferMemoryBarrier statsBarrier = vks::initializers::bufferMemoryBarrier();
+			statsBarrier.buffer = indirect.statsBuffer.buffer;
+			statsBarrier.size = VK_WHOLE_SIZE;
+			statsBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			statsBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+			statsBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			statsBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &statsBarrier, 0, nullptr);
+
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, indirect.cullPipeline);
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, indirect.cullPipelineLayout, 0, 1, &indirect.cullDescriptorSet, 0, nullptr);
+			vkCmdDispatch(commandBuffer, (static_cast<uint32_t>(indirect.primitives.size()) + 63) / 64, 1, 1);
+
+			commandBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			commandBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 0, nullptr, 1, &commandBarrier, 0, nullptr);
+
+			statsBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			statsBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &statsBarrier, 0, nullptr);
+		}
+
+		/**
+		* Draw the model using the draw commands written by cullIndirect
+		* Culled primitives have an instance count of zero
+		*
+		* @param bindMaterial If set, called once per material before drawing its primitives (e.g. to push material constants), otherwise all primitives are drawn with a single call
+		*/
+		void drawIndirect(VkCommandBuffer commandBuffer, std::function<void(const Material &material)> bindMaterial = nullptr)
+		{
+			assert(indirect.prepared);
+			const VkDeviceSize offsets[1] = { 0 };
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertices.buffer, offsets);
+			vkCmdBindIndexBuffer(commandBuffer, indices.buffer, 0, indices.type);
+			if (bindMaterial) {
+				for (auto &batch : indirect.batches) {
+					bindMaterial(materials[batch.materialIndex]);
+					drawIndirectRange(commandBuffer, batch.firstDraw, batch.drawCount);
+				}
+			} else {
+				drawIndirectRange(commandBuffer, 0, static_cast<uint32_t>(indirect.primitives.size()));
+			}
+		}
+
+		/** @brief Statistics of the last culling dispatch, only valid once the command buffer that recorded it has finished execution */
+		const IndirectDraw::Stats& getIndirectStats()
+		{
+			memcpy(&indirect.stats, indirect.statsBuffer.mapped, sizeof(IndirectDraw::Stats));
+			return indirect.stats;
+		}
+
+		void drawIndirectRange(VkCommandBuffer commandBuffer, uint32_t firstDraw, uint32_t drawCount)
+		{
+			const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+			if (device->enabledFeatures.multiDrawIndirect) {
+				vkCmdDrawIndexedIndirect(commandBuffer, indirect.commandBuffer.buffer, firstDraw * stride, drawCount, stride);
+			} else {
+				// Without multi draw indirect, every draw command has to be issued separately
+				for (uint32_t i = 0; i < drawCount; i++) {
+					vkCmdDrawIndexedIndirect(commandBuffer, indirect.commandBuffer.buffer, (firstDraw + i) * stride, 1, stride);
+				}
+			}
+		}
+
 		void getNodeDimensions(Node *node, glm::vec3 &min, glm::vec3 &max)
 		{
 			if (node->mesh) {
+				const glm::mat4 &matrix = node->getMatrix();
 				for (Primitive *primitive : node->mesh->primitives) {
-					glm::vec4 locMin = glm::vec4(primitive->dimensions.min, 1.0f) * node->getMatrix();
-					glm::vec4 locMax = glm::vec4(primitive->dimensions.max, 1.0f) * node->getMatrix();
+					glm::vec4 locMin = glm::vec4(primitive->dimensions.min, 1.0f) * matrix;
+					glm::vec4 locMax = glm::vec4(primitive->dimensions.max, 1.0f) * matrix;
 					if (locMin.x < min.x) { min.x = locMin.x; }
 					if (locMin.y < min.y) { min.y = locMin.y; }
 					if (locMin.z < min.z) { min.z = locMin.z; }
@@ -1147,50 +2247,207 @@ namespace vkglTF
 			bool updated = false;
 			for (auto& channel : animation.channels) {
 				vkglTF::AnimationSampler &sampler = animation.samplers[channel.samplerIndex];
-				if (sampler.inputs.size() > sampler.outputsVec4.size()) {
+				if (!sampler.valid()) {
 					continue;
 				}
+				const glm::vec4 value = sampler.sample(time, channel.path == AnimationChannel::PathType::ROTATION);
+				switch (channel.path) {
+				case vkglTF::AnimationChannel::PathType::TRANSLATION:
+					transforms.setTranslation(channel.node->transformIndex, glm::vec3(value));
+					break;
+				case vkglTF::AnimationChannel::PathType::SCALE:
+					transforms.setScale(channel.node->transformIndex, glm::vec3(value));
+					break;
+				case vkglTF::AnimationChannel::PathType::ROTATION:
+					transforms.setRotation(channel.node->transformIndex, AnimationSampler::toQuat(value));
+					break;
+				}
+				updated = true;
+			}
+			if (updated) {
+				updateNodes();
+			}
+		}
 
-				for (auto i = 0; i < sampler.inputs.size() - 1; i++) {
-					if ((time >= sampler.inputs[i]) && (time <= sampler.inputs[i + 1])) {
-						float u = std::max(0.0f, time - sampler.inputs[i]) / (sampler.inputs[i + 1] - sampler.inputs[i]);
-						if (u <= 1.0f) {
-							switch (channel.path) {
-							case vkglTF::AnimationChannel::PathType::TRANSLATION: {
-								glm::vec4 trans = glm::mix(sampler.outputsVec4[i], sampler.outputsVec4[i + 1], u);
-								channel.node->translation = glm::vec3(trans);
-								break;
-							}
-							case vkglTF::AnimationChannel::PathType::SCALE: {
-								glm::vec4 trans = glm::mix(sampler.outputsVec4[i], sampler.outputsVec4[i + 1], u);
-								channel.node->scale = glm::vec3(trans);
-								break;
-							}
-							case vkglTF::AnimationChannel::PathType::ROTATION: {
-								glm::quat q1;
-								q1.x = sampler.outputsVec4[i].x;
-								q1.y = sampler.outputsVec4[i].y;
-								q1.z = sampler.outputsVec4[i].z;
-								q1.w = sampler.outputsVec4[i].w;
-								glm::quat q2;
-								q2.x = sampler.outputsVec4[i + 1].x;
-								q2.y = sampler.outputsVec4[i + 1].y;
-								q2.z = sampler.outputsVec4[i + 1].z;
-								q2.w = sampler.outputsVec4[i + 1].w;
-								channel.node->rotation = glm::normalize(glm::slerp(q1, q2, u));
-								break;
-							}
-							}
-							updated = true;
+		/** @brief Copy the current local transforms of all nodes into a pose */
+		void getPose(AnimationPose &pose)
+		{
+			pose.translations = transforms.translations;
+			pose.rotations = transforms.rotations;
+			pose.scales = transforms.scales;
+		}
+
+		/**
+		* Sample all channels of an animation into a pose without touching the model's nodes
+		*
+		* @param index Index of the animation
+		* @param time Time to sample at
+		* @param pose Pose receiving the sampled transforms, nodes not animated by the animation keep their values (e.g. initialize with getPose)
+		* @param cursors Optional key cursors per sampler (resized if required), the samplers' own cursors are used if null
+		*/
+		void sampleAnimation(uint32_t index, float time, AnimationPose &pose, std::vector<uint32_t> *cursors = nullptr)
+		{
+			assert(index < animations.size());
+			if (pose.size() < transforms.size()) {
+				pose.resize(transforms.size());
+			}
+			Animation &animation = animations[index];
+			if (cursors && cursors->size() != animation.samplers.size()) {
+				cursors->assign(animation.samplers.size(), 0);
+			}
+			for (auto& channel : animation.channels) {
+				vkglTF::AnimationSampler &sampler = animation.samplers[channel.samplerIndex];
+				if (!sampler.valid()) {
+					continue;
+				}
+				const uint32_t target = channel.node->transformIndex;
+				uint32_t &cursor = cursors ? (*cursors)[channel.samplerIndex] : sampler.cursor;
+				const glm::vec4 value = sampler.sample(time, channel.path == AnimationChannel::PathType::ROTATION, cursor);
+				switch (channel.path) {
+				case vkglTF::AnimationChannel::PathType::TRANSLATION:
+					pose.translations[target] = glm::vec3(value);
+					break;
+				case vkglTF::AnimationChannel::PathType::SCALE:
+					pose.scales[target] = glm::vec3(value);
+					break;
+				case vkglTF::AnimationChannel::PathType::ROTATION:
+					pose.rotations[target] = AnimationSampler::toQuat(value);
+					break;
+				}
+			}
+		}
+
+		/** @brief Normalized linear interpolation between two rotations along the shortest path */
+		static glm::quat nlerp(const glm::quat &a, const glm::quat &b, float t)
+		{
+			const float sign = (glm::dot(a, b) < 0.0f) ? -1.0f : 1.0f;
+			return glm::normalize(a * (1.0f - t) + b * (sign * t));
+		}
+
+		/**
+		* Sample multiple animation layers and blend them into a single pose
+		* Layers are blended in local space in order, the scene graph is only updated once the final pose is applied (see applyPose)
+		*
+		* @param layers Layers to blend, the first layer is blended onto the rest pose, the layers' key cursors are updated
+		* @param pose Pose receiving the blended transforms
+		*
+		* @note The model holds a scratch pose, so the layers of one model must be evaluated from one thread at a time
+		*/
+		void blendAnimations(std::vector<AnimationLayer> &layers, AnimationPose &pose)
+		{
+			const size_t count = transforms.size();
+			pose.translations.assign(restPose.translations.begin(), restPose.translations.end());
+			pose.rotations.assign(restPose.rotations.begin(), restPose.rotations.end());
+			pose.scales.assign(restPose.scales.begin(), restPose.scales.end());
+			for (auto& layer : layers) {
+				if (layer.weight <= 0.0f || layer.animation >= animations.size()) {
+					continue;
+				}
+				assert(layer.mask.empty() || layer.mask.size() >= count);
+				layerPose.translations.assign(restPose.translations.begin(), restPose.translations.end());
+				layerPose.rotations.assign(restPose.rotations.begin(), restPose.rotations.end());
+				layerPose.scales.assign(restPose.scales.begin(), restPose.scales.end());
+				sampleAnimation(layer.animation, layer.time, layerPose, &layer.cursors);
+				for (size_t i = 0; i < count; i++) {
+					const float weight = layer.mask.empty() ? layer.weight : layer.weight * layer.mask[i];
+					if (weight <= 0.0f) {
+						continue;
+					}
+					if (layer.blendMode == AnimationLayer::BLEND_ADDITIVE) {
+						pose.translations[i] += (layerPose.translations[i] - restPose.translations[i]) * weight;
+						const glm::quat delta = layerPose.rotations[i] * glm::inverse(restPose.rotations[i]);
+						pose.rotations[i] = glm::normalize(nlerp(glm::quat(1.0f, 0.0f, 0.0f, 0.0f), delta, weight) * pose.rotations[i]);
+						pose.scales[i] *= glm::mix(glm::vec3(1.0f), layerPose.scales[i] / restPose.scales[i], weight);
+					} else {
+						pose.translations[i] = glm::mix(pose.translations[i], layerPose.translations[i], weight);
+						pose.rotations[i] = nlerp(pose.rotations[i], layerPose.rotations[i], weight);
+						pose.scales[i] = glm::mix(pose.scales[i], layerPose.scales[i], weight);
+					}
+				}
+			}
+		}
+
+		/**
+		* Get a layer mask that contains a node and all of its descendants
+		*
+		* @param node Root node of the masked subtree
+		* @param (Optional) weight Weight of the masked nodes (Defaults to 1.0)
+		*
+		* @return Weights per transform index, usable as AnimationLayer::mask
+		*/
+		std::vector<float> getNodeMask(Node *node, float weight = 1.0f)
+		{
+			std::vector<float> mask(transforms.size(), 0.0f);
+			mask[node->transformIndex] = weight;
+			// Transforms are topologically sorted, so all descendants follow the root
+			for (size_t i = node->transformIndex + 1; i < transforms.size(); i++) {
+				const int32_t parent = transforms.parents[i];
+				if (parent > -1) {
+					mask[i] = mask[parent];
+				}
+			}
+			return mask;
+		}
+
+		/** @brief Apply a pose to the model's nodes, only transforms that differ from the current ones are marked as changed */
+		void applyPose(const AnimationPose &pose)
+		{
+			assert(pose.size() >= transforms.size());
+			for (size_t i = 0; i < transforms.size(); i++) {
+				if (pose.translations[i] != transforms.translations[i] || pose.rotations[i] != transforms.rotations[i] || pose.scales[i] != transforms.scales[i]) {
+					transforms.translations[i] = pose.translations[i];
+					transforms.rotations[i] = pose.rotations[i];
+					transforms.scales[i] = pose.scales[i];
+					transforms.dirty[i] = 1;
+				}
+			}
+			updateNodes();
+		}
+
+		/**
+		* Update the world matrices of all nodes whose transforms have changed (and their children)
+		* and upload the matrices of affected meshes, skinned meshes are updated if any of their joints has changed
+		*/
+		void updateNodes()
+		{
+			if (!transforms.update()) {
+				return;
+			}
+			size_t changedBegin = meshUniforms.data.size();
+			size_t changedEnd = 0;
+			for (auto node : linearNodes) {
+				if (!node->mesh) {
+					continue;
+				}
+				bool changed = transforms.dirty[node->transformIndex] != 0;
+				if (node->skin && !changed) {
+					for (auto joint : node->skin->joints) {
+						if (transforms.dirty[joint->transformIndex]) {
+							changed = true;
+							break;
 						}
 					}
 				}
+				if (changed) {
+					node->updateMesh();
+					const size_t offset = node->mesh->uniformBuffer.dynamicOffset;
+					changedBegin = std::min(changedBegin, offset);
+					changedEnd = std::max(changedEnd, offset + sizeof(Mesh::UniformBlock));
+				}
 			}
-			if (updated) {
-				for (auto &node : nodes) {
-					node->update();
+			// Meshes are updated in the host copy, the changed range is written to the device with one contiguous copy
+			if ((changedBegin < changedEnd) && meshUniforms.buffer.mapped) {
+				memcpy(static_cast<uint8_t*>(meshUniforms.buffer.mapped) + changedBegin, &meshUniforms.data[changedBegin], changedEnd - changedBegin);
+			}
+			if (indirect.prepared) {
+				for (size_t i = 0; i < indirect.matrixNodes.size(); i++) {
+					Node *node = indirect.matrixNodes[i];
+					if (transforms.dirty[node->transformIndex]) {
+						memcpy(static_cast<glm::mat4*>(indirect.matrixBuffer.mapped) + i, &node->getMatrix(), sizeof(glm::mat4));
+					}
 				}
 			}
+			transforms.clearDirty();
 		}
 
 		/*
@@ -1221,28 +2478,37 @@ namespace vkglTF
 			return nodeFound;
 		}
 
-		void prepareNodeDescriptor(vkglTF::Node *node, VkDescriptorSetLayout descriptorSetLayout) {
-			if (node->mesh) {
-				VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
-				descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-				descriptorSetAllocInfo.descriptorPool = descriptorPool;
-				descriptorSetAllocInfo.pSetLayouts = &descriptorSetLayout;
-				descriptorSetAllocInfo.descriptorSetCount = 1;
-				VK_CHECK_RESULT(vkAllocateDescriptorSets(device->logicalDevice, &descriptorSetAllocInfo, &node->mesh->uniformBuffer.descriptorSet));
-
-				VkWriteDescriptorSet writeDescriptorSet{};
-				writeDescriptorSet.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-				writeDescriptorSet.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-				writeDescriptorSet.descriptorCount = 1;
-				writeDescriptorSet.dstSet = node->mesh->uniformBuffer.descriptorSet;
-				writeDescriptorSet.dstBinding = 0;
-				writeDescriptorSet.pBufferInfo = &node->mesh->uniformBuffer.descriptor;
-
-				vkUpdateDescriptorSets(device->logicalDevice, 1, &writeDescriptorSet, 0, nullptr);
+		/** @brief Assign each mesh an aligned block of the shared mesh uniform buffer and fill it with the mesh's initial uniform block */
+		void prepareMeshUniforms()
+		{
+			std::vector<Mesh*> meshes;
+			for (auto node : linearNodes) {
+				if (node->mesh) {
+					meshes.push_back(node->mesh);
+				}
 			}
-			for (auto& child : node->children) {
-				prepareNodeDescriptor(child, descriptorSetLayout);
+			if (meshes.empty()) {
+				return;
+			}
+			const VkDeviceSize alignment = device->properties.limits.minUniformBufferOffsetAlignment;
+			meshUniforms.alignedSize = sizeof(Mesh::UniformBlock);
+			if (alignment > 0) {
+				meshUniforms.alignedSize = (meshUniforms.alignedSize + alignment - 1) & ~(alignment - 1);
+			}
+			meshUniforms.data.resize(meshes.size() * meshUniforms.alignedSize);
+			for (size_t i = 0; i < meshes.size(); i++) {
+				Mesh *mesh = meshes[i];
+				mesh->uniformBuffer.dynamicOffset = static_cast<uint32_t>(i * meshUniforms.alignedSize);
+				mesh->uniformBuffer.mapped = &meshUniforms.data[mesh->uniformBuffer.dynamicOffset];
+				memcpy(mesh->uniformBuffer.mapped, &mesh->uniformBlock, sizeof(Mesh::UniformBlock));
 			}
+			VK_CHECK_RESULT(device->createBuffer(
+				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&meshUniforms.buffer,
+				meshUniforms.data.size(),
+				meshUniforms.data.data()));
+			VK_CHECK_RESULT(meshUniforms.buffer.map());
 		}
 	};
 }
\ No newline at end of file
@@ -13,20 +13,180 @@
 #include <functional>
 #include <chrono>
 #include <iomanip>
+#include <numeric>
+#include <fstream>
+#include <sstream>
+#include <cmath>
 
 namespace vks
 {
+	/** @brief Statistics calculated from the frame times of a benchmark run (all times in ms) */
+	struct FrameTimeStatistics {
+		double min = 0.0;
+		double max = 0.0;
+		double avg = 0.0;
+		double stdDev = 0.0;
+		double p50 = 0.0;
+		double p90 = 0.0;
+		double p99 = 0.0;
+		double p999 = 0.0;
+		/** @brief Average frame rate of the slowest 1% of all frames, catches stutter that is hidden by the average frame rate */
+		double onePercentLowFps = 0.0;
+		/** @brief Number of frames per histogram bin, the last bin also counts all frames that took longer */
+		std::vector<uint32_t> histogram;
+	};
+
 	class Benchmark {
 	private:
 		FILE *stream;
 		VkPhysicalDeviceProperties deviceProps;
+
+		// Nearest rank percentile of a sorted list of frame times
+		static double percentile(const std::vector<double> &sortedFrameTimes, double p)
+		{
+			size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sortedFrameTimes.size()));
+			rank = std::max(rank, (size_t)1);
+			return sortedFrameTimes[std::min(rank, sortedFrameTimes.size()) - 1];
+		}
+
+		static std::string jsonEscape(const std::string &str)
+		{
+			std::string escaped;
+			for (auto c : str) {
+				if (c == '"' || c == '\\') {
+					escaped += '\\';
+				}
+				if (static_cast<unsigned char>(c) >= 0x20) {
+					escaped += c;
+				}
+			}
+			return escaped;
+		}
+
+		// Store the frame time in the preallocated buffer, only grows if the estimate made after the warmup phase was too low
+		void storeFrameTime(double frameTime)
+		{
+			if (frameCount >= frameTimes.size()) {
+				frameTimes.resize(std::max((size_t)1024, frameTimes.size() * 2));
+			}
+			frameTimes[frameCount] = frameTime;
+		}
+
+		void calculateStatistics()
+		{
+			stats = FrameTimeStatistics();
+			stats.histogram.assign(histogramBinCount, 0);
+			if (frameCount == 0) {
+				return;
+			}
+			std::vector<double> sorted(frameTimes.begin(), frameTimes.begin() + frameCount);
+			std::sort(sorted.begin(), sorted.end());
+
+			stats.min = sorted.front();
+			stats.max = sorted.back();
+			stats.avg = std::accumulate(sorted.begin(), sorted.end(), 0.0) / (double)frameCount;
+			double variance = 0.0;
+			for (auto frameTime : sorted) {
+				variance += (frameTime - stats.avg) * (frameTime - stats.avg);
+			}
+			stats.stdDev = std::sqrt(variance / (double)frameCount);
+			stats.p50 = percentile(sorted, 50.0);
+			stats.p90 = percentile(sorted, 90.0);
+			stats.p99 = percentile(sorted, 99.0);
+			stats.p999 = percentile(sorted, 99.9);
+
+			const size_t lowCount = std::max((size_t)1, sorted.size() / 100);
+			const double lowAvg = std::accumulate(sorted.end() - lowCount, sorted.end(), 0.0) / (double)lowCount;
+			stats.onePercentLowFps = 1000.0 / lowAvg;
+
+			for (auto frameTime : sorted) {
+				const size_t bin = static_cast<size_t>(frameTime / histogramBinWidth);
+				stats.histogram[std::min(bin, (size_t)histogramBinCount - 1)]++;
+			}
+		}
+
+		void saveJSON(const std::string &jsonFilename)
+		{
+			std::ofstream result(jsonFilename, std::ios::out);
+			if (!result.is_open()) {
+				std::cerr << "Could not write benchmark results to \"" << jsonFilename << "\"" << std::endl;
+				return;
+			}
+			result << std::fixed << std::setprecision(4);
+			result << "{" << std::endl;
+			result << "\t\"device\": \"" << jsonEscape(deviceProps.deviceName) << "\"," << std::endl;
+			result << "\t\"driverversion\": " << deviceProps.driverVersion << "," << std::endl;
+			result << "\t\"duration\": " << runtime << "," << std::endl;
+			result << "\t\"frames\": " << frameCount << "," << std::endl;
+			result << "\t\"fps\": " << frameCount / (runtime / 1000.0) << "," << std::endl;
+			result << "\t\"framesinflight\": " << framesInFlight << "," << std::endl;
+			result << "\t\"startup\": " << startupTime << "," << std::endl;
+			result << "\t\"pipelinecache\": \"" << jsonEscape(pipelineCacheState) << "\"," << std::endl;
+			result << "\t\"frametime\": {" << std::endl;
+			result << "\t\t\"min\": " << stats.min << "," << std::endl;
+			result << "\t\t\"max\": " << stats.max << "," << std::endl;
+			result << "\t\t\"avg\": " << stats.avg << "," << std::endl;
+			result << "\t\t\"stddev\": " << stats.stdDev << "," << std::endl;
+			result << "\t\t\"p50\": " << stats.p50 << "," << std::endl;
+			result << "\t\t\"p90\": " << stats.p90 << "," << std::endl;
+			result << "\t\t\"p99\": " << stats.p99 << "," << std::endl;
+			result << "\t\t\"p99.9\": " << stats.p999 << std::endl;
+			result << "\t}," << std::endl;
+			result << "\t\"onepercentlowfps\": " << stats.onePercentLowFps << "," << std::endl;
+			result << "\t\"histogram\": {" << std::endl;
+			result << "\t\t\"binwidth\": " << histogramBinWidth << "," << std::endl;
+			result << "\t\t\"bins\": [";
+			for (size_t i = 0; i < stats.histogram.size(); i++) {
+				result << (i > 0 ? ", " : "") << stats.histogram[i];
+			}
+			result << "]" << std::endl;
+			result << "\t}," << std::endl;
+			result << "\t\"gputimes\": [";
+			for (size_t i = 0; i < gpuTimes.size(); i++) {
+				result << (i > 0 ? "," : "") << std::endl;
+				result << "\t\t{ \"name\": \"" << jsonEscape(gpuTimes[i].name) << "\", \"avg\": " << gpuTimes[i].avg << ", \"min\": " << gpuTimes[i].min << ", \"max\": " << gpuTimes[i].max << ", \"samples\": " << gpuTimes[i].samples << " }";
+			}
+			result << (gpuTimes.empty() ? "]" : "\n\t]");
+			if (outputFrameTimes) {
+				result << "," << std::endl << "\t\"frametimes\": [";
+				for (uint32_t i = 0; i < frameCount; i++) {
+					result << (i > 0 ? ", " : "") << frameTimes[i];
+				}
+				result << "]";
+			}
+			result << std::endl << "}" << std::endl;
+		}
 	public:
+		/** @brief GPU time of a named scope measured by the GPU profiler (in ms) */
+		struct GpuTime {
+			std::string name;
+			double avg = 0.0;
+			double min = 0.0;
+			double max = 0.0;
+			uint32_t samples = 0;
+		};
+
 		bool active = false;
 		bool outputFrameTimes = false;
 		uint32_t warmup = 1;
 		uint32_t duration = 10;
+		// Per frame times (ms) of the benchmark phase, preallocated after the warmup phase so measuring doesn't allocate
+		// Only the first frameCount entries are valid
 		std::vector<double> frameTimes;
 		std::string filename = "";
+		// Frame time histogram with fixed bins so results of different runs can be compared
+		double histogramBinWidth = 0.5;
+		uint32_t histogramBinCount = 100;
+		FrameTimeStatistics stats;
+		// Per scope GPU times, filled in by the example base after the run
+		std::vector<GpuTime> gpuTimes;
+		// Called once the warmup phase has finished
+		std::function<void()> warmupFinished;
+		// Number of frames in flight the example was run with
+		uint32_t framesInFlight = 1;
+		// Time it took to prepare the example (ms) and state of the pipeline cache (cold, warm, disabled)
+		double startupTime = 0.0;
+		std::string pipelineCacheState = "disabled";
 
 		double runtime = 0.0;
 		uint32_t frameCount = 0;
@@ -42,15 +202,27 @@ namespace vks
 			std::cout << std::fixed << std::setprecision(3);
 
 			// Warm up phase to get more stable frame rates
+			uint32_t warmupFrames = 0;
+			double tWarmup = 0.0;
 			{
-				double tMeasured = 0.0;
-				while (tMeasured < (warmup * 1000)) {
+				while (tWarmup < (warmup * 1000)) {
 					auto tStart = std::chrono::high_resolution_clock::now();
 					renderFunc();
 					auto tDiff = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
-					tMeasured += tDiff;
+					tWarmup += tDiff;
+					warmupFrames++;
 				};
 			}
+			if (warmupFinished) {
+				warmupFinished();
+			}
+
+			// Estimate the number of frames from the warmup phase with some headroom
+			{
+				const double estimatedFrameTime = (warmupFrames > 0) ? std::max(tWarmup / warmupFrames, 0.001) : 1.0;
+				const double estimatedFrames = (duration * 1000.0) / estimatedFrameTime * 1.5 + 1024.0;
+				frameTimes.assign(static_cast<size_t>(std::min(estimatedFrames, (double)(1 << 24))), 0.0);
+			}
 
 			// Benchmark phase
 			{
@@ -59,44 +231,78 @@ namespace vks
 					renderFunc();
 					auto tDiff = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
 					runtime += tDiff;
-					frameTimes.push_back(tDiff);
+					storeFrameTime(tDiff);
 					frameCount++;
 				};
+				calculateStatistics();
 				std::cout << "Benchmark finished" << std::endl;
 				std::cout << "device : " << deviceProps.deviceName << " (driver version: " << deviceProps.driverVersion << ")" << std::endl;
 				std::cout << "runtime: " << (runtime / 1000.0) << std::endl;
 				std::cout << "frames : " << frameCount << std::endl;
+				std::cout << "frames in flight: " << framesInFlight << std::endl;
+				std::cout << "startup: " << startupTime << " ms (pipeline cache: " << pipelineCacheState << ")" << std::endl;
 				std::cout << "fps    : " << frameCount / (runtime / 1000.0) << std::endl;
+				std::cout << "frame time: avg " << stats.avg << " ms, stddev " << stats.stdDev << " ms" << std::endl;
+				std::cout << "percentiles: p50 " << stats.p50 << " ms, p90 " << stats.p90 << " ms, p99 " << stats.p99 << " ms, p99.9 " << stats.p999 << " ms" << std::endl;
+				std::cout << "1% low : " << stats.onePercentLowFps << " fps" << std::endl;
+			}
+		}
+
+		void printGpuTimes() {
+			for (auto& gpuTime : gpuTimes) {
+				std::cout << "gpu    : " << gpuTime.name << " avg " << gpuTime.avg << " ms (min " << gpuTime.min << " ms, max " << gpuTime.max << " ms)" << std::endl;
 			}
 		}
 
+		/**
+		* Save the results of the benchmark run
+		* Writes a csv file to filename and a json file with the same name (and .json extension) next to it
+		*/
 		void saveResults() {
 			std::ofstream result(filename, std::ios::out);
 			if (result.is_open()) {
 				result << std::fixed << std::setprecision(4);
 
-				result << "device,driverversion,duration (ms),frames,fps" << std::endl;
-				result << deviceProps.deviceName << "," << deviceProps.driverVersion << "," << runtime << "," << frameCount << "," << frameCount / (runtime / 1000.0) << std::endl;
+				result << "device,driverversion,duration (ms),frames,fps,frames in flight,startup (ms),pipeline cache,min (ms),max (ms),avg (ms),stddev (ms),p50 (ms),p90 (ms),p99 (ms),p99.9 (ms),1% low fps" << std::endl;
+				result << deviceProps.deviceName << "," << deviceProps.driverVersion << "," << runtime << "," << frameCount << "," << frameCount / (runtime / 1000.0) << "," << framesInFlight << "," << startupTime << "," << pipelineCacheState << ",";
+				result << stats.min << "," << stats.max << "," << stats.avg << "," << stats.stdDev << "," << stats.p50 << "," << stats.p90 << "," << stats.p99 << "," << stats.p999 << "," << stats.onePercentLowFps << std::endl;
+
+				if (!gpuTimes.empty()) {
+					result << std::endl << "gpu scope,avg (ms),min (ms),max (ms),samples" << std::endl;
+					for (auto& gpuTime : gpuTimes) {
+						result << gpuTime.name << "," << gpuTime.avg << "," << gpuTime.min << "," << gpuTime.max << "," << gpuTime.samples << std::endl;
+					}
+				}
+
+				result << std::endl << "histogram bin (ms),frames" << std::endl;
+				for (size_t i = 0; i < stats.histogram.size(); i++) {
+					result << i * histogramBinWidth << "," << stats.histogram[i] << std::endl;
+				}
 
 				if (outputFrameTimes) {
 					result << std::endl << "frame,ms" << std::endl;
-					for (size_t i = 0; i < frameTimes.size(); i++) {
+					for (uint32_t i = 0; i < frameCount; i++) {
 						result << i << "," << frameTimes[i] << std::endl;
 					}
-					double tMin = *std::min_element(frameTimes.begin(), frameTimes.end());
-					double tMax = *std::max_element(frameTimes.begin(), frameTimes.end());
-					double tAvg = std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0) / (double)frameTimes.size();
-					std::cout << "best   : " << (1000.0 / tMin) << " fps (" << tMin << " ms)" << std::endl;
-					std::cout << "worst  : " << (1000.0 / tMax) << " fps (" << tMax << " ms)" << std::endl;
-					std::cout << "avg    : " << (1000.0 / tAvg) << " fps (" << tAvg << " ms)" << std::endl;
+					std::cout << "best   : " << (1000.0 / stats.min) << " fps (" << stats.min << " ms)" << std::endl;
+					std::cout << "worst  : " << (1000.0 / stats.max) << " fps (" << stats.max << " ms)" << std::endl;
+					std::cout << "avg    : " << (1000.0 / stats.avg) << " fps (" << stats.avg << " ms)" << std::endl;
 					std::cout << std::endl;
 				}
 
 				result.flush();
+			}
+
+			std::string jsonFilename = filename;
+			const size_t extPos = jsonFilename.find_last_of('.');
+			if ((extPos != std::string::npos) && (jsonFilename.find_first_of("/\\", extPos) == std::string::npos)) {
+				jsonFilename = jsonFilename.substr(0, extPos);
+			}
+			saveJSON(jsonFilename + ".json");
+
 #if defined(_WIN32)
-				FreeConsole();
+			FreeConsole();
 #endif
-			}
 		}
 	};
 }
\ No newline at end of file
@@ -1,22 +1,259 @@
 /*
 * View frustum culling class
 *
+* Besides single sphere checks, arrays of bounding spheres and boxes stored in structure of arrays layout
+* can be culled in batches using SSE (or AVX if enabled at compile time, see USE_AVX) with a scalar fallback
+*
 * Copyright (C) 2016 by Sascha Willems - www.saschawillems.de
 *
 * This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
 */
 
 #include <array>
+#include <vector>
+#include <functional>
+#include <stdint.h>
 #include <math.h>
 #include <glm/glm.hpp>
 
+#if defined(__AVX__)
+#define VKS_FRUSTUM_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define VKS_FRUSTUM_SSE
+#include <emmintrin.h>
+#endif
+
 namespace vks
 {
+	/** @brief Bounding spheres in structure of arrays layout for batched culling */
+	struct BoundingSpheres
+	{
+		std::vector<float> x, y, z, radius;
+
+		void resize(size_t count)
+		{
+			x.resize(count);
+			y.resize(count);
+			z.resize(count);
+			radius.resize(count);
+		}
+
+		void set(size_t index, const glm::vec3 &center, float radius)
+		{
+			x[index] = center.x;
+			y[index] = center.y;
+			z[index] = center.z;
+			this->radius[index] = radius;
+		}
+
+		size_t size() const { return x.size(); }
+	};
+
+	/** @brief Axis aligned bounding boxes in structure of arrays layout for batched culling */
+	struct BoundingBoxes
+	{
+		std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+
+		void resize(size_t count)
+		{
+			minX.resize(count);
+			minY.resize(count);
+			minZ.resize(count);
+			maxX.resize(count);
+			maxY.resize(count);
+			maxZ.resize(count);
+		}
+
+		void set(size_t index, const glm::vec3 &min, const glm::vec3 &max)
+		{
+			minX[index] = min.x;
+			minY[index] = min.y;
+			minZ[index] = min.z;
+			maxX[index] = max.x;
+			maxY[index] = max.y;
+			maxZ[index] = max.z;
+		}
+
+		size_t size() const { return minX.size(); }
+	};
+
 	class Frustum
 	{
+	private:
+		// Number of objects tested at once by the SIMD code paths
+#if defined(VKS_FRUSTUM_AVX)
+		static const uint32_t simdWidth = 8;
+#else
+		static const uint32_t simdWidth = 4;
+#endif
+
+		bool sphereVisible(const BoundingSpheres &spheres, uint32_t index)
+		{
+			for (auto i = 0; i < planes.size(); i++)
+			{
+				if ((planes[i].x * spheres.x[index]) + (planes[i].y * spheres.y[index]) + (planes[i].z * spheres.z[index]) + planes[i].w <= -spheres.radius[index])
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		bool boxVisible(const BoundingBoxes &boxes, uint32_t index)
+		{
+			return checkBox(glm::vec3(boxes.minX[index], boxes.minY[index], boxes.minZ[index]), glm::vec3(boxes.maxX[index], boxes.maxY[index], boxes.maxZ[index]));
+		}
+
+		/** @brief Visibility bits of simdWidth spheres starting at index (bit n = sphere index + n) */
+		uint32_t spheresVisible(const BoundingSpheres &spheres, uint32_t index)
+		{
+#if defined(VKS_FRUSTUM_AVX)
+			const __m256 x = _mm256_loadu_ps(&spheres.x[index]);
+			const __m256 y = _mm256_loadu_ps(&spheres.y[index]);
+			const __m256 z = _mm256_loadu_ps(&spheres.z[index]);
+			const __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&spheres.radius[index]));
+			__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (auto i = 0; i < planes.size(); i++)
+			{
+				__m256 d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[i].x), x), _mm256_set1_ps(planes[i].w));
+				d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[i].y), y), d);
+				d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[i].z), z), d);
+				visible = _mm256_and_ps(visible, _mm256_cmp_ps(d, negRadius, _CMP_GT_OQ));
+			}
+			return static_cast<uint32_t>(_mm256_movemask_ps(visible));
+#elif defined(VKS_FRUSTUM_SSE)
+			const __m128 x = _mm_loadu_ps(&spheres.x[index]);
+			const __m128 y = _mm_loadu_ps(&spheres.y[index]);
+			const __m128 z = _mm_loadu_ps(&spheres.z[index]);
+			const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[index]));
+			__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (auto i = 0; i < planes.size(); i++)
+			{
+				__m128 d = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[i].x), x), _mm_set1_ps(planes[i].w));
+				d = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[i].y), y), d);
+				d = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[i].z), z), d);
+				visible = _mm_and_ps(visible, _mm_cmpgt_ps(d, negRadius));
+			}
+			return static_cast<uint32_t>(_mm_movemask_ps(visible));
+#else
+			uint32_t bits = 0;
+			for (uint32_t n = 0; n < simdWidth; n++)
+			{
+				bits |= sphereVisible(spheres, index + n) ? (1u << n) : 0;
+			}
+			return bits;
+#endif
+		}
+
+		/** @brief Visibility bits of simdWidth boxes starting at index (bit n = box index + n) */
+		uint32_t boxesVisible(const BoundingBoxes &boxes, uint32_t index)
+		{
+#if defined(VKS_FRUSTUM_AVX) || defined(VKS_FRUSTUM_SSE)
+			// The plane normal is the same for all boxes, so the corner furthest along the normal can be selected per plane instead of per box
+#if defined(VKS_FRUSTUM_AVX)
+			__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+#else
+			__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+#endif
+			for (auto i = 0; i < planes.size(); i++)
+			{
+				const float *px = (planes[i].x > 0.0f) ? &boxes.maxX[index] : &boxes.minX[index];
+				const float *py = (planes[i].y > 0.0f) ? &boxes.maxY[index] : &boxes.minY[index];
+				const float *pz = (planes[i].z > 0.0f) ? &boxes.maxZ[index] : &boxes.minZ[index];
+#if defined(VKS_FRUSTUM_AVX)
+				__m256 d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[i].x), _mm256_loadu_ps(px)), _mm256_set1_ps(planes[i].w));
+				d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[i].y), _mm256_loadu_ps(py)), d);
+				d = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes[i].z), _mm256_loadu_ps(pz)), d);
+				visible = _mm256_and_ps(visible, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GE_OQ));
+#else
+				__m128 d = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[i].x), _mm_loadu_ps(px)), _mm_set1_ps(planes[i].w));
+				d = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[i].y), _mm_loadu_ps(py)), d);
+				d = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[i].z), _mm_loadu_ps(pz)), d);
+				visible = _mm_and_ps(visible, _mm_cmpge_ps(d, _mm_setzero_ps()));
+#endif
+			}
+#if defined(VKS_FRUSTUM_AVX)
+			return static_cast<uint32_t>(_mm256_movemask_ps(visible));
+#else
+			return static_cast<uint32_t>(_mm_movemask_ps(visible));
+#endif
+#else
+			uint32_t bits = 0;
+			for (uint32_t n = 0; n < simdWidth; n++)
+			{
+				bits |= boxVisible(boxes, index + n) ? (1u << n) : 0;
+			}
+			return bits;
+#endif
+		}
+
+		// Runs the visibility test over a range and passes the visibility bits of each group of objects to the output function
+		template<typename TestGroup, typename TestSingle, typename Output>
+		void cullRange(uint32_t first, uint32_t count, TestGroup testGroup, TestSingle testSingle, Output output)
+		{
+			uint32_t i = 0;
+			if (simd)
+			{
+				for (; i + simdWidth <= count; i += simdWidth)
+				{
+					output(i, testGroup(first + i), simdWidth);
+				}
+			}
+			for (; i < count; i++)
+			{
+				output(i, testSingle(first + i) ? 1u : 0u, 1u);
+			}
+		}
+
+		// Write visibility bits into a bit mask (bit n = object first + n)
+		struct MaskOutput
+		{
+			uint32_t *mask;
+			void operator()(uint32_t offset, uint32_t bits, uint32_t width)
+			{
+				// Groups never straddle two words as the SIMD width divides 32
+				if ((offset & 31) == 0)
+				{
+					mask[offset >> 5] = 0;
+				}
+				mask[offset >> 5] |= bits << (offset & 31);
+			}
+		};
+
+		// Append the indices of all visible objects to a list, branchless (an index is always written but only kept if visible)
+		struct IndexOutput
+		{
+			uint32_t *indices;
+			uint32_t first;
+			uint32_t count;
+			void operator()(uint32_t offset, uint32_t bits, uint32_t width)
+			{
+				for (uint32_t n = 0; n < width; n++)
+				{
+					indices[count] = first + offset + n;
+					count += (bits >> n) & 1;
+				}
+			}
+		};
+
 	public:
 		enum side { LEFT = 0, RIGHT = 1, TOP = 2, BOTTOM = 3, BACK = 4, FRONT = 5 };
 		std::array<glm::vec4, 6> planes;
+		/** @brief Use the SIMD code paths for the batch functions (if available at compile time), can be disabled for comparison */
+		bool simd = true;
+
+		/** @brief Name of the instruction set used for batched culling */
+		static const char* simdInstructionSet()
+		{
+#if defined(VKS_FRUSTUM_AVX)
+			return "AVX";
+#elif defined(VKS_FRUSTUM_SSE)
+			return "SSE";
+#else
+			return "none";
+#endif
+		}
 
 		void update(glm::mat4 matrix)
 		{
@@ -68,5 +305,81 @@ namespace vks
 			}
 			return true;
 		}
+
+		bool checkBox(glm::vec3 min, glm::vec3 max)
+		{
+			for (auto i = 0; i < planes.size(); i++)
+			{
+				// Corner of the box furthest along the plane normal
+				const glm::vec3 p((planes[i].x > 0.0f) ? max.x : min.x, (planes[i].y > 0.0f) ? max.y : min.y, (planes[i].z > 0.0f) ? max.z : min.z);
+				if ((planes[i].x * p.x) + (planes[i].y * p.y) + (planes[i].z * p.z) + planes[i].w < 0.0f)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		/**
+		* Check a range of bounding spheres against the frustum
+		*
+		* @param spheres Bounding spheres to check
+		* @param first Index of the first sphere to check
+		* @param count Number of spheres to check
+		* @param visibilityMask Bit mask receiving the results, bit n is set if sphere first + n is visible (must hold at least (count + 31) / 32 values)
+		*/
+		void checkSpheres(const BoundingSpheres &spheres, uint32_t first, uint32_t count, uint32_t *visibilityMask)
+		{
+			MaskOutput output = { visibilityMask };
+			cullRange(first, count, [&](uint32_t index) { return spheresVisible(spheres, index); }, [&](uint32_t index) { return sphereVisible(spheres, index); }, std::ref(output));
+		}
+
+		/**
+		* Get the indices of all visible bounding spheres in a range
+		*
+		* @param spheres Bounding spheres to check
+		* @param first Index of the first sphere to check
+		* @param count Number of spheres to check
+		* @param visibleIndices List receiving the indices of the visible spheres (must hold at least count values)
+		*
+		* @return Number of visible spheres written to visibleIndices
+		*/
+		uint32_t getVisibleSpheres(const BoundingSpheres &spheres, uint32_t first, uint32_t count, uint32_t *visibleIndices)
+		{
+			IndexOutput output = { visibleIndices, first, 0 };
+			cullRange(first, count, [&](uint32_t index) { return spheresVisible(spheres, index); }, [&](uint32_t index) { return sphereVisible(spheres, index); }, std::ref(output));
+			return output.count;
+		}
+
+		/**
+		* Check a range of axis aligned bounding boxes against the frustum
+		*
+		* @param boxes Bounding boxes to check
+		* @param first Index of the first box to check
+		* @param count Number of boxes to check
+		* @param visibilityMask Bit mask receiving the results, bit n is set if box first + n is visible (must hold at least (count + 31) / 32 values)
+		*/
+		void checkBoxes(const BoundingBoxes &boxes, uint32_t first, uint32_t count, uint32_t *visibilityMask)
+		{
+			MaskOutput output = { visibilityMask };
+			cullRange(first, count, [&](uint32_t index) { return boxesVisible(boxes, index); }, [&](uint32_t index) { return boxVisible(boxes, index); }, std::ref(output));
+		}
+
+		/**
+		* Get the indices of all visible axis aligned bounding boxes in a range
+		*
+		* @param boxes Bounding boxes to check
+		* @param first Index of the first box to check
+		* @param count Number of boxes to check
+		* @param visibleIndices List receiving the indices of the visible boxes (must hold at least count values)
+		*
+		* @return Number of visible boxes written to visibleIndices
+		*/
+		uint32_t getVisibleBoxes(const BoundingBoxes &boxes, uint32_t first, uint32_t count, uint32_t *visibleIndices)
+		{
+			IndexOutput output = { visibleIndices, first, 0 };
+			cullRange(first, count, [&](uint32_t index) { return boxesVisible(boxes, index); }, [&](uint32_t index) { return boxVisible(boxes, index); }, std::ref(output));
+			return output.count;
+		}
 	};
 }
@@ -0,0 +1,632 @@
+/*
+* CPU image processing for textures that are only available as plain 8 bit images at runtime (e.g. glTF images)
+*
+* - Expansion of grey, grey + alpha and RGB images to RGBA (SSE2 with a scalar fallback)
+* - Mip chain generation with a separable box or Kaiser windowed sinc filter, each level is filtered from the
+*   previous one at float precision
+* - sRGB encoded color channels are filtered in linear space, colors can be weighted by alpha (premultiplied),
+*   so fully transparent texels don't bleed into their neighbours
+* - Alpha coverage preservation for alpha tested images: the alpha of each level is scaled so the fraction of
+*   texels passing the alpha test matches the top level, and foliage etc. doesn't fade out in the distance
+*
+* The rows of each level are distributed over the threads of a vks::JobSystem. Converting a level back to 8 bits
+* runs as separate jobs that overlap with filtering the next level.
+*
+* Copyright (C) 2016-2017 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <stdint.h>
+#include <assert.h>
+
+#include "jobsystem.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define VKS_IMAGE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace vks
+{
+	namespace imageproc
+	{
+		enum ColorSpace {
+			/** @brief All channels store linear values (e.g. normals, roughness, occlusion) */
+			COLOR_SPACE_LINEAR,
+			/** @brief Red, green and blue are sRGB encoded and filtered in linear space, alpha is always linear */
+			COLOR_SPACE_SRGB
+		};
+
+		enum MipFilter {
+			/** @brief Area weighted box filter (2x2 average for even sizes) */
+			MIP_FILTER_BOX,
+			/** @brief Kaiser windowed sinc (three texels of the destination level wide), keeps the levels sharper than the box filter */
+			MIP_FILTER_KAISER
+		};
+
+		struct MipOptions {
+			MipFilter filter = MIP_FILTER_KAISER;
+			ColorSpace colorSpace = COLOR_SPACE_LINEAR;
+			/** @brief Weight the colors by alpha while filtering (premultiplied), only for images where alpha is opacity */
+			bool alphaWeighted = false;
+			/** @brief Reference value of the alpha test, if > 0 the alpha of each level is scaled to keep the alpha test coverage of the top level */
+			float alphaCutoff = 0.0f;
+			/** @brief Renormalize the vectors of tangent space normal maps (rgb = xyz * 0.5 + 0.5) after filtering */
+			bool normalMap = false;
+		};
+
+		struct MipLevel {
+			uint32_t width;
+			uint32_t height;
+			/** @brief Offset of the level's texels in the destination */
+			size_t offset;
+			size_t size;
+		};
+
+		/** @brief Run a function over the rows [0, count) on the job system's threads, or on the calling thread if no job system is passed */
+		template<typename F>
+		inline void forRows(vks::JobSystem *jobSystem, uint32_t count, F &&function, uint32_t minChunkSize = 1)
+		{
+			if (jobSystem) {
+				jobSystem->parallelFor(count, function, minChunkSize);
+			} else {
+				function(0, count);
+			}
+		}
+
+		/** @brief Number of levels of a full mip chain */
+		inline uint32_t getMipLevelCount(uint32_t width, uint32_t height)
+		{
+			return static_cast<uint32_t>(floor(log2(std::max(width, height))) + 1.0);
+		}
+
+		/**
+		* Layout of a full RGBA8 mip chain with the levels stored back to back
+		*
+		* @param (Optional) alignment Alignment of the level offsets (e.g. for buffer to image copies, defaults to 16)
+		*/
+		inline std::vector<MipLevel> getMipLevels(uint32_t width, uint32_t height, size_t alignment = 16)
+		{
+			std::vector<MipLevel> levels(getMipLevelCount(width, height));
+			size_t offset = 0;
+			for (uint32_t i = 0; i < levels.size(); i++) {
+				offset = (offset + alignment - 1) / alignment * alignment;
+				levels[i].width = std::max(width >> i, 1u);
+				levels[i].height = std::max(height >> i, 1u);
+				levels[i].offset = offset;
+				levels[i].size = static_cast<size_t>(levels[i].width) * levels[i].height * 4;
+				offset += levels[i].size;
+			}
+			return levels;
+		}
+
+		/** @brief Size of a mip chain including the padding between the levels */
+		inline size_t getMipChainSize(const std::vector<MipLevel> &levels)
+		{
+			return levels.empty() ? 0 : levels.back().offset + levels.back().size;
+		}
+
+		/** @brief Lookup table from sRGB encoded 8 bit values to linear floats */
+		inline const float* srgbToLinearTable()
+		{
+			static const struct Table {
+				float values[256];
+				Table() {
+					for (uint32_t i = 0; i < 256; i++) {
+						const float c = i / 255.0f;
+						values[i] = (c <= 0.04045f) ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+					}
+				}
+			} table;
+			return table.values;
+		}
+
+		/** @brief Entries of the linear to sRGB table, fine enough to round to the nearest 8 bit value in the dark range */
+		static const uint32_t linearToSrgbTableSize = 16384;
+
+		/** @brief Lookup table from linear floats in [0, 1] (scaled to the table size) to sRGB encoded 8 bit values */
+		inline const uint8_t* linearToSrgbTable()
+		{
+			static const struct Table {
+				uint8_t values[linearToSrgbTableSize];
+				Table() {
+					for (uint32_t i = 0; i < linearToSrgbTableSize; i++) {
+						const float c = i / static_cast<float>(linearToSrgbTableSize - 1);
+						const float s = (c <= 0.0031308f) ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+						values[i] = static_cast<uint8_t>(std::min(s, 1.0f) * 255.0f + 0.5f);
+					}
+				}
+			} table;
+			return table.values;
+		}
+
+		inline float srgbToLinear(uint8_t value)
+		{
+			return srgbToLinearTable()[value];
+		}
+
+		inline uint8_t linearToSrgb(float value)
+		{
+			return linearToSrgbTable()[static_cast<uint32_t>(std::min(std::max(value, 0.0f), 1.0f) * (linearToSrgbTableSize - 1) + 0.5f)];
+		}
+
+		/** @brief Expand a range of texels with one to four components to RGBA, missing alpha is set to opaque (internal, see expandToRgba) */
+		inline void expandTexels(const uint8_t *src, uint32_t components, size_t count, uint8_t *dst)
+		{
+			if (components == 4) {
+				memcpy(dst, src, count * 4);
+				return;
+			}
+			size_t i = 0;
+#if defined(VKS_IMAGE_SSE)
+			const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+			switch (components) {
+			case 1:
+				// 16 grey values to 16 texels, each value is replicated into all four bytes
+				for (; i + 16 <= count; i += 16) {
+					const __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+					const __m128i gg0 = _mm_unpacklo_epi8(g, g);
+					const __m128i gg1 = _mm_unpackhi_epi8(g, g);
+					__m128i *out = reinterpret_cast<__m128i*>(dst + i * 4);
+					_mm_storeu_si128(out + 0, _mm_or_si128(_mm_unpacklo_epi16(gg0, gg0), alpha));
+					_mm_storeu_si128(out + 1, _mm_or_si128(_mm_unpackhi_epi16(gg0, gg0), alpha));
+					_mm_storeu_si128(out + 2, _mm_or_si128(_mm_unpacklo_epi16(gg1, gg1), alpha));
+					_mm_storeu_si128(out + 3, _mm_or_si128(_mm_unpackhi_epi16(gg1, gg1), alpha));
+				}
+				break;
+			case 2:
+			{
+				// 8 grey + alpha pairs to 8 texels, interleaving (grey, grey) with (grey, alpha) words gives grey, grey, grey, alpha
+				const __m128i lowBytes = _mm_set1_epi16(0x00FF);
+				for (; i + 8 <= count; i += 8) {
+					const __m128i ga = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 2));
+					const __m128i gg = _mm_or_si128(_mm_and_si128(ga, lowBytes), _mm_slli_epi16(ga, 8));
+					__m128i *out = reinterpret_cast<__m128i*>(dst + i * 4);
+					_mm_storeu_si128(out + 0, _mm_unpacklo_epi16(gg, ga));
+					_mm_storeu_si128(out + 1, _mm_unpackhi_epi16(gg, ga));
+				}
+				break;
+			}
+			case 3:
+				// 4 texels per iteration: shift each texel into the lowest dword and gather the dwords, the fourth byte is overwritten by alpha
+				// The 16 byte load reads ahead into the next texels, so the loop stops early enough to stay inside of the source
+				for (; i + 6 <= count; i += 4) {
+					const __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+					const __m128i t01 = _mm_unpacklo_epi32(rgb, _mm_srli_si128(rgb, 3));
+					const __m128i t23 = _mm_unpacklo_epi32(_mm_srli_si128(rgb, 6), _mm_srli_si128(rgb, 9));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(_mm_unpacklo_epi64(t01, t23), alpha));
+				}
+				break;
+			}
+#endif
+			// Remaining texels (all texels without SSE2)
+			for (; i < count; i++) {
+				uint8_t *out = dst + i * 4;
+				switch (components) {
+				case 1:
+					out[0] = out[1] = out[2] = src[i];
+					out[3] = 255;
+					break;
+				case 2:
+					out[0] = out[1] = out[2] = src[i * 2];
+					out[3] = src[i * 2 + 1];
+					break;
+				default:
+					out[0] = src[i * 3];
+					out[1] = src[i * 3 + 1];
+					out[2] = src[i * 3 + 2];
+					out[3] = 255;
+					break;
+				}
+			}
+		}
+
+		/**
+		* Expand an image with one (grey), two (grey + alpha), three (RGB) or four components to RGBA8
+		*
+		* @param src Source texels
+		* @param components Number of 8 bit components per source texel
+		* @param texelCount Number of texels
+		* @param dst Destination, must hold texelCount * 4 bytes
+		* @param (Optional) jobSystem Distribute the work over the threads of this job system
+		*/
+		inline void expandToRgba(const uint8_t *src, uint32_t components, size_t texelCount, uint8_t *dst, vks::JobSystem *jobSystem = nullptr)
+		{
+			assert((components >= 1) && (components <= 4));
+			const size_t chunkSize = 65536;
+			const uint32_t chunkCount = static_cast<uint32_t>((texelCount + chunkSize - 1) / chunkSize);
+			forRows(jobSystem, chunkCount, [=](uint32_t begin, uint32_t end) {
+				const size_t first = begin * chunkSize;
+				const size_t last = std::min(end * chunkSize, texelCount);
+				expandTexels(src + first * components, components, last - first, dst + first * 4);
+			});
+		}
+
+		/** @brief Weights of a separable filter for all texels of one dimension of a level (internal) */
+		struct FilterTaps {
+			/** @brief Number of weights per destination texel */
+			uint32_t tapCount = 0;
+			/** @brief First source texel of each destination texel */
+			std::vector<uint32_t> first;
+			/** @brief tapCount weights per destination texel */
+			std::vector<float> weights;
+		};
+
+		/** @brief Zeroth order modified Bessel function of the first kind (for the Kaiser window) */
+		inline double besselI0(double x)
+		{
+			double sum = 1.0;
+			double term = 1.0;
+			for (uint32_t k = 1; k < 32; k++) {
+				const double t = x / (2.0 * k);
+				term *= t * t;
+				sum += term;
+			}
+			return sum;
+		}
+
+		/** @brief Filter weights for downsampling one dimension, texels outside of the image are clamped to the edge */
+		inline FilterTaps computeFilterTaps(uint32_t srcSize, uint32_t dstSize, MipFilter filter)
+		{
+			const double kaiserWidth = 3.0;
+			const double kaiserAlpha = 4.0;
+			const double pi = 3.14159265358979323846;
+			const double scale = static_cast<double>(srcSize) / dstSize;
+
+			// Weights of each destination texel, folded into the window of source texels inside of the image
+			std::vector<int32_t> windowStart(dstSize);
+			std::vector<std::vector<double>> windows(dstSize);
+			FilterTaps taps;
+			for (uint32_t i = 0; i < dstSize; i++) {
+				int32_t begin, end;
+				if (filter == MIP_FILTER_BOX) {
+					begin = static_cast<int32_t>(floor(i * scale));
+					end = static_cast<int32_t>(ceil((i + 1) * scale));
+				} else {
+					const double center = (i + 0.5) * scale;
+					begin = static_cast<int32_t>(ceil(center - kaiserWidth * scale - 0.5));
+					end = static_cast<int32_t>(floor(center + kaiserWidth * scale - 0.5)) + 1;
+				}
+				const int32_t lo = std::min(std::max(begin, 0), static_cast<int32_t>(srcSize) - 1);
+				const int32_t hi = std::min(std::max(end - 1, 0), static_cast<int32_t>(srcSize) - 1);
+				windowStart[i] = lo;
+				windows[i].assign(hi - lo + 1, 0.0);
+				double sum = 0.0;
+				for (int32_t j = begin; j < end; j++) {
+					double weight;
+					if (filter == MIP_FILTER_BOX) {
+						// Overlap of the source texel with the destination texel's footprint
+						weight = std::min((i + 1) * scale, j + 1.0) - std::max(i * scale, static_cast<double>(j));
+					} else {
+						const double x = (j + 0.5 - (i + 0.5) * scale) / scale;
+						const double sinc = (fabs(x) < 1e-6) ? 1.0 : sin(pi * x) / (pi * x);
+						const double t = x / kaiserWidth;
+						weight = sinc * besselI0(kaiserAlpha * sqrt(std::max(1.0 - t * t, 0.0))) / besselI0(kaiserAlpha);
+					}
+					const int32_t index = std::min(std::max(j, lo), hi);
+					windows[i][index - lo] += weight;
+					sum += weight;
+				}
+				for (auto &weight : windows[i]) {
+					weight /= sum;
+				}
+				taps.tapCount = std::max(taps.tapCount, static_cast<uint32_t>(windows[i].size()));
+			}
+
+			// All destination texels use the same number of taps, windows at the edges are shifted into the image and padded with zero weights
+			taps.first.resize(dstSize);
+			taps.weights.assign(static_cast<size_t>(dstSize) * taps.tapCount, 0.0f);
+			for (uint32_t i = 0; i < dstSize; i++) {
+				const uint32_t first = std::min(static_cast<uint32_t>(windowStart[i]), srcSize - taps.tapCount);
+				taps.first[i] = first;
+				for (size_t k = 0; k < windows[i].size(); k++) {
+					taps.weights[i * taps.tapCount + (windowStart[i] - first) + k] = static_cast<float>(windows[i][k]);
+				}
+			}
+			return taps;
+		}
+
+		/** @brief Convert a row of RGBA8 texels to linear (optionally premultiplied) floats, returns the number of texels passing the alpha test (internal) */
+		inline uint32_t loadRow(const uint8_t *src, uint32_t width, const MipOptions &options, float *dst)
+		{
+			const float *fromSrgb = srgbToLinearTable();
+			const bool srgb = (options.colorSpace == COLOR_SPACE_SRGB);
+			// Same test as the glTF alpha mask mode, texels with an alpha equal to the cutoff are kept
+			const float alphaReference = options.alphaCutoff * 255.0f;
+			const float toFloat = 1.0f / 255.0f;
+			uint32_t passing = 0;
+			for (uint32_t x = 0; x < width; x++) {
+				const uint8_t *texel = src + x * 4;
+				const float alpha = texel[3] * toFloat;
+				const float weight = options.alphaWeighted ? alpha : 1.0f;
+				passing += (texel[3] >= alphaReference) ? 1 : 0;
+#if defined(VKS_IMAGE_SSE)
+				__m128 value;
+				if (srgb) {
+					value = _mm_set_ps(alpha, fromSrgb[texel[2]], fromSrgb[texel[1]], fromSrgb[texel[0]]);
+				} else {
+					int32_t packed;
+					memcpy(&packed, texel, 4);
+					const __m128i zero = _mm_setzero_si128();
+					value = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero)), _mm_set1_ps(toFloat));
+				}
+				_mm_storeu_ps(dst + x * 4, _mm_mul_ps(value, _mm_set_ps(1.0f, weight, weight, weight)));
+#else
+				for (uint32_t c = 0; c < 3; c++) {
+					dst[x * 4 + c] = (srgb ? fromSrgb[texel[c]] : texel[c] * toFloat) * weight;
+				}
+				dst[x * 4 + 3] = alpha;
+#endif
+			}
+			return passing;
+		}
+
+		/** @brief Horizontal filter pass over a single row (internal) */
+		inline void filterRow(const float *src, const FilterTaps &taps, uint32_t dstWidth, float *dst)
+		{
+			for (uint32_t x = 0; x < dstWidth; x++) {
+				const float *texels = src + static_cast<size_t>(taps.first[x]) * 4;
+				const float *weights = &taps.weights[static_cast<size_t>(x) * taps.tapCount];
+#if defined(VKS_IMAGE_SSE)
+				__m128 sum = _mm_setzero_ps();
+				for (uint32_t t = 0; t < taps.tapCount; t++) {
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(texels + t * 4)));
+				}
+				_mm_storeu_ps(dst + x * 4, sum);
+#else
+				float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				for (uint32_t t = 0; t < taps.tapCount; t++) {
+					for (uint32_t c = 0; c < 4; c++) {
+						sum[c] += weights[t] * texels[t * 4 + c];
+					}
+				}
+				memcpy(dst + x * 4, sum, sizeof(sum));
+#endif
+			}
+		}
+
+		/** @brief Vertical filter pass for a single destination row, filters all texels of the row at once (internal) */
+		inline void filterColumns(const float *src, uint32_t width, const FilterTaps &taps, uint32_t y, float *dst)
+		{
+			const size_t rowLength = static_cast<size_t>(width) * 4;
+			const float *rows = src + taps.first[y] * rowLength;
+			const float *weights = &taps.weights[static_cast<size_t>(y) * taps.tapCount];
+			for (size_t i = 0; i < rowLength; i += 4) {
+#if defined(VKS_IMAGE_SSE)
+				__m128 sum = _mm_setzero_ps();
+				for (uint32_t t = 0; t < taps.tapCount; t++) {
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(rows + t * rowLength + i)));
+				}
+				// Negative lobes of the Kaiser filter may over- and undershoot
+				sum = _mm_min_ps(_mm_max_ps(sum, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+				_mm_storeu_ps(dst + i, sum);
+#else
+				for (uint32_t c = 0; c < 4; c++) {
+					float sum = 0.0f;
+					for (uint32_t t = 0; t < taps.tapCount; t++) {
+						sum += weights[t] * rows[t * rowLength + i + c];
+					}
+					dst[i + c] = std::min(std::max(sum, 0.0f), 1.0f);
+				}
+#endif
+			}
+		}
+
+		/** @brief Bins of the alpha histograms used for alpha coverage preservation */
+		static const uint32_t coverageBins = 1024;
+
+		/** @brief Renormalize the filtered vectors of a normal map row and count its alpha values (internal) */
+		inline void finishRow(float *row, uint32_t width, const MipOptions &options, uint32_t *histogram)
+		{
+			for (uint32_t x = 0; x < width; x++) {
+				float *texel = row + x * 4;
+				if (options.normalMap) {
+					const float nx = texel[0] * 2.0f - 1.0f;
+					const float ny = texel[1] * 2.0f - 1.0f;
+					const float nz = texel[2] * 2.0f - 1.0f;
+					const float length = sqrtf(nx * nx + ny * ny + nz * nz);
+					if (length > 1e-6f) {
+						texel[0] = nx / length * 0.5f + 0.5f;
+						texel[1] = ny / length * 0.5f + 0.5f;
+						texel[2] = nz / length * 0.5f + 0.5f;
+					}
+				}
+				if (histogram) {
+					histogram[std::min(static_cast<uint32_t>(texel[3] * coverageBins), coverageBins - 1)]++;
+				}
+			}
+		}
+
+		/**
+		* Alpha scale that makes the same fraction of a level's texels pass the alpha test as in the top level
+		*
+		* @param histogram Alpha histogram of the level (coverageBins entries)
+		* @param texelCount Number of texels of the level
+		* @param coverage Fraction of the top level's texels passing the alpha test
+		* @param alphaCutoff Reference value of the alpha test
+		*/
+		inline float getCoverageScale(const uint32_t *histogram, size_t texelCount, float coverage, float alphaCutoff)
+		{
+			// Find the lowest alpha that still lets enough texels pass and map it to the reference value
+			const double target = static_cast<double>(coverage) * texelCount;
+			double passing = 0.0;
+			uint32_t bin = coverageBins;
+			while ((bin > 0) && (passing < target)) {
+				bin--;
+				passing += histogram[bin];
+			}
+			const float threshold = std::max(bin, 1u) / static_cast<float>(coverageBins);
+			return alphaCutoff / threshold;
+		}
+
+		/** @brief Convert rows of filtered floats to RGBA8 (internal) */
+		inline void storeRows(const float *src, uint32_t width, uint32_t begin, uint32_t end, float alphaScale, const MipOptions &options, uint8_t *dst)
+		{
+			const uint8_t *toSrgb = linearToSrgbTable();
+			const bool srgb = (options.colorSpace == COLOR_SPACE_SRGB);
+			for (size_t i = static_cast<size_t>(begin) * width; i < static_cast<size_t>(end) * width; i++) {
+				const float *texel = src + i * 4;
+				const float alpha = texel[3];
+				// Undo the alpha weighting, fully transparent texels end up black
+				const float weight = options.alphaWeighted ? ((alpha > 0.0f) ? 1.0f / alpha : 0.0f) : 1.0f;
+				const float scaledAlpha = std::min(alpha * alphaScale, 1.0f);
+#if defined(VKS_IMAGE_SSE)
+				const __m128 value = _mm_min_ps(_mm_mul_ps(_mm_loadu_ps(texel), _mm_set_ps(0.0f, weight, weight, weight)), _mm_set1_ps(1.0f));
+				int32_t packed;
+				if (srgb) {
+					alignas(16) int32_t indices[4];
+					_mm_store_si128(reinterpret_cast<__m128i*>(indices), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(linearToSrgbTableSize - 1.0f)), _mm_set1_ps(0.5f))));
+					packed = toSrgb[indices[0]] | (toSrgb[indices[1]] << 8) | (toSrgb[indices[2]] << 16) | (static_cast<int32_t>(scaledAlpha * 255.0f + 0.5f) << 24);
+				} else {
+					// Alpha is inserted as the fourth lane before packing all lanes to bytes
+					const __m128 lanes = _mm_add_ps(_mm_mul_ps(_mm_add_ps(value, _mm_set_ps(scaledAlpha, 0.0f, 0.0f, 0.0f)), _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f));
+					const __m128i words = _mm_packs_epi32(_mm_cvttps_epi32(lanes), _mm_setzero_si128());
+					packed = _mm_cvtsi128_si32(_mm_packus_epi16(words, words));
+				}
+				memcpy(dst + i * 4, &packed, 4);
+#else
+				uint8_t out[4];
+				for (uint32_t c = 0; c < 3; c++) {
+					const float value = std::min(texel[c] * weight, 1.0f);
+					out[c] = srgb ? toSrgb[static_cast<uint32_t>(value * (linearToSrgbTableSize - 1) + 0.5f)] : static_cast<uint8_t>(value * 255.0f + 0.5f);
+				}
+				out[3] = static_cast<uint8_t>(scaledAlpha * 255.0f + 0.5f);
+				memcpy(dst + i * 4, out, 4);
+#endif
+			}
+		}
+
+		/**
+		* Generate a full RGBA8 mip chain
+		*
+		* @param rgba Texels of the top level (4 bytes per texel)
+		* @param levels Layout of the mip chain (see getMipLevels)
+		* @param dst Destination of all levels (e.g. mapped staging memory, it is only written to), the top level is copied from rgba
+		* @param options Filter, color space and alpha handling
+		* @param (Optional) jobSystem Distribute the work over the threads of this job system, must have been created on the calling thread
+		*/
+		inline void generateMipChain(const uint8_t *rgba, const std::vector<MipLevel> &levels, uint8_t *dst, const MipOptions &options, vks::JobSystem *jobSystem = nullptr)
+		{
+			assert(!levels.empty());
+			uint8_t *topLevel = dst + levels[0].offset;
+			if (levels.size() == 1) {
+				if (topLevel != rgba) {
+					memcpy(topLevel, rgba, levels[0].size);
+				}
+				return;
+			}
+
+			const bool preserveCoverage = (options.alphaCutoff > 0.0f);
+			const uint32_t threadCount = jobSystem ? jobSystem->getThreadCount() : 1;
+			// Per thread counters (padded to separate cache lines) and alpha histograms
+			std::vector<uint64_t> passingTexels(threadCount * 8, 0);
+			std::vector<uint32_t> histograms(preserveCoverage ? threadCount * coverageBins : 0);
+			float coverage = 0.0f;
+
+			// Filtered levels are kept as floats, quantizing a level may still be running while the next two levels are filtered
+			std::vector<float> levelData[3];
+			JobCounter levelCounters[3];
+			for (auto &counter : levelCounters) {
+				counter.store(0);
+			}
+			std::vector<float> horizontal;
+
+			for (uint32_t i = 1; i < levels.size(); i++) {
+				const MipLevel &srcLevel = levels[i - 1];
+				const MipLevel &level = levels[i];
+				const FilterTaps tapsX = computeFilterTaps(srcLevel.width, level.width, options.filter);
+				const FilterTaps tapsY = computeFilterTaps(srcLevel.height, level.height, options.filter);
+				const float *srcData = levelData[(i - 1) % 3].data();
+				horizontal.resize(static_cast<size_t>(level.width) * srcLevel.height * 4);
+				float *horizontalData = horizontal.data();
+
+				// Horizontal pass, the top level is converted to floats one row at a time (and copied to its destination on the way)
+				forRows(jobSystem, srcLevel.height, [&](uint32_t begin, uint32_t end) {
+					std::vector<float> row;
+					for (uint32_t y = begin; y < end; y++) {
+						const float *srcRow;
+						if (i == 1) {
+							const uint8_t *texels = rgba + static_cast<size_t>(y) * srcLevel.width * 4;
+							if (topLevel != rgba) {
+								memcpy(topLevel + static_cast<size_t>(y) * srcLevel.width * 4, texels, srcLevel.width * 4);
+							}
+							row.resize(static_cast<size_t>(srcLevel.width) * 4);
+							const uint32_t passing = loadRow(texels, srcLevel.width, options, row.data());
+							passingTexels[(jobSystem ? jobSystem->getThreadIndex() : 0) * 8] += passing;
+							srcRow = row.data();
+						} else {
+							srcRow = srcData + static_cast<size_t>(y) * srcLevel.width * 4;
+						}
+						filterRow(srcRow, tapsX, level.width, horizontalData + static_cast<size_t>(y) * level.width * 4);
+					}
+				});
+				if (i == 1) {
+					uint64_t passing = 0;
+					for (uint32_t t = 0; t < threadCount; t++) {
+						passing += passingTexels[t * 8];
+					}
+					coverage = static_cast<float>(static_cast<double>(passing) / (static_cast<double>(srcLevel.width) * srcLevel.height));
+				}
+
+				// The level's buffer was last used three levels ago, wait until that level has been quantized
+				JobCounter &counter = levelCounters[i % 3];
+				if (jobSystem) {
+					jobSystem->wait(counter);
+				}
+				std::vector<float> &dstData = levelData[i % 3];
+				dstData.resize(static_cast<size_t>(level.width) * level.height * 4);
+				float *filtered = dstData.data();
+				std::fill(histograms.begin(), histograms.end(), 0);
+
+				// Vertical pass
+				forRows(jobSystem, level.height, [&](uint32_t begin, uint32_t end) {
+					uint32_t *histogram = preserveCoverage ? &histograms[(jobSystem ? jobSystem->getThreadIndex() : 0) * coverageBins] : nullptr;
+					for (uint32_t y = begin; y < end; y++) {
+						float *row = filtered + static_cast<size_t>(y) * level.width * 4;
+						filterColumns(horizontalData, level.width, tapsY, y, row);
+						if (options.normalMap || histogram) {
+							finishRow(row, level.width, options, histogram);
+						}
+					}
+				});
+
+				float alphaScale = 1.0f;
+				if (preserveCoverage) {
+					for (uint32_t t = 1; t < threadCount; t++) {
+						for (uint32_t b = 0; b < coverageBins; b++) {
+							histograms[b] += histograms[t * coverageBins + b];
+						}
+					}
+					alphaScale = getCoverageScale(histograms.data(), static_cast<size_t>(level.width) * level.height, coverage, options.alphaCutoff);
+				}
+
+				// Quantize the level on other threads while the next level is filtered
+				uint8_t *levelDst = dst + level.offset;
+				if (jobSystem) {
+					const uint32_t width = level.width;
+					const uint32_t rowsPerJob = std::max(16384u / width, 1u);
+					const MipOptions *jobOptions = &options;
+					for (uint32_t begin = 0; begin < level.height; begin += rowsPerJob) {
+						const uint32_t end = std::min(begin + rowsPerJob, level.height);
+						jobSystem->run([=] { storeRows(filtered, width, begin, end, alphaScale, *jobOptions, levelDst); }, &counter);
+					}
+				} else {
+					storeRows(filtered, level.width, 0, level.height, alphaScale, options, levelDst);
+				}
+			}
+
+			if (jobSystem) {
+				for (auto &counter : levelCounters) {
+					jobSystem->wait(counter);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,462 @@
+/*
+* C++11 work stealing job system
+*
+* Each worker owns a lock-free job deque (Chase-Lev) that it pushes to and pops from,
+* idle workers steal jobs from the other deques. Jobs store their callable inline
+* (no heap allocations per job) and completion is tracked with atomic counters.
+* Threads that are not workers of a job system (e.g. the one that created it or the workers
+* of another job system) take turns in using the deque and job pool of thread index 0.
+*
+* Copyright (C) 2016-2017 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+#include <deque>
+#include <assert.h>
+
+namespace vks
+{
+	/** @brief Number of unfinished jobs that have been started with a counter, wait on it via JobSystem::wait */
+	typedef std::atomic<uint32_t> JobCounter;
+
+	/** @brief A single unit of work, the callable is stored inside of the job (internal) */
+	struct Job
+	{
+		/** @brief Size of the inline storage for the job's callable (captures), the job itself fills two cache lines */
+		static const size_t storageSize = 80;
+
+		void(*function)(Job&) = nullptr;
+		void(*destroy)(Job&) = nullptr;
+		JobCounter *counter = nullptr;
+		JobCounter *dependency = nullptr;
+		/** @brief Set while the job is queued or running, the slot can be reused once it's cleared */
+		std::atomic<uint32_t> active;
+		alignas(16) unsigned char storage[storageSize];
+
+		Job() : active(0) {}
+	};
+
+	/**
+	* Fixed size work stealing deque (Chase-Lev)
+	* Only the owning thread may push and pop (at the bottom), all other threads may steal (from the top)
+	*
+	* @note Memory orderings follow "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al., 2013)
+	*/
+	class JobDeque
+	{
+	private:
+		static const int64_t capacity = 4096;
+		std::atomic<int64_t> top;
+		// Top and bottom are written by different threads, keep them on separate cache lines
+		char padding[64];
+		std::atomic<int64_t> bottom;
+		std::vector<std::atomic<Job*>> buffer;
+
+	public:
+		JobDeque() : top(0), bottom(0), buffer(capacity)
+		{
+			for (auto& entry : buffer) {
+				entry.store(nullptr, std::memory_order_relaxed);
+			}
+		}
+
+		/** @brief Push a job to the bottom of the deque (owner only), returns false if the deque is full */
+		bool push(Job *job)
+		{
+			const int64_t b = bottom.load(std::memory_order_relaxed);
+			const int64_t t = top.load(std::memory_order_acquire);
+			if (b - t >= capacity) {
+				return false;
+			}
+			buffer[b & (capacity - 1)].store(job, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_release);
+			return true;
+		}
+
+		/** @brief Pop a job from the bottom of the deque (owner only) */
+		Job* pop()
+		{
+			const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = top.load(std::memory_order_relaxed);
+			Job *job = nullptr;
+			if (t <= b) {
+				job = buffer[b & (capacity - 1)].load(std::memory_order_relaxed);
+				if (t == b) {
+					// Last job in the deque, race against concurrent steals
+					if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+						job = nullptr;
+					}
+					bottom.store(b + 1, std::memory_order_relaxed);
+				}
+			}
+			else {
+				bottom.store(b + 1, std::memory_order_relaxed);
+			}
+			return job;
+		}
+
+		/** @brief Steal a job from the top of the deque (any thread) */
+		Job* steal()
+		{
+			int64_t t = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const int64_t b = bottom.load(std::memory_order_acquire);
+			if (t < b) {
+				Job *job = buffer[t & (capacity - 1)].load(std::memory_order_relaxed);
+				if (top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+					return job;
+				}
+			}
+			return nullptr;
+		}
+	};
+
+	class JobSystem
+	{
+	private:
+		/** @brief Per thread state, index 0 is shared by all threads that are not workers of the job system */
+		struct Worker
+		{
+			static const uint32_t poolSize = 4096;
+			JobDeque deque;
+			/** @brief Ring of job slots this thread allocates its jobs from */
+			std::vector<Job> pool;
+			uint32_t poolIndex = 0;
+			std::thread thread;
+			Worker() : pool(poolSize) {}
+		};
+
+		std::vector<std::unique_ptr<Worker>> workers;
+		std::atomic<bool> destroying;
+		std::atomic<int32_t> queuedJobs;
+		std::atomic<uint32_t> sleepingWorkers;
+		std::mutex sleepMutex;
+		std::condition_variable sleepCondition;
+		/** @brief Non-worker thread currently using thread index 0 and its number of nested ExternalScopes */
+		std::atomic<std::thread::id> externalOwner;
+		uint32_t externalDepth = 0;
+		/** @brief Jobs that were dequeued before their dependency had finished */
+		std::deque<Job*> deferredJobs;
+		std::atomic<uint32_t> deferredCount;
+		std::mutex deferredMutex;
+
+		/** @brief Job system the calling thread is a worker of and its index in there */
+		struct ThreadContext
+		{
+			const JobSystem *system = nullptr;
+			uint32_t index = 0;
+		};
+
+		static ThreadContext& threadContext()
+		{
+			static thread_local ThreadContext context;
+			return context;
+		}
+
+		/**
+		* Gives a thread that is not a worker of this job system exclusive use of thread index 0 for its lifetime, no-op for workers
+		* Scopes can be nested (e.g. by jobs started from inside of a job that runs on a non-worker thread)
+		*/
+		class ExternalScope
+		{
+		private:
+			JobSystem &jobSystem;
+			bool external;
+		public:
+			ExternalScope(JobSystem &jobSystem) : jobSystem(jobSystem), external(threadContext().system != &jobSystem)
+			{
+				if (!external) {
+					return;
+				}
+				const std::thread::id self = std::this_thread::get_id();
+				if (jobSystem.externalOwner.load(std::memory_order_relaxed) != self) {
+					std::thread::id none;
+					while (!jobSystem.externalOwner.compare_exchange_weak(none, self, std::memory_order_acquire, std::memory_order_relaxed)) {
+						none = std::thread::id();
+						std::this_thread::yield();
+					}
+				}
+				jobSystem.externalDepth++;
+			}
+			~ExternalScope()
+			{
+				if (external && (--jobSystem.externalDepth == 0)) {
+					jobSystem.externalOwner.store(std::thread::id(), std::memory_order_release);
+				}
+			}
+		};
+
+		/** @brief Index of the calling thread inside of this job system, non-workers must be inside of an ExternalScope */
+		uint32_t threadIndex()
+		{
+			const ThreadContext &context = threadContext();
+			if (context.system == this) {
+				return context.index;
+			}
+			assert(externalOwner.load(std::memory_order_relaxed) == std::this_thread::get_id());
+			return 0;
+		}
+
+		Job* allocateJob()
+		{
+			Worker &worker = *workers[threadIndex()];
+			Job *job = &worker.pool[worker.poolIndex & (Worker::poolSize - 1)];
+			// All slots of the ring are still in flight, help out until the oldest one has finished
+			while (job->active.load(std::memory_order_acquire) != 0) {
+				if (!runPendingJob()) {
+					std::this_thread::yield();
+				}
+			}
+			worker.poolIndex++;
+			job->active.store(1, std::memory_order_relaxed);
+			return job;
+		}
+
+		void submit(Job *job)
+		{
+			if (job->counter) {
+				job->counter->fetch_add(1, std::memory_order_relaxed);
+			}
+			while (!workers[threadIndex()]->deque.push(job)) {
+				// Deque is full, help draining it before queuing more work
+				if (!runPendingJob()) {
+					std::this_thread::yield();
+				}
+			}
+			queuedJobs.fetch_add(1, std::memory_order_seq_cst);
+			if (sleepingWorkers.load(std::memory_order_seq_cst) > 0) {
+				std::lock_guard<std::mutex> lock(sleepMutex);
+				sleepCondition.notify_one();
+			}
+		}
+
+		Job* getJob()
+		{
+			const uint32_t index = threadIndex();
+			Job *job = workers[index]->deque.pop();
+			if (!job) {
+				// Own deque is empty, try to steal from the other threads
+				const uint32_t count = static_cast<uint32_t>(workers.size());
+				for (uint32_t i = 1; i < count; i++) {
+					job = workers[(index + i) % count]->deque.steal();
+					if (job) {
+						break;
+					}
+				}
+			}
+			if (job) {
+				queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+				if (job->dependency && (job->dependency->load(std::memory_order_acquire) > 0)) {
+					// Queue the job again behind the work it depends on instead of blocking this thread on it
+					deferJob(job);
+					job = nullptr;
+				}
+			}
+			if (!job && (deferredCount.load(std::memory_order_acquire) > 0)) {
+				job = takeDeferredJob();
+			}
+			return job;
+		}
+
+		void deferJob(Job *job)
+		{
+			std::lock_guard<std::mutex> lock(deferredMutex);
+			deferredJobs.push_back(job);
+			deferredCount.fetch_add(1, std::memory_order_release);
+			queuedJobs.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		/** @brief Remove the first deferred job whose dependency has finished, returns nullptr if there is none */
+		Job* takeDeferredJob()
+		{
+			std::lock_guard<std::mutex> lock(deferredMutex);
+			for (auto it = deferredJobs.begin(); it != deferredJobs.end(); ++it) {
+				Job *job = *it;
+				if (job->dependency->load(std::memory_order_acquire) == 0) {
+					deferredJobs.erase(it);
+					deferredCount.fetch_sub(1, std::memory_order_relaxed);
+					queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+					return job;
+				}
+			}
+			return nullptr;
+		}
+
+		void execute(Job *job)
+		{
+			job->function(*job);
+			if (job->destroy) {
+				job->destroy(*job);
+			}
+			JobCounter *counter = job->counter;
+			job->active.store(0, std::memory_order_release);
+			if (counter) {
+				counter->fetch_sub(1, std::memory_order_release);
+			}
+		}
+
+		/** @brief Run a single queued job on the calling thread, returns false if no job was available */
+		bool runPendingJob()
+		{
+			Job *job = getJob();
+			if (job) {
+				execute(job);
+				return true;
+			}
+			return false;
+		}
+
+		void workerLoop(uint32_t index)
+		{
+			threadContext().system = this;
+			threadContext().index = index;
+			uint32_t idleSpins = 0;
+			while (!destroying.load(std::memory_order_relaxed)) {
+				if (runPendingJob()) {
+					idleSpins = 0;
+					continue;
+				}
+				// Spin for a short while before going to sleep to keep latency low between bursts of jobs
+				if (++idleSpins < 64) {
+					std::this_thread::yield();
+					continue;
+				}
+				std::unique_lock<std::mutex> lock(sleepMutex);
+				sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+				sleepCondition.wait(lock, [this] { return (queuedJobs.load(std::memory_order_seq_cst) > 0) || destroying.load(); });
+				sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+				idleSpins = 0;
+			}
+		}
+
+	public:
+		/**
+		* Create the job system
+		*
+		* @param (Optional) workerCount Number of additional worker threads, threads waiting on a counter also run jobs in the meantime (Defaults to hardware concurrency - 1)
+		*
+		* @note Jobs may be started from any thread, threads that are not workers of this job system are serialized while they start or run jobs
+		*/
+		JobSystem(uint32_t workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1) : destroying(false), queuedJobs(0), sleepingWorkers(0), externalOwner(std::thread::id()), deferredCount(0)
+		{
+			for (uint32_t i = 0; i < workerCount + 1; i++) {
+				workers.push_back(std::unique_ptr<Worker>(new Worker()));
+			}
+			for (uint32_t i = 1; i < workerCount + 1; i++) {
+				workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+			}
+		}
+
+		/** @brief Stops all workers, jobs that have not been waited for are discarded */
+		~JobSystem()
+		{
+			{
+				std::lock_guard<std::mutex> lock(sleepMutex);
+				destroying = true;
+				sleepCondition.notify_all();
+			}
+			for (auto& worker : workers) {
+				if (worker->thread.joinable()) {
+					worker->thread.join();
+				}
+			}
+		}
+
+		/** @brief Number of threads running jobs (including the thread that created the job system) */
+		uint32_t getThreadCount()
+		{
+			return static_cast<uint32_t>(workers.size());
+		}
+
+		/** @brief Index of the calling thread (0 = not a worker thread), can be used to access per thread data from inside of a job */
+		uint32_t getThreadIndex()
+		{
+			const ThreadContext &context = threadContext();
+			return (context.system == this) ? context.index : 0;
+		}
+
+		/**
+		* Start a job
+		*
+		* @param function Callable to run, its captures must fit into the job's inline storage
+		* @param (Optional) counter Counter that is incremented now and decremented once the job has finished
+		* @param (Optional) dependency The job is not run before this counter has reached zero, threads skip over it instead of waiting
+		*/
+		template<typename F>
+		void run(F &&function, JobCounter *counter = nullptr, JobCounter *dependency = nullptr)
+		{
+			typedef typename std::decay<F>::type Callable;
+			static_assert(sizeof(Callable) <= Job::storageSize, "Job callable is too large for the job's inline storage, capture by reference or pointer instead");
+			static_assert(std::alignment_of<Callable>::value <= 16, "Job callable alignment is not supported");
+
+			ExternalScope scope(*this);
+			Job *job = allocateJob();
+			new (job->storage) Callable(std::forward<F>(function));
+			job->function = [](Job &job) { (*reinterpret_cast<Callable*>(job.storage))(); };
+			job->destroy = nullptr;
+			if (!std::is_trivially_destructible<Callable>::value) {
+				job->destroy = [](Job &job) { reinterpret_cast<Callable*>(job.storage)->~Callable(); };
+			}
+			job->counter = counter;
+			job->dependency = dependency;
+			submit(job);
+		}
+
+		/** @brief Block until the counter has reached zero, the calling thread runs queued jobs in the meantime */
+		void wait(JobCounter &counter)
+		{
+			while (counter.load(std::memory_order_acquire) > 0) {
+				bool ran;
+				{
+					// Released between jobs so other non-worker threads can make progress too
+					ExternalScope scope(*this);
+					ran = runPendingJob();
+				}
+				if (!ran) {
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		/**
+		* Run a function over a range of indices in parallel
+		* The range is split into chunks that are distributed across all threads, the call returns once all chunks have finished
+		*
+		* @param count Number of elements in the range [0, count)
+		* @param function Callable taking the first and one past the last index of a chunk (uint32_t begin, uint32_t end)
+		* @param (Optional) minChunkSize Lower limit for the number of elements per chunk, use larger values for cheap per element work (Defaults to 1)
+		*/
+		template<typename F>
+		void parallelFor(uint32_t count, F &&function, uint32_t minChunkSize = 1)
+		{
+			if (count == 0) {
+				return;
+			}
+			// Aim for a few chunks per thread so work stealing can balance uneven per element costs
+			const uint32_t targetChunks = getThreadCount() * 4;
+			const uint32_t chunkSize = std::max(std::max(minChunkSize, 1u), (count + targetChunks - 1) / targetChunks);
+			JobCounter counter(0);
+			typename std::remove_reference<F>::type *body = &function;
+			for (uint32_t begin = 0; begin < count; begin += chunkSize) {
+				const uint32_t end = std::min(begin + chunkSize, count);
+				run([body, begin, end] { (*body)(begin, end); }, &counter);
+			}
+			wait(counter);
+		}
+	};
+}
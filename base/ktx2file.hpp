@@ -0,0 +1,321 @@
+/*
+* KTX2 texture file reader
+*
+* The file is memory mapped and parsed in place. Levels without supercompression are accessed via pointers
+* into the mapping, Zstandard supercompressed levels are decoded straight into a caller provided destination
+* (e.g. staging memory). Every level is compressed separately, so levels can be decoded in parallel.
+*
+* Zstandard support requires building with USE_ZSTD (defines VKS_USE_ZSTD), BasisLZ and ZLIB supercompression
+* as well as 3D textures are not supported
+*
+* Copyright (C) 2016-2017 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+
+#include "vulkan/vulkan.h"
+#include "mappedfile.hpp"
+
+#if defined(VKS_USE_ZSTD)
+#include <zstd.h>
+#endif
+
+#if defined(__ANDROID__)
+#include <android/asset_manager.h>
+#include "VulkanAndroid.h"
+#endif
+
+namespace vks
+{
+	class Ktx2File
+	{
+	public:
+		enum SupercompressionScheme {
+			SUPERCOMPRESSION_NONE = 0,
+			SUPERCOMPRESSION_BASISLZ = 1,
+			SUPERCOMPRESSION_ZSTD = 2,
+			SUPERCOMPRESSION_ZLIB = 3
+		};
+
+		struct Header {
+			uint32_t vkFormat;
+			uint32_t typeSize;
+			uint32_t pixelWidth;
+			uint32_t pixelHeight;
+			uint32_t pixelDepth;
+			uint32_t layerCount;
+			uint32_t faceCount;
+			uint32_t levelCount;
+			uint32_t supercompressionScheme;
+		};
+
+	private:
+		struct Index {
+			uint32_t dfdByteOffset;
+			uint32_t dfdByteLength;
+			uint32_t kvdByteOffset;
+			uint32_t kvdByteLength;
+			uint64_t sgdByteOffset;
+			uint64_t sgdByteLength;
+		};
+
+		struct Level {
+			uint64_t byteOffset;
+			uint64_t byteLength;
+			uint64_t uncompressedByteLength;
+		};
+
+		vks::MappedFile file;
+#if defined(__ANDROID__)
+		AAsset *asset = nullptr;
+#endif
+		const unsigned char *fileData = nullptr;
+		size_t fileSize = 0;
+		Header header{};
+		std::vector<Level> levels;
+		std::string error;
+
+		/** @brief Validate the header and the level index */
+		bool parse()
+		{
+			static const unsigned char identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+			if ((fileSize < sizeof(identifier) + sizeof(Header) + sizeof(Index)) || (memcmp(fileData, identifier, sizeof(identifier)) != 0)) {
+				error = "not a KTX2 file";
+				return false;
+			}
+			memcpy(&header, fileData + sizeof(identifier), sizeof(Header));
+			if (header.vkFormat == VK_FORMAT_UNDEFINED) {
+				error = "files without a Vulkan format (e.g. Basis Universal) are not supported";
+				return false;
+			}
+			if ((header.pixelDepth > 1) || (header.pixelWidth == 0) || ((header.faceCount != 1) && (header.faceCount != 6))) {
+				error = "3D textures are not supported";
+				return false;
+			}
+			switch (header.supercompressionScheme) {
+			case SUPERCOMPRESSION_NONE:
+				break;
+			case SUPERCOMPRESSION_ZSTD:
+#if defined(VKS_USE_ZSTD)
+				break;
+#else
+				error = "Zstandard supercompression requires building with USE_ZSTD";
+				return false;
+#endif
+			default:
+				error = "unsupported supercompression scheme " + std::to_string(header.supercompressionScheme);
+				return false;
+			}
+
+			const size_t levelIndexOffset = sizeof(identifier) + sizeof(Header) + sizeof(Index);
+			if (levelIndexOffset + levelCount() * sizeof(Level) > fileSize) {
+				error = "truncated level index";
+				return false;
+			}
+			levels.resize(levelCount());
+			memcpy(levels.data(), fileData + levelIndexOffset, levels.size() * sizeof(Level));
+			for (auto &level : levels) {
+				if ((level.byteOffset + level.byteLength > fileSize) || (level.uncompressedByteLength % (static_cast<uint64_t>(layerCount()) * faceCount()) != 0)) {
+					error = "invalid level index";
+					return false;
+				}
+				if ((header.supercompressionScheme == SUPERCOMPRESSION_NONE) && (level.byteLength != level.uncompressedByteLength)) {
+					error = "invalid level index";
+					return false;
+				}
+			}
+			return true;
+		}
+
+	public:
+		Ktx2File() {}
+
+		~Ktx2File()
+		{
+			close();
+		}
+
+		Ktx2File(const Ktx2File&) = delete;
+		Ktx2File& operator=(const Ktx2File&) = delete;
+
+		/** @brief True if the file name has the .ktx2 extension */
+		static bool isKtx2(const std::string &filename)
+		{
+			return (filename.size() > 5) && (filename.compare(filename.size() - 5, 5, ".ktx2") == 0);
+		}
+
+		/**
+		* Map a KTX2 file and parse its header and level index
+		*
+		* @param filename Path of the file (or of the asset on Android)
+		* @param (Optional) asset On Android: Load the file from the apk's assets, otherwise from the file system (Defaults to true)
+		*
+		* @return False if the file can't be opened or isn't supported, see getError
+		*/
+		bool open(const std::string &filename, bool asset = true)
+		{
+			close();
+#if defined(__ANDROID__)
+			if (asset) {
+				// Uncompressed assets are mapped directly from the apk
+				this->asset = AAssetManager_open(androidApp->activity->assetManager, filename.c_str(), AASSET_MODE_BUFFER);
+				if (!this->asset) {
+					error = "could not open file";
+					return false;
+				}
+				fileData = static_cast<const unsigned char*>(AAsset_getBuffer(this->asset));
+				fileSize = static_cast<size_t>(AAsset_getLength(this->asset));
+			}
+			else
+#endif
+			{
+				if (!file.open(filename)) {
+					error = "could not open file";
+					return false;
+				}
+				fileData = file.data();
+				fileSize = file.size();
+			}
+			if (!fileData || !parse()) {
+				const std::string parseError = error;
+				close();
+				error = parseError;
+				return false;
+			}
+			return true;
+		}
+
+		void close()
+		{
+#if defined(__ANDROID__)
+			if (asset) {
+				AAsset_close(asset);
+				asset = nullptr;
+			}
+#endif
+			file.close();
+			fileData = nullptr;
+			fileSize = 0;
+			levels.clear();
+			error.clear();
+		}
+
+		bool isOpen() const
+		{
+			return fileData != nullptr;
+		}
+
+		/** @brief Reason for the last failed open */
+		const std::string& getError() const
+		{
+			return error;
+		}
+
+		const Header& getHeader() const
+		{
+			return header;
+		}
+
+		VkFormat getFormat() const
+		{
+			return static_cast<VkFormat>(header.vkFormat);
+		}
+
+		bool isSupercompressed() const
+		{
+			return header.supercompressionScheme != SUPERCOMPRESSION_NONE;
+		}
+
+		uint32_t width(uint32_t level = 0) const
+		{
+			return std::max(header.pixelWidth >> level, 1u);
+		}
+
+		uint32_t height(uint32_t level = 0) const
+		{
+			return std::max(header.pixelHeight >> level, 1u);
+		}
+
+		/** @brief Number of mip levels stored in the file (files that request runtime mip generation contain a single level) */
+		uint32_t levelCount() const
+		{
+			return std::max(header.levelCount, 1u);
+		}
+
+		uint32_t layerCount() const
+		{
+			return std::max(header.layerCount, 1u);
+		}
+
+		uint32_t faceCount() const
+		{
+			return header.faceCount;
+		}
+
+		/** @brief Size of the file (compressed size of all levels plus headers) */
+		size_t getFileSize() const
+		{
+			return fileSize;
+		}
+
+		/** @brief Uncompressed size of a level (all layers and faces) */
+		size_t levelSize(uint32_t level) const
+		{
+			return static_cast<size_t>(levels[level].uncompressedByteLength);
+		}
+
+		/** @brief Uncompressed size of a single layer or face of a level, layers and faces are stored back to back inside of a level (layer * faceCount + face) */
+		size_t faceSize(uint32_t level) const
+		{
+			return levelSize(level) / (static_cast<size_t>(layerCount()) * faceCount());
+		}
+
+		/** @brief Uncompressed size of all levels */
+		size_t dataSize() const
+		{
+			size_t size = 0;
+			for (uint32_t i = 0; i < levelCount(); i++) {
+				size += levelSize(i);
+			}
+			return size;
+		}
+
+		/** @brief Pointer to the data of a level inside of the mapping, only valid for files without supercompression */
+		const unsigned char* levelData(uint32_t level) const
+		{
+			return isSupercompressed() ? nullptr : fileData + levels[level].byteOffset;
+		}
+
+		/**
+		* Write the uncompressed data of a level to its destination, different levels may be decoded concurrently from different threads
+		*
+		* @param level Mip level
+		* @param dst Destination, must hold levelSize(level) bytes
+		*
+		* @return False if the level's data is corrupt
+		*/
+		bool decodeLevel(uint32_t level, void *dst) const
+		{
+			const Level &l = levels[level];
+			const unsigned char *src = fileData + l.byteOffset;
+			if (!isSupercompressed()) {
+				memcpy(dst, src, static_cast<size_t>(l.byteLength));
+				return true;
+			}
+#if defined(VKS_USE_ZSTD)
+			const size_t result = ZSTD_decompress(dst, static_cast<size_t>(l.uncompressedByteLength), src, static_cast<size_t>(l.byteLength));
+			return !ZSTD_isError(result) && (result == l.uncompressedByteLength);
+#else
+			return false;
+#endif
+		}
+	};
+}
@@ -0,0 +1,306 @@
+/*
+* KTX (version 1) texture file reader and writer
+*
+* The file is memory mapped and parsed in place, image data of the single mip levels, array layers and cube faces
+* is accessed via pointers into the mapping, so it can be copied straight to its destination (e.g. a staging buffer)
+* without reading the whole file into an intermediate heap copy first
+*
+* Writing is limited to 2D textures (with mip levels), e.g. for caching images that have been compressed at runtime
+*
+* Copyright (C) 2016-2017 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#include "mappedfile.hpp"
+
+#if defined(__ANDROID__)
+#include <android/asset_manager.h>
+#include "VulkanAndroid.h"
+#endif
+
+namespace vks
+{
+	class KtxFile
+	{
+	public:
+		struct Header {
+			uint32_t endianness;
+			uint32_t glType;
+			uint32_t glTypeSize;
+			uint32_t glFormat;
+			uint32_t glInternalFormat;
+			uint32_t glBaseInternalFormat;
+			uint32_t pixelWidth;
+			uint32_t pixelHeight;
+			uint32_t pixelDepth;
+			uint32_t numberOfArrayElements;
+			uint32_t numberOfFaces;
+			uint32_t numberOfMipmapLevels;
+			uint32_t bytesOfKeyValueData;
+		};
+
+	private:
+		struct Level {
+			uint32_t width;
+			uint32_t height;
+			const unsigned char *data;
+			// Size of a single layer or face
+			size_t faceSize;
+			// Distance between two layers or faces (includes the padding of non-array cube map faces)
+			size_t faceStride;
+		};
+
+		vks::MappedFile file;
+#if defined(__ANDROID__)
+		AAsset *asset = nullptr;
+#endif
+		const unsigned char *fileData = nullptr;
+		size_t fileSize = 0;
+		Header header{};
+		std::vector<Level> levels;
+
+		static size_t align4(size_t value)
+		{
+			return (value + 3) & ~static_cast<size_t>(3);
+		}
+
+		static const unsigned char* getIdentifier()
+		{
+			static const unsigned char identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x31, 0x31, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+			return identifier;
+		}
+
+		/** @brief Validate the header and collect the image data locations of all mip levels */
+		bool parse()
+		{
+			const size_t identifierSize = 12;
+			if ((fileSize < identifierSize + sizeof(Header)) || (memcmp(fileData, getIdentifier(), identifierSize) != 0)) {
+				return false;
+			}
+			memcpy(&header, fileData + identifierSize, sizeof(Header));
+			// Files written with a different byte order and 3D textures are left to other loaders
+			if ((header.endianness != 0x04030201) || (header.pixelDepth > 1) || (header.pixelWidth == 0)) {
+				return false;
+			}
+			if ((header.numberOfFaces != 1) && (header.numberOfFaces != 6)) {
+				return false;
+			}
+
+			const bool nonArrayCubeMap = (header.numberOfFaces == 6) && (header.numberOfArrayElements == 0);
+			const size_t facesPerLevel = static_cast<size_t>(layerCount()) * faceCount();
+
+			size_t offset = identifierSize + sizeof(Header) + header.bytesOfKeyValueData;
+			for (uint32_t i = 0; i < levelCount(); i++) {
+				if (offset + sizeof(uint32_t) > fileSize) {
+					return false;
+				}
+				uint32_t imageSize;
+				memcpy(&imageSize, fileData + offset, sizeof(uint32_t));
+				offset += sizeof(uint32_t);
+
+				Level level;
+				level.width = std::max(header.pixelWidth >> i, 1u);
+				level.height = std::max(header.pixelHeight >> i, 1u);
+				level.data = fileData + offset;
+				if (nonArrayCubeMap) {
+					// imageSize is the size of a single face, faces are padded to four bytes
+					level.faceSize = imageSize;
+					level.faceStride = align4(imageSize);
+				} else {
+					level.faceSize = imageSize / facesPerLevel;
+					level.faceStride = level.faceSize;
+				}
+				const size_t levelSize = level.faceStride * facesPerLevel;
+				if (offset + levelSize > fileSize) {
+					return false;
+				}
+				levels.push_back(level);
+				offset = align4(offset + levelSize);
+			}
+			return true;
+		}
+
+	public:
+		KtxFile() {}
+
+		~KtxFile()
+		{
+			close();
+		}
+
+		KtxFile(const KtxFile&) = delete;
+		KtxFile& operator=(const KtxFile&) = delete;
+
+		/**
+		* Map a KTX file and parse its header
+		*
+		* @param filename Path of the file (or of the asset on Android)
+		* @param (Optional) asset On Android: Load the file from the apk's assets, otherwise from the file system (Defaults to true)
+		*
+		* @return False if the file can't be opened or isn't a valid (little endian, 1D/2D) KTX file
+		*/
+		bool open(const std::string &filename, bool asset = true)
+		{
+			close();
+#if defined(__ANDROID__)
+			if (asset) {
+				// Uncompressed assets are mapped directly from the apk
+				this->asset = AAssetManager_open(androidApp->activity->assetManager, filename.c_str(), AASSET_MODE_BUFFER);
+				if (!this->asset) {
+					return false;
+				}
+				fileData = static_cast<const unsigned char*>(AAsset_getBuffer(this->asset));
+				fileSize = static_cast<size_t>(AAsset_getLength(this->asset));
+			}
+			else
+#endif
+			{
+				if (!file.open(filename)) {
+					return false;
+				}
+				fileData = file.data();
+				fileSize = file.size();
+			}
+			if (!fileData || !parse()) {
+				close();
+				return false;
+			}
+			return true;
+		}
+
+		void close()
+		{
+#if defined(__ANDROID__)
+			if (asset) {
+				AAsset_close(asset);
+				asset = nullptr;
+			}
+#endif
+			file.close();
+			fileData = nullptr;
+			fileSize = 0;
+			levels.clear();
+		}
+
+		bool isOpen() const
+		{
+			return fileData != nullptr;
+		}
+
+		const Header& getHeader() const
+		{
+			return header;
+		}
+
+		uint32_t width(uint32_t level = 0) const
+		{
+			return levels[level].width;
+		}
+
+		uint32_t height(uint32_t level = 0) const
+		{
+			return levels[level].height;
+		}
+
+		/** @brief Number of mip levels stored in the file (files that request runtime mip generation contain a single level) */
+		uint32_t levelCount() const
+		{
+			return std::max(header.numberOfMipmapLevels, 1u);
+		}
+
+		uint32_t layerCount() const
+		{
+			return std::max(header.numberOfArrayElements, 1u);
+		}
+
+		uint32_t faceCount() const
+		{
+			return header.numberOfFaces;
+		}
+
+		size_t getFileSize() const
+		{
+			return fileSize;
+		}
+
+		/** @brief Size of the image data of all levels, layers and faces (excluding padding) */
+		size_t dataSize() const
+		{
+			size_t size = 0;
+			for (auto &level : levels) {
+				size += level.faceSize * layerCount() * faceCount();
+			}
+			return size;
+		}
+
+		/**
+		* Image data of a single mip level of an array layer or cube face
+		*
+		* @param level Mip level
+		* @param layer Array layer
+		* @param face Cube map face (0 for non cube map textures)
+		* @param size Receives the size of the image data in bytes
+		*
+		* @return Pointer into the mapped file, valid until the file is closed
+		*/
+		const unsigned char* imageData(uint32_t level, uint32_t layer, uint32_t face, size_t *size) const
+		{
+			const Level &l = levels[level];
+			*size = l.faceSize;
+			return l.data + (static_cast<size_t>(layer) * faceCount() + face) * l.faceStride;
+		}
+
+		/**
+		* Write a 2D texture with a mip chain to a KTX file
+		*
+		* @param filename Path of the file to write
+		* @param glInternalFormat OpenGL internal format of the image data (e.g. a compressed format)
+		* @param glBaseInternalFormat OpenGL base internal format (e.g. GL_RGBA)
+		* @param width Width of the first mip level
+		* @param height Height of the first mip level
+		* @param levelData Image data of the mip levels
+		* @param levelSizes Sizes of the mip levels in bytes
+		*
+		* @return False if the file could not be written
+		*/
+		static bool write(const std::string &filename, uint32_t glInternalFormat, uint32_t glBaseInternalFormat, uint32_t width, uint32_t height, const std::vector<const void*> &levelData, const std::vector<size_t> &levelSizes)
+		{
+			assert(levelData.size() == levelSizes.size());
+			std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+			if (!file.is_open()) {
+				return false;
+			}
+			Header header{};
+			header.endianness = 0x04030201;
+			// Compressed formats have no type, their type size is 1
+			header.glTypeSize = 1;
+			header.glInternalFormat = glInternalFormat;
+			header.glBaseInternalFormat = glBaseInternalFormat;
+			header.pixelWidth = width;
+			header.pixelHeight = height;
+			header.numberOfFaces = 1;
+			header.numberOfMipmapLevels = static_cast<uint32_t>(levelData.size());
+			file.write(reinterpret_cast<const char*>(getIdentifier()), 12);
+			file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+			const char padding[3] = {};
+			for (size_t i = 0; i < levelData.size(); i++) {
+				const uint32_t imageSize = static_cast<uint32_t>(levelSizes[i]);
+				file.write(reinterpret_cast<const char*>(&imageSize), sizeof(uint32_t));
+				file.write(static_cast<const char*>(levelData[i]), levelSizes[i]);
+				file.write(padding, align4(levelSizes[i]) - levelSizes[i]);
+			}
+			return file.good();
+		}
+	};
+}
@@ -0,0 +1,165 @@
+/*
+* Read-only memory mapped file
+*
+* Maps a whole file into the address space of the process, so file contents can be parsed
+* in place without reading them into an intermediate buffer first
+*
+* Copyright (C) 2016-2017 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace vks
+{
+	class MappedFile
+	{
+	private:
+		const unsigned char *mappedData = nullptr;
+		size_t mappedSize = 0;
+#if defined(_WIN32)
+		HANDLE file = INVALID_HANDLE_VALUE;
+		HANDLE mapping = NULL;
+#endif
+
+	public:
+		MappedFile() {}
+
+		MappedFile(const std::string &filename)
+		{
+			open(filename);
+		}
+
+		~MappedFile()
+		{
+			close();
+		}
+
+		// The mapping is owned by a single object
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		/**
+		* Map a file into memory
+		*
+		* @param filename Path of the file to map
+		*
+		* @return True if the file could be mapped, empty files can't be mapped
+		*/
+		bool open(const std::string &filename)
+		{
+			close();
+#if defined(_WIN32)
+			file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+			if (file == INVALID_HANDLE_VALUE) {
+				return false;
+			}
+			LARGE_INTEGER fileSize;
+			if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart == 0)) {
+				close();
+				return false;
+			}
+			mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mapping == NULL) {
+				close();
+				return false;
+			}
+			mappedData = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+			if (!mappedData) {
+				close();
+				return false;
+			}
+			mappedSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+			const int fd = ::open(filename.c_str(), O_RDONLY);
+			if (fd < 0) {
+				return false;
+			}
+			struct stat fileStat;
+			if ((fstat(fd, &fileStat) != 0) || (fileStat.st_size == 0)) {
+				::close(fd);
+				return false;
+			}
+			void *data = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			// The mapping stays valid after the descriptor has been closed
+			::close(fd);
+			if (data == MAP_FAILED) {
+				return false;
+			}
+			// Files are usually parsed front to back, let the kernel read ahead
+			madvise(data, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+			mappedData = static_cast<const unsigned char*>(data);
+			mappedSize = static_cast<size_t>(fileStat.st_size);
+#endif
+			return true;
+		}
+
+		/** @brief Unmap the file, pointers into the file's data become invalid */
+		void close()
+		{
+#if defined(_WIN32)
+			if (mappedData) {
+				UnmapViewOfFile(mappedData);
+			}
+			if (mapping != NULL) {
+				CloseHandle(mapping);
+				mapping = NULL;
+			}
+			if (file != INVALID_HANDLE_VALUE) {
+				CloseHandle(file);
+				file = INVALID_HANDLE_VALUE;
+			}
+#else
+			if (mappedData) {
+				munmap(const_cast<unsigned char*>(mappedData), mappedSize);
+			}
+#endif
+			mappedData = nullptr;
+			mappedSize = 0;
+		}
+
+		bool isOpen() const
+		{
+			return mappedData != nullptr;
+		}
+
+		const unsigned char* data() const
+		{
+			return mappedData;
+		}
+
+		size_t size() const
+		{
+			return mappedSize;
+		}
+	};
+
+	/**
+	* Name for a temporary file next to the given file, unique across processes and threads
+	* Files that may be mapped by other processes are written to such a file first and then renamed into place
+	*/
+	inline std::string getUniqueTempFilename(const std::string &filename)
+	{
+#if defined(_WIN32)
+		const unsigned long processId = GetCurrentProcessId();
+#else
+		const unsigned long processId = static_cast<unsigned long>(getpid());
+#endif
+		static std::atomic<uint32_t> counter(0);
+		return filename + "." + std::to_string(processId) + "." + std::to_string(counter.fetch_add(1)) + ".tmp";
+	}
+}
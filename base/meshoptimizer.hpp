@@ -0,0 +1,642 @@
+/*
+* Mesh optimization functions
+*
+* Post-load geometry optimizations for indexed triangle lists:
+* - Vertex welding (removes bitwise identical vertices)
+* - Triangle reordering for the post-transform vertex cache ("Tipsify", Sander et al. 2007)
+* - Cluster reordering to reduce overdraw (clusters facing outwards are drawn first)
+* - Vertex reordering in order of first use for vertex fetch locality
+* - Vertex cache statistics (ACMR and ATVR)
+* - Meshlet (cluster) generation with bounding spheres and normal cones for cluster culling
+*
+* Vertices are treated as opaque blocks of stride bytes, only the overdraw optimization and the meshlet bounds read positions
+*
+* Copyright (C) 2016-2017 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <stdint.h>
+#include <assert.h>
+
+namespace vks
+{
+	namespace meshopt
+	{
+		/** @brief Optimizations applied by the model loaders */
+		enum OptimizeFlagBits {
+			OPTIMIZE_WELD = 0x1,
+			OPTIMIZE_VERTEX_CACHE = 0x2,
+			OPTIMIZE_OVERDRAW = 0x4,
+			OPTIMIZE_VERTEX_FETCH = 0x8,
+			// Use 16 bit indices if all vertices of the model can be addressed with them
+			OPTIMIZE_INDEX_16BIT = 0x10,
+			OPTIMIZE_ALL = 0x1f
+		};
+
+		/** @brief Default number of entries of the simulated FIFO post-transform vertex cache */
+		const uint32_t defaultCacheSize = 16;
+
+		struct VertexCacheStatistics {
+			/** @brief Average cache miss ratio, transformed vertices per triangle (1.0 is optimal for large meshes, 3.0 is the worst case) */
+			float acmr = 0.0f;
+			/** @brief Average transform to vertex ratio, transformed vertices per unique vertex (1.0 is optimal) */
+			float atvr = 0.0f;
+		};
+
+		/**
+		* Simulate a FIFO post-transform vertex cache for an index list
+		*
+		* @param indices Triangle list indices
+		* @param indexCount Number of indices
+		* @param vertexCount Number of vertices referenced by the indices (indices must be smaller)
+		* @param (Optional) cacheSize Number of cache entries (Defaults to 16)
+		*/
+		inline VertexCacheStatistics analyzeVertexCache(const uint32_t *indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize = defaultCacheSize)
+		{
+			VertexCacheStatistics statistics;
+			if (indexCount < 3) {
+				return statistics;
+			}
+			// A vertex is in the cache if fewer than cacheSize vertices have been transformed since it was transformed itself
+			std::vector<uint32_t> cacheTime(vertexCount, 0);
+			std::vector<uint8_t> used(vertexCount, 0);
+			uint32_t time = cacheSize + 1;
+			uint32_t misses = 0;
+			uint32_t uniqueVertices = 0;
+			for (size_t i = 0; i < indexCount; i++) {
+				const uint32_t v = indices[i];
+				assert(v < vertexCount);
+				if (time - cacheTime[v] > cacheSize) {
+					cacheTime[v] = time++;
+					misses++;
+				}
+				if (!used[v]) {
+					used[v] = 1;
+					uniqueVertices++;
+				}
+			}
+			statistics.acmr = (float)misses / (float)(indexCount / 3);
+			statistics.atvr = (uniqueVertices > 0) ? (float)misses / (float)uniqueVertices : 0.0f;
+			return statistics;
+		}
+
+		/**
+		* Remove bitwise identical vertices in place and remap the indices
+		*
+		* @param vertices Vertex data, unique vertices are moved to the front keeping their order
+		* @param vertexCount Number of vertices
+		* @param stride Size of a vertex in bytes
+		* @param indices Indices to remap
+		* @param indexCount Number of indices
+		*
+		* @return Number of unique vertices
+		*/
+		inline uint32_t weldVertices(void *vertices, uint32_t vertexCount, uint32_t stride, uint32_t *indices, size_t indexCount)
+		{
+			unsigned char *data = static_cast<unsigned char*>(vertices);
+			// Open addressing hash table of unique vertex indices, kept at most half full
+			uint32_t tableSize = 1;
+			while (tableSize < vertexCount * 2) {
+				tableSize *= 2;
+			}
+			const uint32_t empty = ~0u;
+			std::vector<uint32_t> table(tableSize, empty);
+			std::vector<uint32_t> remap(vertexCount);
+			uint32_t uniqueCount = 0;
+			for (uint32_t v = 0; v < vertexCount; v++) {
+				const unsigned char *vertex = data + (size_t)v * stride;
+				// FNV-1a
+				uint32_t hash = 2166136261u;
+				for (uint32_t b = 0; b < stride; b++) {
+					hash = (hash ^ vertex[b]) * 16777619u;
+				}
+				uint32_t slot = hash & (tableSize - 1);
+				while (table[slot] != empty && memcmp(data + (size_t)table[slot] * stride, vertex, stride) != 0) {
+					slot = (slot + 1) & (tableSize - 1);
+				}
+				if (table[slot] == empty) {
+					// The unique vertex moves to the next free position, which never lies behind the current one
+					if (uniqueCount != v) {
+						memcpy(data + (size_t)uniqueCount * stride, vertex, stride);
+					}
+					table[slot] = uniqueCount++;
+				}
+				remap[v] = table[slot];
+			}
+			for (size_t i = 0; i < indexCount; i++) {
+				indices[i] = remap[indices[i]];
+			}
+			return uniqueCount;
+		}
+
+		/**
+		* Reorder triangles for the post-transform vertex cache ("Tipsify", linear time)
+		*
+		* @param indices Triangle list indices, reordered in place
+		* @param indexCount Number of indices
+		* @param vertexCount Number of vertices referenced by the indices
+		* @param (Optional) cacheSize Number of cache entries to optimize for (Defaults to 16)
+		*/
+		inline void optimizeVertexCache(uint32_t *indices, size_t indexCount, uint32_t vertexCount, uint32_t cacheSize = defaultCacheSize)
+		{
+			const size_t triangleCount = indexCount / 3;
+			if (triangleCount == 0) {
+				return;
+			}
+
+			// Vertex to triangle adjacency
+			std::vector<uint32_t> liveTriangles(vertexCount, 0);
+			for (size_t i = 0; i < triangleCount * 3; i++) {
+				liveTriangles[indices[i]]++;
+			}
+			std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+			for (uint32_t v = 0; v < vertexCount; v++) {
+				adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+			}
+			std::vector<uint32_t> adjacency(triangleCount * 3);
+			{
+				std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (size_t t = 0; t < triangleCount; t++) {
+					for (uint32_t k = 0; k < 3; k++) {
+						adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+					}
+				}
+			}
+
+			std::vector<uint32_t> cacheTime(vertexCount, 0);
+			std::vector<uint8_t> emitted(triangleCount, 0);
+			std::vector<uint32_t> deadEnd;
+			std::vector<uint32_t> candidates;
+			std::vector<uint32_t> output;
+			output.reserve(triangleCount * 3);
+			deadEnd.reserve(triangleCount * 3);
+
+			uint32_t time = cacheSize + 1;
+			uint32_t cursor = 0;
+			int64_t fanning = indices[0];
+
+			while (fanning >= 0) {
+				const uint32_t f = static_cast<uint32_t>(fanning);
+				candidates.clear();
+				// Emit all remaining triangles around the fanning vertex
+				for (uint32_t a = adjacencyOffsets[f]; a < adjacencyOffsets[f + 1]; a++) {
+					const uint32_t t = adjacency[a];
+					if (emitted[t]) {
+						continue;
+					}
+					emitted[t] = 1;
+					for (uint32_t k = 0; k < 3; k++) {
+						const uint32_t v = indices[t * 3 + k];
+						output.push_back(v);
+						deadEnd.push_back(v);
+						candidates.push_back(v);
+						liveTriangles[v]--;
+						if (time - cacheTime[v] > cacheSize) {
+							cacheTime[v] = time++;
+						}
+					}
+				}
+
+				// Pick the next fanning vertex: the one that stays longest in the cache after its remaining triangles have been emitted
+				fanning = -1;
+				int64_t bestPriority = -1;
+				for (auto v : candidates) {
+					if (liveTriangles[v] == 0) {
+						continue;
+					}
+					int64_t priority = 0;
+					if (time - cacheTime[v] + 2 * liveTriangles[v] <= cacheSize) {
+						priority = time - cacheTime[v];
+					}
+					if (priority > bestPriority) {
+						bestPriority = priority;
+						fanning = v;
+					}
+				}
+
+				if (fanning < 0) {
+					// Dead end, continue with a recently used vertex or the next vertex in input order that still has triangles
+					while (!deadEnd.empty()) {
+						const uint32_t v = deadEnd.back();
+						deadEnd.pop_back();
+						if (liveTriangles[v] > 0) {
+							fanning = v;
+							break;
+						}
+					}
+					while (fanning < 0 && cursor < vertexCount) {
+						if (liveTriangles[cursor] > 0) {
+							fanning = cursor;
+						}
+						cursor++;
+					}
+				}
+			}
+
+			assert(output.size() == triangleCount * 3);
+			memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+		}
+
+		/**
+		* Reorder clusters of triangles to reduce overdraw, should be run after optimizeVertexCache
+		* The index list is split into clusters where the cache order restarts (triangles without any cached vertex),
+		* clusters are then sorted so that the ones facing away from the mesh center are drawn first, as they are more likely to occlude others
+		*
+		* @param indices Triangle list indices, reordered in place
+		* @param indexCount Number of indices
+		* @param positions Pointer to the position (three floats) of the first vertex
+		* @param positionStride Distance between two positions in bytes
+		* @param vertexCount Number of vertices referenced by the indices
+		* @param (Optional) cacheSize Number of cache entries used to find the cluster boundaries (Defaults to 16)
+		*/
+		inline void optimizeOverdraw(uint32_t *indices, size_t indexCount, const void *positions, uint32_t positionStride, uint32_t vertexCount, uint32_t cacheSize = defaultCacheSize)
+		{
+			const size_t triangleCount = indexCount / 3;
+			if (triangleCount < 2) {
+				return;
+			}
+			const unsigned char *positionData = static_cast<const unsigned char*>(positions);
+			auto position = [&](uint32_t v, float *p) {
+				memcpy(p, positionData + (size_t)v * positionStride, 3 * sizeof(float));
+			};
+
+			// Find the cluster boundaries
+			std::vector<uint32_t> clusterStarts;
+			std::vector<uint32_t> cacheTime(vertexCount, 0);
+			uint32_t time = cacheSize + 1;
+			for (size_t t = 0; t < triangleCount; t++) {
+				uint32_t misses = 0;
+				for (uint32_t k = 0; k < 3; k++) {
+					const uint32_t v = indices[t * 3 + k];
+					if (time - cacheTime[v] > cacheSize) {
+						cacheTime[v] = time++;
+						misses++;
+					}
+				}
+				if (t == 0 || misses == 3) {
+					clusterStarts.push_back(static_cast<uint32_t>(t));
+				}
+			}
+			if (clusterStarts.size() < 2) {
+				return;
+			}
+
+			// Area weighted centroid of the whole mesh and of each cluster, and the area weighted normal of each cluster
+			struct Cluster {
+				uint32_t start;
+				uint32_t count;
+				float sortKey;
+			};
+			std::vector<Cluster> clusters(clusterStarts.size());
+			std::vector<float> clusterData(clusterStarts.size() * 7, 0.0f);
+			float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+			float meshArea = 0.0f;
+			for (size_t c = 0; c < clusterStarts.size(); c++) {
+				clusters[c].start = clusterStarts[c];
+				clusters[c].count = ((c + 1 < clusterStarts.size()) ? clusterStarts[c + 1] : static_cast<uint32_t>(triangleCount)) - clusterStarts[c];
+				float *data = &clusterData[c * 7];
+				for (uint32_t t = clusters[c].start; t < clusters[c].start + clusters[c].count; t++) {
+					float p0[3], p1[3], p2[3];
+					position(indices[t * 3], p0);
+					position(indices[t * 3 + 1], p1);
+					position(indices[t * 3 + 2], p2);
+					const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+					const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+					const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+					// Length of the cross product is twice the triangle's area, which cancels out
+					const float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+					for (uint32_t i = 0; i < 3; i++) {
+						const float center = (p0[i] + p1[i] + p2[i]) / 3.0f;
+						data[i] += center * area;
+						data[3 + i] += n[i];
+						meshCentroid[i] += center * area;
+					}
+					data[6] += area;
+					meshArea += area;
+				}
+			}
+			if (meshArea <= 0.0f) {
+				return;
+			}
+			for (uint32_t i = 0; i < 3; i++) {
+				meshCentroid[i] /= meshArea;
+			}
+			for (size_t c = 0; c < clusters.size(); c++) {
+				const float *data = &clusterData[c * 7];
+				clusters[c].sortKey = 0.0f;
+				if (data[6] <= 0.0f) {
+					continue;
+				}
+				const float normalLength = sqrtf(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+				if (normalLength <= 0.0f) {
+					continue;
+				}
+				for (uint32_t i = 0; i < 3; i++) {
+					clusters[c].sortKey += (data[i] / data[6] - meshCentroid[i]) * (data[3 + i] / normalLength);
+				}
+			}
+
+			std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) { return a.sortKey > b.sortKey; });
+
+			std::vector<uint32_t> output;
+			output.reserve(triangleCount * 3);
+			for (auto& cluster : clusters) {
+				output.insert(output.end(), indices + cluster.start * 3, indices + (cluster.start + cluster.count) * 3);
+			}
+			memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+		}
+
+		/**
+		* Reorder vertices in the order they are first referenced by the indices and drop unreferenced vertices
+		*
+		* @param vertices Vertex data, reordered in place
+		* @param vertexCount Number of vertices
+		* @param stride Size of a vertex in bytes
+		* @param indices Indices to remap
+		* @param indexCount Number of indices
+		*
+		* @return Number of referenced vertices
+		*/
+		inline uint32_t optimizeVertexFetch(void *vertices, uint32_t vertexCount, uint32_t stride, uint32_t *indices, size_t indexCount)
+		{
+			unsigned char *data = static_cast<unsigned char*>(vertices);
+			const uint32_t unused = ~0u;
+			std::vector<uint32_t> remap(vertexCount, unused);
+			std::vector<unsigned char> reordered;
+			reordered.reserve((size_t)vertexCount * stride);
+			uint32_t nextVertex = 0;
+			for (size_t i = 0; i < indexCount; i++) {
+				const uint32_t v = indices[i];
+				if (remap[v] == unused) {
+					remap[v] = nextVertex++;
+					reordered.insert(reordered.end(), data + (size_t)v * stride, data + (size_t)(v + 1) * stride);
+				}
+				indices[i] = remap[v];
+			}
+			memcpy(data, reordered.data(), reordered.size());
+			return nextVertex;
+		}
+
+		/** @brief Default meshlet limits, small enough for the vertices of a meshlet to stay in the post transform cache of most GPUs */
+		const uint32_t defaultMeshletMaxVertices = 64;
+		const uint32_t defaultMeshletMaxTriangles = 124;
+
+		/**
+		* Cluster of triangles stored as a contiguous index range, so each meshlet can be drawn with a single (indirect) draw
+		* Layout matches a std430 shader storage buffer struct (uvec4, vec4, vec4)
+		*/
+		struct Meshlet {
+			uint32_t firstIndex;
+			uint32_t indexCount;
+			uint32_t vertexCount;
+			uint32_t _pad0;
+			/** @brief Bounding sphere of the meshlet's vertices */
+			float center[3];
+			float radius;
+			/**
+			* @brief Cone containing the normals of all triangles in the meshlet
+			* The meshlet is facing away from a viewer at c if dot(center - c, coneAxis) >= coneCutoff * length(center - c) + radius * (1 + coneCutoff)
+			* Meshlets that can't be rejected by their normals have a zero axis and a cutoff of one, which never passes the test
+			*/
+			float coneAxis[3];
+			float coneCutoff;
+		};
+
+		/**
+		* Split a triangle list into meshlets of bounded vertex and triangle count
+		* Meshlets are grown greedily from a seed triangle over adjacent triangles, preferring triangles that add the fewest new vertices
+		* The triangles are reordered so that each meshlet is a contiguous index range, which invalidates a previous overdraw optimization
+		*
+		* @param indices Triangle list indices, reordered in place
+		* @param indexCount Number of indices
+		* @param firstIndex Offset of the indices in the model's index buffer, added to the meshlets' first index
+		* @param positions Pointer to the position (three floats) of the first vertex
+		* @param positionStride Distance between two positions in bytes
+		* @param clockwise True if the cross product of a triangle's edges points to the back side of the triangle (clockwise winding seen from the outside)
+		* @param meshlets Meshlets are appended to this list
+		* @param (Optional) maxVertices Maximum number of unique vertices per meshlet (Defaults to 64)
+		* @param (Optional) maxTriangles Maximum number of triangles per meshlet (Defaults to 124)
+		*
+		* @return Number of meshlets created
+		*/
+		inline uint32_t buildMeshlets(uint32_t *indices, size_t indexCount, uint32_t firstIndex, const void *positions, uint32_t positionStride, bool clockwise, std::vector<Meshlet> &meshlets, uint32_t maxVertices = defaultMeshletMaxVertices, uint32_t maxTriangles = defaultMeshletMaxTriangles)
+		{
+			const size_t triangleCount = indexCount / 3;
+			if (triangleCount == 0) {
+				return 0;
+			}
+			assert(maxVertices >= 3 && maxTriangles >= 1);
+			const unsigned char *positionData = static_cast<const unsigned char*>(positions);
+			auto position = [&](uint32_t v, float *p) {
+				memcpy(p, positionData + (size_t)v * positionStride, 3 * sizeof(float));
+			};
+
+			// Vertex to triangle adjacency, indexed relative to the lowest referenced vertex
+			const uint32_t minVertex = *std::min_element(indices, indices + indexCount);
+			const uint32_t maxVertex = *std::max_element(indices, indices + indexCount);
+			const uint32_t vertexRange = maxVertex - minVertex + 1;
+			std::vector<uint32_t> adjacencyOffsets(vertexRange + 1, 0);
+			for (size_t i = 0; i < indexCount; i++) {
+				adjacencyOffsets[indices[i] - minVertex + 1]++;
+			}
+			for (uint32_t v = 0; v < vertexRange; v++) {
+				adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+			}
+			std::vector<uint32_t> adjacency(indexCount);
+			{
+				std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (size_t t = 0; t < triangleCount; t++) {
+					for (uint32_t k = 0; k < 3; k++) {
+						adjacency[fill[indices[t * 3 + k] - minVertex]++] = static_cast<uint32_t>(t);
+					}
+				}
+			}
+
+			// Unit normals of the front faces, degenerate triangles get a zero normal
+			std::vector<float> normals(triangleCount * 3, 0.0f);
+			for (size_t t = 0; t < triangleCount; t++) {
+				float p0[3], p1[3], p2[3];
+				position(indices[t * 3 + 0], p0);
+				position(indices[t * 3 + 1], p1);
+				position(indices[t * 3 + 2], p2);
+				const float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				const float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+				float n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+				const float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (length > 0.0f) {
+					const float scale = (clockwise ? -1.0f : 1.0f) / length;
+					for (uint32_t k = 0; k < 3; k++) {
+						normals[t * 3 + k] = n[k] * scale;
+					}
+				}
+			}
+
+			const uint32_t unused = ~0u;
+			std::vector<bool> emitted(triangleCount, false);
+			// Id of the last meshlet that used a vertex
+			std::vector<uint32_t> vertexMeshlet(vertexRange, unused);
+			std::vector<uint32_t> output;
+			output.reserve(triangleCount * 3);
+			std::vector<uint32_t> candidates;
+			std::vector<uint32_t> meshletTriangles;
+			std::vector<uint32_t> meshletVertices;
+			const uint32_t meshletsBefore = static_cast<uint32_t>(meshlets.size());
+
+			size_t seed = 0;
+			while (true) {
+				while (seed < triangleCount && emitted[seed]) {
+					seed++;
+				}
+				if (seed == triangleCount) {
+					break;
+				}
+
+				const uint32_t meshletId = static_cast<uint32_t>(meshlets.size());
+				meshletTriangles.clear();
+				meshletVertices.clear();
+				candidates.clear();
+
+				auto newVertices = [&](size_t t) {
+					uint32_t count = 0;
+					for (uint32_t k = 0; k < 3; k++) {
+						count += (vertexMeshlet[indices[t * 3 + k] - minVertex] != meshletId) ? 1 : 0;
+					}
+					return count;
+				};
+				auto addTriangle = [&](size_t t) {
+					emitted[t] = true;
+					meshletTriangles.push_back(static_cast<uint32_t>(t));
+					for (uint32_t k = 0; k < 3; k++) {
+						const uint32_t v = indices[t * 3 + k] - minVertex;
+						if (vertexMeshlet[v] == meshletId) {
+							continue;
+						}
+						vertexMeshlet[v] = meshletId;
+						meshletVertices.push_back(v + minVertex);
+						// Triangles sharing a vertex with the meshlet are the candidates for growing it
+						for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++) {
+							if (!emitted[adjacency[a]]) {
+								candidates.push_back(adjacency[a]);
+							}
+						}
+					}
+				};
+
+				addTriangle(seed);
+				while (meshletTriangles.size() < maxTriangles) {
+					// Pick the candidate adding the fewest vertices, emitted candidates are dropped on the way
+					uint32_t best = unused;
+					uint32_t bestScore = 4;
+					size_t keep = 0;
+					for (size_t c = 0; c < candidates.size(); c++) {
+						const uint32_t t = candidates[c];
+						if (emitted[t]) {
+							continue;
+						}
+						candidates[keep++] = t;
+						const uint32_t score = newVertices(t);
+						if ((score < bestScore) && (meshletVertices.size() + score <= maxVertices)) {
+							best = t;
+							bestScore = score;
+						}
+					}
+					candidates.resize(keep);
+					if (best == unused) {
+						break;
+					}
+					addTriangle(best);
+				}
+
+				Meshlet meshlet = {};
+				meshlet.firstIndex = firstIndex + static_cast<uint32_t>(output.size());
+				meshlet.indexCount = static_cast<uint32_t>(meshletTriangles.size()) * 3;
+				meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+				for (auto t : meshletTriangles) {
+					output.insert(output.end(), indices + t * 3, indices + t * 3 + 3);
+				}
+
+				// Bounding sphere around the center of the vertices' bounding box
+				float bbMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+				float bbMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+				for (auto v : meshletVertices) {
+					float p[3];
+					position(v, p);
+					for (uint32_t k = 0; k < 3; k++) {
+						bbMin[k] = std::min(bbMin[k], p[k]);
+						bbMax[k] = std::max(bbMax[k], p[k]);
+					}
+				}
+				for (uint32_t k = 0; k < 3; k++) {
+					meshlet.center[k] = (bbMin[k] + bbMax[k]) * 0.5f;
+				}
+				float radiusSq = 0.0f;
+				for (auto v : meshletVertices) {
+					float p[3];
+					position(v, p);
+					const float d[3] = { p[0] - meshlet.center[0], p[1] - meshlet.center[1], p[2] - meshlet.center[2] };
+					radiusSq = std::max(radiusSq, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+				}
+				meshlet.radius = sqrtf(radiusSq);
+
+				// Normal cone around the average normal, the cutoff is the sine of the cone's half angle
+				float axis[3] = { 0.0f, 0.0f, 0.0f };
+				for (auto t : meshletTriangles) {
+					for (uint32_t k = 0; k < 3; k++) {
+						axis[k] += normals[t * 3 + k];
+					}
+				}
+				const float axisLength = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+				float minDot = -1.0f;
+				if (axisLength > 0.0f) {
+					for (uint32_t k = 0; k < 3; k++) {
+						axis[k] /= axisLength;
+					}
+					minDot = 1.0f;
+					for (auto t : meshletTriangles) {
+						const float *n = &normals[t * 3];
+						if (n[0] != 0.0f || n[1] != 0.0f || n[2] != 0.0f) {
+							minDot = std::min(minDot, n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2]);
+						}
+					}
+				}
+				// Cones wider than ~85 degrees would hardly ever reject the meshlet
+				if (minDot > 0.1f) {
+					memcpy(meshlet.coneAxis, axis, sizeof(axis));
+					meshlet.coneCutoff = sqrtf(1.0f - minDot * minDot);
+				} else {
+					meshlet.coneCutoff = 1.0f;
+				}
+
+				meshlets.push_back(meshlet);
+			}
+
+			assert(output.size() == triangleCount * 3);
+			memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+			return static_cast<uint32_t>(meshlets.size()) - meshletsBefore;
+		}
+
+		/**
+		* Normal cone test of a meshlet, same as the one done by the cluster culling compute shader
+		*
+		* @param meshlet Meshlet to test
+		* @param cameraPos Position of the viewer in the meshlet's model space
+		*
+		* @return False if all triangles of the meshlet are facing away from the viewer
+		*/
+		inline bool coneVisible(const Meshlet &meshlet, const float cameraPos[3])
+		{
+			const float view[3] = { meshlet.center[0] - cameraPos[0], meshlet.center[1] - cameraPos[1], meshlet.center[2] - cameraPos[2] };
+			const float viewLength = sqrtf(view[0] * view[0] + view[1] * view[1] + view[2] * view[2]);
+			const float d = view[0] * meshlet.coneAxis[0] + view[1] * meshlet.coneAxis[1] + view[2] * meshlet.coneAxis[2];
+			return d < meshlet.coneCutoff * viewLength + meshlet.radius * (1.0f + meshlet.coneCutoff);
+		}
+	}
+}
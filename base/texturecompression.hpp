@@ -0,0 +1,613 @@
+/*
+* CPU block compression for textures that are only available uncompressed at runtime (e.g. glTF images)
+*
+* - BC1: RGB endpoints along the principal axis of the block's colors (four color mode only, alpha is ignored)
+* - BC3: BC1 color block plus a BC4 alpha block
+* - BC7: Mode 6 only (single subset, RGBA endpoints with p-bits, 4 bit indices)
+* - Endpoints of BC1 and BC7 blocks are refined with a least squares fit to the selected indices
+* - Mip chains are generated on the CPU with vks::imageproc (see MipOptions for color space and alpha handling)
+*
+* The blocks of all levels are distributed over the threads of a vks::JobSystem
+*
+* Copyright (C) 2016-2017 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cfloat>
+#include <cstdlib>
+#include <stdint.h>
+#include <assert.h>
+
+#include "vulkan/vulkan.h"
+#include "jobsystem.hpp"
+#include "imageprocessing.hpp"
+
+namespace vks
+{
+	namespace texcompress
+	{
+		enum BlockFormat {
+			BLOCK_FORMAT_BC1,
+			BLOCK_FORMAT_BC3,
+			BLOCK_FORMAT_BC7
+		};
+
+		/** @brief Version of the encoders, part of cache keys so cached images are rebuilt once the encoders change */
+		const uint32_t encoderVersion = 2;
+
+		inline VkFormat getVkFormat(BlockFormat format)
+		{
+			switch (format) {
+			case BLOCK_FORMAT_BC1: return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+			case BLOCK_FORMAT_BC3: return VK_FORMAT_BC3_UNORM_BLOCK;
+			default: return VK_FORMAT_BC7_UNORM_BLOCK;
+			}
+		}
+
+		/** @brief OpenGL internal format enum of a block format (as stored in KTX files) */
+		inline uint32_t getGlInternalFormat(BlockFormat format)
+		{
+			switch (format) {
+			case BLOCK_FORMAT_BC1: return 0x83F0; // GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+			case BLOCK_FORMAT_BC3: return 0x83F3; // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+			default: return 0x8E8C; // GL_COMPRESSED_RGBA_BPTC_UNORM
+			}
+		}
+
+		/** @brief OpenGL base internal format enum of a block format (as stored in KTX files) */
+		inline uint32_t getGlBaseInternalFormat(BlockFormat format)
+		{
+			switch (format) {
+			case BLOCK_FORMAT_BC1: return 0x1907; // GL_RGB
+			default: return 0x1908; // GL_RGBA
+			}
+		}
+
+		/** @brief Size of a 4x4 block in bytes */
+		inline uint32_t getBlockSize(BlockFormat format)
+		{
+			return (format == BLOCK_FORMAT_BC1) ? 8 : 16;
+		}
+
+		/** @brief Size of a compressed level in bytes */
+		inline size_t getLevelSize(BlockFormat format, uint32_t width, uint32_t height)
+		{
+			return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+		}
+
+		/** @brief Number of levels of a full mip chain */
+		inline uint32_t getMipLevelCount(uint32_t width, uint32_t height)
+		{
+			return vks::imageproc::getMipLevelCount(width, height);
+		}
+
+		/** @brief True if any texel of an RGBA8 image is not fully opaque */
+		inline bool hasAlpha(const uint8_t *rgba, size_t texelCount)
+		{
+			for (size_t i = 0; i < texelCount; i++) {
+				if (rgba[i * 4 + 3] != 255) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		/** @brief FNV-1a over 64 bit words (with a byte wise tail), used to key cached images by their contents */
+		inline void hashBytes(uint64_t &hash, const void *data, size_t size)
+		{
+			const unsigned char *bytes = static_cast<const unsigned char*>(data);
+			const size_t words = size / sizeof(uint64_t);
+			for (size_t i = 0; i < words; i++) {
+				uint64_t word;
+				memcpy(&word, bytes + i * sizeof(uint64_t), sizeof(uint64_t));
+				hash = (hash ^ word) * 0x100000001b3ULL;
+			}
+			for (size_t i = words * sizeof(uint64_t); i < size; i++) {
+				hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+			}
+		}
+
+		/** @brief Copy a 4x4 block of RGBA8 texels, texels outside of the image repeat the last row or column */
+		inline void loadBlock(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, uint8_t block[64])
+		{
+			for (uint32_t y = 0; y < 4; y++) {
+				const uint32_t sy = std::min(blockY * 4 + y, height - 1);
+				for (uint32_t x = 0; x < 4; x++) {
+					const uint32_t sx = std::min(blockX * 4 + x, width - 1);
+					memcpy(&block[(y * 4 + x) * 4], &rgba[(static_cast<size_t>(sy) * width + sx) * 4], 4);
+				}
+			}
+		}
+
+		/**
+		* Initial endpoints of a block: the extremes of the texels projected onto the principal axis of their distribution
+		*
+		* @param block 16 RGBA8 texels
+		* @param channels Number of channels to consider (3 = RGB, 4 = RGBA)
+		*/
+		inline void computeEndpoints(const uint8_t *block, uint32_t channels, float e0[4], float e1[4])
+		{
+			float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			float minValue[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+			float maxValue[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (uint32_t i = 0; i < 16; i++) {
+				for (uint32_t c = 0; c < channels; c++) {
+					const float v = block[i * 4 + c];
+					mean[c] += v;
+					minValue[c] = std::min(minValue[c], v);
+					maxValue[c] = std::max(maxValue[c], v);
+				}
+			}
+			float cov[4][4] = {};
+			for (uint32_t c = 0; c < channels; c++) {
+				mean[c] /= 16.0f;
+			}
+			for (uint32_t i = 0; i < 16; i++) {
+				float d[4];
+				for (uint32_t c = 0; c < channels; c++) {
+					d[c] = block[i * 4 + c] - mean[c];
+				}
+				for (uint32_t a = 0; a < channels; a++) {
+					for (uint32_t b = 0; b < channels; b++) {
+						cov[a][b] += d[a] * d[b];
+					}
+				}
+			}
+
+			// Power iteration, starting with the diagonal of the bounding box
+			float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (uint32_t c = 0; c < channels; c++) {
+				axis[c] = maxValue[c] - minValue[c];
+			}
+			for (uint32_t iteration = 0; iteration < 8; iteration++) {
+				float v[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+				float norm = 0.0f;
+				for (uint32_t a = 0; a < channels; a++) {
+					for (uint32_t b = 0; b < channels; b++) {
+						v[a] += cov[a][b] * axis[b];
+					}
+					norm = std::max(norm, fabsf(v[a]));
+				}
+				if (norm < 1e-6f) {
+					break;
+				}
+				for (uint32_t c = 0; c < channels; c++) {
+					axis[c] = v[c] / norm;
+				}
+			}
+			float length = 0.0f;
+			for (uint32_t c = 0; c < channels; c++) {
+				length += axis[c] * axis[c];
+			}
+			length = sqrtf(length);
+
+			float minT = 0.0f;
+			float maxT = 0.0f;
+			if (length > 1e-6f) {
+				for (uint32_t c = 0; c < channels; c++) {
+					axis[c] /= length;
+				}
+				minT = FLT_MAX;
+				maxT = -FLT_MAX;
+				for (uint32_t i = 0; i < 16; i++) {
+					float t = 0.0f;
+					for (uint32_t c = 0; c < channels; c++) {
+						t += (block[i * 4 + c] - mean[c]) * axis[c];
+					}
+					minT = std::min(minT, t);
+					maxT = std::max(maxT, t);
+				}
+			}
+			for (uint32_t c = 0; c < 4; c++) {
+				e0[c] = (c < channels) ? std::min(std::max(mean[c] + axis[c] * minT, 0.0f), 255.0f) : 255.0f;
+				e1[c] = (c < channels) ? std::min(std::max(mean[c] + axis[c] * maxT, 0.0f), 255.0f) : 255.0f;
+			}
+		}
+
+		/**
+		* Least squares fit of two endpoints for fixed interpolation weights
+		*
+		* @param block 16 RGBA8 texels
+		* @param channels Number of channels to fit
+		* @param weights Weight of the second endpoint for each texel [0..1]
+		*
+		* @return False if the system is singular (all texels use the same weight)
+		*/
+		inline bool fitEndpoints(const uint8_t *block, uint32_t channels, const float weights[16], float e0[4], float e1[4])
+		{
+			float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+			float ax[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			float bx[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (uint32_t i = 0; i < 16; i++) {
+				const float b = weights[i];
+				const float a = 1.0f - b;
+				aa += a * a;
+				ab += a * b;
+				bb += b * b;
+				for (uint32_t c = 0; c < channels; c++) {
+					ax[c] += a * block[i * 4 + c];
+					bx[c] += b * block[i * 4 + c];
+				}
+			}
+			const float det = aa * bb - ab * ab;
+			if (fabsf(det) < 1e-6f) {
+				return false;
+			}
+			for (uint32_t c = 0; c < channels; c++) {
+				e0[c] = std::min(std::max((ax[c] * bb - bx[c] * ab) / det, 0.0f), 255.0f);
+				e1[c] = std::min(std::max((bx[c] * aa - ax[c] * ab) / det, 0.0f), 255.0f);
+			}
+			return true;
+		}
+
+		/** @brief Select the closest palette entry for each texel, returns the sum of squared errors */
+		inline uint32_t selectIndices(const uint8_t *block, uint32_t channels, const int palette[][4], uint32_t paletteSize, uint8_t indices[16])
+		{
+			uint32_t totalError = 0;
+			for (uint32_t i = 0; i < 16; i++) {
+				uint32_t bestError = UINT32_MAX;
+				for (uint32_t p = 0; p < paletteSize; p++) {
+					uint32_t error = 0;
+					for (uint32_t c = 0; c < channels; c++) {
+						const int d = block[i * 4 + c] - palette[p][c];
+						error += d * d;
+					}
+					if (error < bestError) {
+						bestError = error;
+						indices[i] = static_cast<uint8_t>(p);
+					}
+				}
+				totalError += bestError;
+			}
+			return totalError;
+		}
+
+		inline uint16_t packRGB565(const float color[3])
+		{
+			const uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+			const uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+			const uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+			return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+		}
+
+		inline void unpackRGB565(uint16_t value, int color[4])
+		{
+			const int r = (value >> 11) & 31;
+			const int g = (value >> 5) & 63;
+			const int b = value & 31;
+			color[0] = (r << 3) | (r >> 2);
+			color[1] = (g << 2) | (g >> 4);
+			color[2] = (b << 3) | (b >> 2);
+			color[3] = 255;
+		}
+
+		/** @brief Quantize BC1 endpoints and select the indices, returns the error (four color mode, c0 > c1) */
+		inline uint32_t quantizeBC1(const uint8_t *block, const float e0[4], const float e1[4], uint16_t &c0, uint16_t &c1, uint8_t indices[16])
+		{
+			// The endpoint with the larger 565 value is stored first to select the four color mode
+			c0 = packRGB565(e1);
+			c1 = packRGB565(e0);
+			if (c0 < c1) {
+				std::swap(c0, c1);
+			}
+			int palette[4][4];
+			unpackRGB565(c0, palette[0]);
+			unpackRGB565(c1, palette[1]);
+			for (uint32_t c = 0; c < 3; c++) {
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			if (c0 == c1) {
+				// Three color mode, index 0 selects the only color
+				memset(indices, 0, 16);
+				return selectIndices(block, 3, palette, 1, indices);
+			}
+			return selectIndices(block, 3, palette, 4, indices);
+		}
+
+		/** @brief Encode 16 RGBA8 texels to a BC1 block (8 bytes), alpha is ignored */
+		inline void encodeBlockBC1(const uint8_t *block, uint8_t *dst)
+		{
+			float e0[4], e1[4];
+			computeEndpoints(block, 3, e0, e1);
+			uint16_t c0, c1;
+			uint8_t indices[16];
+			uint32_t error = quantizeBC1(block, e0, e1, c0, c1, indices);
+
+			// Refine the endpoints for the selected indices (index 0 = c0, 1 = c1, 2 = 2/3 c0 + 1/3 c1, 3 = 1/3 c0 + 2/3 c1)
+			if ((error > 0) && (c0 != c1)) {
+				const float indexWeights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+				float weights[16];
+				for (uint32_t i = 0; i < 16; i++) {
+					weights[i] = indexWeights[indices[i]];
+				}
+				float f0[4], f1[4];
+				if (fitEndpoints(block, 3, weights, f0, f1)) {
+					uint16_t r0, r1;
+					uint8_t refinedIndices[16];
+					const uint32_t refinedError = quantizeBC1(block, f0, f1, r0, r1, refinedIndices);
+					if (refinedError < error) {
+						c0 = r0;
+						c1 = r1;
+						memcpy(indices, refinedIndices, 16);
+					}
+				}
+			}
+
+			uint32_t indexBits = 0;
+			for (uint32_t i = 0; i < 16; i++) {
+				indexBits |= static_cast<uint32_t>(indices[i]) << (i * 2);
+			}
+			dst[0] = c0 & 0xFF;
+			dst[1] = c0 >> 8;
+			dst[2] = c1 & 0xFF;
+			dst[3] = c1 >> 8;
+			for (uint32_t i = 0; i < 4; i++) {
+				dst[4 + i] = (indexBits >> (i * 8)) & 0xFF;
+			}
+		}
+
+		/** @brief Encode a single channel of 16 RGBA8 texels to a BC4 block (8 bytes), used for BC3 alpha */
+		inline void encodeBlockBC4(const uint8_t *block, uint32_t channel, uint8_t *dst)
+		{
+			int minValue = 255;
+			int maxValue = 0;
+			for (uint32_t i = 0; i < 16; i++) {
+				minValue = std::min(minValue, static_cast<int>(block[i * 4 + channel]));
+				maxValue = std::max(maxValue, static_cast<int>(block[i * 4 + channel]));
+			}
+			// Eight value mode (first endpoint larger than the second)
+			dst[0] = static_cast<uint8_t>(maxValue);
+			dst[1] = static_cast<uint8_t>(minValue);
+			memset(dst + 2, 0, 6);
+			if (maxValue == minValue) {
+				return;
+			}
+			int palette[8];
+			palette[0] = maxValue;
+			palette[1] = minValue;
+			for (int i = 2; i < 8; i++) {
+				palette[i] = ((8 - i) * maxValue + (i - 1) * minValue) / 7;
+			}
+			uint64_t indexBits = 0;
+			for (uint32_t i = 0; i < 16; i++) {
+				const int value = block[i * 4 + channel];
+				uint32_t bestIndex = 0;
+				int bestError = INT32_MAX;
+				for (uint32_t p = 0; p < 8; p++) {
+					const int error = abs(value - palette[p]);
+					if (error < bestError) {
+						bestError = error;
+						bestIndex = p;
+					}
+				}
+				indexBits |= static_cast<uint64_t>(bestIndex) << (i * 3);
+			}
+			for (uint32_t i = 0; i < 6; i++) {
+				dst[2 + i] = (indexBits >> (i * 8)) & 0xFF;
+			}
+		}
+
+		/** @brief Interpolation weights (of the second endpoint, in 1/64) for BC7 4 bit indices */
+		const int bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		/** @brief Quantize a BC7 mode 6 endpoint to 7 bits per channel plus a shared p-bit (the p-bit is the least significant bit of all channels) */
+		inline void quantizeEndpointBC7(const float endpoint[4], uint8_t quantized[4], uint8_t &pBit)
+		{
+			float bestError = FLT_MAX;
+			for (uint8_t p = 0; p < 2; p++) {
+				uint8_t q[4];
+				float error = 0.0f;
+				for (uint32_t c = 0; c < 4; c++) {
+					const int value = static_cast<int>(floorf((endpoint[c] - p) * 0.5f + 0.5f));
+					q[c] = static_cast<uint8_t>(std::min(std::max(value, 0), 127));
+					const float d = (q[c] * 2 + p) - endpoint[c];
+					error += d * d;
+				}
+				if (error < bestError) {
+					bestError = error;
+					memcpy(quantized, q, 4);
+					pBit = p;
+				}
+			}
+		}
+
+		/** @brief Quantize BC7 mode 6 endpoints and select the indices, returns the error */
+		inline uint32_t quantizeBC7(const uint8_t *block, const float e0[4], const float e1[4], uint8_t q0[4], uint8_t q1[4], uint8_t &p0, uint8_t &p1, uint8_t indices[16])
+		{
+			quantizeEndpointBC7(e0, q0, p0);
+			quantizeEndpointBC7(e1, q1, p1);
+			int palette[16][4];
+			for (uint32_t c = 0; c < 4; c++) {
+				const int a = q0[c] * 2 + p0;
+				const int b = q1[c] * 2 + p1;
+				for (uint32_t i = 0; i < 16; i++) {
+					palette[i][c] = ((64 - bc7Weights4[i]) * a + bc7Weights4[i] * b + 32) >> 6;
+				}
+			}
+			return selectIndices(block, 4, palette, 16, indices);
+		}
+
+		/** @brief Encode 16 RGBA8 texels to a BC7 block (16 bytes) using mode 6 */
+		inline void encodeBlockBC7(const uint8_t *block, uint8_t *dst)
+		{
+			float e0[4], e1[4];
+			computeEndpoints(block, 4, e0, e1);
+			uint8_t q0[4], q1[4], p0, p1;
+			uint8_t indices[16];
+			uint32_t error = quantizeBC7(block, e0, e1, q0, q1, p0, p1, indices);
+
+			if (error > 0) {
+				float weights[16];
+				for (uint32_t i = 0; i < 16; i++) {
+					weights[i] = bc7Weights4[indices[i]] / 64.0f;
+				}
+				float f0[4], f1[4];
+				if (fitEndpoints(block, 4, weights, f0, f1)) {
+					uint8_t r0[4], r1[4], rp0, rp1;
+					uint8_t refinedIndices[16];
+					const uint32_t refinedError = quantizeBC7(block, f0, f1, r0, r1, rp0, rp1, refinedIndices);
+					if (refinedError < error) {
+						memcpy(q0, r0, 4);
+						memcpy(q1, r1, 4);
+						p0 = rp0;
+						p1 = rp1;
+						memcpy(indices, refinedIndices, 16);
+					}
+				}
+			}
+
+			// The most significant bit of the first index is implicitly zero, swap the endpoints if it's set
+			if (indices[0] & 0x8) {
+				for (uint32_t c = 0; c < 4; c++) {
+					std::swap(q0[c], q1[c]);
+				}
+				std::swap(p0, p1);
+				for (uint32_t i = 0; i < 16; i++) {
+					indices[i] = 15 - indices[i];
+				}
+			}
+
+			memset(dst, 0, 16);
+			uint32_t bitPos = 0;
+			auto writeBits = [dst, &bitPos](uint32_t value, uint32_t count) {
+				for (uint32_t i = 0; i < count; i++, bitPos++) {
+					if ((value >> i) & 1) {
+						dst[bitPos >> 3] |= static_cast<uint8_t>(1 << (bitPos & 7));
+					}
+				}
+			};
+			// Mode 6 is selected by six zero bits followed by a one
+			writeBits(1 << 6, 7);
+			for (uint32_t c = 0; c < 4; c++) {
+				writeBits(q0[c], 7);
+				writeBits(q1[c], 7);
+			}
+			writeBits(p0, 1);
+			writeBits(p1, 1);
+			writeBits(indices[0], 3);
+			for (uint32_t i = 1; i < 16; i++) {
+				writeBits(indices[i], 4);
+			}
+		}
+
+		/** @brief Encode 16 RGBA8 texels to a block of the given format */
+		inline void encodeBlock(BlockFormat format, const uint8_t *block, uint8_t *dst)
+		{
+			switch (format) {
+			case BLOCK_FORMAT_BC1:
+				encodeBlockBC1(block, dst);
+				break;
+			case BLOCK_FORMAT_BC3:
+				encodeBlockBC4(block, 3, dst);
+				encodeBlockBC1(block, dst + 8);
+				break;
+			case BLOCK_FORMAT_BC7:
+				encodeBlockBC7(block, dst);
+				break;
+			}
+		}
+
+		/** @brief Block compress the block rows [begin, end) of an RGBA8 image level (internal) */
+		inline void compressBlockRows(const uint8_t *rgba, uint32_t width, uint32_t height, BlockFormat format, uint32_t begin, uint32_t end, uint8_t *dst)
+		{
+			const uint32_t blocksX = (width + 3) / 4;
+			const uint32_t blockSize = getBlockSize(format);
+			uint8_t block[64];
+			for (uint32_t y = begin; y < end; y++) {
+				for (uint32_t x = 0; x < blocksX; x++) {
+					loadBlock(rgba, width, height, x, y, block);
+					encodeBlock(format, block, dst + (static_cast<size_t>(y) * blocksX + x) * blockSize);
+				}
+			}
+		}
+
+		/**
+		* Block compress a single RGBA8 image level
+		*
+		* @param rgba Source texels (4 bytes per texel)
+		* @param dst Destination of the blocks, must hold getLevelSize bytes
+		* @param (Optional) jobSystem Distribute the block rows over the threads of this job system
+		*/
+		inline void compressLevel(const uint8_t *rgba, uint32_t width, uint32_t height, BlockFormat format, uint8_t *dst, vks::JobSystem *jobSystem = nullptr)
+		{
+			vks::imageproc::forRows(jobSystem, (height + 3) / 4, [=](uint32_t begin, uint32_t end) {
+				compressBlockRows(rgba, width, height, format, begin, end, dst);
+			});
+		}
+
+		struct Level {
+			uint32_t width;
+			uint32_t height;
+			/** @brief Offset of the level's blocks in CompressedImage::data */
+			size_t offset;
+			size_t size;
+		};
+
+		/** @brief Block compressed image including its mip chain, the levels are stored back to back */
+		struct CompressedImage {
+			BlockFormat format = BLOCK_FORMAT_BC1;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			std::vector<Level> levels;
+			std::vector<uint8_t> data;
+		};
+
+		/**
+		* Generate the full mip chain of an RGBA8 image and block compress all levels
+		*
+		* @param rgba Top level texels (4 bytes per texel)
+		* @param format Block format to compress to
+		* @param mipOptions Filter, color space and alpha handling of the mip chain
+		* @param (Optional) jobSystem Distribute the work over the threads of this job system
+		*/
+		inline CompressedImage compressImage(const uint8_t *rgba, uint32_t width, uint32_t height, BlockFormat format, const vks::imageproc::MipOptions &mipOptions, vks::JobSystem *jobSystem = nullptr)
+		{
+			CompressedImage image;
+			image.format = format;
+			image.width = width;
+			image.height = height;
+			const std::vector<vks::imageproc::MipLevel> mipLevels = vks::imageproc::getMipLevels(width, height);
+			// First block row of each level in the block rows of all levels
+			std::vector<uint32_t> firstBlockRows;
+			uint32_t blockRowCount = 0;
+			size_t offset = 0;
+			for (auto &mipLevel : mipLevels) {
+				Level level;
+				level.width = mipLevel.width;
+				level.height = mipLevel.height;
+				level.offset = offset;
+				level.size = getLevelSize(format, level.width, level.height);
+				image.levels.push_back(level);
+				offset += level.size;
+				firstBlockRows.push_back(blockRowCount);
+				blockRowCount += (level.height + 3) / 4;
+			}
+			image.data.resize(offset);
+
+			std::vector<uint8_t> chain(vks::imageproc::getMipChainSize(mipLevels));
+			vks::imageproc::generateMipChain(rgba, mipLevels, chain.data(), mipOptions, jobSystem);
+
+			// The block rows of all levels are compressed in one pass, so the small levels don't leave threads idle
+			const uint8_t *chainData = chain.data();
+			uint8_t *blocks = image.data.data();
+			vks::imageproc::forRows(jobSystem, blockRowCount, [&](uint32_t begin, uint32_t end) {
+				while (begin < end) {
+					const uint32_t i = static_cast<uint32_t>(std::upper_bound(firstBlockRows.begin(), firstBlockRows.end(), begin) - firstBlockRows.begin()) - 1;
+					const Level &level = image.levels[i];
+					const uint32_t levelEnd = std::min(end, firstBlockRows[i] + (level.height + 3) / 4);
+					compressBlockRows(chainData + mipLevels[i].offset, level.width, level.height, format, begin - firstBlockRows[i], levelEnd - firstBlockRows[i], blocks + level.offset);
+					begin = levelEnd;
+				}
+			});
+			return image;
+		}
+	}
+}
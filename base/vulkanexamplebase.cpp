@@ -25,24 +25,27 @@ VkResult VulkanExampleBase::createInstance(bool enableValidation)
 	appInfo.pEngineName = name.c_str();
 	appInfo.apiVersion = apiVersion;
 
-	std::vector<const char*> instanceExtensions = { VK_KHR_SURFACE_EXTENSION_NAME };
+	std::vector<const char*> instanceExtensions;
 
-	// Enable surface extensions depending on os
+	// Enable surface extensions depending on os (not required in headless mode)
+	if (!settings.headless) {
+		instanceExtensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
 #if defined(_WIN32)
-	instanceExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_ANDROID_KHR)
-	instanceExtensions.push_back(VK_KHR_ANDROID_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_KHR_ANDROID_SURFACE_EXTENSION_NAME);
 #elif defined(_DIRECT2DISPLAY)
-	instanceExtensions.push_back(VK_KHR_DISPLAY_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_KHR_DISPLAY_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_WAYLAND_KHR)
-	instanceExtensions.push_back(VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_XCB_KHR)
-	instanceExtensions.push_back(VK_KHR_XCB_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_KHR_XCB_SURFACE_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_IOS_MVK)
-	instanceExtensions.push_back(VK_MVK_IOS_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_MVK_IOS_SURFACE_EXTENSION_NAME);
 #elif defined(VK_USE_PLATFORM_MACOS_MVK)
-	instanceExtensions.push_back(VK_MVK_MACOS_SURFACE_EXTENSION_NAME);
+		instanceExtensions.push_back(VK_MVK_MACOS_SURFACE_EXTENSION_NAME);
 #endif
+	}
 
 	if (enabledInstanceExtensions.size() > 0) {
 		for (auto enabledExtension : enabledInstanceExtensions) {
@@ -54,12 +57,12 @@ VkResult VulkanExampleBase::createInstance(bool enableValidation)
 	instanceCreateInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	instanceCreateInfo.pNext = NULL;
 	instanceCreateInfo.pApplicationInfo = &appInfo;
+	if (settings.validation)
+	{
+		instanceExtensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
+	}
 	if (instanceExtensions.size() > 0)
 	{
-		if (settings.validation)
-		{
-			instanceExtensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
-		}
 		instanceCreateInfo.enabledExtensionCount = (uint32_t)instanceExtensions.size();
 		instanceCreateInfo.ppEnabledExtensionNames = instanceExtensions.data();
 	}
@@ -172,15 +175,129 @@ void VulkanExampleBase::flushCommandBuffer(VkCommandBuffer commandBuffer, VkQueu
 	}
 }
 
+// Header prepended to the pipeline cache data stored on disk
+// The driver version is not part of the Vulkan pipeline cache header, so it's stored separately
+struct PipelineCacheFileHeader {
+	uint32_t magic;
+	uint32_t driverVersion;
+	uint64_t dataSize;
+};
+static const uint32_t pipelineCacheFileMagic = 0x564b5043; // "VKPC"
+
+std::string VulkanExampleBase::getPipelineCacheFileName()
+{
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+	return std::string(androidApp->activity->internalDataPath) + "/" + name + "_pipelinecache.bin";
+#else
+	// Examples share the default name, so the executable's name is used to get one cache file per example
+	std::string baseName = name;
+	if (!args.empty()) {
+		baseName = args[0];
+		size_t pos = baseName.find_last_of("/\\");
+		if (pos != std::string::npos) {
+			baseName = baseName.substr(pos + 1);
+		}
+		pos = baseName.find_last_of('.');
+		if ((pos != std::string::npos) && (pos > 0)) {
+			baseName = baseName.substr(0, pos);
+		}
+	}
+	return baseName + "_pipelinecache.bin";
+#endif
+}
+
 void VulkanExampleBase::createPipelineCache()
 {
+	std::vector<char> cacheData;
+
+	if (settings.pipelineCache) {
+		std::ifstream is(getPipelineCacheFileName(), std::ios::binary | std::ios::in | std::ios::ate);
+		if (is.is_open()) {
+			size_t fileSize = is.tellg();
+			is.seekg(0, std::ios::beg);
+			PipelineCacheFileHeader fileHeader{};
+			if (fileSize >= sizeof(fileHeader)) {
+				is.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader));
+			}
+			// Only use the stored data if it has been written with the current driver and is complete
+			if ((fileHeader.magic == pipelineCacheFileMagic) && (fileHeader.driverVersion == deviceProperties.driverVersion) && (fileHeader.dataSize == fileSize - sizeof(fileHeader))) {
+				cacheData.resize(fileHeader.dataSize);
+				is.read(cacheData.data(), cacheData.size());
+			}
+			is.close();
+		}
+
+		// Validate the Vulkan pipeline cache header against the current device
+		// Layout (VK_PIPELINE_CACHE_HEADER_VERSION_ONE): header length, header version, vendor id, device id, pipeline cache UUID
+		const size_t headerSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+		if (cacheData.size() >= headerSize) {
+			uint32_t header[4];
+			memcpy(header, cacheData.data(), sizeof(header));
+			uint8_t uuid[VK_UUID_SIZE];
+			memcpy(uuid, cacheData.data() + sizeof(header), VK_UUID_SIZE);
+			bool valid = (header[0] >= headerSize) && (header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE);
+			valid = valid && (header[2] == deviceProperties.vendorID) && (header[3] == deviceProperties.deviceID);
+			valid = valid && (memcmp(uuid, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0);
+			if (!valid) {
+				cacheData.clear();
+			}
+		}
+		else {
+			cacheData.clear();
+		}
+	}
+
+	pipelineCacheLoaded = !cacheData.empty();
+
 	VkPipelineCacheCreateInfo pipelineCacheCreateInfo = {};
 	pipelineCacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	pipelineCacheCreateInfo.initialDataSize = cacheData.size();
+	pipelineCacheCreateInfo.pInitialData = cacheData.empty() ? nullptr : cacheData.data();
 	VK_CHECK_RESULT(vkCreatePipelineCache(device, &pipelineCacheCreateInfo, nullptr, &pipelineCache));
 }
 
+void VulkanExampleBase::savePipelineCache()
+{
+	size_t dataSize = 0;
+	if ((vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS) || (dataSize == 0)) {
+		return;
+	}
+	std::vector<char> cacheData(dataSize);
+	if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, cacheData.data()) != VK_SUCCESS) {
+		return;
+	}
+
+	std::ofstream os(getPipelineCacheFileName(), std::ios::binary | std::ios::out | std::ios::trunc);
+	if (os.is_open()) {
+		PipelineCacheFileHeader fileHeader{};
+		fileHeader.magic = pipelineCacheFileMagic;
+		fileHeader.driverVersion = deviceProperties.driverVersion;
+		fileHeader.dataSize = dataSize;
+		os.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+		os.write(cacheData.data(), dataSize);
+		os.close();
+	}
+	else {
+		std::cerr << "Could not write pipeline cache to \"" << getPipelineCacheFileName() << "\"" << std::endl;
+	}
+}
+
+void VulkanExampleBase::reportStartupTime()
+{
+	double tStartup = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tPrepareStart).count();
+	std::string cacheState = settings.pipelineCache ? (pipelineCacheLoaded ? "warm" : "cold") : "disabled";
+	benchmark.startupTime = tStartup;
+	benchmark.pipelineCacheState = cacheState;
+#if defined(VK_USE_PLATFORM_ANDROID_KHR)
+	LOGD("Startup time: %.3f ms (pipeline cache: %s)", tStartup, cacheState.c_str());
+#else
+	std::cout << "Startup time: " << tStartup << " ms (pipeline cache: " << cacheState << ")" << std::endl;
+#endif
+}
+
 void VulkanExampleBase::prepare()
 {
+	tPrepareStart = std::chrono::high_resolution_clock::now();
 	if (vulkanDevice->enableDebugMarkers) {
 		vks::debugmarker::setup(device);
 	}
@@ -188,6 +305,7 @@ void VulkanExampleBase::prepare()
 	createCommandPool();
 	setupSwapChain();
 	createCommandBuffers();
+	gpuProfiler.prepare(vulkanDevice, swapChain.queueNodeIndex, static_cast<uint32_t>(drawCmdBuffers.size()));
 	createSynchronizationPrimitives();
 	setupDepthStencil();
 	setupRenderPass();
@@ -269,12 +387,31 @@ void VulkanExampleBase::renderFrame()
 
 void VulkanExampleBase::renderLoop()
 {
+#if !defined(VK_USE_PLATFORM_ANDROID_KHR)
+	// On Android, preparation is done after the window has been created (see handleAppCommand)
+	reportStartupTime();
+#endif
+
 	if (benchmark.active) {
+		// Only measure GPU times of the benchmark phase
+		benchmark.warmupFinished = [=] { gpuProfiler.resetTimings(); };
 		benchmark.run([=] { render(); }, vulkanDevice->properties);
 		vkDeviceWaitIdle(device);
+		gpuProfiler.update();
+		for (auto& timing : gpuProfiler.getTimings()) {
+			vks::Benchmark::GpuTime gpuTime;
+			gpuTime.name = timing.name;
+			gpuTime.avg = timing.average();
+			gpuTime.min = timing.min;
+			gpuTime.max = timing.max;
+			gpuTime.samples = timing.samples;
+			benchmark.gpuTimes.push_back(gpuTime);
+		}
+		benchmark.printGpuTimes();
 		if (benchmark.filename != "") {
 			benchmark.saveResults();
 		}
+		vulkanDevice->memoryAllocator->printStats(std::cout);
 		return;
 	}
 
@@ -585,6 +722,12 @@ void VulkanExampleBase::updateOverlay()
 	ImGui::PushItemWidth(110.0f * UIOverlay.scale);
 	OnUpdateUIOverlay(&UIOverlay);
 	ImGui::PopItemWidth();
+
+	if (!gpuProfiler.getTimings().empty() && UIOverlay.header("GPU timings")) {
+		for (auto& timing : gpuProfiler.getTimings()) {
+			UIOverlay.text("%*s%s: %.3f ms", static_cast<int>(timing.depth * 2), "", timing.name.c_str(), timing.last);
+		}
+	}
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
 	ImGui::PopStyleVar();
 #endif
@@ -593,6 +736,14 @@ void VulkanExampleBase::updateOverlay()
 	ImGui::PopStyleVar();
 	ImGui::Render();
 
+	if (settings.framesInFlight > 1) {
+		// Overlay buffers may be recreated and command buffers rebuilt, which is not allowed while frames are still in flight
+		ImDrawData* imDrawData = ImGui::GetDrawData();
+		if (UIOverlay.updated || (imDrawData && ((imDrawData->TotalVtxCount != UIOverlay.vertexCount) || (imDrawData->TotalIdxCount > UIOverlay.indexCount)))) {
+			VK_CHECK_RESULT(vkQueueWaitIdle(queue));
+		}
+	}
+
 	if (UIOverlay.update() || UIOverlay.updated) {
 		buildCommandBuffers();
 		UIOverlay.updated = false;
@@ -619,6 +770,12 @@ void VulkanExampleBase::drawUI(const VkCommandBuffer commandBuffer)
 
 void VulkanExampleBase::prepareFrame()
 {
+	if (settings.framesInFlight > 1) {
+		// Wait until the GPU has finished the last frame that used the current frame's synchronization objects
+		VK_CHECK_RESULT(vkWaitForFences(device, 1, &frameSync[currentFrame].fence, VK_TRUE, UINT64_MAX));
+		semaphores.presentComplete = frameSync[currentFrame].presentComplete;
+		semaphores.renderComplete = frameSync[currentFrame].renderComplete;
+	}
 	// Acquire the next image from the swap chain
 	VkResult err = swapChain.acquireNextImage(semaphores.presentComplete, &currentBuffer);
 	// Recreate the swapchain if it's no longer compatible with the surface (OUT_OF_DATE) or no longer optimal for presentation (SUBOPTIMAL)
@@ -628,10 +785,27 @@ void VulkanExampleBase::prepareFrame()
 	else {
 		VK_CHECK_RESULT(err);
 	}
+	if ((settings.framesInFlight > 1) && (currentBuffer < imagesInFlight.size())) {
+		// The swap chain may return images out of order, so also wait for a previous frame still rendering to the acquired image
+		if ((imagesInFlight[currentBuffer] != VK_NULL_HANDLE) && (imagesInFlight[currentBuffer] != frameSync[currentFrame].fence)) {
+			VK_CHECK_RESULT(vkWaitForFences(device, 1, &imagesInFlight[currentBuffer], VK_TRUE, UINT64_MAX));
+		}
+		imagesInFlight[currentBuffer] = frameSync[currentFrame].fence;
+	}
 }
 
 void VulkanExampleBase::submitFrame()
 {
+	// Results of earlier frames are read back without waiting
+	gpuProfiler.frameSubmitted(currentBuffer);
+	gpuProfiler.update();
+	bool multipleFramesInFlight = (settings.framesInFlight > 1);
+	if (multipleFramesInFlight) {
+		// An empty submission signals the frame's fence once all work previously submitted to the queue has completed
+		VK_CHECK_RESULT(vkResetFences(device, 1, &frameSync[currentFrame].fence));
+		VK_CHECK_RESULT(vkQueueSubmit(queue, 0, nullptr, frameSync[currentFrame].fence));
+		currentFrame = (currentFrame + 1) % settings.framesInFlight;
+	}
 	VkResult res = swapChain.queuePresent(queue, currentBuffer, semaphores.renderComplete);
 	if (!((res == VK_SUCCESS) || (res == VK_SUBOPTIMAL_KHR))) {
 		if (res == VK_ERROR_OUT_OF_DATE_KHR) {
@@ -642,7 +816,9 @@ void VulkanExampleBase::submitFrame()
 			VK_CHECK_RESULT(res);
 		}
 	}
-	VK_CHECK_RESULT(vkQueueWaitIdle(queue));
+	if (!multipleFramesInFlight) {
+		VK_CHECK_RESULT(vkQueueWaitIdle(queue));
+	}
 }
 
 VulkanExampleBase::VulkanExampleBase(bool enableValidation)
@@ -686,6 +862,22 @@ VulkanExampleBase::VulkanExampleBase(bool enableValidation)
 			uint32_t h = strtol(args[i + 1], &numConvPtr, 10);
 			if (numConvPtr != args[i + 1]) { height = h; };
 		}
+		// Number of frames in flight (only applies to examples that support it)
+		if ((args[i] == std::string("-framesinflight")) || (args[i] == std::string("--framesinflight"))) {
+			if (args.size() > i + 1) {
+				// Parse as a signed number, so negative values are rejected instead of wrapping around
+				long num = strtol(args[i + 1], &numConvPtr, 10);
+				if ((numConvPtr != args[i + 1]) && (num > 0)) {
+					if (num > static_cast<long>(settings.maxFramesInFlight)) {
+						std::cerr << "Number of frames in flight is limited to " << settings.maxFramesInFlight << std::endl;
+						num = settings.maxFramesInFlight;
+					}
+					settings.framesInFlight = static_cast<uint32_t>(num);
+				} else {
+					std::cerr << "Number of frames in flight must be specified as a number greater than zero!" << std::endl;
+				}
+			}
+		}
 		// Benchmark
 		if ((args[i] == std::string("-b")) || (args[i] == std::string("--benchmark"))) {
 			benchmark.active = true;
@@ -728,6 +920,33 @@ VulkanExampleBase::VulkanExampleBase(bool enableValidation)
 		if ((args[i] == std::string("-bt")) || (args[i] == std::string("--benchframetimes"))) {
 			benchmark.outputFrameTimes = true;
 		}
+		// Don't load or store the pipeline cache from/to disk
+		if ((args[i] == std::string("-nopipelinecache")) || (args[i] == std::string("--nopipelinecache"))) {
+			settings.pipelineCache = false;
+		}
+		// Block compress glTF images at load time (only applies to examples that support it)
+		if ((args[i] == std::string("-texturecompression")) || (args[i] == std::string("--texturecompression"))) {
+			settings.textureCompression = true;
+		}
+		// Store processed meshes in a disk cache and load them from there on later runs
+		if ((args[i] == std::string("-meshcache")) || (args[i] == std::string("--meshcache"))) {
+			vks::tools::meshCacheEnabled = true;
+		}
+		// Print loader diagnostics like load timings
+		if ((args[i] == std::string("-verbose")) || (args[i] == std::string("--verbose"))) {
+			vks::tools::verboseOutput = true;
+		}
+		// Render to offscreen images instead of a window
+		if ((args[i] == std::string("-headless")) || (args[i] == std::string("--headless"))) {
+			settings.headless = true;
+		}
+	}
+
+	if (settings.headless && !benchmark.active) {
+		// Nothing is displayed in headless mode, so the only useful thing to do is running the benchmark
+		std::cout << "Headless mode, running benchmark" << std::endl;
+		benchmark.active = true;
+		vks::tools::errorModeSilent = true;
 	}
 	
 #if defined(VK_USE_PLATFORM_ANDROID_KHR)
@@ -737,9 +956,13 @@ VulkanExampleBase::VulkanExampleBase(bool enableValidation)
 #elif defined(_DIRECT2DISPLAY)
 
 #elif defined(VK_USE_PLATFORM_WAYLAND_KHR)
-	initWaylandConnection();
+	if (!settings.headless) {
+		initWaylandConnection();
+	}
 #elif defined(VK_USE_PLATFORM_XCB_KHR)
-	initxcbConnection();
+	if (!settings.headless) {
+		initxcbConnection();
+	}
 #endif
 
 #if defined(_WIN32)
@@ -776,12 +999,20 @@ VulkanExampleBase::~VulkanExampleBase()
 	vkDestroyImage(device, depthStencil.image, nullptr);
 	vkFreeMemory(device, depthStencil.mem, nullptr);
 
+	if (settings.pipelineCache) {
+		savePipelineCache();
+	}
 	vkDestroyPipelineCache(device, pipelineCache, nullptr);
 
 	vkDestroyCommandPool(device, cmdPool, nullptr);
 
-	vkDestroySemaphore(device, semaphores.presentComplete, nullptr);
-	vkDestroySemaphore(device, semaphores.renderComplete, nullptr);
+	gpuProfiler.destroy();
+
+	for (auto& frame : frameSync) {
+		vkDestroySemaphore(device, frame.presentComplete, nullptr);
+		vkDestroySemaphore(device, frame.renderComplete, nullptr);
+		vkDestroyFence(device, frame.fence, nullptr);
+	}
 	for (auto& fence : waitFences) {
 		vkDestroyFence(device, fence, nullptr);
 	}
@@ -790,6 +1021,7 @@ VulkanExampleBase::~VulkanExampleBase()
 		UIOverlay.freeResources();
 	}
 
+	delete vulkanDevice->uploadManager;
 	delete vulkanDevice;
 
 	if (settings.validation)
@@ -802,23 +1034,27 @@ VulkanExampleBase::~VulkanExampleBase()
 #if defined(_DIRECT2DISPLAY)
 
 #elif defined(VK_USE_PLATFORM_WAYLAND_KHR)
-	xdg_toplevel_destroy(xdg_toplevel);
-	xdg_surface_destroy(xdg_surface);
-	wl_surface_destroy(surface);
-	if (keyboard)
-		wl_keyboard_destroy(keyboard);
-	if (pointer)
-		wl_pointer_destroy(pointer);
-	wl_seat_destroy(seat);
-	xdg_wm_base_destroy(shell);
-	wl_compositor_destroy(compositor);
-	wl_registry_destroy(registry);
-	wl_display_disconnect(display);
+	if (!settings.headless) {
+		xdg_toplevel_destroy(xdg_toplevel);
+		xdg_surface_destroy(xdg_surface);
+		wl_surface_destroy(surface);
+		if (keyboard)
+			wl_keyboard_destroy(keyboard);
+		if (pointer)
+			wl_pointer_destroy(pointer);
+		wl_seat_destroy(seat);
+		xdg_wm_base_destroy(shell);
+		wl_compositor_destroy(compositor);
+		wl_registry_destroy(registry);
+		wl_display_disconnect(display);
+	}
 #elif defined(VK_USE_PLATFORM_ANDROID_KHR)
 	// todo : android cleanup (if required)
 #elif defined(VK_USE_PLATFORM_XCB_KHR)
-	xcb_destroy_window(connection, window);
-	xcb_disconnect(connection);
+	if (!settings.headless) {
+		xcb_destroy_window(connection, window);
+		xcb_disconnect(connection);
+	}
 #endif
 }
 
@@ -930,7 +1166,9 @@ bool VulkanExampleBase::initVulkan()
 	// This is handled by a separate class that gets a logical device representation
 	// and encapsulates functions related to a device
 	vulkanDevice = new vks::VulkanDevice(physicalDevice);
-	VkResult res = vulkanDevice->createLogicalDevice(enabledFeatures, enabledDeviceExtensions);
+	// The swapchain extension is not required in headless mode, but still enabled if available as it defines the present image layout used by the render passes
+	const bool useSwapChain = !settings.headless || vulkanDevice->extensionSupported(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	VkResult res = vulkanDevice->createLogicalDevice(enabledFeatures, enabledDeviceExtensions, useSwapChain);
 	if (res != VK_SUCCESS) {
 		vks::tools::exitFatal("Could not create Vulkan device: \n" + vks::tools::errorString(res), res);
 		return false;
@@ -940,20 +1178,37 @@ bool VulkanExampleBase::initVulkan()
 	// Get a graphics queue from the device
 	vkGetDeviceQueue(device, vulkanDevice->queueFamilyIndices.graphics, 0, &queue);
 
+	// Asset uploads of the base loaders are done via the upload manager, which uses a separate transfer queue if the device has one
+	vulkanDevice->uploadManager = new vks::UploadManager(vulkanDevice, queue);
+
 	// Find a suitable depth format
 	VkBool32 validDepthFormat = vks::tools::getSupportedDepthFormat(physicalDevice, &depthFormat);
 	assert(validDepthFormat);
 
+	swapChain.headless = settings.headless;
 	swapChain.connect(instance, physicalDevice, device);
 
+	// Examples that don't explicitly support multiple frames in flight wait for the queue to become idle after each frame
+	if (!framesInFlightSupported) {
+		settings.framesInFlight = 1;
+	}
+	benchmark.framesInFlight = settings.framesInFlight;
+
 	// Create synchronization objects
+	// One set of semaphores is required for each frame in flight
 	VkSemaphoreCreateInfo semaphoreCreateInfo = vks::initializers::semaphoreCreateInfo();
-	// Create a semaphore used to synchronize image presentation
-	// Ensures that the image is displayed before we start submitting new commands to the queu
-	VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &semaphores.presentComplete));
-	// Create a semaphore used to synchronize command submission
-	// Ensures that the image is not presented until all commands have been sumbitted and executed
-	VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &semaphores.renderComplete));
+	frameSync.resize(settings.framesInFlight);
+	for (auto& frame : frameSync) {
+		// Create a semaphore used to synchronize image presentation
+		// Ensures that the image is displayed before we start submitting new commands to the queu
+		VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &frame.presentComplete));
+		// Create a semaphore used to synchronize command submission
+		// Ensures that the image is not presented until all commands have been sumbitted and executed
+		VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &frame.renderComplete));
+		frame.fence = VK_NULL_HANDLE;
+	}
+	semaphores.presentComplete = frameSync[0].presentComplete;
+	semaphores.renderComplete = frameSync[0].renderComplete;
 
 	// Set up submit info structure
 	// Semaphores will stay the same during application lifetime
@@ -1018,6 +1273,10 @@ HWND VulkanExampleBase::setupWindow(HINSTANCE hinstance, WNDPROC wndproc)
 {
 	this->windowInstance = hinstance;
 
+	if (settings.headless) {
+		return nullptr;
+	}
+
 	WNDCLASSEX wndClass;
 
 	wndClass.cbSize = sizeof(WNDCLASSEX);
@@ -1414,6 +1673,7 @@ void VulkanExampleBase::handleAppCommand(android_app * app, int32_t cmd)
 			if (vulkanExample->initVulkan()) {
 				vulkanExample->prepare();
 				assert(vulkanExample->prepared);
+				vulkanExample->reportStartupTime();
 			}
 			else {
 				LOGE("Could not initialize Vulkan, exiting!");
@@ -1757,6 +2017,10 @@ static const struct xdg_toplevel_listener xdg_toplevel_listener = {
 
 struct xdg_surface *VulkanExampleBase::setupWindow()
 {
+	if (settings.headless) {
+		return nullptr;
+	}
+
 	surface = wl_compositor_create_surface(compositor);
 	xdg_surface = xdg_wm_base_get_xdg_surface(shell, surface);
 
@@ -1781,6 +2045,10 @@ static inline xcb_intern_atom_reply_t* intern_atom_helper(xcb_connection_t *conn
 // Set up a window using XCB and request event types
 xcb_window_t VulkanExampleBase::setupWindow()
 {
+	if (settings.headless) {
+		return 0;
+	}
+
 	uint32_t value_mask, value_list[32];
 
 	window = xcb_generate_id(connection);
@@ -1994,6 +2262,11 @@ void VulkanExampleBase::createSynchronizationPrimitives()
 	for (auto& fence : waitFences) {
 		VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &fence));
 	}
+	// Fences to limit the number of frames in flight, created in signalled state so the first wait won't block
+	for (auto& frame : frameSync) {
+		VK_CHECK_RESULT(vkCreateFence(device, &fenceCreateInfo, nullptr, &frame.fence));
+	}
+	imagesInFlight.assign(swapChain.imageCount, VK_NULL_HANDLE);
 }
 
 void VulkanExampleBase::createCommandPool()
@@ -2170,6 +2443,8 @@ void VulkanExampleBase::windowResize()
 	width = destWidth;
 	height = destHeight;
 	setupSwapChain();
+	// The device is idle, so no frame is using any of the (possibly recreated) swap chain images
+	imagesInFlight.assign(swapChain.imageCount, VK_NULL_HANDLE);
 
 	// Recreate the frame buffers
 	vkDestroyImageView(device, depthStencil.view, nullptr);
@@ -2251,6 +2526,10 @@ void VulkanExampleBase::windowResized()
 
 void VulkanExampleBase::initSwapchain()
 {
+	if (settings.headless) {
+		swapChain.initHeadless();
+		return;
+	}
 #if defined(_WIN32)
 	swapChain.initSurface(windowInstance, window);
 #elif defined(VK_USE_PLATFORM_ANDROID_KHR)	
@@ -50,6 +50,8 @@
 
 #include "VulkanInitializers.hpp"
 #include "VulkanDevice.hpp"
+#include "VulkanUploadManager.hpp"
+#include "VulkanGpuProfiler.hpp"
 #include "VulkanSwapChain.hpp"
 #include "camera.hpp"
 #include "benchmark.hpp"
@@ -70,6 +72,16 @@ private:
 	// Called if the window is resized and some resources have to be recreatesd
 	void windowResize();
 	void handleMouseMove(int32_t x, int32_t y);
+	/** @brief Time at which preparation of the example started, used to report startup times */
+	std::chrono::time_point<std::chrono::high_resolution_clock> tPrepareStart;
+	/** @brief True if the pipeline cache was initialized with valid data read from disk */
+	bool pipelineCacheLoaded = false;
+	// Returns the file name used to store the pipeline cache for this example
+	std::string getPipelineCacheFileName();
+	// Write the contents of the pipeline cache to disk
+	void savePipelineCache();
+	// Output the time it took to prepare the example along with the pipeline cache state
+	void reportStartupTime();
 protected:
 	// Frame counter to display fps
 	uint32_t frameCounter = 0;
@@ -123,6 +135,7 @@ protected:
 	// Wraps the swap chain to present images (framebuffers) to the windowing system
 	VulkanSwapChain swapChain;
 	// Synchronization semaphores
+	// If multiple frames are in flight, these point to the semaphores of the current frame (set by prepareFrame)
 	struct {
 		// Swap chain image presentation
 		VkSemaphore presentComplete;
@@ -130,6 +143,24 @@ protected:
 		VkSemaphore renderComplete;
 	} semaphores;
 	std::vector<VkFence> waitFences;
+	/** @brief Per-frame synchronization objects used if more than one frame is in flight */
+	struct FrameSync {
+		VkSemaphore presentComplete;
+		VkSemaphore renderComplete;
+		// Signalled once all work submitted for this frame has finished
+		VkFence fence;
+	};
+	std::vector<FrameSync> frameSync;
+	/** @brief Fence of the frame that last rendered to a swap chain image (indexed by image) */
+	std::vector<VkFence> imagesInFlight;
+	/** @brief Index of the current frame in flight (0..settings.framesInFlight-1) */
+	uint32_t currentFrame = 0;
+	/**
+	* Set to true in the derived constructor if the example supports more than one frame in flight
+	*
+	* @note Examples opting in must not overwrite resources still in use by the GPU, e.g. by using one uniform buffer per swap chain image
+	*/
+	bool framesInFlightSupported = false;
 public: 
 	bool prepared = false;
 	uint32_t width = 1280;
@@ -144,6 +175,9 @@ public:
 
 	vks::Benchmark benchmark;
 
+	/** @brief GPU timestamp profiler, examples add scopes to their command buffers using the swap chain image index as the slot */
+	vks::GpuProfiler gpuProfiler;
+
 	/** @brief Encapsulated physical and logical vulkan device */
 	vks::VulkanDevice *vulkanDevice;
 
@@ -157,6 +191,16 @@ public:
 		bool vsync = false;
 		/** @brief Enable UI overlay */
 		bool overlay = false;
+		/** @brief Number of frames the CPU may record ahead of the GPU (only used by examples that support it) */
+		uint32_t framesInFlight = 1;
+		/** @brief Upper limit for framesInFlight, more frames than swapchain images (usually two to four) only add latency */
+		uint32_t maxFramesInFlight = 4;
+		/** @brief Load and store the pipeline cache from/to disk to speed up pipeline creation on subsequent runs */
+		bool pipelineCache = true;
+		/** @brief Render to offscreen images without creating a window or surface (implies benchmark mode) */
+		bool headless = false;
+		/** @brief Block compress glTF images on the CPU at load time (only used by examples that support it) */
+		bool textureCompression = false;
 	} settings;
 
 	VkClearColorValue defaultClearColor = { { 0.025f, 0.025f, 0.025f, 1.0f } };
@@ -379,6 +423,7 @@ public:
 	void flushCommandBuffer(VkCommandBuffer commandBuffer, VkQueue queue, bool free);
 
 	// Create a cache pool for rendering pipelines
+	// If enabled, the cache is initialized with the data stored by a previous run on the same device and driver
 	void createPipelineCache();
 
 	// Prepare commonly used Vulkan functions
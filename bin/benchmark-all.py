@@ -7,6 +7,8 @@ import platform
 EXAMPLES = [
 	"bloom",
 	"computecloth",
+	"computeclusterculling",
+	"computegltfculling",
 	"computecullandlod",
 	"computenbody",
 	"computeparticles",
@@ -0,0 +1,385 @@
+/*
+* Vulkan Example - GPU driven rendering of a glTF scene using compute shader culling and indirect draws
+*
+* Instead of walking the node tree and issuing one draw per primitive, all primitives of the glTF model are stored in a primitive table
+* (index range, material, node matrix index and bounds) that is culled against the view frustum in a compute shader.
+* The shader writes one indexed indirect draw command per primitive, and the scene is drawn with one indirect draw per material
+*
+* Copyright (C) 2016-2017 by Sascha Willems - www.saschawillems.de
+*
+* This code is licensed under the MIT license (MIT) (http://opensource.org/licenses/MIT)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <vulkan/vulkan.h>
+#include "vulkanexamplebase.h"
+#include "VulkanglTFModel.hpp"
+#include "frustum.hpp"
+
+#define ENABLE_VALIDATION false
+
+class VulkanExample : public VulkanExampleBase
+{
+public:
+	bool gpuDriven = true;
+	bool frustumCulling = true;
+	bool fixedFrustum = false;
+	// Requires drawIndirectFirstInstance, otherwise only the node tree path is available
+	bool indirectSupported = false;
+
+	vkglTF::Model scene;
+
+	struct {
+		glm::mat4 projection;
+		glm::mat4 view;
+		glm::mat4 model;
+	} uboVS;
+
+	vks::Buffer uniformBuffer;
+
+	struct {
+		VkPipeline nodes;
+		VkPipeline indirect;
+	} pipelines;
+
+	struct {
+		VkPipelineLayout nodes;
+		VkPipelineLayout indirect;
+	} pipelineLayouts;
+
+	VkDescriptorSetLayout descriptorSetLayout;
+	VkDescriptorSet descriptorSet;
+
+	// View frustum for culling the scene's primitives
+	vks::Frustum frustum;
+
+	vkglTF::Model::IndirectDraw::Stats indirectStats{};
+	uint32_t primitiveCount = 0;
+
+	struct PushBlock {
+		glm::vec4 baseColorFactor;
+	};
+
+	VulkanExample() : VulkanExampleBase(ENABLE_VALIDATION)
+	{
+		title = "GPU driven glTF rendering";
+		settings.overlay = true;
+		camera.type = Camera::CameraType::lookat;
+		camera.setPerspective(45.0f, (float)width / (float)height, 0.1f, 512.0f);
+		camera.setRotation(glm::vec3(-2.25f, -52.0f, 0.0f));
+		camera.setTranslation(glm::vec3(1.9f, -2.05f, -18.0f));
+		camera.rotationSpeed *= 0.25f;
+	}
+
+	~VulkanExample()
+	{
+		vkDestroyPipeline(device, pipelines.nodes, nullptr);
+		vkDestroyPipelineLayout(device, pipelineLayouts.nodes, nullptr);
+		if (indirectSupported) {
+			vkDestroyPipeline(device, pipelines.indirect, nullptr);
+			vkDestroyPipelineLayout(device, pipelineLayouts.indirect, nullptr);
+		}
+		vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+		uniformBuffer.destroy();
+	}
+
+	virtual void getEnabledFeatures()
+	{
+		// Enable multi draw indirect if supported, so all draws of a material can be issued with a single call
+		if (deviceFeatures.multiDrawIndirect) {
+			enabledFeatures.multiDrawIndirect = VK_TRUE;
+		}
+		// The draw commands select the primitive table entry via firstInstance
+		if (deviceFeatures.drawIndirectFirstInstance) {
+			enabledFeatures.drawIndirectFirstInstance = VK_TRUE;
+		}
+		// Required for compressing the glTF images at load time ("-texturecompression")
+		if (deviceFeatures.textureCompressionBC) {
+			enabledFeatures.textureCompressionBC = VK_TRUE;
+		}
+	}
+
+	// Draws the scene by walking the node tree, with one dynamic offset bind per mesh and one draw per primitive
+	void renderNode(vkglTF::Node *node, VkCommandBuffer commandBuffer) {
+		if (node->mesh) {
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.nodes, 1, 1, &node->mesh->uniformBuffer.descriptorSet, 1, &node->mesh->uniformBuffer.dynamicOffset);
+			for (vkglTF::Primitive * primitive : node->mesh->primitives) {
+				PushBlock pushBlock;
+				pushBlock.baseColorFactor = primitive->material.baseColorFactor;
+				vkCmdPushConstants(commandBuffer, pipelineLayouts.nodes, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushBlock), &pushBlock);
+				vkCmdDrawIndexed(commandBuffer, primitive->indexCount, 1, primitive->firstIndex, 0, 0);
+			}
+		};
+		for (auto child : node->children) {
+			renderNode(child, commandBuffer);
+		}
+	}
+
+	void buildCommandBuffers()
+	{
+		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
+
+		VkClearValue clearValues[2];
+		clearValues[0].color = { { 1.0f, 1.0f, 1.0f, 1.0f } };
+		clearValues[1].depthStencil = { 1.0f, 0 };
+
+		VkRenderPassBeginInfo renderPassBeginInfo = vks::initializers::renderPassBeginInfo();
+		renderPassBeginInfo.renderPass = renderPass;
+		renderPassBeginInfo.renderArea.offset.x = 0;
+		renderPassBeginInfo.renderArea.offset.y = 0;
+		renderPassBeginInfo.renderArea.extent.width = width;
+		renderPassBeginInfo.renderArea.extent.height = height;
+		renderPassBeginInfo.clearValueCount = 2;
+		renderPassBeginInfo.pClearValues = clearValues;
+
+		for (int32_t i = 0; i < drawCmdBuffers.size(); ++i) {
+			renderPassBeginInfo.framebuffer = frameBuffers[i];
+
+			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
+
+			// The culling dispatch writes the draw commands consumed by the indirect draws inside the render pass
+			if (gpuDriven) {
+				scene.cullIndirect(drawCmdBuffers[i]);
+			}
+
+			vkCmdBeginRenderPass(drawCmdBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+			VkViewport viewport = vks::initializers::viewport((float)width, (float)height, 0.0f, 1.0f);
+			vkCmdSetViewport(drawCmdBuffers[i], 0, 1, &viewport);
+			VkRect2D scissor = vks::initializers::rect2D(width, height, 0, 0);
+			vkCmdSetScissor(drawCmdBuffers[i], 0, 1, &scissor);
+
+			if (gpuDriven) {
+				const std::array<VkDescriptorSet, 2> descriptorSets = { descriptorSet, scene.indirect.descriptorSet };
+				vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.indirect, 0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), 0, NULL);
+				vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.indirect);
+				// One indirect draw per material, the material's color is passed via push constants
+				VkCommandBuffer commandBuffer = drawCmdBuffers[i];
+				VkPipelineLayout pipelineLayout = pipelineLayouts.indirect;
+				scene.drawIndirect(commandBuffer, [commandBuffer, pipelineLayout](const vkglTF::Material &material) {
+					PushBlock pushBlock;
+					pushBlock.baseColorFactor = material.baseColorFactor;
+					vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushBlock), &pushBlock);
+				});
+			} else {
+				vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.nodes, 0, 1, &descriptorSet, 0, NULL);
+				vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.nodes);
+				const VkDeviceSize offsets[1] = { 0 };
+				vkCmdBindVertexBuffers(drawCmdBuffers[i], 0, 1, &scene.vertices.buffer, offsets);
+				vkCmdBindIndexBuffer(drawCmdBuffers[i], scene.indices.buffer, 0, scene.indices.type);
+				for (auto node : scene.nodes) {
+					renderNode(node, drawCmdBuffers[i]);
+				}
+			}
+
+			drawUI(drawCmdBuffers[i]);
+
+			vkCmdEndRenderPass(drawCmdBuffers[i]);
+
+			VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
+		}
+	}
+
+	void loadAssets()
+	{
+		scene.textureCompression.enabled = settings.textureCompression;
+		scene.loadFromFile(getAssetPath() + "models/gltf/glTF-Embedded/Buggy.gltf", vulkanDevice, queue);
+		indirectSupported = vulkanDevice->enabledFeatures.drawIndirectFirstInstance;
+		if (indirectSupported) {
+			// Builds the primitive table and the culling pipeline
+			scene.prepareIndirect(getAssetPath() + "shaders/base/gltfcull.comp.spv");
+			primitiveCount = static_cast<uint32_t>(scene.indirect.primitives.size());
+		} else {
+			std::cout << "drawIndirectFirstInstance not supported, GPU driven rendering disabled" << std::endl;
+			gpuDriven = false;
+		}
+	}
+
+	void setupDescriptorSets()
+	{
+		std::vector<VkDescriptorPoolSize> poolSizes = {
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1),
+		};
+		VkDescriptorPoolCreateInfo descriptorPoolCI = vks::initializers::descriptorPoolCreateInfo(poolSizes.size(), poolSizes.data(), 1);
+		VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolCI, nullptr, &descriptorPool));
+
+		std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings = {
+			vks::initializers::descriptorSetLayoutBinding(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT, 0),
+		};
+		VkDescriptorSetLayoutCreateInfo descriptorLayoutCI = vks::initializers::descriptorSetLayoutCreateInfo(setLayoutBindings);
+		VK_CHECK_RESULT(vkCreateDescriptorSetLayout(device, &descriptorLayoutCI, nullptr, &descriptorSetLayout));
+
+		VkPushConstantRange pushConstantRange = vks::initializers::pushConstantRange(VK_SHADER_STAGE_VERTEX_BIT, sizeof(PushBlock), 0);
+
+		// Node tree path: Set 1 is the model's dynamic mesh uniform buffer
+		std::array<VkDescriptorSetLayout, 2> setLayouts = { descriptorSetLayout, scene.descriptorSetLayout };
+		VkPipelineLayoutCreateInfo pipelineLayoutCI = vks::initializers::pipelineLayoutCreateInfo(setLayouts.data(), static_cast<uint32_t>(setLayouts.size()));
+		pipelineLayoutCI.pushConstantRangeCount = 1;
+		pipelineLayoutCI.pPushConstantRanges = &pushConstantRange;
+		VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCI, nullptr, &pipelineLayouts.nodes));
+
+		// Indirect path: Set 1 contains the primitive table and the node matrices
+		if (indirectSupported) {
+			setLayouts = { descriptorSetLayout, scene.indirect.descriptorSetLayout };
+			VK_CHECK_RESULT(vkCreatePipelineLayout(device, &pipelineLayoutCI, nullptr, &pipelineLayouts.indirect));
+		}
+
+		VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);
+		VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &descriptorSetAllocateInfo, &descriptorSet));
+		std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+			vks::initializers::writeDescriptorSet(descriptorSet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 0, &uniformBuffer.descriptor)
+		};
+		vkUpdateDescriptorSets(device, writeDescriptorSets.size(), writeDescriptorSets.data(), 0, NULL);
+	}
+
+	void preparePipelines()
+	{
+		const std::vector<VkDynamicState> dynamicStateEnables = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCI = vks::initializers::pipelineInputAssemblyStateCreateInfo(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, 0, VK_FALSE);
+		VkPipelineRasterizationStateCreateInfo rasterizationStateCI = vks::initializers::pipelineRasterizationStateCreateInfo(VK_POLYGON_MODE_FILL, VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_COUNTER_CLOCKWISE, 0);
+		VkPipelineColorBlendAttachmentState blendAttachmentState = vks::initializers::pipelineColorBlendAttachmentState(0xf, VK_FALSE);
+		VkPipelineColorBlendStateCreateInfo colorBlendStateCI = vks::initializers::pipelineColorBlendStateCreateInfo(1, &blendAttachmentState);
+		VkPipelineDepthStencilStateCreateInfo depthStencilStateCI = vks::initializers::pipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS_OR_EQUAL);
+		VkPipelineViewportStateCreateInfo viewportStateCI = vks::initializers::pipelineViewportStateCreateInfo(1, 1, 0);
+		VkPipelineMultisampleStateCreateInfo multisampleStateCI = vks::initializers::pipelineMultisampleStateCreateInfo(VK_SAMPLE_COUNT_1_BIT, 0);
+		VkPipelineDynamicStateCreateInfo dynamicStateCI = vks::initializers::pipelineDynamicStateCreateInfo(dynamicStateEnables.data(), static_cast<uint32_t>(dynamicStateEnables.size()), 0);
+
+		// Vertex bindings and attributes
+		const std::vector<VkVertexInputBindingDescription> vertexInputBindings = {
+			vks::initializers::vertexInputBindingDescription(0, sizeof(vkglTF::Model::Vertex), VK_VERTEX_INPUT_RATE_VERTEX),
+		};
+		const std::vector<VkVertexInputAttributeDescription> vertexInputAttributes = {
+			vks::initializers::vertexInputAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0),					// Location 0: Position
+			vks::initializers::vertexInputAttributeDescription(0, 1, VK_FORMAT_R32G32B32_SFLOAT, sizeof(float) * 3),	// Location 1: Normal
+			vks::initializers::vertexInputAttributeDescription(0, 2, VK_FORMAT_R32G32_SFLOAT, sizeof(float) * 6),		// Location 2: UV
+		};
+		VkPipelineVertexInputStateCreateInfo vertexInputState = vks::initializers::pipelineVertexInputStateCreateInfo();
+		vertexInputState.vertexBindingDescriptionCount = static_cast<uint32_t>(vertexInputBindings.size());
+		vertexInputState.pVertexBindingDescriptions = vertexInputBindings.data();
+		vertexInputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputAttributes.size());
+		vertexInputState.pVertexAttributeDescriptions = vertexInputAttributes.data();
+
+		VkGraphicsPipelineCreateInfo pipelineCreateInfoCI = vks::initializers::pipelineCreateInfo(pipelineLayouts.nodes, renderPass, 0);
+		pipelineCreateInfoCI.pVertexInputState = &vertexInputState;
+		pipelineCreateInfoCI.pInputAssemblyState = &inputAssemblyStateCI;
+		pipelineCreateInfoCI.pRasterizationState = &rasterizationStateCI;
+		pipelineCreateInfoCI.pColorBlendState = &colorBlendStateCI;
+		pipelineCreateInfoCI.pMultisampleState = &multisampleStateCI;
+		pipelineCreateInfoCI.pViewportState = &viewportStateCI;
+		pipelineCreateInfoCI.pDepthStencilState = &depthStencilStateCI;
+		pipelineCreateInfoCI.pDynamicState = &dynamicStateCI;
+
+		std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages = {
+			loadShader(getAssetPath() + "shaders/computegltfculling/node.vert.spv", VK_SHADER_STAGE_VERTEX_BIT),
+			loadShader(getAssetPath() + "shaders/computegltfculling/mesh.frag.spv", VK_SHADER_STAGE_FRAGMENT_BIT)
+		};
+		pipelineCreateInfoCI.stageCount = static_cast<uint32_t>(shaderStages.size());
+		pipelineCreateInfoCI.pStages = shaderStages.data();
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfoCI, nullptr, &pipelines.nodes));
+
+		// Fetches the node matrix from the primitive table instead of a per-mesh uniform buffer
+		if (indirectSupported) {
+			shaderStages[0] = loadShader(getAssetPath() + "shaders/computegltfculling/indirect.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+			pipelineCreateInfoCI.layout = pipelineLayouts.indirect;
+			VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfoCI, nullptr, &pipelines.indirect));
+		}
+	}
+
+	void prepareUniformBuffers()
+	{
+		VK_CHECK_RESULT(vulkanDevice->createBuffer(
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&uniformBuffer,
+			sizeof(uboVS)));
+		VK_CHECK_RESULT(uniformBuffer.map());
+		updateUniformBuffers();
+	}
+
+	void updateUniformBuffers()
+	{
+		uboVS.projection = camera.matrices.perspective;
+		uboVS.view = glm::scale(camera.matrices.view, glm::vec3(0.1f , -0.1f, 0.1f));
+		uboVS.model = glm::translate(glm::mat4(1.0f), scene.dimensions.min);
+		memcpy(uniformBuffer.mapped, &uboVS, sizeof(uboVS));
+
+		if (indirectSupported) {
+			if (!fixedFrustum) {
+				frustum.update(uboVS.projection * uboVS.view);
+			}
+			scene.updateIndirectCulling(uboVS.model, frustum.planes.data(), frustumCulling);
+		}
+	}
+
+	void draw()
+	{
+		VulkanExampleBase::prepareFrame();
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &drawCmdBuffers[currentBuffer];
+		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE));
+		VulkanExampleBase::submitFrame();
+		// The frame has finished execution at this point (submitFrame waits for the queue to become idle)
+		if (gpuDriven) {
+			indirectStats = scene.getIndirectStats();
+		}
+	}
+
+	void prepare()
+	{
+		VulkanExampleBase::prepare();
+		loadAssets();
+		prepareUniformBuffers();
+		setupDescriptorSets();
+		preparePipelines();
+		buildCommandBuffers();
+		prepared = true;
+	}
+
+	virtual void render()
+	{
+		if (!prepared)
+			return;
+		draw();
+		if (camera.updated) {
+			updateUniformBuffers();
+		}
+	}
+
+	virtual void OnUpdateUIOverlay(vks::UIOverlay *overlay)
+	{
+		if (!indirectSupported) {
+			overlay->text("drawIndirectFirstInstance not supported");
+			return;
+		}
+		if (overlay->header("Settings")) {
+			if (overlay->checkBox("GPU driven (indirect)", &gpuDriven)) {
+				buildCommandBuffers();
+			}
+			if (overlay->checkBox("Frustum culling", &frustumCulling)) {
+				updateUniformBuffers();
+			}
+			if (overlay->checkBox("Freeze frustum", &fixedFrustum)) {
+				updateUniformBuffers();
+			}
+		}
+		if (gpuDriven && overlay->header("Statistics")) {
+			overlay->text("Primitives: %d / %d", indirectStats.visiblePrimitives, primitiveCount);
+			overlay->text("Triangles: %d", indirectStats.visibleTriangles);
+			overlay->text("Material batches: %d", static_cast<int32_t>(scene.indirect.batches.size()));
+		}
+	}
+
+};
+
+VULKAN_EXAMPLE_MAIN()
@@ -84,7 +84,8 @@ public:
 					descriptorSet,
 					node->mesh->uniformBuffer.descriptorSet
 				};
-				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, static_cast<uint32_t>(descriptorsets.size()), descriptorsets.data(), 0, NULL);
+				// All meshes share one dynamic uniform buffer, the offset selects the mesh's matrix
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, static_cast<uint32_t>(descriptorsets.size()), descriptorsets.data(), 1, &node->mesh->uniformBuffer.dynamicOffset);
 				
 				struct PushBlock {
 					glm::vec4 baseColorFactor;
@@ -155,7 +156,7 @@ public:
 				
 			const VkDeviceSize offsets[1] = { 0 };
 			vkCmdBindVertexBuffers(drawCmdBuffers[i], 0, 1, &scene.vertices.buffer, offsets);
-			vkCmdBindIndexBuffer(drawCmdBuffers[i], scene.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(drawCmdBuffers[i], scene.indices.buffer, 0, scene.indices.type);
 			for (auto node : scene.nodes) {
 				renderNode(node, drawCmdBuffers[i]);
 			}
@@ -168,8 +169,17 @@ public:
 		}
 	}
 
+	virtual void getEnabledFeatures()
+	{
+		// Required for compressing the glTF images at load time ("-texturecompression")
+		if (deviceFeatures.textureCompressionBC) {
+			enabledFeatures.textureCompressionBC = VK_TRUE;
+		}
+	}
+
 	void loadAssets()
 	{
+		scene.textureCompression.enabled = settings.textureCompression;
 		scene.loadFromFile(getAssetPath() + "models/gltf/glTF-Embedded/Buggy.gltf", vulkanDevice, queue);
 	}
 
@@ -495,6 +495,9 @@ public:
 
 	void loadAssets()
 	{
+		// Collect all asset uploads into a single batch instead of waiting for each upload separately
+		vulkanDevice->uploadManager->beginBatch();
+
 		models.model.loadFromFile(getAssetPath() + "models/armor/armor.dae", vertexLayout, 1.0f, vulkanDevice, queue);
 
 		vks::ModelCreateInfo modelCreateInfo;
@@ -527,6 +530,8 @@ public:
 		textures.model.normalMap.loadFromFile(getAssetPath() + "models/armor/normal" + texFormatSuffix + ".ktx", texFormat, vulkanDevice, queue);
 		textures.floor.colorMap.loadFromFile(getAssetPath() + "textures/stonefloor01_color" + texFormatSuffix + ".ktx", texFormat, vulkanDevice, queue);
 		textures.floor.normalMap.loadFromFile(getAssetPath() + "textures/stonefloor01_normal" + texFormatSuffix + ".ktx", texFormat, vulkanDevice, queue);
+
+		vulkanDevice->uploadManager->wait(vulkanDevice->uploadManager->endBatch());
 	}
 
 	void reBuildCommandBuffers()
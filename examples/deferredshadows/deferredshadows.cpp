@@ -52,6 +52,10 @@ class VulkanExample : public VulkanExampleBase
 public:
 	bool debugDisplay = false;
 	bool enableShadows = true;
+	// Render the shadow maps from the models' position only vertex streams
+	bool positionOnlyShadowPass = true;
+	// Measures the GPU time of the passes in the offscreen command buffer
+	vks::GpuProfiler offscreenProfiler;
 
 	// Keep depth range as small as possible
 	// for better shadow map precision
@@ -93,6 +97,10 @@ public:
 		VkPipelineVertexInputStateCreateInfo inputState;
 		std::vector<VkVertexInputBindingDescription> bindingDescriptions;
 		std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+		// Input state for the models' position only depth streams
+		VkPipelineVertexInputStateCreateInfo depthInputState;
+		VkVertexInputBindingDescription depthBindingDescription;
+		VkVertexInputAttributeDescription depthAttributeDescription;
 	} vertices;
 
 	struct {
@@ -136,6 +144,7 @@ public:
 		VkPipeline offscreen;
 		VkPipeline debug;
 		VkPipeline shadowpass;
+		VkPipeline shadowpassPositions;
 	} pipelines;
 
 	struct {
@@ -198,9 +207,20 @@ public:
 			delete frameBuffers.shadow;
 		}
 
+		if (benchmark.active) {
+			// The offscreen passes are measured by a separate profiler, report them next to the benchmark's GPU times
+			vkDeviceWaitIdle(device);
+			offscreenProfiler.update();
+			for (auto& timing : offscreenProfiler.getTimings()) {
+				std::cout << "gpu    : " << timing.name << " avg " << timing.average() << " ms (min " << timing.min << " ms, max " << timing.max << " ms)" << std::endl;
+			}
+		}
+		offscreenProfiler.destroy();
+
 		vkDestroyPipeline(device, pipelines.deferred, nullptr);
 		vkDestroyPipeline(device, pipelines.offscreen, nullptr);
 		vkDestroyPipeline(device, pipelines.shadowpass, nullptr);
+		vkDestroyPipeline(device, pipelines.shadowpassPositions, nullptr);
 		vkDestroyPipeline(device, pipelines.debug, nullptr);
 
 		vkDestroyPipelineLayout(device, pipelineLayouts.deferred, nullptr);
@@ -331,21 +351,34 @@ public:
 		VK_CHECK_RESULT(frameBuffers.deferred->createRenderPass());
 	}
 
+	// The position only shadow pass pipeline can only be used if all models have a depth stream (it is not created if the layout lacks a component)
+	bool useDepthStreams()
+	{
+		return positionOnlyShadowPass && models.background.hasDepthStream() && models.model.hasDepthStream();
+	}
+
+	// Bind the vertex and index buffers of a model, the shadow pass may use the position only depth stream
+	void bindModelBuffers(VkCommandBuffer cmdBuffer, vks::Model &model, bool depthStream)
+	{
+		VkDeviceSize offsets[1] = { 0 };
+		// The depth stream has its own (reordered) indices with the same index count
+		vkCmdBindVertexBuffers(cmdBuffer, VERTEX_BUFFER_BIND_ID, 1, depthStream ? &model.depthStream.vertices.buffer : &model.vertices.buffer, offsets);
+		vkCmdBindIndexBuffer(cmdBuffer, depthStream ? model.depthStream.indices.buffer : model.indices.buffer, 0, model.indexType);
+	}
+
 	// Put render commands for the scene into the given command buffer
 	void renderScene(VkCommandBuffer cmdBuffer, bool shadow)
 	{
-		VkDeviceSize offsets[1] = { 0 };
+		const bool depthStreams = shadow && useDepthStreams();
 
 		// Background
 		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.offscreen, 0, 1, shadow ? &descriptorSets.shadow : &descriptorSets.background, 0, NULL);
-		vkCmdBindVertexBuffers(cmdBuffer, VERTEX_BUFFER_BIND_ID, 1, &models.background.vertices.buffer, offsets);
-		vkCmdBindIndexBuffer(cmdBuffer, models.background.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		bindModelBuffers(cmdBuffer, models.background, depthStreams);
 		vkCmdDrawIndexed(cmdBuffer, models.background.indexCount, 1, 0, 0, 0);
 
 		// Objects
 		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.offscreen, 0, 1, shadow ? &descriptorSets.shadow : &descriptorSets.model, 0, NULL);
-		vkCmdBindVertexBuffers(cmdBuffer, VERTEX_BUFFER_BIND_ID, 1, &models.model.vertices.buffer, offsets);
-		vkCmdBindIndexBuffer(cmdBuffer, models.model.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		bindModelBuffers(cmdBuffer, models.model, depthStreams);
 		vkCmdDrawIndexed(cmdBuffer, models.model.indexCount, 3, 0, 0, 0);
 	}
 
@@ -358,8 +391,11 @@ public:
 		}
 
 		// Create a semaphore used to synchronize offscreen rendering and usage
-		VkSemaphoreCreateInfo semaphoreCreateInfo = vks::initializers::semaphoreCreateInfo();
-		VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &offscreenSemaphore));
+		if (offscreenSemaphore == VK_NULL_HANDLE)
+		{
+			VkSemaphoreCreateInfo semaphoreCreateInfo = vks::initializers::semaphoreCreateInfo();
+			VK_CHECK_RESULT(vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &offscreenSemaphore));
+		}
 
 		VkCommandBufferBeginInfo cmdBufInfo = vks::initializers::commandBufferBeginInfo();
 
@@ -381,6 +417,7 @@ public:
 		renderPassBeginInfo.pClearValues = clearValues.data();
 
 		VK_CHECK_RESULT(vkBeginCommandBuffer(commandBuffers.deferred, &cmdBufInfo));
+		offscreenProfiler.beginCommandBuffer(commandBuffers.deferred, 0);
 
 		viewport = vks::initializers::viewport((float)frameBuffers.shadow->width, (float)frameBuffers.shadow->height, 0.0f, 1.0f);
 		vkCmdSetViewport(commandBuffers.deferred, 0, 1, &viewport);
@@ -395,10 +432,12 @@ public:
 			0.0f,
 			depthBiasSlope);
 
+		offscreenProfiler.beginScope(commandBuffers.deferred, "Shadow pass");
 		vkCmdBeginRenderPass(commandBuffers.deferred, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-		vkCmdBindPipeline(commandBuffers.deferred, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.shadowpass);
+		vkCmdBindPipeline(commandBuffers.deferred, VK_PIPELINE_BIND_POINT_GRAPHICS, useDepthStreams() ? pipelines.shadowpassPositions : pipelines.shadowpass);
 		renderScene(commandBuffers.deferred, true);
 		vkCmdEndRenderPass(commandBuffers.deferred);
+		offscreenProfiler.endScope(commandBuffers.deferred);
 
 		// Second pass: Deferred calculations
 		// -------------------------------------------------------------------------------------------------------
@@ -416,6 +455,7 @@ public:
 		renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 		renderPassBeginInfo.pClearValues = clearValues.data();
 
+		offscreenProfiler.beginScope(commandBuffers.deferred, "G-Buffer pass");
 		vkCmdBeginRenderPass(commandBuffers.deferred, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 		viewport = vks::initializers::viewport((float)frameBuffers.deferred->width, (float)frameBuffers.deferred->height, 0.0f, 1.0f);
@@ -427,15 +467,19 @@ public:
 		vkCmdBindPipeline(commandBuffers.deferred, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.offscreen);
 		renderScene(commandBuffers.deferred, false);
 		vkCmdEndRenderPass(commandBuffers.deferred);
+		offscreenProfiler.endScope(commandBuffers.deferred);
 
+		offscreenProfiler.endCommandBuffer();
 		VK_CHECK_RESULT(vkEndCommandBuffer(commandBuffers.deferred));
 	}
 
 	void loadAssets()
 	{
-		models.model.loadFromFile(getAssetPath() + "models/armor/armor.dae", vertexLayout, 1.0f, vulkanDevice, queue);
+		// Both models also get a position only vertex stream for the shadow pass
+		vks::ModelCreateInfo modelCreateInfo(1.0f, 1.0f, 0.0f);
+		modelCreateInfo.depthStreamComponents = { vks::VERTEX_COMPONENT_POSITION };
+		models.model.loadFromFile(getAssetPath() + "models/armor/armor.dae", vertexLayout, &modelCreateInfo, vulkanDevice, queue);
 
-		vks::ModelCreateInfo modelCreateInfo;
 		modelCreateInfo.scale = glm::vec3(15.0f);
 		modelCreateInfo.uvscale = glm::vec2(1.0f, 1.5f);
 		modelCreateInfo.center = glm::vec3(0.0f, 2.3f, 0.0f);
@@ -635,6 +679,15 @@ public:
 		vertices.inputState.pVertexBindingDescriptions = vertices.bindingDescriptions.data();
 		vertices.inputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertices.attributeDescriptions.size());
 		vertices.inputState.pVertexAttributeDescriptions = vertices.attributeDescriptions.data();
+
+		// Position only depth stream
+		vertices.depthBindingDescription = vks::initializers::vertexInputBindingDescription(VERTEX_BUFFER_BIND_ID, sizeof(float) * 3, VK_VERTEX_INPUT_RATE_VERTEX);
+		vertices.depthAttributeDescription = vks::initializers::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 0, VK_FORMAT_R32G32B32_SFLOAT, 0);
+		vertices.depthInputState = vks::initializers::pipelineVertexInputStateCreateInfo();
+		vertices.depthInputState.vertexBindingDescriptionCount = 1;
+		vertices.depthInputState.pVertexBindingDescriptions = &vertices.depthBindingDescription;
+		vertices.depthInputState.vertexAttributeDescriptionCount = 1;
+		vertices.depthInputState.pVertexAttributeDescriptions = &vertices.depthAttributeDescription;
 	}
 
 	void setupDescriptorPool()
@@ -987,6 +1040,9 @@ public:
 		// Reset blend attachment state
 		pipelineCreateInfo.renderPass = frameBuffers.shadow->renderPass;
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipelines.shadowpass));
+		// Same shaders reading the position only depth streams
+		pipelineCreateInfo.pVertexInputState = &vertices.depthInputState;
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipelines.shadowpassPositions));
 	}
 
 	// Prepare and initialize uniform buffer containing shader uniforms
@@ -1124,6 +1180,8 @@ public:
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &commandBuffers.deferred;
 		VK_CHECK_RESULT(vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE));
+		offscreenProfiler.frameSubmitted(0);
+		offscreenProfiler.update();
 
 		// Scene rendering
 
@@ -1142,6 +1200,7 @@ public:
 	void prepare()
 	{
 		VulkanExampleBase::prepare();
+		offscreenProfiler.prepare(vulkanDevice, swapChain.queueNodeIndex, 1);
 		loadAssets();
 		generateQuads();
 		setupVertexDescriptions();
@@ -1183,6 +1242,19 @@ public:
 				uboFragmentLights.useShadows = shadows;
 				updateUniformBufferDeferredLights();
 			}
+			if (overlay->checkBox("Position only shadow pass", &positionOnlyShadowPass)) {
+				buildDeferredCommandBuffer();
+				// Averages are measured separately for both modes
+				offscreenProfiler.resetTimings();
+			}
+		}
+		if (overlay->header("Statistics")) {
+			if (!offscreenProfiler.supported()) {
+				overlay->text("Timestamps not supported");
+			}
+			for (auto& timing : offscreenProfiler.getTimings()) {
+				overlay->text("%s: %.3f ms (avg %.3f ms)", timing.name.c_str(), timing.last, timing.average());
+			}
 		}
 	}
 };
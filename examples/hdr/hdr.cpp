@@ -212,7 +212,11 @@ public:
 
 			VK_CHECK_RESULT(vkBeginCommandBuffer(drawCmdBuffers[i], &cmdBufInfo));
 
+			gpuProfiler.beginCommandBuffer(drawCmdBuffers[i], i);
+
 			// Bloom filter
+			gpuProfiler.beginScope(drawCmdBuffers[i], "Bloom filter");
+
 			renderPassBeginInfo.framebuffer = filterPass.frameBuffer;
 			renderPassBeginInfo.renderPass = filterPass.renderPass;
 			renderPassBeginInfo.clearValueCount = 1;
@@ -234,10 +238,14 @@ public:
 
 			vkCmdEndRenderPass(drawCmdBuffers[i]);
 
+			gpuProfiler.endScope(drawCmdBuffers[i]);
+
 			viewport = vks::initializers::viewport((float)width, (float)height, 0.0f, 1.0f);
 			scissor = vks::initializers::rect2D(width, height, 0, 0);
 
 			// Final composition
+			gpuProfiler.beginScope(drawCmdBuffers[i], "Composition");
+
 			renderPassBeginInfo.framebuffer = frameBuffers[i];
 			renderPassBeginInfo.renderPass = renderPass;
 			renderPassBeginInfo.clearValueCount = 2;
@@ -252,20 +260,31 @@ public:
 			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.composition, 0, 1, &descriptorSets.composition, 0, NULL);
 
 			// Scene
-			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.composition);
-			vkCmdDraw(drawCmdBuffers[i], 3, 1, 0, 0);
+			{
+				vks::GpuProfiler::Scope scope(gpuProfiler, drawCmdBuffers[i], "Tone mapping");
+				vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.composition);
+				vkCmdDraw(drawCmdBuffers[i], 3, 1, 0, 0);
+			}
 
 			// Bloom
 			if (bloom)
 			{
+				vks::GpuProfiler::Scope scope(gpuProfiler, drawCmdBuffers[i], "Bloom");
 				vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.bloom[0]);
 				vkCmdDraw(drawCmdBuffers[i], 3, 1, 0, 0);
 			}
 
-			drawUI(drawCmdBuffers[i]);
+			{
+				vks::GpuProfiler::Scope scope(gpuProfiler, drawCmdBuffers[i], "UI overlay");
+				drawUI(drawCmdBuffers[i]);
+			}
 
 			vkCmdEndRenderPass(drawCmdBuffers[i]);
 
+			gpuProfiler.endScope(drawCmdBuffers[i]);
+
+			gpuProfiler.endCommandBuffer();
+
 			VK_CHECK_RESULT(vkEndCommandBuffer(drawCmdBuffers[i]));
 		}
 	}
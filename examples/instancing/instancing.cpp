@@ -50,6 +50,15 @@ public:
 		vks::VERTEX_COMPONENT_COLOR,
 	});
 
+	// Quantized vertex layout selected with -compactvertices: 20 instead of 44 bytes per vertex
+	vks::VertexLayout compactVertexLayout = vks::VertexLayout({
+		vks::VERTEX_COMPONENT_POSITION_HALF,
+		vks::VERTEX_COMPONENT_NORMAL_PACKED,
+		vks::VERTEX_COMPONENT_UV_HALF,
+		vks::VERTEX_COMPONENT_COLOR_UNORM8,
+	});
+	bool compactVertices = false;
+
 	struct {
 		vks::Model rock;
 		vks::Model planet;
@@ -78,8 +87,9 @@ public:
 		float globSpeed = 0.0f;
 	} uboVS;
 
+	// One uniform buffer per swap chain image, so the CPU can update a frame's matrices while previous frames are still in flight
 	struct {
-		vks::Buffer scene;
+		std::vector<vks::Buffer> scene;
 	} uniformBuffers;
 
 	VkPipelineLayout pipelineLayout;
@@ -90,10 +100,12 @@ public:
 	} pipelines;
 
 	VkDescriptorSetLayout descriptorSetLayout;
-	struct {
+	// Per swap chain image
+	struct DescriptorSets {
 		VkDescriptorSet instancedRocks;
 		VkDescriptorSet planet;
-	} descriptorSets;
+	};
+	std::vector<DescriptorSets> descriptorSets;
 
 	VulkanExample() : VulkanExampleBase(ENABLE_VALIDATION)
 	{
@@ -103,6 +115,12 @@ public:
 		cameraPos = { 5.5f, -1.85f, 0.0f };
 		rotationSpeed = 0.25f;
 		settings.overlay = true;
+		framesInFlightSupported = true;
+		for (size_t i = 0; i < args.size(); i++) {
+			if (args[i] == std::string("-compactvertices")) {
+				compactVertices = true;
+			}
+		}
 	}
 
 	~VulkanExample()
@@ -118,7 +136,9 @@ public:
 		models.planet.destroy();
 		textures.rocks.destroy();
 		textures.planet.destroy();
-		uniformBuffers.scene.destroy();
+		for (auto& uniformBuffer : uniformBuffers.scene) {
+			uniformBuffer.destroy();
+		}
 	}
 
 	// Enable physical device features required for this example				
@@ -173,19 +193,19 @@ public:
 			VkDeviceSize offsets[1] = { 0 };
 
 			// Star field
-			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets.planet, 0, NULL);
+			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[i].planet, 0, NULL);
 			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.starfield);
 			vkCmdDraw(drawCmdBuffers[i], 4, 1, 0, 0);
 
 			// Planet
-			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets.planet, 0, NULL);
+			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[i].planet, 0, NULL);
 			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.planet);
 			vkCmdBindVertexBuffers(drawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &models.planet.vertices.buffer, offsets);
 			vkCmdBindIndexBuffer(drawCmdBuffers[i], models.planet.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
 			vkCmdDrawIndexed(drawCmdBuffers[i], models.planet.indexCount, 1, 0, 0, 0);
 
 			// Instanced rocks
-			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets.instancedRocks, 0, NULL);
+			vkCmdBindDescriptorSets(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSets[i].instancedRocks, 0, NULL);
 			vkCmdBindPipeline(drawCmdBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.instancedRocks);
 			// Binding point 0 : Mesh vertex buffer
 			vkCmdBindVertexBuffers(drawCmdBuffers[i], VERTEX_BUFFER_BIND_ID, 1, &models.rock.vertices.buffer, offsets);
@@ -207,6 +227,14 @@ public:
 
 	void loadAssets()
 	{
+		if (compactVertices) {
+			if (compactVertexLayout.supported(physicalDevice)) {
+				vertexLayout = compactVertexLayout;
+			} else {
+				std::cout << "Quantized vertex formats are not supported by the device, using the float vertex layout" << std::endl;
+				compactVertices = false;
+			}
+		}
 		models.rock.loadFromFile(getAssetPath() + "models/rock01.dae", vertexLayout, 0.1f, vulkanDevice, queue);
 		models.planet.loadFromFile(getAssetPath() + "models/sphere.obj", vertexLayout, 0.2f, vulkanDevice, queue);
 
@@ -236,18 +264,19 @@ public:
 
 	void setupDescriptorPool()
 	{
-		// Example uses one ubo 
+		// Example uses one ubo per swap chain image
+		const uint32_t imageCount = static_cast<uint32_t>(uniformBuffers.scene.size());
 		std::vector<VkDescriptorPoolSize> poolSizes =
 		{
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2),
-			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 * imageCount),
+			vks::initializers::descriptorPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 * imageCount),
 		};
 
 		VkDescriptorPoolCreateInfo descriptorPoolInfo =
 			vks::initializers::descriptorPoolCreateInfo(
 				poolSizes.size(),
 				poolSizes.data(),
-				2);
+				2 * imageCount);
 
 		VK_CHECK_RESULT(vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool));
 	}
@@ -290,22 +319,24 @@ public:
 
 		descripotrSetAllocInfo = vks::initializers::descriptorSetAllocateInfo(descriptorPool, &descriptorSetLayout, 1);;
 
-		// Instanced rocks
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &descripotrSetAllocInfo, &descriptorSets.instancedRocks));
-		writeDescriptorSets = {			
-			vks::initializers::writeDescriptorSet(descriptorSets.instancedRocks, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	0, &uniformBuffers.scene.descriptor),	// Binding 0 : Vertex shader uniform buffer			
-			vks::initializers::writeDescriptorSet(descriptorSets.instancedRocks, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &textures.rocks.descriptor)	// Binding 1 : Color map 
-		};
-		vkUpdateDescriptorSets(device, writeDescriptorSets.size(), writeDescriptorSets.data(), 0, NULL);
-
-		// Planet
-		VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &descripotrSetAllocInfo, &descriptorSets.planet));
-		writeDescriptorSets = {
-			vks::initializers::writeDescriptorSet(descriptorSets.planet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	0, &uniformBuffers.scene.descriptor),			// Binding 0 : Vertex shader uniform buffer			
-			vks::initializers::writeDescriptorSet(descriptorSets.planet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &textures.planet.descriptor)			// Binding 1 : Color map 
-		};
-		vkUpdateDescriptorSets(device, writeDescriptorSets.size(), writeDescriptorSets.data(), 0, NULL);
+		descriptorSets.resize(uniformBuffers.scene.size());
+		for (size_t i = 0; i < descriptorSets.size(); i++) {
+			// Instanced rocks
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &descripotrSetAllocInfo, &descriptorSets[i].instancedRocks));
+			writeDescriptorSets = {
+				vks::initializers::writeDescriptorSet(descriptorSets[i].instancedRocks, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	0, &uniformBuffers.scene[i].descriptor),	// Binding 0 : Vertex shader uniform buffer
+				vks::initializers::writeDescriptorSet(descriptorSets[i].instancedRocks, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &textures.rocks.descriptor)	// Binding 1 : Color map
+			};
+			vkUpdateDescriptorSets(device, writeDescriptorSets.size(), writeDescriptorSets.data(), 0, NULL);
 
+			// Planet
+			VK_CHECK_RESULT(vkAllocateDescriptorSets(device, &descripotrSetAllocInfo, &descriptorSets[i].planet));
+			writeDescriptorSets = {
+				vks::initializers::writeDescriptorSet(descriptorSets[i].planet, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	0, &uniformBuffers.scene[i].descriptor),			// Binding 0 : Vertex shader uniform buffer
+				vks::initializers::writeDescriptorSet(descriptorSets[i].planet, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, &textures.planet.descriptor)			// Binding 1 : Color map
+			};
+			vkUpdateDescriptorSets(device, writeDescriptorSets.size(), writeDescriptorSets.data(), 0, NULL);
+		}
 	}
 
 	void preparePipelines()
@@ -396,20 +427,18 @@ public:
 		//	layout (location = 0) in vec3 inPos;		Per-Vertex
 		//	...
 		//	layout (location = 4) in vec3 instancePos;	Per-Instance
-		attributeDescriptions = {
-			// Per-vertex attributees
-			// These are advanced for each vertex fetched by the vertex shader
-			vks::initializers::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 0, VK_FORMAT_R32G32B32_SFLOAT, 0),					// Location 0: Position			
-			vks::initializers::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 1, VK_FORMAT_R32G32B32_SFLOAT, sizeof(float) * 3),	// Location 1: Normal			
-			vks::initializers::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 2, VK_FORMAT_R32G32_SFLOAT, sizeof(float) * 6),		// Location 2: Texture coordinates			
-			vks::initializers::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 3, VK_FORMAT_R32G32B32_SFLOAT, sizeof(float) * 8),	// Location 3: Color
-			// Per-Instance attributes
-			// These are fetched for each instance rendered
+		// Per-vertex attributes
+		// These are advanced for each vertex fetched by the vertex shader, formats and offsets are taken from the (float or quantized) vertex layout
+		// Location 0: Position, Location 1: Normal, Location 2: Texture coordinates, Location 3: Color
+		attributeDescriptions = vertexLayout.inputAttributeDescriptions(VERTEX_BUFFER_BIND_ID);
+		// Per-Instance attributes
+		// These are fetched for each instance rendered
+		attributeDescriptions.insert(attributeDescriptions.end(), {
 			vks::initializers::vertexInputAttributeDescription(INSTANCE_BUFFER_BIND_ID, 4, VK_FORMAT_R32G32B32_SFLOAT, 0),					// Location 4: Position
 			vks::initializers::vertexInputAttributeDescription(INSTANCE_BUFFER_BIND_ID, 5, VK_FORMAT_R32G32B32_SFLOAT, sizeof(float) * 3),	// Location 5: Rotation
 			vks::initializers::vertexInputAttributeDescription(INSTANCE_BUFFER_BIND_ID, 6, VK_FORMAT_R32_SFLOAT,sizeof(float) * 6),			// Location 6: Scale
 			vks::initializers::vertexInputAttributeDescription(INSTANCE_BUFFER_BIND_ID, 7, VK_FORMAT_R32_SINT, sizeof(float) * 7),			// Location 7: Texture array layer index
-		};
+		});
 		inputState.pVertexBindingDescriptions = bindingDescriptions.data();
 		inputState.pVertexAttributeDescriptions = attributeDescriptions.data();
 
@@ -528,14 +557,18 @@ public:
 
 	void prepareUniformBuffers()
 	{
-		VK_CHECK_RESULT(vulkanDevice->createBuffer(
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&uniformBuffers.scene,
-			sizeof(uboVS)));
-
-		// Map persistent
-		VK_CHECK_RESULT(uniformBuffers.scene.map());
+		// Command buffers are pre-recorded per swap chain image, so each image gets its own uniform buffer
+		uniformBuffers.scene.resize(swapChain.imageCount);
+		for (auto& uniformBuffer : uniformBuffers.scene) {
+			VK_CHECK_RESULT(vulkanDevice->createBuffer(
+				VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+				&uniformBuffer,
+				sizeof(uboVS)));
+
+			// Map persistent
+			VK_CHECK_RESULT(uniformBuffer.map());
+		}
 
 		updateUniformBuffer(true);
 	}
@@ -556,14 +589,15 @@ public:
 			uboVS.locSpeed += frameTimer * 0.35f;
 			uboVS.globSpeed += frameTimer * 0.01f;
 		}
-
-		memcpy(uniformBuffers.scene.mapped, &uboVS, sizeof(uboVS));
 	}
 
 	void draw()
 	{
 		VulkanExampleBase::prepareFrame();
 
+		// The uniform buffer of the acquired image is no longer in use by the GPU once prepareFrame returns
+		memcpy(uniformBuffers.scene[currentBuffer].mapped, &uboVS, sizeof(uboVS));
+
 		// Command buffer to be sumitted to the queue
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &drawCmdBuffers[currentBuffer];
@@ -610,6 +644,7 @@ public:
 	{
 		if (overlay->header("Statistics")) {
 			overlay->text("Instances: %d", INSTANCE_COUNT);
+			overlay->text("Vertex size: %d bytes", vertexLayout.stride());
 		}
 	}
 };
@@ -13,6 +13,8 @@
 #include <vector>
 #include <thread>
 #include <random>
+#include <chrono>
+#include <iomanip>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -23,6 +25,7 @@
 #include "vulkanexamplebase.h"
 
 #include "threadpool.hpp"
+#include "jobsystem.hpp"
 #include "frustum.hpp"
 
 #include "VulkanModel.hpp"
@@ -67,14 +70,28 @@ public:
 		VkCommandBuffer ui;
 	} secondaryCommandBuffers;
 
-	// Number of animated objects to be renderer
+	// Number of animated objects to be rendered
 	// by using threads and secondary command buffers
-	uint32_t numObjectsPerThread;
+	const std::vector<uint32_t> objectCounts = { 512, 2048, 8192, 32768, 100000 };
+	int32_t objectCountIndex = 0;
+	uint32_t visibleObjectCount = 0;
 
 	// Multi threaded stuff
 	// Max. number of concurrent threads
 	uint32_t numThreads;
 
+	// Scheduler used to distribute the command buffer generation across the threads
+	enum Scheduler { SCHEDULER_JOBSYSTEM = 0, SCHEDULER_THREADPOOL = 1 };
+	int32_t scheduler = SCHEDULER_JOBSYSTEM;
+
+	// CPU time for culling and generating the command buffers of the last frame
+	float recordTime = 0.0f;
+
+	// Compare both schedulers at all object counts after startup (-jobbenchmark)
+	bool schedulerBenchmark = false;
+	// Compare the scalar and batched frustum culling paths after startup (-cullbenchmark)
+	bool cullingBenchmark = false;
+
 	// Use push constants to update shader
 	// parameters on a per-thread base
 	struct ThreadPushConstantBlock {
@@ -91,20 +108,30 @@ public:
 		float scale;
 		float deltaT;
 		float stateT = 0;
-		bool visible = true;
 	};
 
+	// One push constant block per render object
+	std::vector<ThreadPushConstantBlock> pushConstBlocks;
+	// Per object information (position, rotation, etc.)
+	std::vector<ObjectData> objects;
+	// Bounding spheres of all objects in structure of arrays layout for batched (SIMD) frustum culling
+	vks::BoundingSpheres objectBounds;
+
 	struct ThreadData {
+		// The pool is reset as a whole once per frame
 		VkCommandPool commandPool;
-		// One command buffer per render object
-		std::vector<VkCommandBuffer> commandBuffer;
-		// One push constant block per render object
-		std::vector<ThreadPushConstantBlock> pushConstBlock;
-		// Per object information (position, rotation, etc.)
-		std::vector<ObjectData> objectData;
+		// Secondary command buffers recorded by this thread, grows on demand
+		std::vector<VkCommandBuffer> commandBuffers;
+		uint32_t usedCommandBuffers = 0;
+		uint32_t visibleObjects = 0;
+		// Indices of the visible objects of the range that is currently being recorded
+		std::vector<uint32_t> visibleIndices;
 	};
 	std::vector<ThreadData> threadData;
 
+	// Work stealing job system, the main thread also takes part in running jobs
+	vks::JobSystem jobSystem;
+	// Per-thread job queues, kept for comparison
 	vks::ThreadPool threadPool;
 
 	// Fence to wait for all command buffers to finish before
@@ -128,6 +155,14 @@ public:
 		rotation = { 0.0f, 37.5f, 0.0f };
 		title = "Multi threaded command buffer";
 		settings.overlay = true;
+		for (size_t i = 0; i < args.size(); i++) {
+			if (args[i] == std::string("-jobbenchmark")) {
+				schedulerBenchmark = true;
+			}
+			if (args[i] == std::string("-cullbenchmark")) {
+				cullingBenchmark = true;
+			}
+		}
 		// Get number of max. concurrrent threads
 		numThreads = std::thread::hardware_concurrency();
 		assert(numThreads > 0);
@@ -137,8 +172,9 @@ public:
 		std::cout << "numThreads = " << numThreads << std::endl;
 #endif
 		threadPool.setThreadCount(numThreads);
-		numObjectsPerThread = 512 / numThreads;
-		rndEngine.seed(benchmark.active ? 0 : (unsigned)time(nullptr));
+		// The job system uses the same number of threads (workers + main thread) so both schedulers can share the per-thread data
+		assert(jobSystem.getThreadCount() == std::max(1u, numThreads));
+		rndEngine.seed((benchmark.active || schedulerBenchmark) ? 0 : (unsigned)time(nullptr));
 	}
 
 	~VulkanExample()
@@ -154,7 +190,9 @@ public:
 		models.skysphere.destroy();
 
 		for (auto& thread : threadData) {
-			vkFreeCommandBuffers(device, thread.commandPool, thread.commandBuffer.size(), thread.commandBuffer.data());
+			if (!thread.commandBuffers.empty()) {
+				vkFreeCommandBuffers(device, thread.commandPool, static_cast<uint32_t>(thread.commandBuffers.size()), thread.commandBuffers.data());
+			}
 			vkDestroyCommandPool(device, thread.commandPool, nullptr);
 		}
 
@@ -167,6 +205,35 @@ public:
 		return rndDist(rndEngine);
 	}
 
+	// Generate the animated objects for the currently selected object count
+	void prepareObjects()
+	{
+		const uint32_t objectCount = objectCounts[objectCountIndex];
+		objects.resize(objectCount);
+		objectBounds.resize(objectCount);
+		pushConstBlocks.resize(objectCount);
+
+		// Spread larger object counts over a larger area to keep the density (and visible ratio) comparable
+		const float radius = 35.0f * std::sqrt((float)objectCount / 512.0f);
+
+		for (uint32_t i = 0; i < objectCount; i++) {
+			ObjectData &objectData = objects[i];
+			float theta = 2.0f * float(M_PI) * rnd(1.0f);
+			float phi = acos(1.0f - 2.0f * rnd(1.0f));
+			objectData.pos = glm::vec3(sin(phi) * cos(theta), 0.0f, cos(phi)) * radius;
+
+			objectData.rotation = glm::vec3(0.0f, rnd(360.0f), 0.0f);
+			objectData.deltaT = rnd(1.0f);
+			objectData.rotationDir = (rnd(100.0f) < 50.0f) ? 1.0f : -1.0f;
+			objectData.rotationSpeed = (2.0f + rnd(4.0f)) * objectData.rotationDir;
+			objectData.scale = 0.75f + rnd(0.5f);
+
+			objectBounds.set(i, objectData.pos, objectSphereDim * 0.5f);
+
+			pushConstBlocks[i].color = glm::vec3(rnd(1.0f), rnd(1.0f), rnd(1.0f));
+		}
+	}
+
 	// Create all threads and initialize shader push constants
 	void prepareMultiThreadedRenderer()
 	{
@@ -187,115 +254,153 @@ public:
 
 		threadData.resize(numThreads);
 
-		float maxX = std::floor(std::sqrt(numThreads * numObjectsPerThread));
-		uint32_t posX = 0;
-		uint32_t posZ = 0;
-
 		for (uint32_t i = 0; i < numThreads; i++) {
-			ThreadData *thread = &threadData[i];
-			
 			// Create one command pool for each thread
+			// Secondary command buffers are allocated on demand when recording (see nextCommandBuffer)
 			VkCommandPoolCreateInfo cmdPoolInfo = vks::initializers::commandPoolCreateInfo();
 			cmdPoolInfo.queueFamilyIndex = swapChain.queueNodeIndex;
-			cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-			VK_CHECK_RESULT(vkCreateCommandPool(device, &cmdPoolInfo, nullptr, &thread->commandPool));
+			cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			VK_CHECK_RESULT(vkCreateCommandPool(device, &cmdPoolInfo, nullptr, &threadData[i].commandPool));
+		}
 
-			// One secondary command buffer per object that is updated by this thread
-			thread->commandBuffer.resize(numObjectsPerThread);
-			// Generate secondary command buffers for each thread
+		prepareObjects();
+	}
+
+	// Returns an unused secondary command buffer from the thread's pool, allocates new ones if all have been used
+	VkCommandBuffer nextCommandBuffer(ThreadData &thread)
+	{
+		if (thread.usedCommandBuffers == thread.commandBuffers.size()) {
+			const uint32_t count = std::max(16u, static_cast<uint32_t>(thread.commandBuffers.size()));
+			thread.commandBuffers.resize(thread.commandBuffers.size() + count);
 			VkCommandBufferAllocateInfo secondaryCmdBufAllocateInfo =
 				vks::initializers::commandBufferAllocateInfo(
-					thread->commandPool,
+					thread.commandPool,
 					VK_COMMAND_BUFFER_LEVEL_SECONDARY,
-					thread->commandBuffer.size());
-			VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &secondaryCmdBufAllocateInfo, thread->commandBuffer.data()));
-
-			thread->pushConstBlock.resize(numObjectsPerThread);
-			thread->objectData.resize(numObjectsPerThread);
-
-			for (uint32_t j = 0; j < numObjectsPerThread; j++) {
-				float theta = 2.0f * float(M_PI) * rnd(1.0f);
-				float phi = acos(1.0f - 2.0f * rnd(1.0f));
-				thread->objectData[j].pos = glm::vec3(sin(phi) * cos(theta), 0.0f, cos(phi)) * 35.0f;
-
-				thread->objectData[j].rotation = glm::vec3(0.0f, rnd(360.0f), 0.0f);
-				thread->objectData[j].deltaT = rnd(1.0f);
-				thread->objectData[j].rotationDir = (rnd(100.0f) < 50.0f) ? 1.0f : -1.0f;
-				thread->objectData[j].rotationSpeed = (2.0f + rnd(4.0f)) * thread->objectData[j].rotationDir;
-				thread->objectData[j].scale = 0.75f + rnd(0.5f);
-
-				thread->pushConstBlock[j].color = glm::vec3(rnd(1.0f), rnd(1.0f), rnd(1.0f));
-			}
+					count);
+			VK_CHECK_RESULT(vkAllocateCommandBuffers(device, &secondaryCmdBufAllocateInfo, &thread.commandBuffers[thread.usedCommandBuffers]));
 		}
-	
+		return thread.commandBuffers[thread.usedCommandBuffers++];
 	}
 
-	// Builds the secondary command buffer for each thread
-	void threadRenderCode(uint32_t threadIndex, uint32_t cmdBufferIndex, VkCommandBufferInheritanceInfo inheritanceInfo)
+	// Updates the objects in the range [first, last) and records all visible objects into a single secondary command buffer
+	// Called from the threads of the selected scheduler, each thread only touches its own ThreadData
+	void threadRenderCode(uint32_t threadIndex, uint32_t first, uint32_t last, const VkCommandBufferInheritanceInfo &inheritanceInfo)
 	{
 		ThreadData *thread = &threadData[threadIndex];
-		ObjectData *objectData = &thread->objectData[cmdBufferIndex];
+		VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
 
-		// Check visibility against view frustum
-		objectData->visible = frustum.checkSphere(objectData->pos, objectSphereDim * 0.5f); 
-
-		if (!objectData->visible)
-		{
-			return;
+		// Check visibility of the whole range against the view frustum at once
+		if (thread->visibleIndices.size() < last - first) {
+			thread->visibleIndices.resize(last - first);
 		}
+		const uint32_t visibleCount = frustum.getVisibleSpheres(objectBounds, first, last - first, thread->visibleIndices.data());
+		thread->visibleObjects += visibleCount;
 
-		VkCommandBufferBeginInfo commandBufferBeginInfo = vks::initializers::commandBufferBeginInfo();
-		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
-		commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
+		for (uint32_t v = 0; v < visibleCount; v++) {
+			const uint32_t i = thread->visibleIndices[v];
+			ObjectData *objectData = &objects[i];
 
-		VkCommandBuffer cmdBuffer = thread->commandBuffer[cmdBufferIndex];
+			// Command buffer is only started once the first visible object of the range has been found
+			if (cmdBuffer == VK_NULL_HANDLE) {
+				cmdBuffer = nextCommandBuffer(*thread);
 
-		VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &commandBufferBeginInfo));
+				VkCommandBufferBeginInfo commandBufferBeginInfo = vks::initializers::commandBufferBeginInfo();
+				commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+				commandBufferBeginInfo.pInheritanceInfo = &inheritanceInfo;
 
-		VkViewport viewport = vks::initializers::viewport((float)width, (float)height, 0.0f, 1.0f);
-		vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+				VK_CHECK_RESULT(vkBeginCommandBuffer(cmdBuffer, &commandBufferBeginInfo));
 
-		VkRect2D scissor = vks::initializers::rect2D(width, height, 0, 0);
-		vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
+				VkViewport viewport = vks::initializers::viewport((float)width, (float)height, 0.0f, 1.0f);
+				vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+
+				VkRect2D scissor = vks::initializers::rect2D(width, height, 0, 0);
+				vkCmdSetScissor(cmdBuffer, 0, 1, &scissor);
 
-		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.phong);
+				vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.phong);
 
-		// Update
-		if (!paused) {
-			objectData->rotation.y += 2.5f * objectData->rotationSpeed * frameTimer;
-			if (objectData->rotation.y > 360.0f) {
-				objectData->rotation.y -= 360.0f;
+				VkDeviceSize offsets[1] = { 0 };
+				vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &models.ufo.vertices.buffer, offsets);
+				vkCmdBindIndexBuffer(cmdBuffer, models.ufo.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+			}
+
+			// Update
+			if (!paused) {
+				objectData->rotation.y += 2.5f * objectData->rotationSpeed * frameTimer;
+				if (objectData->rotation.y > 360.0f) {
+					objectData->rotation.y -= 360.0f;
+				}
+				objectData->deltaT += 0.15f * frameTimer;
+				if (objectData->deltaT > 1.0f)
+					objectData->deltaT -= 1.0f;
+				objectData->pos.y = sin(glm::radians(objectData->deltaT * 360.0f)) * 2.5f;
+				objectBounds.y[i] = objectData->pos.y;
 			}
-			objectData->deltaT += 0.15f * frameTimer;
-			if (objectData->deltaT > 1.0f)
-				objectData->deltaT -= 1.0f;
-			objectData->pos.y = sin(glm::radians(objectData->deltaT * 360.0f)) * 2.5f;
+
+			objectData->model = glm::translate(glm::mat4(1.0f), objectData->pos);
+			objectData->model = glm::rotate(objectData->model, -sinf(glm::radians(objectData->deltaT * 360.0f)) * 0.25f, glm::vec3(objectData->rotationDir, 0.0f, 0.0f));
+			objectData->model = glm::rotate(objectData->model, glm::radians(objectData->rotation.y), glm::vec3(0.0f, objectData->rotationDir, 0.0f));
+			objectData->model = glm::rotate(objectData->model, glm::radians(objectData->deltaT * 360.0f), glm::vec3(0.0f, objectData->rotationDir, 0.0f));
+			objectData->model = glm::scale(objectData->model, glm::vec3(objectData->scale));
+
+			pushConstBlocks[i].mvp = matrices.projection * matrices.view * objectData->model;
+
+			// Update shader push constant block
+			// Contains model view matrix
+			vkCmdPushConstants(
+				cmdBuffer,
+				pipelineLayout,
+				VK_SHADER_STAGE_VERTEX_BIT,
+				0,
+				sizeof(ThreadPushConstantBlock),
+				&pushConstBlocks[i]);
+
+			vkCmdDrawIndexed(cmdBuffer, models.ufo.indexCount, 1, 0, 0, 0);
 		}
 
-		objectData->model = glm::translate(glm::mat4(1.0f), objectData->pos);
-		objectData->model = glm::rotate(objectData->model, -sinf(glm::radians(objectData->deltaT * 360.0f)) * 0.25f, glm::vec3(objectData->rotationDir, 0.0f, 0.0f));
-		objectData->model = glm::rotate(objectData->model, glm::radians(objectData->rotation.y), glm::vec3(0.0f, objectData->rotationDir, 0.0f));
-		objectData->model = glm::rotate(objectData->model, glm::radians(objectData->deltaT * 360.0f), glm::vec3(0.0f, objectData->rotationDir, 0.0f));
-		objectData->model = glm::scale(objectData->model, glm::vec3(objectData->scale));
+		if (cmdBuffer != VK_NULL_HANDLE) {
+			VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
+		}
+	}
 
-		thread->pushConstBlock[cmdBufferIndex].mvp = matrices.projection * matrices.view * objectData->model;
+	// Culls all objects and generates the secondary command buffers for the visible ones using the selected scheduler
+	void updateObjectCommandBuffers(const VkCommandBufferInheritanceInfo &inheritanceInfo)
+	{
+		// Command buffers from the last frame are no longer in use (see draw), so the pools can be reset as a whole
+		for (auto& thread : threadData) {
+			VK_CHECK_RESULT(vkResetCommandPool(device, thread.commandPool, 0));
+			thread.usedCommandBuffers = 0;
+			thread.visibleObjects = 0;
+		}
 
-		// Update shader push constant block
-		// Contains model view matrix
-		vkCmdPushConstants(
-			cmdBuffer,
-			pipelineLayout,
-			VK_SHADER_STAGE_VERTEX_BIT,
-			0,
-			sizeof(ThreadPushConstantBlock),
-			&thread->pushConstBlock[cmdBufferIndex]);
+		const uint32_t objectCount = static_cast<uint32_t>(objects.size());
 
-		VkDeviceSize offsets[1] = { 0 };
-		vkCmdBindVertexBuffers(cmdBuffer, 0, 1, &models.ufo.vertices.buffer, offsets);
-		vkCmdBindIndexBuffer(cmdBuffer, models.ufo.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-		vkCmdDrawIndexed(cmdBuffer, models.ufo.indexCount, 1, 0, 0, 0);
+		if (scheduler == SCHEDULER_JOBSYSTEM) {
+			// The objects are split into chunks that are balanced across all threads via work stealing
+			// Each chunk records its visible objects into one command buffer of the thread that runs it
+			jobSystem.parallelFor(objectCount, [this, &inheritanceInfo](uint32_t first, uint32_t last) {
+				threadRenderCode(jobSystem.getThreadIndex(), first, last, inheritanceInfo);
+			}, 32);
+		}
+		else {
+			// Add a job to the thread's queue for each object to be rendered, each object gets its own command buffer
+			const uint32_t objectsPerThread = (objectCount + numThreads - 1) / numThreads;
+			for (uint32_t t = 0; t < numThreads; t++)
+			{
+				const uint32_t first = t * objectsPerThread;
+				const uint32_t last = std::min(first + objectsPerThread, objectCount);
+				for (uint32_t i = first; i < last; i++)
+				{
+					threadPool.threads[t]->addJob([=] { threadRenderCode(t, i, i + 1, inheritanceInfo); });
+				}
+			}
+
+			threadPool.wait();
+		}
 
-		VK_CHECK_RESULT(vkEndCommandBuffer(cmdBuffer));
+		visibleObjectCount = 0;
+		for (auto& thread : threadData) {
+			visibleObjectCount += thread.visibleObjects;
+		}
 	}
 
 	void updateSecondaryCommandBuffers(VkCommandBufferInheritanceInfo inheritanceInfo)
@@ -407,27 +512,16 @@ public:
 			commandBuffers.push_back(secondaryCommandBuffers.background);
 		}
 
-		// Add a job to the thread's queue for each object to be rendered
-		for (uint32_t t = 0; t < numThreads; t++)
-		{
-			for (uint32_t i = 0; i < numObjectsPerThread; i++)
-			{
-				threadPool.threads[t]->addJob([=] { threadRenderCode(t, i, inheritanceInfo); });
-			}
-		}
-			
-		threadPool.wait();
+		auto tStart = std::chrono::high_resolution_clock::now();
+
+		updateObjectCommandBuffers(inheritanceInfo);
 
-		// Only submit if object is within the current view frustum
-		for (uint32_t t = 0; t < numThreads; t++)
+		recordTime = (float)std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count();
+
+		// Only objects within the current view frustum have been recorded
+		for (auto& thread : threadData)
 		{
-			for (uint32_t i = 0; i < numObjectsPerThread; i++)
-			{
-				if (threadData[t].objectData[i].visible)
-				{
-					commandBuffers.push_back(threadData[t].commandBuffer[i]);
-				}
-			}
+			commandBuffers.insert(commandBuffers.end(), thread.commandBuffers.begin(), thread.commandBuffers.begin() + thread.usedCommandBuffers);
 		}
 
 		// Render ui last
@@ -436,7 +530,7 @@ public:
 		}
 
 		// Execute render commands from the secondary command buffer
-		vkCmdExecuteCommands(primaryCommandBuffer, commandBuffers.size(), commandBuffers.data());
+		vkCmdExecuteCommands(primaryCommandBuffer, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
 
 		vkCmdEndRenderPass(primaryCommandBuffer);
 
@@ -595,6 +689,127 @@ public:
 		VulkanExampleBase::submitFrame();
 	}
 
+	// Compares the CPU time for culling and recording the object command buffers of both schedulers at all object counts
+	// Command buffers are only recorded, not submitted, so the results are not affected by the GPU
+	void runSchedulerBenchmark()
+	{
+		const uint32_t warmupIterations = 10;
+		const uint32_t iterations = 100;
+
+		VkCommandBufferInheritanceInfo inheritanceInfo = vks::initializers::commandBufferInheritanceInfo();
+		inheritanceInfo.renderPass = renderPass;
+		inheritanceInfo.framebuffer = frameBuffers[0];
+
+		const int32_t selectedScheduler = scheduler;
+		const int32_t selectedObjectCountIndex = objectCountIndex;
+
+		std::cout << "Scheduler benchmark (" << numThreads << " threads, average of " << iterations << " iterations)" << std::endl;
+		std::cout << std::setw(10) << "objects" << std::setw(10) << "visible" << std::setw(16) << "thread pool ms" << std::setw(16) << "job system ms" << std::setw(10) << "speedup" << std::endl;
+
+		for (int32_t countIndex = 0; countIndex < static_cast<int32_t>(objectCounts.size()); countIndex++) {
+			objectCountIndex = countIndex;
+			prepareObjects();
+			double times[2];
+			for (int32_t s = 0; s < 2; s++) {
+				scheduler = (s == 0) ? SCHEDULER_THREADPOOL : SCHEDULER_JOBSYSTEM;
+				for (uint32_t i = 0; i < warmupIterations; i++) {
+					updateObjectCommandBuffers(inheritanceInfo);
+				}
+				auto tStart = std::chrono::high_resolution_clock::now();
+				for (uint32_t i = 0; i < iterations; i++) {
+					updateObjectCommandBuffers(inheritanceInfo);
+				}
+				times[s] = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - tStart).count() / iterations;
+			}
+			std::cout << std::fixed << std::setprecision(3);
+			std::cout << std::setw(10) << objects.size() << std::setw(10) << visibleObjectCount << std::setw(16) << times[0] << std::setw(16) << times[1] << std::setw(9) << times[0] / times[1] << "x" << std::endl;
+		}
+
+		scheduler = selectedScheduler;
+		objectCountIndex = selectedObjectCountIndex;
+		prepareObjects();
+	}
+
+	// Compares the throughput of the different frustum culling paths on a large set of random bounding volumes
+	// Culling is single threaded here to measure the raw per object cost
+	void runCullingBenchmark()
+	{
+		const uint32_t count = 1 << 20;
+		const uint32_t iterations = 20;
+		const float range = 128.0f;
+
+		vks::BoundingSpheres spheres;
+		vks::BoundingBoxes boxes;
+		std::vector<glm::vec4> aosSpheres(count);
+		spheres.resize(count);
+		boxes.resize(count);
+		for (uint32_t i = 0; i < count; i++) {
+			const glm::vec3 center(rnd(range) - range * 0.5f, rnd(range) - range * 0.5f, rnd(range) - range * 0.5f);
+			const float radius = 0.5f + rnd(2.0f);
+			aosSpheres[i] = glm::vec4(center, radius);
+			spheres.set(i, center, radius);
+			boxes.set(i, center - glm::vec3(radius), center + glm::vec3(radius));
+		}
+		std::vector<uint32_t> visibilityMask((count + 31) / 32);
+		std::vector<uint32_t> visibleIndices(count);
+		uint32_t visible = 0;
+
+		const bool simd = frustum.simd;
+
+		auto measure = [&](const std::string &name, std::function<uint32_t()> cull) {
+			visible = cull();
+			auto tStart = std::chrono::high_resolution_clock::now();
+			for (uint32_t i = 0; i < iterations; i++) {
+				visible = cull();
+			}
+			const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - tStart).count() / iterations;
+			std::cout << std::setw(28) << std::left << name << std::right << std::setw(10) << visible << std::setw(12) << seconds * 1000.0 << std::setw(14) << (count / seconds) / 1000000.0 << std::endl;
+		};
+
+		// Number of set bits in the visibility mask
+		auto countVisible = [&]() {
+			uint32_t n = 0;
+			for (auto bits : visibilityMask) {
+				for (; bits; bits &= bits - 1) {
+					n++;
+				}
+			}
+			return n;
+		};
+
+		std::cout << "Culling benchmark (" << count << " objects, instruction set: " << vks::Frustum::simdInstructionSet() << ")" << std::endl;
+		std::cout << std::fixed << std::setprecision(3);
+		std::cout << std::setw(28) << std::left << "method" << std::right << std::setw(10) << "visible" << std::setw(12) << "ms" << std::setw(14) << "Mobjects/s" << std::endl;
+
+		measure("spheres per object", [&]() {
+			uint32_t n = 0;
+			for (uint32_t i = 0; i < count; i++) {
+				n += frustum.checkSphere(glm::vec3(aosSpheres[i]), aosSpheres[i].w) ? 1 : 0;
+			}
+			return n;
+		});
+		frustum.simd = false;
+		measure("spheres batched scalar", [&]() { frustum.checkSpheres(spheres, 0, count, visibilityMask.data()); return countVisible(); });
+		frustum.simd = true;
+		measure("spheres batched SIMD mask", [&]() { frustum.checkSpheres(spheres, 0, count, visibilityMask.data()); return countVisible(); });
+		measure("spheres batched SIMD list", [&]() { return frustum.getVisibleSpheres(spheres, 0, count, visibleIndices.data()); });
+
+		measure("boxes per object", [&]() {
+			uint32_t n = 0;
+			for (uint32_t i = 0; i < count; i++) {
+				n += frustum.checkBox(glm::vec3(boxes.minX[i], boxes.minY[i], boxes.minZ[i]), glm::vec3(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i])) ? 1 : 0;
+			}
+			return n;
+		});
+		frustum.simd = false;
+		measure("boxes batched scalar", [&]() { frustum.checkBoxes(boxes, 0, count, visibilityMask.data()); return countVisible(); });
+		frustum.simd = true;
+		measure("boxes batched SIMD mask", [&]() { frustum.checkBoxes(boxes, 0, count, visibilityMask.data()); return countVisible(); });
+		measure("boxes batched SIMD list", [&]() { return frustum.getVisibleBoxes(boxes, 0, count, visibleIndices.data()); });
+
+		frustum.simd = simd;
+	}
+
 	void prepare()
 	{
 		VulkanExampleBase::prepare();
@@ -606,6 +821,12 @@ public:
 		preparePipelines();
 		prepareMultiThreadedRenderer();
 		updateMatrices();
+		if (schedulerBenchmark) {
+			runSchedulerBenchmark();
+		}
+		if (cullingBenchmark) {
+			runCullingBenchmark();
+		}
 		prepared = true;
 	}
 
@@ -625,9 +846,20 @@ public:
 	{
 		if (overlay->header("Statistics")) {
 			overlay->text("Active threads: %d", numThreads);
+			overlay->text("Visible objects: %d / %d", visibleObjectCount, (uint32_t)objects.size());
+			overlay->text("Record time: %.2f ms", recordTime);
 		}
 		if (overlay->header("Settings")) {
 			overlay->checkBox("Skybox", &displaySkybox);
+			overlay->comboBox("Scheduler", &scheduler, { "Job system", "Thread pool" });
+			overlay->checkBox("SIMD culling", &frustum.simd);
+			std::vector<std::string> objectCountNames;
+			for (auto count : objectCounts) {
+				objectCountNames.push_back(std::to_string(count));
+			}
+			if (overlay->comboBox("Objects", &objectCountIndex, objectCountNames)) {
+				prepareObjects();
+			}
 		}
 
 	}
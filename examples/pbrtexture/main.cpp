@@ -205,6 +205,8 @@ public:
 
 	void loadAssets()
 	{
+		// Collect all asset uploads into a single batch instead of waiting for each upload separately
+		vulkanDevice->uploadManager->beginBatch();
 		textures.environmentCube.loadFromFile(ASSET_PATH "textures/hdr/gcanyon_cube.ktx", VK_FORMAT_R16G16B16A16_SFLOAT, vulkanDevice, queue);
 		models.skybox.loadFromFile(ASSET_PATH "models/cube.obj", vertexLayout, 1.0f, vulkanDevice, queue);
 		// PBR model
@@ -214,6 +216,7 @@ public:
 		textures.aoMap.loadFromFile(ASSET_PATH "models/cerberus/ao.ktx", VK_FORMAT_R8_UNORM, vulkanDevice, queue);
 		textures.metallicMap.loadFromFile(ASSET_PATH "models/cerberus/metallic.ktx", VK_FORMAT_R8_UNORM, vulkanDevice, queue);
 		textures.roughnessMap.loadFromFile(ASSET_PATH "models/cerberus/roughness.ktx", VK_FORMAT_R8_UNORM, vulkanDevice, queue);
+		vulkanDevice->uploadManager->wait(vulkanDevice->uploadManager->endBatch());
 	}
 
 	void setupDescriptors()
@@ -44,6 +44,8 @@ class VulkanExample : public VulkanExampleBase
 public:
 	bool displayShadowMap = false;
 	bool filterPCF = true;
+	// Render the shadow map from the models' position only vertex streams
+	bool positionOnlyShadowPass = true;
 
 	// Keep depth range as small as possible
 	// for better shadow map precision
@@ -79,6 +81,10 @@ public:
 		VkPipelineVertexInputStateCreateInfo inputState;
 		std::vector<VkVertexInputBindingDescription> bindingDescriptions;
 		std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+		// Input state for the models' position only depth streams
+		VkPipelineVertexInputStateCreateInfo depthInputState;
+		VkVertexInputBindingDescription depthBindingDescription;
+		VkVertexInputAttributeDescription depthAttributeDescription;
 	} vertices;
 
 	struct {
@@ -107,6 +113,7 @@ public:
 	struct {
 		VkPipeline quad;
 		VkPipeline offscreen;
+		VkPipeline offscreenPositions;
 		VkPipeline sceneShadow;
 		VkPipeline sceneShadowPCF;
 	} pipelines;
@@ -170,6 +177,7 @@ public:
 
 		vkDestroyPipeline(device, pipelines.quad, nullptr);
 		vkDestroyPipeline(device, pipelines.offscreen, nullptr);
+		vkDestroyPipeline(device, pipelines.offscreenPositions, nullptr);
 		vkDestroyPipeline(device, pipelines.sceneShadow, nullptr);
 		vkDestroyPipeline(device, pipelines.sceneShadowPCF, nullptr);
 
@@ -365,13 +373,16 @@ public:
 
 		vkCmdBeginRenderPass(offscreenPass.commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
-		vkCmdBindPipeline(offscreenPass.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.offscreen);
+		vks::Model &scene = scenes[sceneIndex];
+		const bool positionsOnly = positionOnlyShadowPass && scene.hasDepthStream();
+		vkCmdBindPipeline(offscreenPass.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, positionsOnly ? pipelines.offscreenPositions : pipelines.offscreen);
 		vkCmdBindDescriptorSets(offscreenPass.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.offscreen, 0, 1, &descriptorSets.offscreen, 0, NULL);
 
 		VkDeviceSize offsets[1] = { 0 };
-		vkCmdBindVertexBuffers(offscreenPass.commandBuffer, VERTEX_BUFFER_BIND_ID, 1, &scenes[sceneIndex].vertices.buffer, offsets);
-		vkCmdBindIndexBuffer(offscreenPass.commandBuffer, scenes[sceneIndex].indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-		vkCmdDrawIndexed(offscreenPass.commandBuffer, scenes[sceneIndex].indexCount, 1, 0, 0, 0);
+		// The depth stream only contains positions and uses its own indices (with the same index count)
+		vkCmdBindVertexBuffers(offscreenPass.commandBuffer, VERTEX_BUFFER_BIND_ID, 1, positionsOnly ? &scene.depthStream.vertices.buffer : &scene.vertices.buffer, offsets);
+		vkCmdBindIndexBuffer(offscreenPass.commandBuffer, positionsOnly ? scene.depthStream.indices.buffer : scene.indices.buffer, 0, scene.indexType);
+		vkCmdDrawIndexed(offscreenPass.commandBuffer, scene.indexCount, 1, 0, 0, 0);
 
 		vkCmdEndRenderPass(offscreenPass.commandBuffer);
 
@@ -440,8 +451,12 @@ public:
 	void loadAssets()
 	{
 		scenes.resize(2);
-		scenes[0].loadFromFile(getAssetPath() + "models/vulkanscene_shadow.dae", vertexLayout, 4.0f, vulkanDevice, queue);
-		scenes[1].loadFromFile(getAssetPath() + "models/samplescene.dae", vertexLayout, 0.25f, vulkanDevice, queue);
+		// Also create position only vertex streams for the shadow map pass
+		vks::ModelCreateInfo modelCreateInfo(4.0f, 1.0f, 0.0f);
+		modelCreateInfo.depthStreamComponents = { vks::VERTEX_COMPONENT_POSITION };
+		scenes[0].loadFromFile(getAssetPath() + "models/vulkanscene_shadow.dae", vertexLayout, &modelCreateInfo, vulkanDevice, queue);
+		modelCreateInfo.scale = glm::vec3(0.25f);
+		scenes[1].loadFromFile(getAssetPath() + "models/samplescene.dae", vertexLayout, &modelCreateInfo, vulkanDevice, queue);
 		sceneNames = {"Vulkan scene", "Teapots and pillars" };
 	}
 
@@ -534,6 +549,15 @@ public:
 		vertices.inputState.pVertexBindingDescriptions = vertices.bindingDescriptions.data();
 		vertices.inputState.vertexAttributeDescriptionCount = vertices.attributeDescriptions.size();
 		vertices.inputState.pVertexAttributeDescriptions = vertices.attributeDescriptions.data();
+
+		// Position only depth stream
+		vertices.depthBindingDescription = vks::initializers::vertexInputBindingDescription(VERTEX_BUFFER_BIND_ID, sizeof(float) * 3, VK_VERTEX_INPUT_RATE_VERTEX);
+		vertices.depthAttributeDescription = vks::initializers::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 0, VK_FORMAT_R32G32B32_SFLOAT, 0);
+		vertices.depthInputState = vks::initializers::pipelineVertexInputStateCreateInfo();
+		vertices.depthInputState.vertexBindingDescriptionCount = 1;
+		vertices.depthInputState.pVertexBindingDescriptions = &vertices.depthBindingDescription;
+		vertices.depthInputState.vertexAttributeDescriptionCount = 1;
+		vertices.depthInputState.pVertexAttributeDescriptions = &vertices.depthAttributeDescription;
 	}
 
 	void setupDescriptorPool()
@@ -777,6 +801,9 @@ public:
 		pipelineCreateInfo.layout = pipelineLayouts.offscreen;
 		pipelineCreateInfo.renderPass = offscreenPass.renderPass;
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipelines.offscreen));
+		// Same shader reading the position only depth streams
+		pipelineCreateInfo.pVertexInputState = &vertices.depthInputState;
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipelines.offscreenPositions));
 	}
 
 	// Prepare and initialize uniform buffer containing shader uniforms
@@ -942,6 +969,14 @@ public:
 			if (overlay->checkBox("PCF filtering", &filterPCF)) {
 				buildCommandBuffers();
 			}
+			if (overlay->checkBox("Position only shadow pass", &positionOnlyShadowPass)) {
+				buildOffscreenCommandBuffer();
+			}
+		}
+		if (overlay->header("Statistics")) {
+			vks::Model &scene = scenes[sceneIndex];
+			const bool positionsOnly = positionOnlyShadowPass && scene.hasDepthStream();
+			overlay->text("Shadow pass vertex fetch: %.1f KB", (positionsOnly ? scene.depthStream.fetchSize : scene.depthStream.fullFetchSize) / 1024.0f);
 		}
 	}
 };
@@ -51,6 +51,8 @@ public:
 	int32_t displayDepthMapCascadeIndex = 0;
 	bool colorCascades = false;
 	bool filterPCF = false;
+	// Render the depth pass from the models' position and uv only vertex streams
+	bool useDepthStreams = true;
 
 	float cascadeSplitLambda = 0.95f;
 
@@ -122,6 +124,7 @@ public:
 		VkSemaphore semaphore;
 		VkPipelineLayout pipelineLayout;
 		VkPipeline pipeline;
+		VkPipeline pipelineDepthStreams;
 		vks::Buffer uniformBuffer;
 
 		struct UniformBlock {
@@ -184,6 +187,7 @@ public:
 
 		vkDestroyPipeline(device, pipelines.debugShadowMap, nullptr);
 		vkDestroyPipeline(device, depthPass.pipeline, nullptr);
+		vkDestroyPipeline(device, depthPass.pipelineDepthStreams, nullptr);
 		vkDestroyPipeline(device, pipelines.sceneShadow, nullptr);
 		vkDestroyPipeline(device, pipelines.sceneShadowPCF, nullptr);
 
@@ -215,12 +219,27 @@ public:
 		enabledFeatures.depthClamp = deviceFeatures.depthClamp;		
 	}
 
+	/*
+		Draw a single model, either from its full vertex buffer or from its depth stream
+		The depth pass selects the pipeline per model, as models without a depth stream (see vks::Model::hasDepthStream) need the full vertex layout
+	*/
+	void drawModel(VkCommandBuffer commandBuffer, vks::Model &model, bool depthPassDraw) {
+		const bool depthStream = depthPassDraw && useDepthStreams && model.hasDepthStream();
+		if (depthPassDraw) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthStream ? depthPass.pipelineDepthStreams : depthPass.pipeline);
+		}
+		const VkDeviceSize offsets[1] = { 0 };
+		// The depth stream has its own (reordered) indices with the same index count
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, depthStream ? &model.depthStream.vertices.buffer : &model.vertices.buffer, offsets);
+		vkCmdBindIndexBuffer(commandBuffer, depthStream ? model.depthStream.indices.buffer : model.indices.buffer, 0, model.indexType);
+		vkCmdDrawIndexed(commandBuffer, model.indexCount, 1, 0, 0, 0);
+	}
+
 	/*
 		Render the example scene with given command buffer, pipeline layout and dscriptor set
 		Used by the scene rendering and depth pass generation command buffer
 	*/
-	void renderScene(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VkDescriptorSet descriptorSet, uint32_t cascadeIndex = 0) {
-		const VkDeviceSize offsets[1] = { 0 };
+	void renderScene(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VkDescriptorSet descriptorSet, uint32_t cascadeIndex = 0, bool depthPassDraw = false) {
 		PushConstBlock pushConstBlock = { glm::vec4(0.0f), cascadeIndex };
 
 		std::array<VkDescriptorSet, 2> sets;
@@ -230,9 +249,7 @@ public:
 		sets[1] = materials[0].descriptorSet;
 		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 2, sets.data(), 0, NULL);
 		vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstBlock), &pushConstBlock);
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, &models[0].vertices.buffer, offsets);
-		vkCmdBindIndexBuffer(commandBuffer, models[0].indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-		vkCmdDrawIndexed(commandBuffer, models[0].indexCount, 1, 0, 0, 0);
+		drawModel(commandBuffer, models[0], depthPassDraw);
 
 		// Trees
 		const std::vector<glm::vec3> positions = {
@@ -249,15 +266,11 @@ public:
 
 			sets[1] = materials[1].descriptorSet;
 			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 2, sets.data(), 0, NULL);
-			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &models[1].vertices.buffer, offsets);
-			vkCmdBindIndexBuffer(commandBuffer, models[1].indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(commandBuffer, models[1].indexCount, 1, 0, 0, 0);
+			drawModel(commandBuffer, models[1], depthPassDraw);
 
 			sets[1] = materials[2].descriptorSet;
 			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 2, sets.data(), 0, NULL);
-			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &models[2].vertices.buffer, offsets);
-			vkCmdBindIndexBuffer(commandBuffer, models[2].indices.buffer, 0, VK_INDEX_TYPE_UINT32);
-			vkCmdDrawIndexed(commandBuffer, models[2].indexCount, 1, 0, 0, 0);
+			drawModel(commandBuffer, models[2], depthPassDraw);
 		}
 	}
 
@@ -439,8 +452,8 @@ public:
 		for (uint32_t i = 0; i < SHADOW_MAP_CASCADE_COUNT; i++) {
 			renderPassBeginInfo.framebuffer = cascades[i].frameBuffer;
 			vkCmdBeginRenderPass(depthPass.commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-			vkCmdBindPipeline(depthPass.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, depthPass.pipeline);
-			renderScene(depthPass.commandBuffer, depthPass.pipelineLayout, cascades[i].descriptorSet, i);
+			// The pipeline is bound per model (see drawModel)
+			renderScene(depthPass.commandBuffer, depthPass.pipelineLayout, cascades[i].descriptorSet, i, true);
 			vkCmdEndRenderPass(depthPass.commandBuffer);
 		}
 
@@ -507,9 +520,13 @@ public:
 		materials[2].texture.loadFromFile(getAssetPath() + "textures/oak_leafs.ktx", VK_FORMAT_R8G8B8A8_UNORM, vulkanDevice, queue);
 
 		models.resize(3);
-		models[0].loadFromFile(getAssetPath() + "models/terrain_simple.dae", vertexLayout, 1.0f, vulkanDevice, queue);
-		models[1].loadFromFile(getAssetPath() + "models/oak_trunk.dae", vertexLayout, 2.0f, vulkanDevice, queue);
-		models[2].loadFromFile(getAssetPath() + "models/oak_leafs.dae", vertexLayout, 2.0f, vulkanDevice, queue);
+		// The depth pass alpha tests against the leaf texture, so the depth streams also need to contain the uvs
+		vks::ModelCreateInfo modelCreateInfo(1.0f, 1.0f, 0.0f);
+		modelCreateInfo.depthStreamComponents = { vks::VERTEX_COMPONENT_POSITION, vks::VERTEX_COMPONENT_UV };
+		models[0].loadFromFile(getAssetPath() + "models/terrain_simple.dae", vertexLayout, &modelCreateInfo, vulkanDevice, queue);
+		modelCreateInfo.scale = glm::vec3(2.0f);
+		models[1].loadFromFile(getAssetPath() + "models/oak_trunk.dae", vertexLayout, &modelCreateInfo, vulkanDevice, queue);
+		models[2].loadFromFile(getAssetPath() + "models/oak_leafs.dae", vertexLayout, &modelCreateInfo, vulkanDevice, queue);
 	}
 
 	void setupLayoutsAndDescriptors() 
@@ -693,6 +710,16 @@ public:
 		pipelineCreateInfo.layout = depthPass.pipelineLayout;
 		pipelineCreateInfo.renderPass = depthPass.renderPass;
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &depthPass.pipeline));
+
+		// Depth map generation from the models' depth streams (tightly packed position and uv)
+		vertexInputBindings[0] = vks::initializers::vertexInputBindingDescription(0, sizeof(float) * 5, VK_VERTEX_INPUT_RATE_VERTEX);
+		vertexInputAttributes = {
+			vks::initializers::vertexInputAttributeDescription(0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0),					// Location 0: Position
+			vks::initializers::vertexInputAttributeDescription(0, 1, VK_FORMAT_R32G32_SFLOAT, sizeof(float) * 3),		// Location 1: UV
+		};
+		vertexInputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(vertexInputAttributes.size());
+		vertexInputState.pVertexAttributeDescriptions = vertexInputAttributes.data();
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &depthPass.pipelineDepthStreams));
 	}
 
 	void prepareUniformBuffers()
@@ -924,6 +951,18 @@ public:
 			if (overlay->checkBox("PCF filtering", &filterPCF)) {
 				buildCommandBuffers();
 			}
+			if (overlay->checkBox("Depth pass vertex streams", &useDepthStreams)) {
+				buildDepthPassCommandBuffer();
+			}
+		}
+		if (overlay->header("Statistics")) {
+			// Trees are drawn once per position and all models once per cascade
+			uint64_t fetchSize = 0;
+			for (uint32_t i = 0; i < models.size(); i++) {
+				const uint64_t modelFetchSize = (useDepthStreams && models[i].hasDepthStream()) ? models[i].depthStream.fetchSize : models[i].depthStream.fullFetchSize;
+				fetchSize += (i == 0) ? modelFetchSize : modelFetchSize * 5;
+			}
+			overlay->text("Depth pass vertex fetch: %.1f KB", (fetchSize * SHADOW_MAP_CASCADE_COUNT) / 1024.0f);
 		}
 	}
 };
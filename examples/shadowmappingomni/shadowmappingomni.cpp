@@ -38,6 +38,8 @@ class VulkanExample : public VulkanExampleBase
 {
 public:
 	bool displayCubeMap = false;
+	// Render the shadow cube map from the scene's position only vertex stream
+	bool positionOnlyShadowPass = true;
 
 	float zNear = 0.1f;
 	float zFar = 1024.0f;
@@ -46,6 +48,10 @@ public:
 		VkPipelineVertexInputStateCreateInfo inputState;
 		std::vector<VkVertexInputBindingDescription> bindingDescriptions;
 		std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+		// Input state for the position only depth stream
+		VkPipelineVertexInputStateCreateInfo depthInputState;
+		VkVertexInputBindingDescription depthBindingDescription;
+		VkVertexInputAttributeDescription depthAttributeDescription;
 	} vertices;
 
 	// Vertex layout for the models
@@ -85,6 +91,7 @@ public:
 	struct {
 		VkPipeline scene;
 		VkPipeline offscreen;
+		VkPipeline offscreenPositions;
 		VkPipeline cubeMap;
 	} pipelines;
 
@@ -162,6 +169,7 @@ public:
 		// Pipelibes
 		vkDestroyPipeline(device, pipelines.scene, nullptr);
 		vkDestroyPipeline(device, pipelines.offscreen, nullptr);
+		vkDestroyPipeline(device, pipelines.offscreenPositions, nullptr);
 		vkDestroyPipeline(device, pipelines.cubeMap, nullptr);
 
 		vkDestroyPipelineLayout(device, pipelineLayouts.scene, nullptr);
@@ -430,12 +438,14 @@ public:
 			sizeof(glm::mat4),
 			&viewMatrix);
 
-		vkCmdBindPipeline(offscreenPass.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines.offscreen);
+		const bool positionsOnly = positionOnlyShadowPass && models.scene.hasDepthStream();
+		vkCmdBindPipeline(offscreenPass.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, positionsOnly ? pipelines.offscreenPositions : pipelines.offscreen);
 		vkCmdBindDescriptorSets(offscreenPass.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayouts.offscreen, 0, 1, &descriptorSets.offscreen, 0, NULL);
 
 		VkDeviceSize offsets[1] = { 0 };
-		vkCmdBindVertexBuffers(offscreenPass.commandBuffer, VERTEX_BUFFER_BIND_ID, 1, &models.scene.vertices.buffer, offsets);
-		vkCmdBindIndexBuffer(offscreenPass.commandBuffer, models.scene.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+		// The depth stream only contains positions and uses its own indices (with the same index count)
+		vkCmdBindVertexBuffers(offscreenPass.commandBuffer, VERTEX_BUFFER_BIND_ID, 1, positionsOnly ? &models.scene.depthStream.vertices.buffer : &models.scene.vertices.buffer, offsets);
+		vkCmdBindIndexBuffer(offscreenPass.commandBuffer, positionsOnly ? models.scene.depthStream.indices.buffer : models.scene.indices.buffer, 0, models.scene.indexType);
 		vkCmdDrawIndexed(offscreenPass.commandBuffer, models.scene.indexCount, 1, 0, 0, 0);
 
 		vkCmdEndRenderPass(offscreenPass.commandBuffer);
@@ -609,7 +619,10 @@ public:
 	void loadAssets()
 	{
 		models.skybox.loadFromFile(getAssetPath() + "models/cube.obj", vertexLayout, 2.0f, vulkanDevice, queue);
-		models.scene.loadFromFile(getAssetPath() + "models/shadowscene_fire.dae", vertexLayout, 2.0f, vulkanDevice, queue);
+		// Also create a position only vertex stream for the shadow cube map pass
+		vks::ModelCreateInfo modelCreateInfo(2.0f, 1.0f, 0.0f);
+		modelCreateInfo.depthStreamComponents = { vks::VERTEX_COMPONENT_POSITION };
+		models.scene.loadFromFile(getAssetPath() + "models/shadowscene_fire.dae", vertexLayout, &modelCreateInfo, vulkanDevice, queue);
 	}
 
 	void setupVertexDescriptions()
@@ -658,6 +671,15 @@ public:
 		vertices.inputState.pVertexBindingDescriptions = vertices.bindingDescriptions.data();
 		vertices.inputState.vertexAttributeDescriptionCount = vertices.attributeDescriptions.size();
 		vertices.inputState.pVertexAttributeDescriptions = vertices.attributeDescriptions.data();
+
+		// Position only depth stream
+		vertices.depthBindingDescription = vks::initializers::vertexInputBindingDescription(VERTEX_BUFFER_BIND_ID, sizeof(float) * 3, VK_VERTEX_INPUT_RATE_VERTEX);
+		vertices.depthAttributeDescription = vks::initializers::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 0, VK_FORMAT_R32G32B32_SFLOAT, 0);
+		vertices.depthInputState = vks::initializers::pipelineVertexInputStateCreateInfo();
+		vertices.depthInputState.vertexBindingDescriptionCount = 1;
+		vertices.depthInputState.pVertexBindingDescriptions = &vertices.depthBindingDescription;
+		vertices.depthInputState.vertexAttributeDescriptionCount = 1;
+		vertices.depthInputState.pVertexAttributeDescriptions = &vertices.depthAttributeDescription;
 	}
 
 	void setupDescriptorPool()
@@ -917,6 +939,9 @@ public:
 		pipelineCreateInfo.layout = pipelineLayouts.offscreen;
 		pipelineCreateInfo.renderPass = offscreenPass.renderPass;
 		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipelines.offscreen));
+		// Same shader reading the position only depth stream
+		pipelineCreateInfo.pVertexInputState = &vertices.depthInputState;
+		VK_CHECK_RESULT(vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineCreateInfo, nullptr, &pipelines.offscreenPositions));
 	}
 
 	// Prepare and initialize uniform buffer containing shader uniforms
@@ -1046,6 +1071,14 @@ public:
 			if (overlay->checkBox("Display shadow cube render target", &displayCubeMap)) {
 				buildCommandBuffers();
 			}
+			if (overlay->checkBox("Position only shadow pass", &positionOnlyShadowPass)) {
+				buildOffscreenCommandBuffer();
+			}
+		}
+		if (overlay->header("Statistics")) {
+			// The scene is drawn once per cube map face
+			const bool positionsOnly = positionOnlyShadowPass && models.scene.hasDepthStream();
+			overlay->text("Shadow pass vertex fetch: %.1f KB", ((positionsOnly ? models.scene.depthStream.fetchSize : models.scene.depthStream.fullFetchSize) * 6) / 1024.0f);
 		}
 	}
 };
@@ -12,6 +12,9 @@
 #include <assert.h>
 #include <vector>
 #include <map>
+#include <chrono>
+#include <iomanip>
+#include <random>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -29,6 +32,7 @@
 #include "VulkanBuffer.hpp"
 #include "VulkanTexture.hpp"
 #include "VulkanModel.hpp"
+#include "VulkanglTFModel.hpp"
 
 #define VERTEX_BUFFER_BIND_ID 0
 #define ENABLE_VALIDATION false
@@ -403,6 +407,9 @@ public:
 
 	float runningTime = 0.0f;
 
+	// Measure glTF animation blending throughput after startup (-posebenchmark)
+	bool poseBenchmark = false;
+
 	VulkanExample() : VulkanExampleBase(ENABLE_VALIDATION)
 	{
 		zoom = -150.0f;
@@ -412,6 +419,11 @@ public:
 		title = "Skeletal animation (GPU skinning)";
 		cameraPos = { 0.0f, 0.0f, 12.0f };
 		settings.overlay = true;
+		for (size_t i = 0; i < args.size(); i++) {
+			if (args[i] == std::string("-posebenchmark")) {
+				poseBenchmark = true;
+			}
+		}
 	}
 
 	~VulkanExample()
@@ -992,9 +1004,91 @@ public:
 		setupDescriptorPool();
 		setupDescriptorSet();
 		buildCommandBuffers();
+		if (poseBenchmark) {
+			runPoseBenchmark();
+		}
 		prepared = true;
 	}
 
+	// Measures the number of poses per second the glTF animation stage can sample and blend for a crowd of characters
+	// Requires the CesiumMan model from the separate asset pack (see data/README.md)
+	void runPoseBenchmark()
+	{
+		const std::string filename = getAssetPath() + "models/gltf/glTF-Embedded/CesiumMan.gltf";
+		if (!vks::tools::fileExists(filename)) {
+			std::cerr << "Pose benchmark: " << filename << " not found, download the asset pack (see data/README.md)" << std::endl;
+			return;
+		}
+		vkglTF::Model model;
+		model.loadFromFile(filename, vulkanDevice, queue);
+		if (model.animations.empty()) {
+			std::cerr << "Pose benchmark: model contains no animations" << std::endl;
+			return;
+		}
+
+		const uint32_t characterCount = 1000;
+		const uint32_t frameCount = 100;
+		const float frameTime = 1.0f / 60.0f;
+		const vkglTF::Animation &animation = model.animations[0];
+		const float duration = animation.end - animation.start;
+
+		// Each character plays the animation at a random offset
+		std::default_random_engine rndEngine(0);
+		std::uniform_real_distribution<float> rndDist(0.0f, duration);
+		std::vector<float> offsets(characterCount);
+		for (auto& offset : offsets) {
+			offset = rndDist(rndEngine);
+		}
+
+		// Additive layer restricted to the upper half of the skeleton
+		vkglTF::Node *maskRoot = model.linearNodes.front();
+		if (!model.skins.empty() && !model.skins[0]->joints.empty()) {
+			maskRoot = model.skins[0]->joints[model.skins[0]->joints.size() / 2];
+		}
+
+		// Base layer cross-fades into the same clip at a different phase, the third layer adds a masked additive motion
+		std::vector<vkglTF::AnimationLayer> layers(3);
+		layers[2].weight = 0.5f;
+		layers[2].blendMode = vkglTF::AnimationLayer::BLEND_ADDITIVE;
+		layers[2].mask = model.getNodeMask(maskRoot);
+		vkglTF::AnimationPose pose;
+
+		std::cout << "Pose benchmark (" << model.transforms.size() << " nodes, " << animation.channels.size() << " channels, " << characterCount << " characters x " << frameCount << " frames)" << std::endl;
+		std::cout << std::fixed << std::setprecision(3);
+		std::cout << std::setw(36) << std::left << "evaluation" << std::right << std::setw(12) << "ms/frame" << std::setw(14) << "poses/s" << std::endl;
+
+		auto measure = [&](const std::string &name, uint32_t layerCount, bool apply) {
+			// Every character has its own layers, so the key cursors follow that character's playback instead of being reset by the others
+			std::vector<std::vector<vkglTF::AnimationLayer>> characterLayers(characterCount, std::vector<vkglTF::AnimationLayer>(layers.begin(), layers.begin() + layerCount));
+			auto tStart = std::chrono::high_resolution_clock::now();
+			for (uint32_t frame = 0; frame < frameCount; frame++) {
+				for (uint32_t c = 0; c < characterCount; c++) {
+					std::vector<vkglTF::AnimationLayer> &activeLayers = characterLayers[c];
+					const float t = offsets[c] + frame * frameTime;
+					activeLayers[0].time = animation.start + fmod(t, duration);
+					if (layerCount > 1) {
+						activeLayers[1].time = animation.start + fmod(t + duration * 0.5f, duration);
+						activeLayers[1].weight = 0.5f + 0.5f * sin(t);
+					}
+					if (layerCount > 2) {
+						activeLayers[2].time = animation.start + fmod(t * 2.0f, duration);
+					}
+					model.blendAnimations(activeLayers, pose);
+					if (apply) {
+						model.applyPose(pose);
+					}
+				}
+			}
+			const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - tStart).count();
+			std::cout << std::setw(36) << std::left << name << std::right << std::setw(12) << seconds * 1000.0 / frameCount << std::setw(14) << (characterCount * frameCount) / seconds << std::endl;
+		};
+
+		measure("1 layer", 1, false);
+		measure("2 layers (cross-fade)", 2, false);
+		measure("3 layers (cross-fade + additive)", 3, false);
+		measure("3 layers + apply (world matrices)", 3, true);
+	}
+
 	virtual void render()
 	{
 		if (!prepared)
@@ -35,12 +35,13 @@ class VulkanExample : public VulkanExampleBase
 public:
 
 	// Vertex layout for the models
-	vks::VertexLayout vertexLayout = vks::VertexLayout({
+	// Stride and attribute offsets are compile time constants and the models are loaded with a vertex writer specialized for this layout
+	typedef vks::StaticVertexLayout<
 		vks::VERTEX_COMPONENT_POSITION,
 		vks::VERTEX_COMPONENT_NORMAL,
 		vks::VERTEX_COMPONENT_UV,
-		vks::VERTEX_COMPONENT_COLOR,
-	});
+		vks::VERTEX_COMPONENT_COLOR
+	> VertexLayout;
 
 	struct DemoModel
 	{
@@ -52,7 +53,7 @@ public:
 			VkDeviceSize offsets[1] = { 0 };
 			vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, *pipeline);
 			vkCmdBindVertexBuffers(cmdBuffer, VERTEX_BUFFER_BIND_ID, 1, &model.vertices.buffer, offsets);
-			vkCmdBindIndexBuffer(cmdBuffer, model.indices.buffer, 0, VK_INDEX_TYPE_UINT32);
+			vkCmdBindIndexBuffer(cmdBuffer, model.indices.buffer, 0, model.indexType);
 			vkCmdDrawIndexed(cmdBuffer, model.indexCount, 1, 0, 0, 0);
 		}
 	};
@@ -88,6 +89,9 @@ public:
 
 	glm::vec4 lightPos = glm::vec4(1.0f, 2.0f, 0.0f, 0.0f);
 
+	// Run the mesh optimizer on the loaded models (-optimizemeshes), their vertex cache statistics are printed if -verbose is also set
+	bool optimizeMeshes = false;
+
 	VulkanExample() : VulkanExampleBase(ENABLE_VALIDATION)
 	{
 		zoom = -3.75f;
@@ -95,6 +99,11 @@ public:
 		rotation = glm::vec3(15.0f, 0.f, 0.0f);
 		title = "Vulkan Demo Scene - (c) 2016 by Sascha Willems";
 		settings.overlay = true;
+		for (size_t i = 0; i < args.size(); i++) {
+			if (args[i] == std::string("-optimizemeshes")) {
+				optimizeMeshes = true;
+			}
+		}
 	}
 
 	~VulkanExample()
@@ -129,7 +138,10 @@ public:
 			if (modelFiles[i] != "cube.obj") {
 				modelCreateInfo.center.y += 1.15f;
 			}
-			model.model.loadFromFile(getAssetPath() + "models/" + modelFiles[i], vertexLayout, &modelCreateInfo, vulkanDevice, queue);
+			if (optimizeMeshes) {
+				modelCreateInfo.optimizeFlags = vks::meshopt::OPTIMIZE_ALL;
+			}
+			model.model.loadFromFile(getAssetPath() + "models/" + modelFiles[i], VertexLayout(), &modelCreateInfo, vulkanDevice, queue);
 			demoModels.push_back(model);
 		}
 		// Textures
@@ -336,16 +348,12 @@ public:
 		pipelineCreateInfo.pStages = shaderStages.data();
 
 		VkVertexInputBindingDescription vertexInputBinding =
-			vks::initializers::vertexInputBindingDescription(VERTEX_BUFFER_BIND_ID, vertexLayout.stride(), VK_VERTEX_INPUT_RATE_VERTEX);
+			vks::initializers::vertexInputBindingDescription(VERTEX_BUFFER_BIND_ID, VertexLayout::stride(), VK_VERTEX_INPUT_RATE_VERTEX);
 
 		// Attribute descriptions
 		// Describes memory layout and shader positions
-		std::vector<VkVertexInputAttributeDescription> vertexInputAttributes = {
-			vks::initializers::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 0, VK_FORMAT_R32G32B32_SFLOAT, 0),						// Location 0: Position		
-			vks::initializers::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 1, VK_FORMAT_R32G32B32_SFLOAT, sizeof(float) * 3),		// Location 1: Normal		
-			vks::initializers::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 2, VK_FORMAT_R32G32_SFLOAT, sizeof(float) * 5),			// Location 2: Texture coordinates		
-			vks::initializers::vertexInputAttributeDescription(VERTEX_BUFFER_BIND_ID, 3, VK_FORMAT_R32G32B32_SFLOAT, sizeof(float) * 8),		// Location 3: Color		
-		};
+		// Location 0: Position, Location 1: Normal, Location 2: Texture coordinates, Location 3: Color
+		std::vector<VkVertexInputAttributeDescription> vertexInputAttributes = VertexLayout::inputAttributeDescriptions(VERTEX_BUFFER_BIND_ID);
 
 		VkPipelineVertexInputStateCreateInfo vertexInputState = vks::initializers::pipelineVertexInputStateCreateInfo();
 		vertexInputState.vertexBindingDescriptionCount = 1;